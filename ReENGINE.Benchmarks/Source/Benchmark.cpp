@@ -0,0 +1,291 @@
+/*
+ * Benchmark.cpp
+ *
+ * This source file defines the microbenchmark harness declared in the
+ * Benchmark.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace Re
+{
+	namespace Benchmarks
+	{
+		namespace
+		{
+			struct ValidationInfo
+			{
+				const utf8* Name;
+				ValidationFunction Function;
+			};
+
+			std::vector<BenchmarkInfo>& GetRegistry()
+			{
+				static std::vector<BenchmarkInfo> registry;
+				return registry;
+			}
+
+			std::vector<ValidationInfo>& GetValidations()
+			{
+				static std::vector<ValidationInfo> validations;
+				return validations;
+			}
+
+			bool MatchesFilter(const utf8* InName, const std::string& InFilter)
+			{
+				return InFilter.empty() || std::string(InName).find(InFilter) != std::string::npos;
+			}
+
+			bool RunValidations(const std::string& InFilter)
+			{
+				u32 failures = 0;
+				for (const ValidationInfo& info : GetValidations())
+				{
+					if (!MatchesFilter(info.Name, InFilter))
+						continue;
+
+					if (!info.Function())
+					{
+						fprintf(stderr, "Validation failed: %s\n", info.Name);
+						++failures;
+					}
+				}
+
+				if (failures)
+					fprintf(stderr, "%u validation(s) failed, skipping benchmarks.\n", failures);
+
+				return failures == 0;
+			}
+
+			f64 TimeFunction(BenchmarkFunction InFunction, u64 InIterations)
+			{
+				auto start = std::chrono::steady_clock::now();
+				InFunction(InIterations);
+				auto end = std::chrono::steady_clock::now();
+
+				return std::chrono::duration<f64>(end - start).count();
+			}
+
+			u64 CalibrateIterations(BenchmarkFunction InFunction, f64 InMinimumSampleTime)
+			{
+				// Grow the iteration count until a single sample lasts long enough to be timed
+				// accurately. This also serves as the warm-up for caches and branch predictors.
+				u64 iterations = 1;
+				while (true)
+				{
+					f64 elapsed = TimeFunction(InFunction, iterations);
+					if (elapsed >= InMinimumSampleTime)
+						return iterations;
+
+					f64 factor = elapsed > 0.0 ? 1.4 * InMinimumSampleTime / elapsed : 10.0;
+					factor = std::min(std::max(factor, 2.0), 10.0);
+					iterations = static_cast<u64>(iterations * factor);
+				}
+			}
+
+			BenchmarkResult RunBenchmark(const BenchmarkInfo& InInfo, const BenchmarkOptions& InOptions)
+			{
+				BenchmarkResult result = {};
+				result.Name = InInfo.Name;
+				result.Iterations = CalibrateIterations(InInfo.Function, InOptions.MinimumSampleTime);
+				result.Samples = std::max(InOptions.Samples, 1u);
+
+				// Collect the samples as nanoseconds per operation.
+				std::vector<f64> samples(result.Samples);
+				for (u32 i = 0; i < result.Samples; ++i)
+					samples[i] = TimeFunction(InInfo.Function, result.Iterations) * 1e9 / result.Iterations;
+
+				std::sort(samples.begin(), samples.end());
+				usize middle = samples.size() / 2;
+				result.Median = samples.size() % 2 ? samples[middle] : 0.5 * (samples[middle - 1] + samples[middle]);
+				result.Minimum = samples.front();
+
+				f64 sum = 0.0;
+				for (f64 sample : samples)
+					sum += sample;
+				result.Mean = sum / samples.size();
+
+				f64 squares = 0.0;
+				for (f64 sample : samples)
+					squares += (sample - result.Mean) * (sample - result.Mean);
+				result.Deviation = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0.0;
+
+				// Report bytes per second when the benchmark processes memory, operations per second otherwise.
+				f64 operationsPerSecond = result.Median > 0.0 ? 1e9 / result.Median : 0.0;
+				result.Throughput = InInfo.BytesPerOperation ? operationsPerSecond * InInfo.BytesPerOperation : operationsPerSecond;
+				return result;
+			}
+
+			void FormatThroughput(utf8* OutBuffer, usize InSize, f64 InThroughput, bool InBytes)
+			{
+				const utf8* units = InBytes ? "KMGT" : "kMGT";
+				const utf8* suffix = InBytes ? "B/s" : "op/s";
+				f64 divisor = InBytes ? 1024.0 : 1000.0;
+
+				i32 unit = -1;
+				while (InThroughput >= divisor && unit < 3)
+				{
+					InThroughput /= divisor;
+					++unit;
+				}
+
+				if (unit < 0)
+					snprintf(OutBuffer, InSize, "%.2f %s", InThroughput, suffix);
+				else if (InBytes)
+					snprintf(OutBuffer, InSize, "%.2f %ci%s", InThroughput, units[unit], suffix);
+				else
+					snprintf(OutBuffer, InSize, "%.2f %c%s", InThroughput, units[unit], suffix);
+			}
+
+			bool ReadBaseline(const std::string& InPath, std::map<std::string, f64>* OutMedians)
+			{
+				boost::property_tree::ptree tree;
+				try
+				{
+					boost::property_tree::read_json(InPath, tree);
+				}
+				catch (const boost::property_tree::json_parser_error& error)
+				{
+					fprintf(stderr, "Failed to read baseline %s: %s\n", InPath.c_str(), error.what());
+					return false;
+				}
+
+				auto benchmarks = tree.get_child_optional("benchmarks");
+				if (!benchmarks)
+					return true;
+
+				for (const auto& entry : *benchmarks)
+					(*OutMedians)[entry.first] = entry.second.get<f64>("ns_per_op", 0.0);
+
+				return true;
+			}
+
+			bool WriteBaseline(const std::string& InPath, const std::vector<BenchmarkResult>& InResults,
+				const std::vector<BenchmarkInfo>& InInfos)
+			{
+				FILE* file = fopen(InPath.c_str(), "w");
+				if (!file)
+				{
+					fprintf(stderr, "Failed to write baseline %s.\n", InPath.c_str());
+					return false;
+				}
+
+				fprintf(file, "{\n  \"benchmarks\": {\n");
+				for (usize i = 0; i < InResults.size(); ++i)
+				{
+					const BenchmarkResult& result = InResults[i];
+					fprintf(file, "    \"%s\": { \"ns_per_op\": %.4f, \"deviation\": %.4f, \"minimum\": %.4f, \"%s\": %.2f, \"iterations\": %llu, \"samples\": %u }%s\n",
+						result.Name.c_str(), result.Median, result.Deviation, result.Minimum,
+						InInfos[i].BytesPerOperation ? "bytes_per_second" : "operations_per_second", result.Throughput,
+						static_cast<unsigned long long>(result.Iterations), result.Samples, i + 1 < InResults.size() ? "," : "");
+				}
+				fprintf(file, "  }\n}\n");
+
+				fclose(file);
+				return true;
+			}
+		}
+
+		bool Register(const utf8* InName, BenchmarkFunction InFunction, u64 InBytesPerOperation)
+		{
+			GetRegistry().push_back(BenchmarkInfo { InName, InFunction, InBytesPerOperation });
+			return true;
+		}
+
+		bool RegisterValidation(const utf8* InName, ValidationFunction InFunction)
+		{
+			GetValidations().push_back(ValidationInfo { InName, InFunction });
+			return true;
+		}
+
+		i32 RunBenchmarks(const BenchmarkOptions& InOptions)
+		{
+			// Timing code that produces wrong results is meaningless, so validate it first.
+			if (!RunValidations(InOptions.Filter))
+				return 1;
+
+			// Select the benchmarks to run, sorted by name so the report is stable across builds.
+			std::vector<BenchmarkInfo> selected;
+			for (const BenchmarkInfo& info : GetRegistry())
+			{
+				if (MatchesFilter(info.Name, InOptions.Filter))
+					selected.push_back(info);
+			}
+
+			std::sort(selected.begin(), selected.end(), [](const BenchmarkInfo& InLeft, const BenchmarkInfo& InRight) {
+				return std::string(InLeft.Name) < std::string(InRight.Name);
+			});
+
+			std::map<std::string, f64> baseline;
+			bool hasBaseline = !InOptions.BaselinePath.empty();
+			if (hasBaseline && !ReadBaseline(InOptions.BaselinePath, &baseline))
+				return 1;
+
+			printf("%-48s %12s %8s %12s %16s %s\n", "Benchmark", "ns/op", "+/-", "min ns/op", "Throughput", hasBaseline ? "  vs. Baseline" : "");
+
+			u32 regressions = 0;
+			std::vector<BenchmarkResult> results;
+			for (const BenchmarkInfo& info : selected)
+			{
+				BenchmarkResult result = RunBenchmark(info, InOptions);
+				results.push_back(result);
+
+				utf8 throughput[32];
+				FormatThroughput(throughput, sizeof(throughput), result.Throughput, info.BytesPerOperation != 0);
+
+				f64 variation = result.Median > 0.0 ? 100.0 * result.Deviation / result.Median : 0.0;
+				printf("%-48s %12.2f %7.1f%% %12.2f %16s", info.Name, result.Median, variation, result.Minimum, throughput);
+
+				// A change only counts when it exceeds both the threshold and three times the measured noise.
+				auto reference = baseline.find(result.Name);
+				if (hasBaseline && reference != baseline.end() && reference->second > 0.0)
+				{
+					f64 delta = (result.Median - reference->second) / reference->second;
+					f64 tolerance = std::max(InOptions.Threshold, 3.0 * variation / 100.0);
+
+					const utf8* verdict = "";
+					if (delta > tolerance)
+					{
+						verdict = "  REGRESSION";
+						++regressions;
+					}
+					else if (delta < -tolerance)
+					{
+						verdict = "  improved";
+					}
+
+					printf("  %+7.1f%%%s", 100.0 * delta, verdict);
+				}
+				else if (hasBaseline)
+				{
+					printf("  (new)");
+				}
+
+				printf("\n");
+				fflush(stdout);
+			}
+
+			if (!InOptions.OutputPath.empty() && !WriteBaseline(InOptions.OutputPath, results, selected))
+				return 1;
+
+			if (regressions)
+			{
+				printf("\n%u benchmark(s) regressed by more than %.0f%% against %s.\n", regressions, 100.0 * InOptions.Threshold, InOptions.BaselinePath.c_str());
+				return 1;
+			}
+
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,206 @@
+/*
+ * Benchmark.hpp
+ *
+ * This header file declares the microbenchmark harness used by the
+ * ReENGINE.Benchmarks target, which times registered benchmarks, reports
+ * their statistics and compares them against a stored baseline.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Re
+{
+	namespace Benchmarks
+	{
+		/*
+		 * @brief This type is the signature of a benchmark body, which must execute the measured
+		 * operation exactly InIterations times.
+		 *
+		 */
+		typedef void (*BenchmarkFunction)(u64 InIterations);
+
+		/*
+		 * @brief This type is the signature of a validation, which checks that the code being
+		 * measured produces correct results before it is timed.
+		 *
+		 */
+		typedef bool (*ValidationFunction)();
+
+		/*
+		 * @brief This structure describes a registered benchmark.
+		 *
+		 */
+		struct BenchmarkInfo
+		{
+			const utf8* Name;
+			BenchmarkFunction Function;
+			u64 BytesPerOperation;
+		};
+
+		/*
+		 * @brief This structure holds the statistics of a benchmark run. All times are in
+		 * nanoseconds per operation.
+		 *
+		 */
+		struct BenchmarkResult
+		{
+			std::string Name;
+			u64 Iterations;
+			u32 Samples;
+			f64 Median;
+			f64 Mean;
+			f64 Deviation;
+			f64 Minimum;
+			f64 Throughput;
+		};
+
+		/*
+		 * @brief This structure holds the options of a benchmark session, as parsed from the
+		 * command line.
+		 *
+		 */
+		struct BenchmarkOptions
+		{
+			std::string Filter;
+			std::string BaselinePath;
+			std::string OutputPath;
+			u32 Samples = 15;
+			f64 MinimumSampleTime = 0.01;
+			f64 Threshold = 0.10;
+		};
+
+		/*
+		 * @brief This function registers a benchmark with the global registry. It is used through
+		 * the REGISTER_BENCHMARK macro rather than being called directly.
+		 *
+		 * @param InName: the qualified name of the benchmark, such as "Math::Matrix::Multiply".
+		 * @param InFunction: the benchmark body.
+		 * @param InBytesPerOperation: the number of bytes processed by one operation, or zero.
+		 *
+		 * @return always true, so that it may initialize a static variable.
+		 *
+		 */
+		bool Register(const utf8* InName, BenchmarkFunction InFunction, u64 InBytesPerOperation);
+
+		/*
+		 * @brief This function registers a validation with the global registry. It is used through
+		 * the REGISTER_VALIDATION macro rather than being called directly.
+		 *
+		 * @param InName: the qualified name of the validation, such as "Memory::Copy".
+		 * @param InFunction: the validation body, returning false on any mismatch.
+		 *
+		 * @return always true, so that it may initialize a static variable.
+		 *
+		 */
+		bool RegisterValidation(const utf8* InName, ValidationFunction InFunction);
+
+		/*
+		 * @brief This function runs every registered benchmark that matches the options' filter,
+		 * prints a report and, when requested, compares against and writes baseline files.
+		 *
+		 * @param InOptions: the options of the session.
+		 *
+		 * Validations matching the filter run first, and the benchmarks are skipped if any fails.
+		 *
+		 * @return zero if every validation passed and no benchmark regressed against the baseline,
+		 * one otherwise.
+		 *
+		 */
+		i32 RunBenchmarks(const BenchmarkOptions& InOptions);
+
+		/*
+		 * @brief This function prevents the compiler from optimizing away the computation of a
+		 * value which is otherwise unused.
+		 *
+		 * @param InValue: the value to keep alive.
+		 *
+		 */
+		template <typename Type>
+		FORCEINLINE void DoNotOptimize(const Type& InValue)
+		{
+#if defined(_MSC_VER)
+			const volatile utf8* volatile sink = &reinterpret_cast<const volatile utf8&>(InValue);
+			(void)sink;
+			_ReadWriteBarrier();
+#else
+			asm volatile("" : : "r,m"(InValue) : "memory");
+#endif
+		}
+
+		/*
+		 * @brief This function prevents the compiler from optimizing away the computation of a
+		 * value and makes it assume the value was modified, so that work depending on it is not
+		 * hoisted out of the benchmark loop.
+		 *
+		 * @param InOutValue: the value to keep alive and opaque.
+		 *
+		 */
+		template <typename Type>
+		FORCEINLINE void DoNotOptimize(Type& InOutValue)
+		{
+#if defined(_MSC_VER)
+			volatile utf8* volatile sink = &reinterpret_cast<volatile utf8&>(InOutValue);
+			(void)sink;
+			_ReadWriteBarrier();
+#else
+			asm volatile("" : "+m,r"(InOutValue) : : "memory");
+#endif
+		}
+
+		/*
+		 * @brief This function makes the compiler assume an object is reachable from outside of
+		 * the benchmark, so that its state is really loaded and stored around every barrier
+		 * instead of being folded into registers or computed at compile time.
+		 *
+		 * @param InObject: the object to publish.
+		 *
+		 */
+		template <typename Type>
+		FORCEINLINE void Escape(Type* InObject)
+		{
+			void* pointer = InObject;
+			DoNotOptimize(pointer);
+		}
+
+		/*
+		 * @brief This function forces the compiler to assume all memory was read and written,
+		 * so that stores to benchmark buffers are not elided.
+		 *
+		 */
+		FORCEINLINE void ClobberMemory()
+		{
+#if defined(_MSC_VER)
+			_ReadWriteBarrier();
+#else
+			asm volatile("" : : : "memory");
+#endif
+		}
+	}
+}
+
+/*
+ * @brief This macro registers a benchmark function under a qualified name, optionally
+ * declaring how many bytes a single operation processes so throughput can be reported.
+ *
+ */
+#define REGISTER_BENCHMARK(Function, Name, BytesPerOperation) \
+	static const bool Function##Registered = Re::Benchmarks::Register(Name, Function, BytesPerOperation)
+
+/*
+ * @brief This macro registers a validation function under a qualified name.
+ *
+ */
+#define REGISTER_VALIDATION(Function, Name) \
+	static const bool Function##Registered = Re::Benchmarks::RegisterValidation(Name, Function)
@@ -0,0 +1,184 @@
+/*
+ * CoreBenchmarks.cpp
+ *
+ * This source file defines the benchmarks of the Core module, covering
+ * hashing and the Entity-Component system.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include "Core/Entity.hpp"
+#include "Core/Hash/FNV.hpp"
+#include "Core/Hash/XXH64.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Re;
+using namespace Re::Benchmarks;
+
+namespace
+{
+	const usize WORLD_ENTITIES = 1024;
+
+	class PositionComponent : public Core::Component
+	{
+	public:
+		virtual void Initialize() override {}
+		virtual void Update(f32 deltaTime) override { _value += deltaTime; }
+
+	private:
+		f32 _value = 0.0f;
+	};
+
+	class VelocityComponent : public Core::Component
+	{
+	public:
+		virtual void Initialize() override {}
+		virtual void Update(f32 deltaTime) override { _value -= deltaTime; }
+
+	private:
+		f32 _value = 0.0f;
+	};
+
+	class BenchmarkEntity : public Core::Entity
+	{
+	public:
+		BenchmarkEntity()
+		{
+			AddComponent<PositionComponent>();
+			AddComponent<VelocityComponent>();
+			AddComponent<VelocityComponent>();
+		}
+	};
+
+	template <usize Size>
+	void HashFNV(u64 InIterations)
+	{
+		std::vector<u8> buffer(Size, 0x5A);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			u32 result = Core::Hash::FNV(buffer.data(), Size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void HashXXH64(u64 InIterations)
+	{
+		std::vector<u8> buffer(Size, 0x5A);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			u64 result = Core::Hash::XXH64(buffer.data(), Size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	bool ValidateXXH64()
+	{
+		struct Vector
+		{
+			const utf8* Input;
+			u64 Expected;
+		};
+
+		// Reference values of the xxHash specification, which cover every tail and the 32-byte stripes.
+		const Vector vectors[] = {
+			{ "", 0xEF46DB3751D8E999ull },
+			{ "a", 0xD24EC4F1A98C6E5Bull },
+			{ "abc", 0x44BC2CF5AD770999ull },
+			{ "Nobody inspects the spammish repetition", 0xFBCEA83C8A378BF1ull },
+		};
+
+		for (const auto& vector : vectors)
+		{
+			u64 result = Core::Hash::XXH64(vector.Input, strlen(vector.Input));
+			if (result != vector.Expected)
+			{
+				fprintf(stderr, "  XXH64 mismatch: \"%s\" hashed to %016llx\n", vector.Input, static_cast<unsigned long long>(result));
+				return false;
+			}
+		}
+
+		// A longer input, read from an unaligned address and seeded.
+		std::vector<u8> buffer(1000);
+		for (usize i = 0; i < buffer.size(); ++i)
+			buffer[i] = static_cast<u8>(i * 7);
+
+		if (Core::Hash::XXH64(buffer.data(), buffer.size()) != 0x25275608A9CFC168ull ||
+			Core::Hash::XXH64(buffer.data() + 3, buffer.size() - 3, 0x9E3779B97F4A7C15ull) != 0x8E61319713D8E05Dull)
+		{
+			fprintf(stderr, "  XXH64 mismatch on the long input\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	void HashFNVString(u64 InIterations)
+	{
+		const utf8* string = "Textures/brick.png";
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(string);
+			u32 result = Core::Hash::FNV(string);
+			DoNotOptimize(result);
+		}
+	}
+
+	void EntityGetComponents(u64 InIterations)
+	{
+		BenchmarkEntity entity;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			auto components = entity.GetComponents<VelocityComponent>();
+			DoNotOptimize(components);
+		}
+	}
+
+	void WorldUpdate(u64 InIterations)
+	{
+		// Core::World owns a window and a Vulkan renderer, so this reproduces its Update loop
+		// over the same type-indexed entity container that World::SpawnEntity fills.
+		Memory::MultiMap<const std::type_info*, boost::shared_ptr<Core::Entity>, Memory::MemoryTag::ECS> entities;
+		for (usize i = 0; i < WORLD_ENTITIES; ++i)
+			entities.emplace(&typeid(BenchmarkEntity), boost::shared_ptr<Core::Entity>(Memory::ObjectPool<BenchmarkEntity>::Shared().Create(),
+				[](BenchmarkEntity* InEntity) { Memory::ObjectPool<BenchmarkEntity>::Shared().Destroy(InEntity); }));
+
+		f32 deltaTime = 1.0f / 60.0f;
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(deltaTime);
+			for (auto& entity : entities)
+			{
+				entity.second->Update(deltaTime);
+			}
+			ClobberMemory();
+		}
+	}
+}
+
+static void HashFNVSmall(u64 InIterations) { HashFNV<64>(InIterations); }
+static void HashFNVMedium(u64 InIterations) { HashFNV<4 * 1024>(InIterations); }
+static void HashXXH64Small(u64 InIterations) { HashXXH64<64>(InIterations); }
+static void HashXXH64Medium(u64 InIterations) { HashXXH64<4 * 1024>(InIterations); }
+
+REGISTER_BENCHMARK(HashFNVSmall, "Core::Hash::FNV/64", 64);
+REGISTER_BENCHMARK(HashFNVMedium, "Core::Hash::FNV/4K", 4 * 1024);
+REGISTER_BENCHMARK(HashFNVString, "Core::Hash::FNV/String", 0);
+REGISTER_BENCHMARK(HashXXH64Small, "Core::Hash::XXH64/64", 64);
+REGISTER_BENCHMARK(HashXXH64Medium, "Core::Hash::XXH64/4K", 4 * 1024);
+REGISTER_BENCHMARK(EntityGetComponents, "Core::Entity::GetComponents", 0);
+REGISTER_BENCHMARK(WorldUpdate, "Core::World::Update/1024", 0);
+
+REGISTER_VALIDATION(ValidateXXH64, "Core::Hash::XXH64");
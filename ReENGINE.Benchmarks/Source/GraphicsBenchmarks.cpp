@@ -0,0 +1,339 @@
+/*
+ * GraphicsBenchmarks.cpp
+ *
+ * This source file defines the benchmarks of the parts of the Graphics
+ * module which run on the CPU, covering mip chain generation and the cost
+ * of sampling minified textures with and without it.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include "Graphics/Mipmap.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Re;
+using namespace Re::Benchmarks;
+
+namespace
+{
+	// The size of the renderer's default grid texture, and one that stays within the caches.
+	const u32 TEXTURE_SIZE = 2048;
+	const usize TEXTURE_BYTES = static_cast<usize>(TEXTURE_SIZE) * TEXTURE_SIZE * 4;
+	const u32 SMALL_TEXTURE_SIZE = 512;
+	const usize SMALL_TEXTURE_BYTES = static_cast<usize>(SMALL_TEXTURE_SIZE) * SMALL_TEXTURE_SIZE * 4;
+
+	// The texture covers a 224x224 footprint on screen, which puts it between the third and fourth levels.
+	const u32 FOOTPRINT_SIZE = 224;
+
+	// The footprint scrolls across the texture between frames, as it would under a moving camera.
+	const u32 SCROLL_TEXELS = 37;
+
+	// Each frame draws this many materials, whose textures together outgrow the last level cache,
+	// much as a single texture outgrows the far smaller texture cache of a GPU.
+	const u32 SCENE_TEXTURES = 8;
+
+	struct MipLevel
+	{
+		const u8* Texels;
+		u32 Width;
+		u32 Height;
+	};
+
+	u64 NextRandom(u64* InOutState)
+	{
+		// Xorshift64, deterministic so a failing case can be reproduced.
+		u64 x = *InOutState;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		*InOutState = x;
+		return x;
+	}
+
+	void FillTexture(std::vector<u8>* OutTexels, u32 InWidth, u32 InHeight)
+	{
+		// A grid over some noise, so neither the filter nor the caches see a constant image.
+		u64 state = 0x2545F4914F6CDD1Dull;
+		OutTexels->resize(static_cast<usize>(InWidth) * InHeight * 4);
+
+		for (u32 y = 0; y < InHeight; ++y)
+		{
+			for (u32 x = 0; x < InWidth; ++x)
+			{
+				u8* texel = OutTexels->data() + (static_cast<usize>(y) * InWidth + x) * 4;
+				const bool line = (x % 64) < 2 || (y % 64) < 2;
+				const u8 noise = static_cast<u8>(NextRandom(&state));
+
+				texel[0] = line ? 255 : noise;
+				texel[1] = line ? 255 : static_cast<u8>(noise ^ 0x5A);
+				texel[2] = line ? 255 : static_cast<u8>(x ^ y);
+				texel[3] = 255;
+			}
+		}
+	}
+
+	/* Validations */
+
+	void DownsampleReference(const u8* InSource, u32 InWidth, u32 InHeight, u8* OutDestination)
+	{
+		const u32 width = Graphics::GetMipExtent(InWidth, 1);
+		const u32 height = Graphics::GetMipExtent(InHeight, 1);
+
+		for (u32 y = 0; y < height; ++y)
+		{
+			const u32 top = InHeight > 1 ? y * 2 : 0;
+			const u32 bottom = InHeight > 1 ? y * 2 + 1 : 0;
+
+			for (u32 x = 0; x < width; ++x)
+			{
+				const u32 left = InWidth > 1 ? x * 2 : 0;
+				const u32 right = InWidth > 1 ? x * 2 + 1 : 0;
+
+				for (u32 c = 0; c < 4; ++c)
+				{
+					const u32 sum = InSource[(static_cast<usize>(top) * InWidth + left) * 4 + c] + InSource[(static_cast<usize>(top) * InWidth + right) * 4 + c] +
+						InSource[(static_cast<usize>(bottom) * InWidth + left) * 4 + c] + InSource[(static_cast<usize>(bottom) * InWidth + right) * 4 + c];
+					OutDestination[(static_cast<usize>(y) * width + x) * 4 + c] = static_cast<u8>((sum + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	bool ValidateMipmap()
+	{
+		// Level counts and chain sizes, including the non square and non power of two cases.
+		if (Graphics::GetMipLevelCount(1, 1) != 1 || Graphics::GetMipLevelCount(2048, 2048) != 12 || Graphics::GetMipLevelCount(5, 3) != 3 ||
+			Graphics::GetMipLevelCount(1, 300) != 9)
+		{
+			fprintf(stderr, "  GetMipLevelCount mismatch\n");
+			return false;
+		}
+
+		if (Graphics::GetMipChainSize(4, 2, 4) != (8 + 2 + 1) * 4 || Graphics::GetMipChainSize(5, 3, 4) != (15 + 2 + 1) * 4)
+		{
+			fprintf(stderr, "  GetMipChainSize mismatch\n");
+			return false;
+		}
+
+		// The kernel against the reference, over extents that exercise the tails and the single texel edges.
+		const u32 extents[][2] = { { 1, 1 }, { 1, 7 }, { 7, 1 }, { 2, 2 }, { 3, 3 }, { 8, 2 }, { 9, 5 }, { 13, 9 }, { 17, 1 }, { 64, 3 }, { 33, 33 }, { 256, 128 } };
+		u64 state = 0x9E3779B97F4A7C15ull;
+
+		for (const auto& extent : extents)
+		{
+			const u32 width = extent[0];
+			const u32 height = extent[1];
+			const usize halfSize = static_cast<usize>(Graphics::GetMipExtent(width, 1)) * Graphics::GetMipExtent(height, 1) * 4;
+
+			std::vector<u8> source(static_cast<usize>(width) * height * 4);
+			for (u8& byte : source)
+				byte = static_cast<u8>(NextRandom(&state));
+
+			// Pad the destination, so writes past the end of the level are caught as well.
+			std::vector<u8> actual(halfSize + 64, 0xCD), expected(halfSize + 64, 0xCD);
+			Graphics::DownsampleBox(source.data(), width, height, actual.data());
+			DownsampleReference(source.data(), width, height, expected.data());
+
+			if (memcmp(actual.data(), expected.data(), actual.size()) != 0)
+			{
+				fprintf(stderr, "  DownsampleBox mismatch: %ux%u\n", width, height);
+				return false;
+			}
+
+			// The chain must end in a single texel, right at the end of the destination.
+			const usize levelsSize = Graphics::GetMipChainSize(width, height, 4) - source.size();
+			std::vector<u8> levels(levelsSize + 64, 0xCD);
+			Graphics::GenerateMipChain(source.data(), width, height, levels.data());
+
+			for (usize i = levelsSize; i < levels.size(); ++i)
+			{
+				if (levels[i] != 0xCD)
+				{
+					fprintf(stderr, "  GenerateMipChain wrote past the chain: %ux%u\n", width, height);
+					return false;
+				}
+			}
+
+			if (levelsSize > 0 && memcmp(levels.data(), expected.data(), halfSize) != 0)
+			{
+				fprintf(stderr, "  GenerateMipChain first level mismatch: %ux%u\n", width, height);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/* Sampling */
+
+	struct MipChain
+	{
+		std::vector<u8> Base;
+		std::vector<u8> Levels;
+		std::vector<MipLevel> Chain;
+	};
+
+	const std::vector<MipChain>& GetScene()
+	{
+		// Built once, so the benchmarks only measure the sampling.
+		static std::vector<MipChain> scene(SCENE_TEXTURES);
+		for (MipChain& texture : scene)
+		{
+			if (!texture.Chain.empty())
+				break;
+
+			FillTexture(&texture.Base, TEXTURE_SIZE, TEXTURE_SIZE);
+			texture.Levels.resize(Graphics::GetMipChainSize(TEXTURE_SIZE, TEXTURE_SIZE, 4) - TEXTURE_BYTES);
+			Graphics::GenerateMipChain(texture.Base.data(), TEXTURE_SIZE, TEXTURE_SIZE, texture.Levels.data());
+
+			const u8* texels = texture.Base.data();
+			const u32 levels = Graphics::GetMipLevelCount(TEXTURE_SIZE, TEXTURE_SIZE);
+			for (u32 level = 0; level < levels; ++level)
+			{
+				const u32 extent = Graphics::GetMipExtent(TEXTURE_SIZE, level);
+				texture.Chain.push_back(MipLevel{ texels, extent, extent });
+				texels = (level == 0 ? texture.Levels.data() : texels + static_cast<usize>(extent) * extent * 4);
+			}
+		}
+
+		return scene;
+	}
+
+	FORCEINLINE void SampleBilinear(const MipLevel& InLevel, f32 InU, f32 InV, f32 InWeight, f32* InOutColor)
+	{
+		// Repeat addressing, as the renderer's sampler uses, on power of two extents.
+		const f32 x = InU * InLevel.Width - 0.5f;
+		const f32 y = InV * InLevel.Height - 0.5f;
+		const f32 x0 = floorf(x);
+		const f32 y0 = floorf(y);
+		const f32 fx = x - x0;
+		const f32 fy = y - y0;
+
+		const u32 mask = InLevel.Width - 1;
+		const u32 left = static_cast<u32>(static_cast<i32>(x0)) & mask;
+		const u32 right = (left + 1) & mask;
+		const u32 top = static_cast<u32>(static_cast<i32>(y0)) & (InLevel.Height - 1);
+		const u32 bottom = (top + 1) & (InLevel.Height - 1);
+
+		const u8* t00 = InLevel.Texels + (static_cast<usize>(top) * InLevel.Width + left) * 4;
+		const u8* t10 = InLevel.Texels + (static_cast<usize>(top) * InLevel.Width + right) * 4;
+		const u8* t01 = InLevel.Texels + (static_cast<usize>(bottom) * InLevel.Width + left) * 4;
+		const u8* t11 = InLevel.Texels + (static_cast<usize>(bottom) * InLevel.Width + right) * 4;
+
+		const f32 w00 = (1.0f - fx) * (1.0f - fy) * InWeight;
+		const f32 w10 = fx * (1.0f - fy) * InWeight;
+		const f32 w01 = (1.0f - fx) * fy * InWeight;
+		const f32 w11 = fx * fy * InWeight;
+
+		for (u32 c = 0; c < 4; ++c)
+			InOutColor[c] += t00[c] * w00 + t10[c] * w10 + t01[c] * w01 + t11[c] * w11;
+	}
+
+	// Shades every pixel of each material's footprint, as the fragment shader would, with the LOD clamped to the given maximum.
+	// Linear mip filtering blends the two nearest levels, while nearest mip filtering takes the nearest level alone.
+	void SampleFootprint(u64 InIterations, f32 InMaxLod, bool InLinear)
+	{
+		const std::vector<MipChain>& scene = GetScene();
+		const u32 levels = static_cast<u32>(scene[0].Chain.size());
+		const f32 lod = fminf(log2f(static_cast<f32>(TEXTURE_SIZE) / FOOTPRINT_SIZE), fminf(InMaxLod, static_cast<f32>(levels - 1)));
+		const u32 level = InLinear ? static_cast<u32>(lod) : static_cast<u32>(lod + 0.5f);
+		const u32 nextLevel = level + 1 < levels ? level + 1 : level;
+		const f32 blend = InLinear ? lod - level : 0.0f;
+		const f32 step = 1.0f / FOOTPRINT_SIZE;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			const f32 scroll = static_cast<f32>((i * SCROLL_TEXELS) % TEXTURE_SIZE) / TEXTURE_SIZE;
+			f32 sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			for (const MipChain& texture : scene)
+			{
+				for (u32 y = 0; y < FOOTPRINT_SIZE; ++y)
+				{
+					const f32 v = (y + 0.5f) * step + scroll;
+					for (u32 x = 0; x < FOOTPRINT_SIZE; ++x)
+					{
+						const f32 u = (x + 0.5f) * step + scroll;
+
+						// Trilinear filtering, which degenerates to bilinear on the first level when the LOD is clamped to zero.
+						SampleBilinear(texture.Chain[level], u, v, 1.0f - blend, sum);
+						if (blend > 0.0f)
+							SampleBilinear(texture.Chain[nextLevel], u, v, blend, sum);
+					}
+				}
+			}
+
+			DoNotOptimize(sum);
+		}
+	}
+
+	/* Mip chain generation */
+
+	struct MipInput
+	{
+		std::vector<u8> Source;
+		std::vector<u8> Levels;
+	};
+
+	template <u32 Size>
+	MipInput& GetMipInput()
+	{
+		// Built once, so the benchmarks only measure the filtering. The levels hold the whole chain after the first level,
+		// which the second level alone also fits in.
+		static MipInput input;
+		if (input.Source.empty())
+		{
+			FillTexture(&input.Source, Size, Size);
+			input.Levels.resize(Graphics::GetMipChainSize(Size, Size, 4) - input.Source.size());
+		}
+
+		return input;
+	}
+
+	template <u32 Size>
+	void DownsampleBox(u64 InIterations)
+	{
+		MipInput& input = GetMipInput<Size>();
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Graphics::DownsampleBox(input.Source.data(), Size, Size, input.Levels.data());
+			ClobberMemory();
+		}
+	}
+
+	void GenerateMipChain(u64 InIterations)
+	{
+		MipInput& input = GetMipInput<TEXTURE_SIZE>();
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Graphics::GenerateMipChain(input.Source.data(), TEXTURE_SIZE, TEXTURE_SIZE, input.Levels.data());
+			ClobberMemory();
+		}
+	}
+}
+
+static void DownsampleBoxSmall(u64 InIterations) { DownsampleBox<SMALL_TEXTURE_SIZE>(InIterations); }
+static void DownsampleBoxLarge(u64 InIterations) { DownsampleBox<TEXTURE_SIZE>(InIterations); }
+static void SampleMinifiedBase(u64 InIterations) { SampleFootprint(InIterations, 0.0f, true); }
+static void SampleMinifiedNearest(u64 InIterations) { SampleFootprint(InIterations, 1000.0f, false); }
+static void SampleMinifiedTrilinear(u64 InIterations) { SampleFootprint(InIterations, 1000.0f, true); }
+
+REGISTER_VALIDATION(ValidateMipmap, "Graphics::Mipmap");
+
+REGISTER_BENCHMARK(DownsampleBoxSmall, "Graphics::Mipmap::DownsampleBox/512", SMALL_TEXTURE_BYTES);
+REGISTER_BENCHMARK(DownsampleBoxLarge, "Graphics::Mipmap::DownsampleBox/2048", TEXTURE_BYTES);
+REGISTER_BENCHMARK(GenerateMipChain, "Graphics::Mipmap::GenerateMipChain/2048", TEXTURE_BYTES);
+
+/* The same minified draw, sampled as with maxLod = 0, and then with the full chain under nearest and linear mip filtering. */
+REGISTER_BENCHMARK(SampleMinifiedBase, "Graphics::Sampling::Minified/Base", 0);
+REGISTER_BENCHMARK(SampleMinifiedNearest, "Graphics::Sampling::Minified/MipNearest", 0);
+REGISTER_BENCHMARK(SampleMinifiedTrilinear, "Graphics::Sampling::Minified/Trilinear", 0);
@@ -0,0 +1,58 @@
+/*
+ * Main.cpp
+ *
+ * This source file is the entry point of the ReENGINE.Benchmarks target.
+ *
+ * Usage: ReENGINE.Benchmarks [--filter=<text>] [--samples=<count>] [--min-time=<ms>]
+ *                            [--baseline=<file>] [--write-baseline=<file>] [--threshold=<percent>]
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include <cstring>
+
+using namespace Re;
+using namespace Re::Benchmarks;
+
+static bool ParseOption(const utf8* InArgument, const utf8* InName, const utf8** OutValue)
+{
+	usize length = strlen(InName);
+	if (strncmp(InArgument, InName, length) != 0 || InArgument[length] != '=')
+		return false;
+
+	*OutValue = InArgument + length + 1;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+
+	for (i32 i = 1; i < argc; ++i)
+	{
+		const utf8* value = nullptr;
+
+		if (ParseOption(argv[i], "--filter", &value))
+			options.Filter = value;
+		else if (ParseOption(argv[i], "--samples", &value))
+			options.Samples = static_cast<u32>(atoi(value));
+		else if (ParseOption(argv[i], "--min-time", &value))
+			options.MinimumSampleTime = atof(value) / 1000.0;
+		else if (ParseOption(argv[i], "--baseline", &value))
+			options.BaselinePath = value;
+		else if (ParseOption(argv[i], "--write-baseline", &value))
+			options.OutputPath = value;
+		else if (ParseOption(argv[i], "--threshold", &value))
+			options.Threshold = atof(value) / 100.0;
+		else
+		{
+			fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	return RunBenchmarks(options);
+}
@@ -0,0 +1,277 @@
+/*
+ * MathBenchmarks.cpp
+ *
+ * This source file defines the benchmarks of the Math module, covering
+ * matrices, vectors, transforms and the fast approximation kernels.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include "Math/Fast.hpp"
+#include "Math/Matrix.hpp"
+#include "Math/Transform.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace Re;
+using namespace Re::Benchmarks;
+
+namespace
+{
+	const usize BATCH_SIZE = 1024;
+
+	bool ValidateMatrixNormal()
+	{
+		struct Case
+		{
+			const utf8* Name;
+			Math::Matrix Model;
+		};
+
+		// Uniformly scaled rotations take the fast path, the others the full inverse transpose, and both must agree with it.
+		const Case cases[] = {
+			{ "rotation", Math::Matrix::Rotation(30.0f, Math::Vector3(0.0f, 1.0f, 0.0f)) },
+			{ "uniformly scaled rotation", Math::Matrix::Translation(Math::Vector3(1.0f, 2.0f, 3.0f)) * Math::Matrix::Rotation(50.0f, Math::Vector3(1.0f, 0.0f, 0.0f)) * Math::Matrix::Scale(Math::Vector3(3.0f, 3.0f, 3.0f)) },
+			{ "shrunk rotation", Math::Matrix::Rotation(-75.0f, Math::Vector3(0.0f, 0.0f, 1.0f)) * Math::Matrix::Scale(Math::Vector3(0.25f, 0.25f, 0.25f)) },
+			{ "non-uniformly scaled rotation", Math::Matrix::Rotation(30.0f, Math::Vector3(0.0f, 1.0f, 0.0f)) * Math::Matrix::Scale(Math::Vector3(1.0f, 2.0f, 4.0f)) },
+		};
+
+		for (const auto& test : cases)
+		{
+			Math::Matrix actual = Math::Matrix::Normal(test.Model);
+			Math::Matrix expected = test.Model.Inverse().Transposed();
+
+			for (u32 column = 0; column < 3; ++column)
+			{
+				for (u32 row = 0; row < 3; ++row)
+				{
+					const f32 a = actual.Elements[row + column * 4];
+					const f32 e = expected.Elements[row + column * 4];
+					if (fabsf(a - e) > 1e-4f * (1.0f + fabsf(e)))
+					{
+						fprintf(stderr, "  Matrix::Normal mismatch for a %s at (%u, %u): %f instead of %f\n", test.Name, row, column, a, e);
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void MatrixMultiply(u64 InIterations)
+	{
+		Math::Matrix left = Math::Matrix::Rotation(30.0f, Math::Vector3(0.0f, 1.0f, 0.0f));
+		Math::Matrix right = Math::Matrix::Translation(Math::Vector3(1.0f, 2.0f, 3.0f));
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(left);
+			DoNotOptimize(right);
+			Math::Matrix result = left * right;
+			DoNotOptimize(result);
+		}
+	}
+
+	void MatrixInverse(u64 InIterations)
+	{
+		Math::Matrix matrix = Math::Matrix::Translation(Math::Vector3(1.0f, 2.0f, 3.0f)) * Math::Matrix::Scale(Math::Vector3(1.0f, 2.0f, 4.0f));
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(matrix);
+			Math::Matrix result = matrix.Inverse();
+			DoNotOptimize(result);
+		}
+	}
+
+	void MatrixNormal(u64 InIterations)
+	{
+		Math::Matrix model = Math::Matrix::Rotation(30.0f, Math::Vector3(0.0f, 1.0f, 0.0f)) * Math::Matrix::Scale(Math::Vector3(1.0f, 2.0f, 4.0f));
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(model);
+			Math::Matrix result = Math::Matrix::Normal(model);
+			DoNotOptimize(result);
+		}
+	}
+
+	void MatrixRotation(u64 InIterations)
+	{
+		Math::Vector3 axis(0.0f, 1.0f, 0.0f);
+		f32 angle = 45.0f;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(angle);
+			Math::Matrix result = Math::Matrix::Rotation(angle, axis);
+			DoNotOptimize(result);
+		}
+	}
+
+	void MatrixPerspective(u64 InIterations)
+	{
+		f32 fieldOfView = 60.0f;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(fieldOfView);
+			Math::Matrix result = Math::Matrix::Perspective(16.0f / 9.0f, fieldOfView, 0.1f, 1000.0f);
+			DoNotOptimize(result);
+		}
+	}
+
+	void MatrixLookAt(u64 InIterations)
+	{
+		Math::Vector3 eye(0.0f, 2.0f, 16.0f);
+		Math::Vector3 center(0.0f, 0.0f, 0.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(eye);
+			Math::Matrix result = Math::Matrix::LookAt(eye, center, Math::WorldUp);
+			DoNotOptimize(result);
+		}
+	}
+
+	void Vector3Cross(u64 InIterations)
+	{
+		Math::Vector3 left(1.0f, 2.0f, 3.0f);
+		Math::Vector3 right(-3.0f, 0.5f, 2.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(left);
+			Math::Vector3 result = Math::Vector3::Cross(left, right);
+			DoNotOptimize(result);
+		}
+	}
+
+	void Vector3Dot(u64 InIterations)
+	{
+		Math::Vector3 left(1.0f, 2.0f, 3.0f);
+		Math::Vector3 right(-3.0f, 0.5f, 2.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(left);
+			f32 result = left.Dot(right);
+			DoNotOptimize(result);
+		}
+	}
+
+	void Vector3Normalize(u64 InIterations)
+	{
+		Math::Vector3 vector(1.0f, 2.0f, 3.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Math::Vector3 result = vector;
+			DoNotOptimize(result);
+			result.Normalize();
+			DoNotOptimize(result);
+		}
+	}
+
+	void Vector3NormalizeMedium(u64 InIterations)
+	{
+		Math::Vector3 vector(1.0f, 2.0f, 3.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Math::Vector3 result = vector;
+			DoNotOptimize(result);
+			result.Normalize(Math::Fast::Accuracy::Medium);
+			DoNotOptimize(result);
+		}
+	}
+
+	void TransformToModel(u64 InIterations)
+	{
+		Math::Transform transform;
+		transform._position = Math::Vector3(1.0f, 2.0f, 3.0f);
+		transform._rotation = Math::Rotator(15.0f);
+		transform._scale = Math::Vector3(1.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(transform);
+			Math::Matrix result = transform.ToModel();
+			DoNotOptimize(result);
+		}
+	}
+
+	void TransformForward(u64 InIterations)
+	{
+		Math::Transform transform;
+		transform._rotation = Math::Rotator(15.0f);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(transform);
+			Math::Vector3 result = transform.Forward();
+			DoNotOptimize(result);
+		}
+	}
+
+	template <Math::Fast::Accuracy Tier>
+	void FastSinCos(u64 InIterations)
+	{
+		std::vector<f32> angles(BATCH_SIZE), sines(BATCH_SIZE), cosines(BATCH_SIZE);
+		for (usize i = 0; i < BATCH_SIZE; ++i)
+			angles[i] = -8.0f + 16.0f * i / BATCH_SIZE;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Math::Fast::SinCos<Tier>(angles.data(), sines.data(), cosines.data(), BATCH_SIZE);
+			ClobberMemory();
+		}
+	}
+
+	template <Math::Fast::Accuracy Tier>
+	void FastRSqrt(u64 InIterations)
+	{
+		std::vector<f32> values(BATCH_SIZE), results(BATCH_SIZE);
+		for (usize i = 0; i < BATCH_SIZE; ++i)
+			values[i] = 0.5f + i;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Math::Fast::RSqrt<Tier>(values.data(), results.data(), BATCH_SIZE);
+			ClobberMemory();
+		}
+	}
+}
+
+REGISTER_VALIDATION(ValidateMatrixNormal, "Math::Matrix::Normal");
+
+REGISTER_BENCHMARK(MatrixMultiply, "Math::Matrix::Multiply", 0);
+REGISTER_BENCHMARK(MatrixInverse, "Math::Matrix::Inverse", 0);
+REGISTER_BENCHMARK(MatrixNormal, "Math::Matrix::Normal", 0);
+REGISTER_BENCHMARK(MatrixRotation, "Math::Matrix::Rotation", 0);
+REGISTER_BENCHMARK(MatrixPerspective, "Math::Matrix::Perspective", 0);
+REGISTER_BENCHMARK(MatrixLookAt, "Math::Matrix::LookAt", 0);
+REGISTER_BENCHMARK(Vector3Cross, "Math::Vector3::Cross", 0);
+REGISTER_BENCHMARK(Vector3Dot, "Math::Vector3::Dot", 0);
+REGISTER_BENCHMARK(Vector3Normalize, "Math::Vector3::Normalize", 0);
+REGISTER_BENCHMARK(Vector3NormalizeMedium, "Math::Vector3::Normalize/Medium", 0);
+REGISTER_BENCHMARK(TransformToModel, "Math::Transform::ToModel", 0);
+REGISTER_BENCHMARK(TransformForward, "Math::Transform::Forward", 0);
+
+static void FastSinCosLow(u64 InIterations) { FastSinCos<Math::Fast::Accuracy::Low>(InIterations); }
+static void FastSinCosMedium(u64 InIterations) { FastSinCos<Math::Fast::Accuracy::Medium>(InIterations); }
+static void FastSinCosFull(u64 InIterations) { FastSinCos<Math::Fast::Accuracy::Full>(InIterations); }
+static void FastRSqrtMedium(u64 InIterations) { FastRSqrt<Math::Fast::Accuracy::Medium>(InIterations); }
+static void FastRSqrtFull(u64 InIterations) { FastRSqrt<Math::Fast::Accuracy::Full>(InIterations); }
+
+REGISTER_BENCHMARK(FastSinCosLow, "Math::Fast::SinCos/Low/1024", BATCH_SIZE * sizeof(f32));
+REGISTER_BENCHMARK(FastSinCosMedium, "Math::Fast::SinCos/Medium/1024", BATCH_SIZE * sizeof(f32));
+REGISTER_BENCHMARK(FastSinCosFull, "Math::Fast::SinCos/Full/1024", BATCH_SIZE * sizeof(f32));
+REGISTER_BENCHMARK(FastRSqrtMedium, "Math::Fast::RSqrt/Medium/1024", BATCH_SIZE * sizeof(f32));
+REGISTER_BENCHMARK(FastRSqrtFull, "Math::Fast::RSqrt/Full/1024", BATCH_SIZE * sizeof(f32));
@@ -0,0 +1,2097 @@
+/*
+ * MemoryBenchmarks.cpp
+ *
+ * This source file defines the benchmarks of the Memory module, covering
+ * the memory primitives and the allocators.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Benchmark.hpp"
+
+#include "Memory/AllocationTracer.hpp"
+#include "Memory/Containers.hpp"
+#include "Memory/DefaultAllocator.hpp"
+#include "Memory/FrameAllocator.hpp"
+#include "Memory/Memory.hpp"
+#include "Memory/MemoryManager.hpp"
+#include "Memory/ObjectPool.hpp"
+#include "Memory/RangeAllocator.hpp"
+#include "Memory/SmallObjectAllocator.hpp"
+#include "Memory/StackAllocator.hpp"
+#include "Memory/VirtualArena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Files written by the validations go to the build directory, rather than wherever the benchmarks are run from.
+#if !defined(BENCHMARKS_OUTPUT_DIRECTORY)
+#define BENCHMARKS_OUTPUT_DIRECTORY "."
+#endif
+
+using namespace Re;
+using namespace Re::Benchmarks;
+
+namespace
+{
+	const usize SMALL_SIZE = 64;
+	const usize MEDIUM_SIZE = 4 * 1024;
+	const usize LARGE_SIZE = 1024 * 1024;
+	const usize HUGE_SIZE = 16 * 1024 * 1024;
+
+	const u32 FUZZ_ROUNDS = 20000;
+	const usize FUZZ_MAXIMUM_SIZE = 8 * 1024;
+	const usize FUZZ_PADDING = 64;
+
+	const usize STACK_SIZE = 64 * 1024;
+	const usize STACK_ALLOCATIONS = 64;
+	const usize STACK_VALIDATION_SIZE = 4096;
+
+	const usize POOL_BLOCK_SIZE = 48;
+	const usize POOL_ALLOCATIONS = 64;
+	const usize POOL_VALIDATION_THREADS = 4;
+	const usize POOL_VALIDATION_BLOCKS = 4096;
+	const usize POOL_VALIDATION_ROUNDS = 64;
+
+	const usize FRAME_VALIDATION_THREADS = 4;
+	const usize FRAME_VALIDATION_ALLOCATIONS = 4096;
+	const usize FRAME_VALIDATION_FRAMES = 8;
+
+	const usize TRACKING_VALIDATION_THREADS = 4;
+	const usize TRACKING_VALIDATION_ALLOCATIONS = 2048;
+
+	const usize TLSF_VALIDATION_ROUNDS = 20000;
+	const usize TLSF_VALIDATION_SLOTS = 512;
+	const usize TLSF_VALIDATION_POOL_SIZE = 256 * 1024;
+	const usize TLSF_MIXED_ALLOCATIONS = 256;
+	const usize TLSF_MIXED_MAXIMUM_SIZE = 4096;
+
+	const usize VIRTUAL_ARENA_RESERVE = 256 * 1024 * 1024;
+	const usize VIRTUAL_VALIDATION_BYTES = 8 * 1024 * 1024;
+	const usize VIRTUAL_VALIDATION_THREADS = 4;
+	const usize VIRTUAL_VALIDATION_ALLOCATIONS = 4096;
+
+	const usize SMALL_OBJECT_RESERVE = 256 * 1024 * 1024;
+	const usize SMALL_OBJECT_VALIDATION_ROUNDS = 20000;
+	const usize SMALL_OBJECT_VALIDATION_SLOTS = 1024;
+	const usize SMALL_OBJECT_VALIDATION_THREADS = 4;
+	const usize SMALL_OBJECT_VALIDATION_BLOCKS = 8192;
+
+	const usize TRACER_VALIDATION_ALLOCATIONS = 256;
+	const u32 TRACER_SAMPLE_RATE = 64;
+	const usize TRACER_NEW_ELEMENTS = 6;
+	const utf8* TRACER_PROFILE_PATH = BENCHMARKS_OUTPUT_DIRECTORY "/ReENGINE.Benchmarks.heap";
+	const utf8* TRACER_HISTORY_PATH = BENCHMARKS_OUTPUT_DIRECTORY "/ReENGINE.Benchmarks.frames.csv";
+
+	const usize RANGE_BLOCK_SIZE = 64 * 1024 * 1024;
+	const usize RANGE_VALIDATION_ROUNDS = 20000;
+	const usize RANGE_VALIDATION_SLOTS = 512;
+	const usize RANGE_MIXED_ALLOCATIONS = 256;
+	const usize RANGE_MIXED_MAXIMUM_SIZE = 256 * 1024;
+
+	const usize CONTAINER_VALIDATION_ENTRIES = 4096;
+	const usize CONTAINER_ENTRIES = 64;
+	const usize CONTAINER_NODE_SIZE = 64;
+
+	struct PooledObject
+	{
+		f32 Position[4];
+		f32 Velocity[4];
+		u32 Flags[4];
+	};
+
+	/* Validations */
+
+	u64 NextRandom(u64* InOutState)
+	{
+		// Xorshift64, deterministic so a failing case can be reproduced.
+		u64 x = *InOutState;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		*InOutState = x;
+		return x;
+	}
+
+	usize RandomSize(u64* InOutState)
+	{
+		// Favor the small sizes, where the head and tail handling lives.
+		u64 random = NextRandom(InOutState);
+		return (random & 3) ? static_cast<usize>((random >> 8) % 160) : static_cast<usize>((random >> 8) % FUZZ_MAXIMUM_SIZE);
+	}
+
+	void FillRandom(std::vector<u8>* OutBuffer, u64* InOutState)
+	{
+		for (u8& byte : *OutBuffer)
+			byte = static_cast<u8>(NextRandom(InOutState));
+	}
+
+	bool ValidateCopy()
+	{
+		u64 state = 0x9E3779B97F4A7C15ull;
+		std::vector<u8> source(FUZZ_MAXIMUM_SIZE + FUZZ_PADDING), actual(source.size()), expected(source.size());
+		FillRandom(&source, &state);
+
+		for (u32 round = 0; round < FUZZ_ROUNDS; ++round)
+		{
+			usize size = RandomSize(&state);
+			usize sourceOffset = NextRandom(&state) % FUZZ_PADDING;
+			usize destinationOffset = NextRandom(&state) % FUZZ_PADDING;
+			bool temporal = (round & 1) == 0;
+
+			FillRandom(&actual, &state);
+			expected = actual;
+
+			memcpy(expected.data() + destinationOffset, source.data() + sourceOffset, size);
+			if (temporal)
+				Memory::Copy(actual.data() + destinationOffset, source.data() + sourceOffset, size);
+			else
+				Memory::CopyNonTemporal(actual.data() + destinationOffset, source.data() + sourceOffset, size);
+
+			// Compare the whole buffer, so writes outside of the destination are caught as well.
+			if (memcmp(actual.data(), expected.data(), actual.size()) != 0)
+			{
+				fprintf(stderr, "  %s mismatch: size %zu, source offset %zu, destination offset %zu\n",
+					temporal ? "Copy" : "CopyNonTemporal", size, sourceOffset, destinationOffset);
+				return false;
+			}
+		}
+
+		// Cover the non-temporal path taken by Copy above the threshold.
+		std::vector<u8> large(Memory::NON_TEMPORAL_THRESHOLD + 77), copy(large.size() + 16);
+		FillRandom(&large, &state);
+		Memory::Copy(copy.data() + 3, large.data(), large.size());
+		return memcmp(copy.data() + 3, large.data(), large.size()) == 0;
+	}
+
+	bool ValidateMove()
+	{
+		u64 state = 0xD1B54A32D192ED03ull;
+		std::vector<u8> actual(FUZZ_MAXIMUM_SIZE + 2 * FUZZ_PADDING), expected(actual.size());
+
+		for (u32 round = 0; round < FUZZ_ROUNDS; ++round)
+		{
+			// Both regions lie in the same buffer, so most cases overlap in either direction.
+			usize size = RandomSize(&state);
+			usize sourceOffset = NextRandom(&state) % (2 * FUZZ_PADDING);
+			usize destinationOffset = NextRandom(&state) % (2 * FUZZ_PADDING);
+
+			FillRandom(&actual, &state);
+			expected = actual;
+
+			memmove(expected.data() + destinationOffset, expected.data() + sourceOffset, size);
+			Memory::Move(actual.data() + destinationOffset, actual.data() + sourceOffset, size);
+
+			if (memcmp(actual.data(), expected.data(), actual.size()) != 0)
+			{
+				fprintf(stderr, "  Move mismatch: size %zu, source offset %zu, destination offset %zu\n", size, sourceOffset, destinationOffset);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ValidateSet()
+	{
+		u64 state = 0x94D049BB133111EBull;
+		std::vector<u8> actual(FUZZ_MAXIMUM_SIZE + FUZZ_PADDING), expected(actual.size());
+
+		for (u32 round = 0; round < FUZZ_ROUNDS; ++round)
+		{
+			usize size = RandomSize(&state);
+			usize offset = NextRandom(&state) % FUZZ_PADDING;
+			u8 value = static_cast<u8>(NextRandom(&state));
+
+			FillRandom(&actual, &state);
+			expected = actual;
+
+			memset(expected.data() + offset, value, size);
+			Memory::Set(actual.data() + offset, value, size);
+
+			if (memcmp(actual.data(), expected.data(), actual.size()) != 0)
+			{
+				fprintf(stderr, "  Set mismatch: size %zu, offset %zu, value %u\n", size, offset, value);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ValidateCompare()
+	{
+		u64 state = 0xBF58476D1CE4E5B9ull;
+		std::vector<u8> left(FUZZ_MAXIMUM_SIZE + FUZZ_PADDING), right(left.size());
+
+		for (u32 round = 0; round < FUZZ_ROUNDS; ++round)
+		{
+			usize size = RandomSize(&state);
+			usize leftOffset = NextRandom(&state) % FUZZ_PADDING;
+			usize rightOffset = NextRandom(&state) % FUZZ_PADDING;
+
+			// Start from equal regions and, most of the time, flip a single byte anywhere in them.
+			FillRandom(&left, &state);
+			memcpy(right.data() + rightOffset, left.data() + leftOffset, size);
+			if (size && (round % 4) != 0)
+				right[rightOffset + NextRandom(&state) % size] ^= static_cast<u8>(1 + NextRandom(&state) % 255);
+
+			bool expected = memcmp(left.data() + leftOffset, right.data() + rightOffset, size) == 0;
+			if (Memory::Compare(left.data() + leftOffset, right.data() + rightOffset, size) != expected)
+			{
+				fprintf(stderr, "  Compare mismatch: size %zu, left offset %zu, right offset %zu\n", size, leftOffset, rightOffset);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ValidateStackMarkers()
+	{
+		Memory::StackAllocator<STACK_VALIDATION_SIZE> stack;
+
+		// Allocations below a marker survive rolling back to it, and the space above it is handed out again.
+		u8* kept = static_cast<u8*>(stack.Allocate(100));
+		Memory::Set(kept, 0x5A, 100);
+		Memory::StackMarker marker = stack.GetMarker();
+
+		void* first = stack.Allocate(64);
+		void* aligned = stack.AllocateAligned(200, 64);
+		if (!first || !aligned || reinterpret_cast<usize>(aligned) % 64 != 0)
+		{
+			fprintf(stderr, "  StackAllocator returned a bad chunk above the marker\n");
+			return false;
+		}
+
+		stack.FreeToMarker(marker);
+		if (stack.GetOffset() != marker || stack.Allocate(64) != first)
+		{
+			fprintf(stderr, "  StackAllocator did not roll back to its marker\n");
+			return false;
+		}
+
+		for (usize i = 0; i < 100; ++i)
+		{
+			if (kept[i] != 0x5A)
+			{
+				fprintf(stderr, "  StackAllocator overwrote an allocation below its marker\n");
+				return false;
+			}
+		}
+
+		// A scoped marker rolls back when it goes out of scope, and so do Free and FreeAligned, to the chunk they release.
+		usize offset = stack.GetOffset();
+		{
+			Memory::StackAllocator<STACK_VALIDATION_SIZE>::ScopedMarker scope(stack);
+			stack.Allocate(300);
+			stack.AllocateAligned(16, 32);
+		}
+
+		if (stack.GetOffset() != offset)
+		{
+			fprintf(stderr, "  StackAllocator::ScopedMarker did not roll back\n");
+			return false;
+		}
+
+		aligned = stack.AllocateAligned(48, 128);
+		stack.Allocate(32);
+		stack.FreeAligned(aligned);
+		if (stack.GetOffset() != offset)
+		{
+			fprintf(stderr, "  StackAllocator::FreeAligned did not rewind to the chunk it released\n");
+			return false;
+		}
+
+		// The high-water mark remembers the peak after rolling back, and the stack refuses to overflow.
+		usize peak = stack.GetHighWaterMark();
+		if (peak <= stack.GetOffset() || stack.Allocate(STACK_VALIDATION_SIZE) != nullptr)
+		{
+			fprintf(stderr, "  StackAllocator lost its high-water mark or overflowed\n");
+			return false;
+		}
+
+		stack.Clear();
+		return stack.GetOffset() == 0 && stack.GetHighWaterMark() == peak;
+	}
+
+	bool ValidateDoubleEndedStack()
+	{
+		Memory::DoubleEndedStackAllocator<STACK_VALIDATION_SIZE> stack;
+		std::vector<std::pair<u8*, usize>> chunks;
+		u64 state = 0x2545F4914F6CDD1Dull;
+
+		// Fill the stack from both ends with chunks of random sizes and alignments until the ends meet.
+		bool lowerFull = false, upperFull = false;
+		for (u32 round = 0; !lowerFull || !upperFull; ++round)
+		{
+			usize size = 1 + NextRandom(&state) % 96;
+			usize alignment = static_cast<usize>(1) << (NextRandom(&state) % 7);
+			bool upper = (round & 1) != 0;
+			if (upper ? upperFull : lowerFull)
+				continue;
+
+			u8* chunk = static_cast<u8*>(upper ? stack.AllocateUpper(size, alignment) : stack.AllocateAligned(size, alignment));
+			if (!chunk)
+			{
+				(upper ? upperFull : lowerFull) = true;
+				continue;
+			}
+
+			if (reinterpret_cast<usize>(chunk) % alignment != 0)
+			{
+				fprintf(stderr, "  DoubleEndedStackAllocator misaligned a chunk of %zu bytes to %zu\n", size, alignment);
+				return false;
+			}
+
+			Memory::Set(chunk, static_cast<u8>(chunks.size()), size);
+			chunks.emplace_back(chunk, size);
+		}
+
+		// Once the ends have met, neither hands out more than the space left between them, and no chunk was overwritten.
+		if (stack.GetFreeSpace() > 96 + 64 + 2 * Memory::StackGuard::Size || stack.GetOffset() + stack.GetUpperOffset() + stack.GetFreeSpace() != STACK_VALIDATION_SIZE)
+		{
+			fprintf(stderr, "  DoubleEndedStackAllocator gave up with %zu bytes free\n", stack.GetFreeSpace());
+			return false;
+		}
+
+		for (usize i = 0; i < chunks.size(); ++i)
+		{
+			for (usize j = 0; j < chunks[i].second; ++j)
+			{
+				if (chunks[i].first[j] != static_cast<u8>(i))
+				{
+					fprintf(stderr, "  DoubleEndedStackAllocator handed out overlapping chunks\n");
+					return false;
+				}
+			}
+		}
+
+		// Releasing the upper end leaves the lower end alone, and frees room for upper allocations again.
+		usize lowerOffset = stack.GetOffset();
+		Memory::StackMarker upperMarker = stack.GetUpperMarker();
+		stack.ClearUpper();
+		if (stack.GetUpperOffset() != 0 || stack.GetOffset() != lowerOffset || !stack.AllocateUpper(64, 16))
+		{
+			fprintf(stderr, "  DoubleEndedStackAllocator did not clear its upper end\n");
+			return false;
+		}
+
+		{
+			Memory::DoubleEndedStackAllocator<STACK_VALIDATION_SIZE>::ScopedUpperMarker scope(stack);
+			stack.AllocateUpper(128);
+		}
+
+		if (stack.GetUpperMarker() <= upperMarker || stack.GetUpperOffset() > 64 + 16 + Memory::StackGuard::Size)
+		{
+			fprintf(stderr, "  DoubleEndedStackAllocator::ScopedUpperMarker did not roll back\n");
+			return false;
+		}
+
+		stack.Clear();
+		return stack.GetOffset() == 0 && stack.GetUpperOffset() == 0;
+	}
+
+	bool ValidateStackGuards()
+	{
+		// The guards are only written by debug builds, so they are checked directly on a buffer laid out as a stack would.
+		const usize guardSize = 16;
+		std::vector<u8> buffer(256);
+		const usize offsets[] = { 16, 48, 80 };
+
+		for (usize corrupted = 0; corrupted <= 3; ++corrupted)
+		{
+			usize last = Memory::StackGuard::None;
+			for (usize offset : offsets)
+			{
+				Memory::StackGuard::Write(buffer.data(), offset, last);
+				last = offset;
+			}
+
+			// Overrun the chunk below one of the guards by a single byte.
+			if (corrupted < 3)
+				buffer[offsets[corrupted]] ^= 0xFF;
+
+			// Releasing everything from offset 32 walks the guards at 80 and 48, and stops at the one at 16.
+			usize remaining = Memory::StackGuard::Release(buffer.data(), last, 32, 96 + guardSize);
+			usize expected = (corrupted == 1 || corrupted == 2) ? Memory::StackGuard::None : 16;
+			if (remaining != expected)
+			{
+				fprintf(stderr, "  StackGuard %s\n", expected == 16 ? "reported an intact chain as corrupted" : "missed an overwritten guard");
+				return false;
+			}
+
+			for (usize i = 32; i < 96 + guardSize; ++i)
+			{
+				if (buffer[i] != 0xDD)
+				{
+					fprintf(stderr, "  StackGuard did not poison the released range\n");
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Runs a validation once with every kernel level the processor supports, so the SSE2 kernels are covered on AVX2 machines too.
+	bool ValidateAtEveryKernelLevel(bool (*InValidate)(), const utf8* InName)
+	{
+		const Memory::KernelLevel levels[] = { Memory::KernelLevel::SSE2, Memory::KernelLevel::AVX2 };
+		const utf8* levelNames[] = { "SSE2", "AVX2" };
+		const Memory::KernelLevel original = Memory::GetKernelLevel();
+		bool valid = true;
+
+		for (usize i = 0; i < sizeof(levels) / sizeof(levels[0]) && valid; ++i)
+		{
+			if (Memory::SetKernelLevel(levels[i]) != levels[i])
+				continue;
+
+			valid = InValidate();
+			if (!valid)
+				fprintf(stderr, "  %s failed with the %s kernels\n", InName, levelNames[i]);
+		}
+
+		Memory::SetKernelLevel(original);
+		return valid;
+	}
+
+	bool ValidatePoolAllocator()
+	{
+		Memory::PoolAllocator pool(POOL_BLOCK_SIZE, 100, 16);
+		std::vector<std::vector<void*>> blocks(POOL_VALIDATION_THREADS);
+
+		// Allocate from several threads at once, then free every block on another thread
+		// than the one that allocated it.
+		std::vector<std::thread> threads;
+		for (usize t = 0; t < POOL_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&pool, &blocks, t]() {
+				for (usize i = 0; i < POOL_VALIDATION_BLOCKS; ++i)
+				{
+					void* block = pool.Allocate(POOL_BLOCK_SIZE);
+					memset(block, static_cast<int>(t), POOL_BLOCK_SIZE);
+					blocks[t].push_back(block);
+				}
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		std::vector<void*> all;
+		for (usize t = 0; t < POOL_VALIDATION_THREADS; ++t)
+		{
+			for (void* block : blocks[t])
+			{
+				if (reinterpret_cast<usize>(block) % 16 != 0)
+				{
+					fprintf(stderr, "  PoolAllocator returned a misaligned block %p\n", block);
+					return false;
+				}
+
+				// A block handed out twice would have been overwritten by another thread.
+				for (usize i = 0; i < POOL_BLOCK_SIZE; ++i)
+				{
+					if (static_cast<u8*>(block)[i] != t)
+					{
+						fprintf(stderr, "  PoolAllocator block %p is shared between threads\n", block);
+						return false;
+					}
+				}
+
+				all.push_back(block);
+			}
+		}
+
+		std::sort(all.begin(), all.end());
+		if (std::adjacent_find(all.begin(), all.end()) != all.end())
+		{
+			fprintf(stderr, "  PoolAllocator returned the same block twice\n");
+			return false;
+		}
+
+		threads.clear();
+		for (usize t = 0; t < POOL_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&pool, &blocks, t]() {
+				for (void* block : blocks[(t + 1) % POOL_VALIDATION_THREADS])
+					pool.Free(block);
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		// Every block is free again, and the threads that cached them have exited, so allocating
+		// them all must not grow the pool.
+		usize capacity = pool.GetCapacity();
+		for (usize i = 0; i < all.size(); ++i)
+			all[i] = pool.Allocate(POOL_BLOCK_SIZE);
+
+		if (pool.GetCapacity() > capacity)
+		{
+			fprintf(stderr, "  PoolAllocator grew from %zu to %zu blocks instead of reusing freed ones\n", capacity, pool.GetCapacity());
+			return false;
+		}
+
+		// Threads that come and go must hand their cached blocks back rather than strand them.
+		Memory::PoolAllocator churned(POOL_BLOCK_SIZE, 2 * Memory::PoolAllocator::CACHE_BATCH, 16);
+		for (usize round = 0; round < POOL_VALIDATION_ROUNDS; ++round)
+		{
+			std::thread thread([&churned]() {
+				void* cached[2 * Memory::PoolAllocator::CACHE_BATCH - 1];
+				for (void*& block : cached)
+					block = churned.Allocate(POOL_BLOCK_SIZE);
+
+				for (void* block : cached)
+					churned.Free(block);
+			});
+
+			thread.join();
+		}
+
+		if (churned.GetChunkCount() > 1)
+		{
+			fprintf(stderr, "  PoolAllocator grew to %zu chunks as threads exited\n", churned.GetChunkCount());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ValidateFrameArena()
+	{
+		struct FrameAllocation
+		{
+			u8* Address;
+			usize Size;
+			u8 Pattern;
+		};
+
+		Memory::FrameArena arena(Memory::FrameArena::SPAN_SIZE * 8);
+		usize capacity = 0;
+
+		// Every frame allocates the same amounts, so the arena must stop growing after the first.
+		for (usize frame = 0; frame < FRAME_VALIDATION_FRAMES; ++frame)
+		{
+			std::vector<std::vector<FrameAllocation>> allocations(FRAME_VALIDATION_THREADS);
+			std::vector<std::thread> threads;
+			for (usize t = 0; t < FRAME_VALIDATION_THREADS; ++t)
+			{
+				threads.emplace_back([&arena, &allocations, t]() {
+					u64 state = 0x9E3779B97F4A7C15ull + t;
+					for (usize i = 0; i < FRAME_VALIDATION_ALLOCATIONS; ++i)
+					{
+						// Mostly small allocations, with the odd one large enough to take a span of its own.
+						u64 random = NextRandom(&state);
+						usize size = (random & 63) ? static_cast<usize>(1 + (random >> 8) % 256) : Memory::FrameArena::SPAN_SIZE;
+						usize alignment = static_cast<usize>(1) << ((random >> 32) % 7);
+
+						u8* address = static_cast<u8*>(arena.AllocateAligned(size, alignment));
+						if (reinterpret_cast<usize>(address) % alignment != 0)
+							address = nullptr;
+
+						if (address)
+							memset(address, static_cast<int>(t + 1), size);
+
+						allocations[t].push_back({ address, size, static_cast<u8>(t + 1) });
+					}
+				});
+			}
+
+			for (std::thread& thread : threads)
+				thread.join();
+
+			std::vector<FrameAllocation> all;
+			for (usize t = 0; t < FRAME_VALIDATION_THREADS; ++t)
+			{
+				for (const FrameAllocation& allocation : allocations[t])
+				{
+					if (!allocation.Address)
+					{
+						fprintf(stderr, "  FrameArena returned a null or misaligned allocation\n");
+						return false;
+					}
+
+					// An allocation overlapping another thread's would have been overwritten.
+					for (usize i = 0; i < allocation.Size; ++i)
+					{
+						if (allocation.Address[i] != allocation.Pattern)
+						{
+							fprintf(stderr, "  FrameArena allocation %p is shared between threads\n", allocation.Address);
+							return false;
+						}
+					}
+
+					all.push_back(allocation);
+				}
+			}
+
+			std::sort(all.begin(), all.end(), [](const FrameAllocation& InLeft, const FrameAllocation& InRight) { return InLeft.Address < InRight.Address; });
+			for (usize i = 1; i < all.size(); ++i)
+			{
+				if (all[i - 1].Address + all[i - 1].Size > all[i].Address)
+				{
+					fprintf(stderr, "  FrameArena allocations %p and %p overlap\n", all[i - 1].Address, all[i].Address);
+					return false;
+				}
+			}
+
+			if (frame == 1)
+				capacity = arena.GetCapacity();
+
+			if (frame > 1 && arena.GetCapacity() > capacity)
+			{
+				fprintf(stderr, "  FrameArena grew from %zu to %zu bytes instead of reusing its blocks\n", capacity, arena.GetCapacity());
+				return false;
+			}
+
+			arena.Reset();
+		}
+
+		return true;
+	}
+
+	bool ValidateTrackingAllocator()
+	{
+		// The Assets tag is otherwise unused by the benchmarks, so its counters start at rest.
+		const Memory::MemoryTag tag = Memory::MemoryTag::Assets;
+		Memory::MemoryStats before = Memory::MemoryManager::GetStats(tag);
+		Memory::MemoryManager::SetCallSiteCapture(true);
+
+		std::vector<std::vector<void*>> addresses(TRACKING_VALIDATION_THREADS);
+		std::vector<std::thread> threads;
+		for (usize t = 0; t < TRACKING_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&addresses, t, tag]() {
+				for (usize i = 0; i < TRACKING_VALIDATION_ALLOCATIONS; ++i)
+				{
+					// Sizes 1 to 64, with alignments up to 256 bytes.
+					usize alignment = static_cast<usize>(16) << (i % 5);
+					void* address = TRACKED_ALLOCATE_ALIGNED(tag, 1 + i % 64, alignment);
+					if (reinterpret_cast<usize>(address) % alignment != 0)
+						address = nullptr;
+
+					addresses[t].push_back(address);
+				}
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		usize bytes = 0;
+		for (usize i = 0; i < TRACKING_VALIDATION_ALLOCATIONS; ++i)
+			bytes += TRACKING_VALIDATION_THREADS * (1 + i % 64);
+
+		Memory::MemoryStats during = Memory::MemoryManager::GetStats(tag);
+		if (during.LiveBytes - before.LiveBytes != bytes || during.LiveCount - before.LiveCount != TRACKING_VALIDATION_THREADS * TRACKING_VALIDATION_ALLOCATIONS)
+		{
+			fprintf(stderr, "  MemoryManager counted %zu bytes in %zu allocations, expected %zu in %zu\n", during.LiveBytes - before.LiveBytes,
+				during.LiveCount - before.LiveCount, bytes, TRACKING_VALIDATION_THREADS * TRACKING_VALIDATION_ALLOCATIONS);
+			return false;
+		}
+
+		// Every allocation above comes from the same line, so a single call site holds them all.
+		std::vector<Memory::MemoryCallSite> sites(Memory::MemoryManager::MAX_CALL_SITES);
+		sites.resize(Memory::MemoryManager::GetCallSites(sites.data(), sites.size()));
+		auto site = std::find_if(sites.begin(), sites.end(), [tag](const Memory::MemoryCallSite& InSite) { return InSite.Tag == tag; });
+		if (site == sites.end() || site->LiveBytes != bytes)
+		{
+			fprintf(stderr, "  MemoryManager did not capture the call site of the allocations\n");
+			return false;
+		}
+
+		// Free on other threads than the ones that allocated.
+		threads.clear();
+		for (usize t = 0; t < TRACKING_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&addresses, t, tag]() {
+				for (void* address : addresses[(t + 1) % TRACKING_VALIDATION_THREADS])
+					TRACKED_FREE(tag, address);
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		Memory::MemoryManager::SetCallSiteCapture(false);
+
+		Memory::MemoryStats after = Memory::MemoryManager::GetStats(tag);
+		if (after.LiveBytes != before.LiveBytes || after.LiveCount != before.LiveCount || after.PeakBytes < before.LiveBytes + bytes)
+		{
+			fprintf(stderr, "  MemoryManager left %zu bytes live with a peak of %zu after freeing everything\n", after.LiveBytes, after.PeakBytes);
+			return false;
+		}
+
+		// An enforced budget refuses what would go over it, and lets the rest through.
+		Memory::MemoryManager::SetBudget(tag, after.LiveBytes + 1024, true);
+		void* fits = Memory::MemoryManager::GetAllocator(tag).Allocate(512);
+		void* overruns = Memory::MemoryManager::GetAllocator(tag).Allocate(1024);
+		Memory::MemoryManager::GetAllocator(tag).Free(fits);
+		Memory::MemoryManager::GetAllocator(tag).Free(overruns);
+		Memory::MemoryManager::SetBudget(tag, 0);
+
+		if (!fits || overruns || Memory::MemoryManager::GetStats(tag).BudgetOverruns == 0)
+		{
+			fprintf(stderr, "  MemoryManager did not enforce the budget of the tag\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ValidateTLSFAllocator()
+	{
+		struct Allocation
+		{
+			u8* Address;
+			usize Size;
+			u8 Pattern;
+		};
+
+		// Small pools, so the allocator grows and releases pools along the way.
+		Memory::TLSFAllocator allocator(TLSF_VALIDATION_POOL_SIZE);
+		std::vector<Allocation> slots(TLSF_VALIDATION_SLOTS, Allocation{ nullptr, 0, 0 });
+
+		u64 state = 0x9E3779B97F4A7C15ull;
+		for (usize round = 0; round < TLSF_VALIDATION_ROUNDS; ++round)
+		{
+			Allocation& slot = slots[NextRandom(&state) % TLSF_VALIDATION_SLOTS];
+			if (slot.Address)
+			{
+				for (usize i = 0; i < slot.Size; ++i)
+				{
+					if (slot.Address[i] != slot.Pattern)
+					{
+						fprintf(stderr, "  TLSFAllocator chunk of %zu bytes was overwritten at byte %zu\n", slot.Size, i);
+						return false;
+					}
+				}
+
+				allocator.Free(slot.Address);
+				slot.Address = nullptr;
+				continue;
+			}
+
+			// Mostly small chunks, with the odd one larger than a pool, at alignments up to 4K.
+			u64 random = NextRandom(&state);
+			usize size = (random & 63) ? RandomSize(&state) : TLSF_VALIDATION_POOL_SIZE + static_cast<usize>(random >> 40) % TLSF_VALIDATION_POOL_SIZE;
+			usize alignment = static_cast<usize>(1) << ((random >> 8) % 13);
+
+			slot.Address = static_cast<u8*>(allocator.AllocateAligned(size, alignment));
+			slot.Size = size;
+			slot.Pattern = static_cast<u8>(round);
+			if (!slot.Address || reinterpret_cast<usize>(slot.Address) % alignment != 0 || Memory::TLSFAllocator::GetSize(slot.Address) < size)
+			{
+				fprintf(stderr, "  TLSFAllocator returned a bad chunk for %zu bytes aligned to %zu\n", size, alignment);
+				return false;
+			}
+
+			memset(slot.Address, slot.Pattern, size);
+		}
+
+		Memory::TLSFStats during = allocator.GetStats();
+		for (Allocation& slot : slots)
+			allocator.Free(slot.Address);
+
+		// Everything merges back, and the pools grown for the burst are released.
+		Memory::TLSFStats after = allocator.GetStats();
+		if (during.UsedBytes == 0 || after.UsedBytes != 0 || after.UsedBlocks != 0 || after.PoolCount != 1 || after.FreeBlocks != 1 ||
+			after.LargestFreeBlock != after.FreeBytes || after.GetFragmentation() != 0.0f)
+		{
+			fprintf(stderr, "  TLSFAllocator kept %zu pools with %zu free blocks after freeing everything\n", after.PoolCount, after.FreeBlocks);
+			return false;
+		}
+
+		// A pool given by the caller is used up to its last byte, and never grown past.
+		std::vector<u64> buffer(TLSF_VALIDATION_POOL_SIZE / sizeof(u64));
+		Memory::TLSFAllocator fixed(0);
+		if (!fixed.AddPool(buffer.data(), TLSF_VALIDATION_POOL_SIZE))
+		{
+			fprintf(stderr, "  TLSFAllocator refused a pool of %zu bytes\n", TLSF_VALIDATION_POOL_SIZE);
+			return false;
+		}
+
+		std::vector<void*> chunks;
+		while (void* chunk = fixed.Allocate(POOL_BLOCK_SIZE))
+			chunks.push_back(chunk);
+
+		Memory::TLSFStats full = fixed.GetStats();
+		for (void* chunk : chunks)
+			fixed.Free(chunk);
+
+		if (full.PoolCount != 1 || full.FreeBytes >= 2 * POOL_BLOCK_SIZE || fixed.GetStats().FreeBlocks != 1)
+		{
+			fprintf(stderr, "  TLSFAllocator left %zu bytes of a fixed pool unused\n", full.FreeBytes);
+			return false;
+		}
+
+		// Switching the heap while memory is live frees every chunk to the heap it came from.
+		Memory::TLSFStats before = Memory::TLSFAllocator::Shared().GetStats();
+		Memory::TrackingAllocator& tracking = Memory::MemoryManager::GetAllocator(Memory::MemoryTag::Assets);
+
+		Memory::MemoryManager::SetHeap(Memory::HeapType::TLSF);
+		void* fromTLSF = tracking.AllocateAligned(POOL_BLOCK_SIZE, 64);
+		Memory::MemoryManager::SetHeap(Memory::HeapType::System);
+		void* fromSystem = tracking.Allocate(POOL_BLOCK_SIZE);
+		bool switched = Memory::TLSFAllocator::Shared().GetStats().UsedBlocks == before.UsedBlocks + 1;
+		tracking.Free(fromTLSF);
+		tracking.Free(fromSystem);
+
+		if (!switched || Memory::TLSFAllocator::Shared().GetStats().UsedBlocks != before.UsedBlocks)
+		{
+			fprintf(stderr, "  TrackingAllocator did not free to the heap it allocated from\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ValidateVirtualArena()
+	{
+		const Memory::MemoryTag tag = Memory::MemoryTag::Assets;
+		Memory::MemoryStats before = Memory::MemoryManager::GetStats(tag);
+
+		{
+			Memory::VirtualArena arena(VIRTUAL_ARENA_RESERVE, Memory::HugePages::None, tag);
+			if (!arena.IsValid() || arena.GetCommitted() != 0)
+			{
+				fprintf(stderr, "  VirtualArena could not reserve %zu bytes\n", VIRTUAL_ARENA_RESERVE);
+				return false;
+			}
+
+			// Allocations come out in order and commit pages only as they reach them.
+			u64 state = 0x9E3779B97F4A7C15ull;
+			u8* previous = nullptr;
+			while (arena.GetUsed() < VIRTUAL_VALIDATION_BYTES)
+			{
+				u64 random = NextRandom(&state);
+				usize size = 1 + RandomSize(&state);
+				usize alignment = static_cast<usize>(1) << (random % 13);
+
+				u8* address = static_cast<u8*>(arena.AllocateAligned(size, alignment));
+				if (!address || reinterpret_cast<usize>(address) % alignment != 0 || address < previous)
+				{
+					fprintf(stderr, "  VirtualArena returned a bad chunk for %zu bytes aligned to %zu\n", size, alignment);
+					return false;
+				}
+
+				memset(address, static_cast<u8>(random), size);
+				previous = address + size;
+
+				if (arena.GetCommitted() < arena.GetUsed() || arena.GetCommitted() > arena.GetUsed() + Memory::VirtualArena::COMMIT_GRANULARITY)
+				{
+					fprintf(stderr, "  VirtualArena committed %zu bytes for %zu used\n", arena.GetCommitted(), arena.GetUsed());
+					return false;
+				}
+			}
+
+			Memory::MemoryStats during = Memory::MemoryManager::GetStats(tag);
+			if (during.LiveBytes - before.LiveBytes != arena.GetCommitted() || during.LiveCount - before.LiveCount != 1)
+			{
+				fprintf(stderr, "  VirtualArena accounted %zu bytes for %zu committed\n", during.LiveBytes - before.LiveBytes, arena.GetCommitted());
+				return false;
+			}
+
+			// Rolling back to a marker releases everything after it, and nothing before it.
+			Memory::StackMarker marker = arena.GetMarker();
+			arena.Allocate(VIRTUAL_VALIDATION_BYTES);
+			arena.FreeToMarker(marker);
+			if (arena.GetUsed() != marker || arena.Allocate(VIRTUAL_ARENA_RESERVE) != nullptr)
+			{
+				fprintf(stderr, "  VirtualArena did not roll back to its marker\n");
+				return false;
+			}
+
+			// Allocations from several threads never overlap.
+			arena.Reset();
+			std::vector<std::vector<u8*>> addresses(VIRTUAL_VALIDATION_THREADS);
+			std::vector<std::thread> threads;
+			for (usize t = 0; t < VIRTUAL_VALIDATION_THREADS; ++t)
+			{
+				threads.emplace_back([&arena, &addresses, t]() {
+					for (usize i = 0; i < VIRTUAL_VALIDATION_ALLOCATIONS; ++i)
+					{
+						u8* address = static_cast<u8*>(arena.Allocate(POOL_BLOCK_SIZE));
+						if (address)
+							memset(address, static_cast<u8>(t), POOL_BLOCK_SIZE);
+
+						addresses[t].push_back(address);
+					}
+				});
+			}
+
+			for (std::thread& thread : threads)
+				thread.join();
+
+			for (usize t = 0; t < VIRTUAL_VALIDATION_THREADS; ++t)
+			{
+				for (u8* address : addresses[t])
+				{
+					if (!address || std::count(address, address + POOL_BLOCK_SIZE, static_cast<u8>(t)) != static_cast<std::ptrdiff_t>(POOL_BLOCK_SIZE))
+					{
+						fprintf(stderr, "  VirtualArena handed out overlapping chunks to different threads\n");
+						return false;
+					}
+				}
+			}
+
+			// Decommitting keeps what is asked for past the top, and returns the rest.
+			arena.Reset();
+			arena.Decommit(Memory::VirtualArena::COMMIT_GRANULARITY);
+			if (arena.GetCommitted() != Memory::VirtualArena::COMMIT_GRANULARITY ||
+				Memory::MemoryManager::GetStats(tag).LiveBytes - before.LiveBytes != Memory::VirtualArena::COMMIT_GRANULARITY)
+			{
+				fprintf(stderr, "  VirtualArena kept %zu bytes committed after decommitting\n", arena.GetCommitted());
+				return false;
+			}
+
+			arena.Decommit();
+			if (arena.GetCommitted() != 0 || !arena.Allocate(POOL_BLOCK_SIZE))
+			{
+				fprintf(stderr, "  VirtualArena could not be used again after decommitting\n");
+				return false;
+			}
+
+			// Huge pages are a request, so the arena works whether or not they are granted.
+			Memory::VirtualArena huge(VIRTUAL_ARENA_RESERVE, Memory::HugePages::Transparent, tag);
+			u8* address = static_cast<u8*>(huge.Allocate(VIRTUAL_VALIDATION_BYTES));
+			if (!address || (huge.GetHugePages() != Memory::HugePages::None && reinterpret_cast<usize>(address) % Memory::VirtualArena::HUGE_PAGE_SIZE != 0))
+			{
+				fprintf(stderr, "  VirtualArena backed by huge pages returned a bad chunk\n");
+				return false;
+			}
+
+			memset(address, 0xAB, VIRTUAL_VALIDATION_BYTES);
+		}
+
+		Memory::MemoryStats after = Memory::MemoryManager::GetStats(tag);
+		if (after.LiveBytes != before.LiveBytes || after.LiveCount != before.LiveCount)
+		{
+			fprintf(stderr, "  VirtualArena left %zu bytes accounted after being destroyed\n", after.LiveBytes - before.LiveBytes);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ValidateSmallObjectAllocator()
+	{
+		struct Allocation
+		{
+			u8* Address;
+			usize Size;
+			u8 Pattern;
+		};
+
+		Memory::SmallObjectAllocator allocator(SMALL_OBJECT_RESERVE);
+
+		// Random sizes, small and large, keep their contents until they are freed.
+		u64 state = 0xD1B54A32D192ED03ull;
+		std::vector<Allocation> slots(SMALL_OBJECT_VALIDATION_SLOTS, Allocation{ nullptr, 0, 0 });
+		for (usize round = 0; round < SMALL_OBJECT_VALIDATION_ROUNDS; ++round)
+		{
+			Allocation& slot = slots[NextRandom(&state) % SMALL_OBJECT_VALIDATION_SLOTS];
+			if (slot.Address)
+			{
+				if (std::count(slot.Address, slot.Address + slot.Size, slot.Pattern) != static_cast<std::ptrdiff_t>(slot.Size))
+				{
+					fprintf(stderr, "  SmallObjectAllocator chunk of %zu bytes was overwritten\n", slot.Size);
+					return false;
+				}
+
+				allocator.Free(slot.Address);
+				slot.Address = nullptr;
+				continue;
+			}
+
+			u64 random = NextRandom(&state);
+			usize size = (random & 31) ? 1 + static_cast<usize>(random >> 32) % Memory::SmallObjectAllocator::MAXIMUM_SMALL_SIZE : 1 + RandomSize(&state);
+			usize alignment = static_cast<usize>(1) << ((random >> 8) % 8);
+
+			slot.Address = static_cast<u8*>(allocator.AllocateAligned(size, alignment));
+			slot.Size = size;
+			slot.Pattern = static_cast<u8>(random >> 16);
+			if (!slot.Address || reinterpret_cast<usize>(slot.Address) % alignment != 0)
+			{
+				fprintf(stderr, "  SmallObjectAllocator returned a bad chunk for %zu bytes aligned to %zu\n", size, alignment);
+				return false;
+			}
+
+			memset(slot.Address, slot.Pattern, size);
+		}
+
+		for (Allocation& slot : slots)
+			allocator.Free(slot.Address);
+
+		// Spans emptied out are reused rather than carved again.
+		usize spans = allocator.GetSpanCount();
+		for (usize i = 0; i < SMALL_OBJECT_VALIDATION_SLOTS; ++i)
+			slots[i].Address = static_cast<u8*>(allocator.Allocate(POOL_BLOCK_SIZE));
+
+		for (Allocation& slot : slots)
+			allocator.Free(slot.Address);
+
+		if (allocator.GetSpanCount() != spans)
+		{
+			fprintf(stderr, "  SmallObjectAllocator carved %zu spans instead of reusing them\n", allocator.GetSpanCount() - spans);
+			return false;
+		}
+
+		// Blocks allocated on one thread and freed on others go back to their owner's spans.
+		std::vector<std::vector<u8*>> blocks(SMALL_OBJECT_VALIDATION_THREADS);
+		std::vector<std::thread> threads;
+		for (usize t = 0; t < SMALL_OBJECT_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&allocator, &blocks, t]() {
+				for (usize i = 0; i < SMALL_OBJECT_VALIDATION_BLOCKS; ++i)
+				{
+					u8* address = static_cast<u8*>(allocator.Allocate(POOL_BLOCK_SIZE));
+					if (address)
+						memset(address, static_cast<u8>(t), POOL_BLOCK_SIZE);
+
+					blocks[t].push_back(address);
+				}
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (usize t = 0; t < SMALL_OBJECT_VALIDATION_THREADS; ++t)
+		{
+			for (u8* address : blocks[t])
+			{
+				if (!address || std::count(address, address + POOL_BLOCK_SIZE, static_cast<u8>(t)) != static_cast<std::ptrdiff_t>(POOL_BLOCK_SIZE))
+				{
+					fprintf(stderr, "  SmallObjectAllocator handed out overlapping chunks to different threads\n");
+					return false;
+				}
+			}
+		}
+
+		// The threads have exited, so their heaps are adopted rather than created again.
+		usize heaps = allocator.GetHeapCount();
+		threads.clear();
+		for (usize t = 0; t < SMALL_OBJECT_VALIDATION_THREADS; ++t)
+		{
+			threads.emplace_back([&allocator, &blocks, t]() {
+				for (u8* address : blocks[(t + 1) % SMALL_OBJECT_VALIDATION_THREADS])
+					allocator.Free(address);
+
+				for (usize i = 0; i < SMALL_OBJECT_VALIDATION_BLOCKS; ++i)
+					allocator.Free(allocator.Allocate(POOL_BLOCK_SIZE));
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		if (allocator.GetHeapCount() != heaps)
+		{
+			fprintf(stderr, "  SmallObjectAllocator created %zu heaps instead of adopting them\n", allocator.GetHeapCount() - heaps);
+			return false;
+		}
+
+		// Every block freed remotely was collected, so an adopted heap fits as many blocks again.
+		spans = allocator.GetSpanCount();
+		std::thread([&allocator, &blocks]() {
+			for (u8*& address : blocks[0])
+				address = static_cast<u8*>(allocator.Allocate(POOL_BLOCK_SIZE));
+
+			for (u8* address : blocks[0])
+				allocator.Free(address);
+		}).join();
+
+		if (allocator.GetSpanCount() != spans)
+		{
+			fprintf(stderr, "  SmallObjectAllocator lost blocks freed by other threads\n");
+			return false;
+		}
+
+		// Switching the tracking allocators to the heap routes their chunks through it.
+		Memory::TrackingAllocator& tracking = Memory::MemoryManager::GetAllocator(Memory::MemoryTag::Assets);
+		Memory::MemoryManager::SetHeap(Memory::HeapType::SmallObject);
+		void* fromSmall = tracking.Allocate(POOL_BLOCK_SIZE);
+		Memory::MemoryManager::SetHeap(Memory::HeapType::System);
+		bool routed = fromSmall && Memory::SmallObjectAllocator::Shared().GetSpanCount() > 0;
+		tracking.Free(fromSmall);
+
+		if (!routed)
+		{
+			fprintf(stderr, "  TrackingAllocator did not allocate from the small object heap\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ReadProfileHeader(const utf8* InPath, unsigned long long* OutLiveCount, unsigned long long* OutTotalCount)
+	{
+		FILE* file = fopen(InPath, "r");
+		if (!file)
+			return false;
+
+		unsigned long long liveBytes, totalBytes;
+		int read = fscanf(file, "heap profile: %llu: %llu [%llu: %llu] @ heapprofile", OutLiveCount, &liveBytes, OutTotalCount, &totalBytes);
+		fclose(file);
+		return read == 4;
+	}
+
+	bool ValidateAllocationTracer()
+	{
+		Memory::DefaultAllocator heap;
+		Memory::TrackingAllocator& tracking = Memory::MemoryManager::GetAllocator(Memory::MemoryTag::General);
+		Memory::PoolAllocator pool(POOL_BLOCK_SIZE);
+		std::vector<void*> heapChunks(TRACER_VALIDATION_ALLOCATIONS), trackedChunks(TRACER_VALIDATION_ALLOCATIONS), pooledChunks(TRACER_VALIDATION_ALLOCATIONS);
+
+		// Fill the pool first, so it doesn't refill itself from the heap during the frame.
+		for (void*& chunk : pooledChunks)
+			chunk = pool.Allocate(POOL_BLOCK_SIZE);
+
+		for (void* chunk : pooledChunks)
+			pool.Free(chunk);
+
+		Memory::AllocationTracer::Enable();
+		Memory::AllocationTracer::BeginFrame();
+
+		unsigned long long liveBefore = 0, totalBefore = 0;
+		bool written = Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveBefore, &totalBefore);
+
+		for (usize i = 0; i < TRACER_VALIDATION_ALLOCATIONS; ++i)
+		{
+			heapChunks[i] = heap.Allocate(POOL_BLOCK_SIZE);
+			trackedChunks[i] = tracking.Allocate(POOL_BLOCK_SIZE);
+			pooledChunks[i] = pool.Allocate(POOL_BLOCK_SIZE);
+		}
+
+		// The tracking allocator's own heap call is nested in it, so it is only counted once.
+		Memory::AllocationTracer::BeginFrame();
+		Memory::FrameAllocations frame;
+		Memory::AllocationTracer::GetFrameHistory(&frame, 1);
+
+		unsigned long long liveDuring = 0, totalDuring = 0;
+		written = written && Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveDuring, &totalDuring);
+
+		for (usize i = 0; i < TRACER_VALIDATION_ALLOCATIONS; ++i)
+		{
+			heap.Free(heapChunks[i]);
+			tracking.Free(trackedChunks[i]);
+			pool.Free(pooledChunks[i]);
+		}
+
+		unsigned long long liveAfter = 0, totalAfter = 0;
+		written = written && Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveAfter, &totalAfter);
+		written = written && Memory::AllocationTracer::WriteFrameHistory(TRACER_HISTORY_PATH);
+
+		Memory::AllocationTracer::Disable();
+		remove(TRACER_PROFILE_PATH);
+		remove(TRACER_HISTORY_PATH);
+
+		if (!written)
+		{
+			fprintf(stderr, "  AllocationTracer could not write its profiles\n");
+			return false;
+		}
+
+		if (frame.HeapCount != 2 * TRACER_VALIDATION_ALLOCATIONS || frame.HeapBytes != 2 * TRACER_VALIDATION_ALLOCATIONS * POOL_BLOCK_SIZE ||
+			frame.PooledCount != TRACER_VALIDATION_ALLOCATIONS)
+		{
+			fprintf(stderr, "  AllocationTracer counted %llu heap and %llu pooled allocations in a frame\n",
+				static_cast<unsigned long long>(frame.HeapCount), static_cast<unsigned long long>(frame.PooledCount));
+			return false;
+		}
+
+		// Every chunk is sampled at the default rate, and the heap chunks are live until freed.
+		if (liveDuring - liveBefore != 2 * TRACER_VALIDATION_ALLOCATIONS || totalDuring - totalBefore != 3 * TRACER_VALIDATION_ALLOCATIONS ||
+			liveAfter != liveBefore)
+		{
+			fprintf(stderr, "  AllocationTracer profiled %llu live chunks, %llu after freeing them\n", liveDuring - liveBefore, liveAfter - liveBefore);
+			return false;
+		}
+
+		return true;
+	}
+
+#if defined(ALLOCATION_TRACING)
+	bool ValidateTracedNew()
+	{
+		std::vector<u64*> objects(TRACER_VALIDATION_ALLOCATIONS);
+
+		Memory::AllocationTracer::Enable();
+		Memory::AllocationTracer::BeginFrame();
+
+		unsigned long long liveBefore = 0, totalBefore = 0;
+		bool written = Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveBefore, &totalBefore);
+
+		for (u64*& object : objects)
+			object = new u64[TRACER_NEW_ELEMENTS];
+
+		Memory::AllocationTracer::BeginFrame();
+		Memory::FrameAllocations frame;
+		Memory::AllocationTracer::GetFrameHistory(&frame, 1);
+
+		unsigned long long liveDuring = 0, totalDuring = 0;
+		written = written && Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveDuring, &totalDuring);
+
+		for (u64* object : objects)
+			delete[] object;
+
+		unsigned long long liveAfter = 0, totalAfter = 0;
+		written = written && Memory::AllocationTracer::WriteHeapProfile(TRACER_PROFILE_PATH) && ReadProfileHeader(TRACER_PROFILE_PATH, &liveAfter, &totalAfter);
+
+		Memory::AllocationTracer::Disable();
+		remove(TRACER_PROFILE_PATH);
+
+		if (!written)
+		{
+			fprintf(stderr, "  AllocationTracer could not write its profile\n");
+			return false;
+		}
+
+		// Global operator new goes through the tracer like any other heap allocation.
+		if (frame.HeapCount != TRACER_VALIDATION_ALLOCATIONS || frame.HeapBytes != TRACER_VALIDATION_ALLOCATIONS * TRACER_NEW_ELEMENTS * sizeof(u64))
+		{
+			fprintf(stderr, "  AllocationTracer counted %llu allocations made with new in a frame\n", static_cast<unsigned long long>(frame.HeapCount));
+			return false;
+		}
+
+		// And global operator delete takes them out of the profile again.
+		if (liveDuring - liveBefore != TRACER_VALIDATION_ALLOCATIONS || liveAfter != liveBefore)
+		{
+			fprintf(stderr, "  AllocationTracer profiled %llu live objects made with new, %llu after deleting them\n", liveDuring - liveBefore, liveAfter - liveBefore);
+			return false;
+		}
+
+		return true;
+	}
+#endif
+
+	bool ValidateAllocatorAdapter()
+	{
+		const Memory::MemoryTag tag = Memory::MemoryTag::Assets;
+		Memory::MemoryStats before = Memory::MemoryManager::GetStats(tag);
+
+		{
+			// A tree over a pool, checked against the standard library's with random keys.
+			Memory::PoolAllocator pool(CONTAINER_NODE_SIZE);
+			Memory::MultiMap<u32, u32, tag> tree(pool);
+			std::multimap<u32, u32> reference;
+
+			u64 state = 0x2545F4914F6CDD1Dull;
+			for (usize i = 0; i < CONTAINER_VALIDATION_ENTRIES; ++i)
+			{
+				u32 key = static_cast<u32>(NextRandom(&state) % 512);
+				tree.emplace(key, static_cast<u32>(i));
+				reference.emplace(key, static_cast<u32>(i));
+
+				// Erase along the way, so the pool hands freed nodes out again.
+				if (i % 3 == 0)
+				{
+					u32 erased = static_cast<u32>(NextRandom(&state) % 512);
+					auto found = tree.find(erased);
+					if (found != tree.end())
+					{
+						tree.erase(found);
+						reference.erase(reference.find(erased));
+					}
+				}
+			}
+
+			if (tree.size() != reference.size() || !std::equal(tree.begin(), tree.end(), reference.begin(),
+				[](const std::pair<const u32, u32>& InLeft, const std::pair<const u32, u32>& InRight) { return InLeft == InRight; }))
+			{
+				fprintf(stderr, "  MultiMap over a PoolAllocator differs from std::multimap\n");
+				return false;
+			}
+
+			// A default constructed container allocates from its tag's tracking allocator.
+			Memory::Vector<u32, tag> values;
+			values.assign(CONTAINER_VALIDATION_ENTRIES, 7);
+			if (Memory::MemoryManager::GetStats(tag).LiveBytes < before.LiveBytes + CONTAINER_VALIDATION_ENTRIES * sizeof(u32))
+			{
+				fprintf(stderr, "  Memory::Vector did not account its storage to its tag\n");
+				return false;
+			}
+
+			// Swapping moves the allocators along with the elements.
+			Memory::Vector<u32, tag> pooled(pool);
+			pooled.swap(values);
+			if (pooled.get_stored_allocator().GetAllocator() == &pool || values.get_stored_allocator().GetAllocator() != &pool)
+			{
+				fprintf(stderr, "  Memory::Vector did not swap its allocator\n");
+				return false;
+			}
+		}
+
+		Memory::MemoryStats after = Memory::MemoryManager::GetStats(tag);
+		if (after.LiveBytes != before.LiveBytes || after.LiveCount != before.LiveCount)
+		{
+			fprintf(stderr, "  Containers left %zu bytes live after being destroyed\n", after.LiveBytes - before.LiveBytes);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ValidateRangeAllocator()
+	{
+		struct Range
+		{
+			usize Offset;
+			usize Size;
+			bool Used;
+		};
+
+		Memory::RangeAllocator allocator(RANGE_BLOCK_SIZE);
+		std::vector<Range> slots(RANGE_VALIDATION_SLOTS, Range{ 0, 0, false });
+		std::map<usize, usize> live;
+
+		u64 state = 0x9E3779B97F4A7C15ull;
+		for (usize round = 0; round < RANGE_VALIDATION_ROUNDS; ++round)
+		{
+			Range& slot = slots[NextRandom(&state) % RANGE_VALIDATION_SLOTS];
+			if (slot.Used)
+			{
+				allocator.Free(slot.Offset);
+				live.erase(slot.Offset);
+				slot.Used = false;
+				continue;
+			}
+
+			// Sizes and alignments in the range of buffers and images on a graphics device.
+			u64 random = NextRandom(&state);
+			usize size = 1 + static_cast<usize>((random >> 16) % RANGE_MIXED_MAXIMUM_SIZE);
+			usize alignment = static_cast<usize>(1) << (random & 15);
+
+			usize offset;
+			if (!allocator.Allocate(size, alignment, &offset))
+				continue;
+
+			// The range must be aligned, inside the block, and clear of every other live range.
+			auto next = live.lower_bound(offset);
+			bool overlaps = (next != live.end() && next->first < offset + size);
+			if (next != live.begin())
+			{
+				auto previous = next;
+				--previous;
+				overlaps |= previous->first + previous->second > offset;
+			}
+
+			if (offset % alignment != 0 || offset + size > RANGE_BLOCK_SIZE || overlaps)
+			{
+				fprintf(stderr, "  RangeAllocator returned a bad range at %zu for %zu bytes aligned to %zu\n", offset, size, alignment);
+				return false;
+			}
+
+			live.emplace(offset, size);
+			slot = Range{ offset, size, true };
+		}
+
+		usize used = 0;
+		for (const auto& range : live)
+			used += range.second;
+
+		if (allocator.GetUsedSize() != used || allocator.GetAllocationCount() != live.size())
+		{
+			fprintf(stderr, "  RangeAllocator counted %zu bytes in %zu ranges, expected %zu in %zu\n",
+				allocator.GetUsedSize(), allocator.GetAllocationCount(), used, live.size());
+			return false;
+		}
+
+		// Once everything is freed, the neighbours must have merged back into a single range.
+		for (const Range& slot : slots)
+		{
+			if (slot.Used)
+				allocator.Free(slot.Offset);
+		}
+
+		if (!allocator.IsEmpty() || allocator.GetFreeRangeCount() != 1 || allocator.GetLargestFreeRange() != RANGE_BLOCK_SIZE)
+		{
+			fprintf(stderr, "  RangeAllocator kept %zu free ranges after freeing everything\n", allocator.GetFreeRangeCount());
+			return false;
+		}
+
+		return true;
+	}
+
+	/* Benchmarks */
+
+	template <usize Size>
+	void Copy(u64 InIterations)
+	{
+		std::vector<u8> source(Size, 0xAB), destination(Size);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Memory::Copy(destination.data(), source.data(), Size);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void CopyNonTemporal(u64 InIterations)
+	{
+		std::vector<u8> source(Size, 0xAB), destination(Size);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Memory::CopyNonTemporal(destination.data(), source.data(), Size);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void LibcCopy(u64 InIterations)
+	{
+		std::vector<u8> source(Size, 0xAB), destination(Size);
+
+		// Hide the size from the compiler, which would otherwise inline the call for small constants.
+		usize size = Size;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(size);
+			void* result = memcpy(destination.data(), source.data(), size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void Set(u64 InIterations)
+	{
+		std::vector<u8> destination(Size);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Memory::Set(destination.data(), static_cast<u8>(i), Size);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void LibcSet(u64 InIterations)
+	{
+		std::vector<u8> destination(Size);
+
+		usize size = Size;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(size);
+			void* result = memset(destination.data(), static_cast<u8>(i), size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void Compare(u64 InIterations)
+	{
+		// Equal buffers are the worst case, since every byte must be inspected.
+		std::vector<u8> left(Size, 0xCD), right(Size, 0xCD);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			bool result = Memory::Compare(left.data(), right.data(), Size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void LibcCompare(u64 InIterations)
+	{
+		std::vector<u8> left(Size, 0xCD), right(Size, 0xCD);
+
+		usize size = Size;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(size);
+			bool result = memcmp(left.data(), right.data(), size) == 0;
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void Move(u64 InIterations)
+	{
+		// Overlapping regions, shifted by one cache line.
+		std::vector<u8> buffer(Size + 64, 0xEF);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Memory::Move(buffer.data() + 64, buffer.data(), Size);
+			ClobberMemory();
+		}
+	}
+
+	template <usize Size>
+	void LibcMove(u64 InIterations)
+	{
+		std::vector<u8> buffer(Size + 64, 0xEF);
+
+		usize size = Size;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			DoNotOptimize(size);
+			void* result = memmove(buffer.data() + 64, buffer.data(), size);
+			DoNotOptimize(result);
+			ClobberMemory();
+		}
+	}
+
+	void StackAllocate(u64 InIterations)
+	{
+		Memory::StackAllocator<STACK_SIZE> allocator;
+		Escape(&allocator);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < STACK_ALLOCATIONS; ++j)
+			{
+				void* address = allocator.Allocate(32);
+				DoNotOptimize(address);
+			}
+
+			allocator.Clear();
+		}
+	}
+
+	void StackAllocateAligned(u64 InIterations)
+	{
+		Memory::StackAllocator<STACK_SIZE> allocator;
+		Escape(&allocator);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < STACK_ALLOCATIONS; ++j)
+			{
+				void* address = allocator.AllocateAligned(24, 16);
+				DoNotOptimize(address);
+			}
+
+			allocator.Clear();
+		}
+	}
+
+	void StackScopedMarker(u64 InIterations)
+	{
+		Memory::StackAllocator<STACK_SIZE> allocator;
+		Escape(&allocator);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			Memory::StackAllocator<STACK_SIZE>::ScopedMarker scope(allocator);
+
+			for (usize j = 0; j < STACK_ALLOCATIONS; ++j)
+			{
+				void* address = allocator.Allocate(32);
+				DoNotOptimize(address);
+			}
+		}
+	}
+
+	void DoubleEndedAllocateUpper(u64 InIterations)
+	{
+		Memory::DoubleEndedStackAllocator<STACK_SIZE> allocator;
+		Escape(&allocator);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < STACK_ALLOCATIONS; ++j)
+			{
+				void* address = allocator.AllocateUpper(32, 16);
+				DoNotOptimize(address);
+			}
+
+			allocator.ClearUpper();
+		}
+	}
+
+	void PoolAllocateFree(u64 InIterations)
+	{
+		Memory::PoolAllocator allocator(POOL_BLOCK_SIZE);
+		void* addresses[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	void DefaultAllocateFree(u64 InIterations)
+	{
+		// The general purpose heap, as the reference for the pool.
+		Memory::DefaultAllocator allocator;
+		void* addresses[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	template <u32 SampleRate>
+	void TracedAllocateFree(u64 InIterations)
+	{
+		// The system heap with every allocation counted, and one in SampleRate with its stack captured.
+		Memory::DefaultAllocator allocator;
+		void* addresses[POOL_ALLOCATIONS];
+
+		Memory::AllocationTracer::Enable(SampleRate);
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+
+		Memory::AllocationTracer::Disable();
+	}
+
+	void TLSFAllocateFree(u64 InIterations)
+	{
+		Memory::TLSFAllocator allocator;
+		void* addresses[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	template <typename AllocatorType>
+	void MixedAllocateFree(AllocatorType* InAllocator, u64 InIterations)
+	{
+		// Random sizes freed in a random order, which is where general purpose heaps search and fragment.
+		usize sizes[TLSF_MIXED_ALLOCATIONS];
+		usize order[TLSF_MIXED_ALLOCATIONS];
+		void* addresses[TLSF_MIXED_ALLOCATIONS];
+
+		u64 state = 0x2545F4914F6CDD1Dull;
+		for (usize j = 0; j < TLSF_MIXED_ALLOCATIONS; ++j)
+		{
+			sizes[j] = 16 + static_cast<usize>(NextRandom(&state) % TLSF_MIXED_MAXIMUM_SIZE);
+			order[j] = j;
+		}
+
+		for (usize j = TLSF_MIXED_ALLOCATIONS - 1; j > 0; --j)
+			std::swap(order[j], order[NextRandom(&state) % (j + 1)]);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < TLSF_MIXED_ALLOCATIONS; ++j)
+			{
+				addresses[j] = InAllocator->Allocate(sizes[j]);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < TLSF_MIXED_ALLOCATIONS; ++j)
+				InAllocator->Free(addresses[order[j]]);
+
+			ClobberMemory();
+		}
+	}
+
+	void TLSFMixed(u64 InIterations)
+	{
+		Memory::TLSFAllocator allocator;
+		MixedAllocateFree(&allocator, InIterations);
+	}
+
+	void DefaultMixed(u64 InIterations)
+	{
+		Memory::DefaultAllocator allocator;
+		MixedAllocateFree(&allocator, InIterations);
+	}
+
+	void RangeMixed(u64 InIterations)
+	{
+		// Buffer and image sized ranges carved from a block of device memory, freed in a random order.
+		Memory::RangeAllocator allocator(RANGE_BLOCK_SIZE);
+		usize sizes[RANGE_MIXED_ALLOCATIONS];
+		usize order[RANGE_MIXED_ALLOCATIONS];
+		usize offsets[RANGE_MIXED_ALLOCATIONS];
+
+		u64 state = 0x2545F4914F6CDD1Dull;
+		for (usize j = 0; j < RANGE_MIXED_ALLOCATIONS; ++j)
+		{
+			sizes[j] = 256 + static_cast<usize>(NextRandom(&state) % RANGE_MIXED_MAXIMUM_SIZE);
+			order[j] = j;
+		}
+
+		for (usize j = RANGE_MIXED_ALLOCATIONS - 1; j > 0; --j)
+			std::swap(order[j], order[NextRandom(&state) % (j + 1)]);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < RANGE_MIXED_ALLOCATIONS; ++j)
+			{
+				allocator.Allocate(sizes[j], 256, &offsets[j]);
+				DoNotOptimize(offsets[j]);
+			}
+
+			for (usize j = 0; j < RANGE_MIXED_ALLOCATIONS; ++j)
+				allocator.Free(offsets[order[j]]);
+
+			ClobberMemory();
+		}
+	}
+
+	void TrackingAllocateFree(u64 InIterations)
+	{
+		// The DefaultAllocator plus the accounting of every allocation to its tag.
+		Memory::TrackingAllocator allocator(Memory::MemoryTag::General);
+		void* addresses[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	template <typename MapType>
+	void MultiMapInsertClear(MapType* InMap, u64 InIterations)
+	{
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < CONTAINER_ENTRIES; ++j)
+				InMap->emplace(static_cast<u32>((j * 37) % CONTAINER_ENTRIES), static_cast<u32>(j));
+
+			DoNotOptimize(InMap->size());
+			InMap->clear();
+			ClobberMemory();
+		}
+	}
+
+	void MultiMapHeap(u64 InIterations)
+	{
+		boost::container::multimap<u32, u32> map;
+		MultiMapInsertClear(&map, InIterations);
+	}
+
+	void MultiMapTracked(u64 InIterations)
+	{
+		Memory::MultiMap<u32, u32> map;
+		MultiMapInsertClear(&map, InIterations);
+	}
+
+	void MultiMapPool(u64 InIterations)
+	{
+		Memory::PoolAllocator pool(CONTAINER_NODE_SIZE);
+		Memory::MultiMap<u32, u32> map(pool);
+		MultiMapInsertClear(&map, InIterations);
+	}
+
+	void ObjectPoolCreateDestroy(u64 InIterations)
+	{
+		Memory::ObjectPool<PooledObject> pool;
+		PooledObject* objects[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				objects[j] = pool.Create();
+				DoNotOptimize(objects[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				pool.Destroy(objects[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	void FrameArenaAllocate(u64 InIterations)
+	{
+		Memory::FrameArena arena;
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				void* address = arena.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(address);
+			}
+
+			// Released all at once, as at the start of a frame.
+			arena.Reset();
+			ClobberMemory();
+		}
+	}
+
+	void VirtualArenaAllocate(u64 InIterations)
+	{
+		Memory::VirtualArena arena(VIRTUAL_ARENA_RESERVE);
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				void* address = arena.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(address);
+			}
+
+			// The pages stay committed across resets, so only the first pass commits.
+			arena.Reset();
+			ClobberMemory();
+		}
+	}
+
+	void SmallObjectAllocateFree(u64 InIterations)
+	{
+		Memory::SmallObjectAllocator& allocator = Memory::SmallObjectAllocator::Shared();
+		void* addresses[POOL_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(POOL_BLOCK_SIZE);
+				DoNotOptimize(addresses[j]);
+			}
+
+			for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+				allocator.Free(addresses[j]);
+
+			ClobberMemory();
+		}
+	}
+
+	template <usize Threads, typename AllocatorType>
+	void Contention(AllocatorType* InAllocator, u64 InIterations)
+	{
+		// Every thread allocates and frees at once, so a shared lock or cache line shows up as time.
+		// The threads wait for each other before starting, so the early ones do not finish before
+		// the late ones are even created.
+		std::atomic<usize> ready(0);
+		std::vector<std::thread> threads;
+		for (usize t = 0; t < Threads; ++t)
+		{
+			threads.emplace_back([InAllocator, InIterations, &ready]() {
+				ready.fetch_add(1);
+				while (ready.load() < Threads)
+					std::this_thread::yield();
+
+				void* addresses[POOL_ALLOCATIONS];
+				for (u64 i = 0; i < InIterations; ++i)
+				{
+					for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+					{
+						addresses[j] = InAllocator->Allocate(POOL_BLOCK_SIZE);
+						DoNotOptimize(addresses[j]);
+					}
+
+					for (usize j = 0; j < POOL_ALLOCATIONS; ++j)
+						InAllocator->Free(addresses[j]);
+
+					ClobberMemory();
+				}
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	template <usize Threads>
+	void SmallObjectContention(u64 InIterations)
+	{
+		Contention<Threads>(&Memory::SmallObjectAllocator::Shared(), InIterations);
+	}
+
+	template <usize Threads>
+	void DefaultContention(u64 InIterations)
+	{
+		Memory::DefaultAllocator allocator;
+		Contention<Threads>(&allocator, InIterations);
+	}
+
+	void StackAllocateFree(u64 InIterations)
+	{
+		Memory::StackAllocator<STACK_SIZE> allocator;
+		Escape(&allocator);
+		void* addresses[STACK_ALLOCATIONS];
+
+		for (u64 i = 0; i < InIterations; ++i)
+		{
+			for (usize j = 0; j < STACK_ALLOCATIONS; ++j)
+			{
+				addresses[j] = allocator.Allocate(32);
+				DoNotOptimize(addresses[j]);
+			}
+
+			// Release in reverse order, as the stack requires.
+			for (usize j = STACK_ALLOCATIONS; j > 0; --j)
+				allocator.Free(addresses[j - 1]);
+
+			ClobberMemory();
+		}
+	}
+}
+
+static bool ValidateCopyKernels() { return ValidateAtEveryKernelLevel(ValidateCopy, "Copy"); }
+static bool ValidateMoveKernels() { return ValidateAtEveryKernelLevel(ValidateMove, "Move"); }
+static bool ValidateSetKernels() { return ValidateAtEveryKernelLevel(ValidateSet, "Set"); }
+static bool ValidateCompareKernels() { return ValidateAtEveryKernelLevel(ValidateCompare, "Compare"); }
+
+REGISTER_VALIDATION(ValidateCopyKernels, "Memory::Copy");
+REGISTER_VALIDATION(ValidateMoveKernels, "Memory::Move");
+REGISTER_VALIDATION(ValidateSetKernels, "Memory::Set");
+REGISTER_VALIDATION(ValidateCompareKernels, "Memory::Compare");
+REGISTER_VALIDATION(ValidateStackMarkers, "Memory::StackAllocator");
+REGISTER_VALIDATION(ValidateDoubleEndedStack, "Memory::DoubleEndedStackAllocator");
+REGISTER_VALIDATION(ValidateStackGuards, "Memory::StackGuard");
+REGISTER_VALIDATION(ValidatePoolAllocator, "Memory::PoolAllocator");
+REGISTER_VALIDATION(ValidateFrameArena, "Memory::FrameArena");
+REGISTER_VALIDATION(ValidateTrackingAllocator, "Memory::TrackingAllocator");
+REGISTER_VALIDATION(ValidateTLSFAllocator, "Memory::TLSFAllocator");
+REGISTER_VALIDATION(ValidateVirtualArena, "Memory::VirtualArena");
+REGISTER_VALIDATION(ValidateSmallObjectAllocator, "Memory::SmallObjectAllocator");
+REGISTER_VALIDATION(ValidateAllocationTracer, "Memory::AllocationTracer");
+#if defined(ALLOCATION_TRACING)
+REGISTER_VALIDATION(ValidateTracedNew, "Memory::AllocationTracer::New");
+#endif
+REGISTER_VALIDATION(ValidateAllocatorAdapter, "Memory::AllocatorAdapter");
+REGISTER_VALIDATION(ValidateRangeAllocator, "Memory::RangeAllocator");
+
+static void CopySmall(u64 InIterations) { Copy<SMALL_SIZE>(InIterations); }
+static void CopyMedium(u64 InIterations) { Copy<MEDIUM_SIZE>(InIterations); }
+static void CopyLarge(u64 InIterations) { Copy<LARGE_SIZE>(InIterations); }
+static void CopyHuge(u64 InIterations) { Copy<HUGE_SIZE>(InIterations); }
+static void CopyNonTemporalHuge(u64 InIterations) { CopyNonTemporal<HUGE_SIZE>(InIterations); }
+static void SetSmall(u64 InIterations) { Set<SMALL_SIZE>(InIterations); }
+static void SetMedium(u64 InIterations) { Set<MEDIUM_SIZE>(InIterations); }
+static void SetLarge(u64 InIterations) { Set<LARGE_SIZE>(InIterations); }
+static void CompareSmall(u64 InIterations) { Compare<SMALL_SIZE>(InIterations); }
+static void CompareMedium(u64 InIterations) { Compare<MEDIUM_SIZE>(InIterations); }
+static void CompareLarge(u64 InIterations) { Compare<LARGE_SIZE>(InIterations); }
+static void MoveMedium(u64 InIterations) { Move<MEDIUM_SIZE>(InIterations); }
+static void LibcCopySmall(u64 InIterations) { LibcCopy<SMALL_SIZE>(InIterations); }
+static void LibcCopyMedium(u64 InIterations) { LibcCopy<MEDIUM_SIZE>(InIterations); }
+static void LibcCopyLarge(u64 InIterations) { LibcCopy<LARGE_SIZE>(InIterations); }
+static void LibcCopyHuge(u64 InIterations) { LibcCopy<HUGE_SIZE>(InIterations); }
+static void LibcSetMedium(u64 InIterations) { LibcSet<MEDIUM_SIZE>(InIterations); }
+static void LibcCompareMedium(u64 InIterations) { LibcCompare<MEDIUM_SIZE>(InIterations); }
+static void LibcMoveMedium(u64 InIterations) { LibcMove<MEDIUM_SIZE>(InIterations); }
+static void TracedAllocateFreeSampled(u64 InIterations) { TracedAllocateFree<TRACER_SAMPLE_RATE>(InIterations); }
+static void TracedAllocateFreeEvery(u64 InIterations) { TracedAllocateFree<1>(InIterations); }
+static void SmallObjectContention1(u64 InIterations) { SmallObjectContention<1>(InIterations); }
+static void SmallObjectContention4(u64 InIterations) { SmallObjectContention<4>(InIterations); }
+static void SmallObjectContention16(u64 InIterations) { SmallObjectContention<16>(InIterations); }
+static void SmallObjectContention64(u64 InIterations) { SmallObjectContention<64>(InIterations); }
+static void DefaultContention1(u64 InIterations) { DefaultContention<1>(InIterations); }
+static void DefaultContention4(u64 InIterations) { DefaultContention<4>(InIterations); }
+static void DefaultContention16(u64 InIterations) { DefaultContention<16>(InIterations); }
+static void DefaultContention64(u64 InIterations) { DefaultContention<64>(InIterations); }
+
+REGISTER_BENCHMARK(CopySmall, "Memory::Copy/64", SMALL_SIZE);
+REGISTER_BENCHMARK(CopyMedium, "Memory::Copy/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(CopyLarge, "Memory::Copy/1M", LARGE_SIZE);
+REGISTER_BENCHMARK(CopyHuge, "Memory::Copy/16M", HUGE_SIZE);
+REGISTER_BENCHMARK(CopyNonTemporalHuge, "Memory::CopyNonTemporal/16M", HUGE_SIZE);
+REGISTER_BENCHMARK(SetSmall, "Memory::Set/64", SMALL_SIZE);
+REGISTER_BENCHMARK(SetMedium, "Memory::Set/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(SetLarge, "Memory::Set/1M", LARGE_SIZE);
+REGISTER_BENCHMARK(CompareSmall, "Memory::Compare/64", SMALL_SIZE);
+REGISTER_BENCHMARK(CompareMedium, "Memory::Compare/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(CompareLarge, "Memory::Compare/1M", LARGE_SIZE);
+REGISTER_BENCHMARK(MoveMedium, "Memory::Move/4K", MEDIUM_SIZE);
+
+/* The C library equivalents, as the reference the Memory primitives are measured against. */
+REGISTER_BENCHMARK(LibcCopySmall, "libc::memcpy/64", SMALL_SIZE);
+REGISTER_BENCHMARK(LibcCopyMedium, "libc::memcpy/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(LibcCopyLarge, "libc::memcpy/1M", LARGE_SIZE);
+REGISTER_BENCHMARK(LibcCopyHuge, "libc::memcpy/16M", HUGE_SIZE);
+REGISTER_BENCHMARK(LibcSetMedium, "libc::memset/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(LibcCompareMedium, "libc::memcmp/4K", MEDIUM_SIZE);
+REGISTER_BENCHMARK(LibcMoveMedium, "libc::memmove/4K", MEDIUM_SIZE);
+
+REGISTER_BENCHMARK(StackAllocate, "Memory::StackAllocator::Allocate/64x32", 0);
+REGISTER_BENCHMARK(StackAllocateAligned, "Memory::StackAllocator::AllocateAligned/64x24", 0);
+REGISTER_BENCHMARK(StackAllocateFree, "Memory::StackAllocator::Free/64x32", 0);
+REGISTER_BENCHMARK(PoolAllocateFree, "Memory::PoolAllocator::AllocateFree/64x48", 0);
+REGISTER_BENCHMARK(DefaultAllocateFree, "Memory::DefaultAllocator::AllocateFree/64x48", 0);
+REGISTER_BENCHMARK(TLSFAllocateFree, "Memory::TLSFAllocator::AllocateFree/64x48", 0);
+REGISTER_BENCHMARK(TLSFMixed, "Memory::TLSFAllocator::Mixed/256", 0);
+REGISTER_BENCHMARK(DefaultMixed, "Memory::DefaultAllocator::Mixed/256", 0);
+REGISTER_BENCHMARK(SmallObjectAllocateFree, "Memory::SmallObjectAllocator::AllocateFree/64x48", 0);
+REGISTER_BENCHMARK(RangeMixed, "Memory::RangeAllocator::Mixed/256", 0);
+
+/* The same loop on 1 to 64 threads at once, where a shared heap serializes and a per thread one doesn't. */
+REGISTER_BENCHMARK(SmallObjectContention1, "Memory::SmallObjectAllocator::Contention/1", 0);
+REGISTER_BENCHMARK(SmallObjectContention4, "Memory::SmallObjectAllocator::Contention/4", 0);
+REGISTER_BENCHMARK(SmallObjectContention16, "Memory::SmallObjectAllocator::Contention/16", 0);
+REGISTER_BENCHMARK(SmallObjectContention64, "Memory::SmallObjectAllocator::Contention/64", 0);
+REGISTER_BENCHMARK(DefaultContention1, "Memory::DefaultAllocator::Contention/1", 0);
+REGISTER_BENCHMARK(DefaultContention4, "Memory::DefaultAllocator::Contention/4", 0);
+REGISTER_BENCHMARK(DefaultContention16, "Memory::DefaultAllocator::Contention/16", 0);
+REGISTER_BENCHMARK(DefaultContention64, "Memory::DefaultAllocator::Contention/64", 0);
+REGISTER_BENCHMARK(TrackingAllocateFree, "Memory::TrackingAllocator::AllocateFree/64x48", 0);
+REGISTER_BENCHMARK(TracedAllocateFreeSampled, "Memory::AllocationTracer::AllocateFree/64x48/Sampled", 0);
+REGISTER_BENCHMARK(TracedAllocateFreeEvery, "Memory::AllocationTracer::AllocateFree/64x48/Every", 0);
+REGISTER_BENCHMARK(ObjectPoolCreateDestroy, "Memory::ObjectPool::CreateDestroy/64x48", 0);
+REGISTER_BENCHMARK(MultiMapHeap, "boost::container::multimap::InsertClear/64", 0);
+REGISTER_BENCHMARK(MultiMapTracked, "Memory::MultiMap::InsertClear/64", 0);
+REGISTER_BENCHMARK(MultiMapPool, "Memory::MultiMap::InsertClear/Pool/64", 0);
+REGISTER_BENCHMARK(FrameArenaAllocate, "Memory::FrameArena::Allocate/64x48", 0);
+REGISTER_BENCHMARK(VirtualArenaAllocate, "Memory::VirtualArena::Allocate/64x48", 0);
+REGISTER_BENCHMARK(StackScopedMarker, "Memory::StackAllocator::ScopedMarker/64x32", 0);
+REGISTER_BENCHMARK(DoubleEndedAllocateUpper, "Memory::DoubleEndedStack::AllocateUpper/64x32", 0);
@@ -5,6 +5,10 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 textureCoordinate;
 
+// Per-instance attributes, each matrix taking four locations.
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in mat4 instanceNormal;
+
 layout(location = 0) out vec3 fragPosition;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTextureCoordinate;
@@ -13,21 +17,17 @@ layout(location = 3) out vec3 eyeDirection;
 layout(set = 0, binding = 0) uniform VertexUniform
 {
 	mat4 projection;
-} vu;
-
-layout(push_constant) uniform VertexPush
-{
 	mat4 view;
-	mat4 model;
-} vp;
+} vu;
 
 void main()
 {
-	gl_Position = vu.projection * vp.view * vp.model * vec4(position, 1.0);
+	gl_Position = vu.projection * vu.view * instanceModel * vec4(position, 1.0);
 
 	// Perform calculations and prepare data for the fragment shader.
-	fragPosition = (vp.model * vec4(position, 1.0)).xyz;
-	fragNormal = mat3(transpose(inverse(vp.model))) * normal;
+	// The normal matrix is computed once per entity on the CPU.
+	fragPosition = (instanceModel * vec4(position, 1.0)).xyz;
+	fragNormal = mat3(instanceNormal) * normal;
 	fragTextureCoordinate = textureCoordinate;
-	eyeDirection = -transpose(vp.view)[2].xyz;
+	eyeDirection = -transpose(vu.view)[2].xyz;
 }
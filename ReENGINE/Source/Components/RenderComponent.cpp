@@ -34,12 +34,12 @@ namespace Re
 		void RenderComponent::Update(f32 deltaTime)
 		{}
 
-		boost::container::vector<u32> RenderComponent::GetIndices() const
+		const boost::container::vector<u32>& RenderComponent::GetIndices() const
 		{
 			return _indices;
 		}
 
-		boost::container::vector<Graphics::Vertex> RenderComponent::GetVertices() const
+		const boost::container::vector<Graphics::Vertex>& RenderComponent::GetVertices() const
 		{
 			return _vertices;
 		}
@@ -26,8 +26,8 @@ namespace Re
             virtual void Initialize() override;
             virtual void Update(f32 deltaTime) override;
 
-            boost::container::vector<u32> GetIndices() const;
-            boost::container::vector<Graphics::Vertex> GetVertices() const;
+            const boost::container::vector<u32>& GetIndices() const;
+            const boost::container::vector<Graphics::Vertex>& GetVertices() const;
             Graphics::Material* GetMaterial() const;
 
         private:
@@ -14,7 +14,7 @@ namespace Re
 	namespace Components
 	{
 		TransformComponent::TransformComponent()
-			: _transform(Math::Transform()), _model(Math::Matrix::Identity())
+			: _transform(Math::Transform()), _model(Math::Matrix::Identity()), _normal(Math::Matrix::Identity()), _version(0)
 		{
 			// Set default scale values.
 			_transform._scale.X = 1.0f;
@@ -98,6 +98,16 @@ namespace Re
 			return _model;
 		}
 
+		Math::Matrix TransformComponent::GetNormal() const
+		{
+			return _normal;
+		}
+
+		u64 TransformComponent::GetVersion() const
+		{
+			return _version;
+		}
+
 		void TransformComponent::SetPosition(f32 newX, f32 newY, f32 newZ)
 		{
 			_transform._position.X = newX;
@@ -168,8 +178,12 @@ namespace Re
 
 		void TransformComponent::TransformChanged()
 		{
-			// Update model matrix.
+			// Update model and normal matrices.
 			_model = _transform.ToModel();
+			_normal = Math::Matrix::Normal(_model);
+
+			// Count the changes, so the renderer can tell transforms that stand still.
+			_version++;
 		}
 
 		const Math::Transform& TransformComponent::GetTransform() const
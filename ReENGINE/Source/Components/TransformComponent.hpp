@@ -32,6 +32,8 @@ namespace Re
 			Math::Rotator GetRotation() const;
 			Math::Vector3 GetScale() const;
 			Math::Matrix GetModel() const;
+			Math::Matrix GetNormal() const;
+			u64 GetVersion() const;
 
 			void SetPosition(f32 newX, f32 newY, f32 newZ);
 			void SetRotation(f32 newPitch, f32 newRoll, f32 newYaw);
@@ -51,7 +53,9 @@ namespace Re
 
 		private:
 			Math::Matrix _model;
+			Math::Matrix _normal;
 			Math::Transform _transform;
+			u64 _version;
 
 		};
 	}
@@ -13,6 +13,8 @@ namespace Re
 {
 	namespace Core
 	{
+		class Entity;
+
 		class Component
 		{
 			friend class Entity;
@@ -27,6 +29,7 @@ namespace Re
 
 		private:
 			Entity* Owner;
+			void (*Release)(Component*);
 
 		};
 	}
@@ -35,40 +35,49 @@ namespace Re
              *
              */
             template <typename... ParamType, u32 bufferSize = DEBUG_BUFFER>
-            static void Log(utf8* pStr, ParamType ... args)
+            static void Log(const utf8* pStr, ParamType ... args)
             {
                 // Create Buffer
                 utf8 pBuffer[bufferSize];
 
                 // Write to Buffer and Output
                 snprintf(pBuffer, bufferSize, pStr, args...);
+#if PLATFORM_WINDOWS
                 OutputDebugString(pBuffer);
+#else
+                fputs(pBuffer, stderr);
+#endif
             }
 
             /**
              * ...
              */
             template <typename... ParamType, u32 bufferSize = DEBUG_BUFFER>
-            static void Warning(utf8*, ParamType ...)
+            static void Warning(const utf8*, ParamType ...)
             {
             }
 
             /**
-             * @brief This method outputs a Unicode String to a Windows MessageBox.
+             * @brief This method outputs a Unicode String to a Windows MessageBox, or to the
+             * standard error on other platforms.
              *
              * @param pStr: the pointer to the unformatted version of the string to output.
              * @param args: the arguments to fill the string's parameters.
              *
              */
             template <typename... ParamType, u32 bufferSize = DEBUG_BUFFER>
-            static void Error(utf8* pStr, ParamType ... args)
+            static void Error(const utf8* pStr, ParamType ... args)
             {
                 // Create Buffer
                 utf8 pBuffer[bufferSize];
 
                 // Write to Buffer and Create MessageBox
                 snprintf(pBuffer, bufferSize, pStr, args...);
+#if PLATFORM_WINDOWS
                 MessageBox(nullptr, pBuffer, NTEXT("ReENGINE Error"), MB_OK);
+#else
+                fprintf(stderr, "ReENGINE Error: %s\n", pBuffer);
+#endif
             }
         };
     }
@@ -20,7 +20,7 @@ namespace Re
 		{
 			for (auto& comp : _components)
 			{
-				delete comp.second;
+				comp.second->Release(comp.second);
 			}
 
 			_components.clear();
@@ -9,6 +9,8 @@
 
 #include "Component.hpp"
 #include "Graphics/Vertex.hpp"
+#include "Memory/Containers.hpp"
+#include "Memory/ObjectPool.hpp"
 
 #include <boost/container/map.hpp>
 #include <boost/container/vector.hpp>
@@ -19,6 +21,8 @@ namespace Re
 {
     namespace Core
     {
+        class World;
+
         class Entity
         {
             friend class World;
@@ -37,10 +41,14 @@ namespace Re
             {
                 static_assert(boost::is_base_of<Component, ComponentType>::value,
                     "ComponentType passed for AddComponent does not inherit from Component.");
-                auto newComponent = new ComponentType(std::forward<ComponentArgs>(args)...);
+                // Components of the same type share a pool, so updating them walks contiguous memory.
+                auto newComponent = Memory::ObjectPool<ComponentType>::Shared().Create(std::forward<ComponentArgs>(args)...);
 
                 _components.emplace(&typeid(ComponentType), newComponent);
                 newComponent->Owner = this;
+                newComponent->Release = [](Component* InComponent) {
+                    Memory::ObjectPool<ComponentType>::Shared().Destroy(static_cast<ComponentType*>(InComponent));
+                };
                 newComponent->Initialize();
                 return newComponent;
             }
@@ -49,8 +57,9 @@ namespace Re
             boost::container::vector<ComponentType*> GetComponents()
             {
                 usize i = 0;
-                boost::container::vector<ComponentType*> components(_components.count(&typeid(ComponentType)));
-                for (auto it = _components.lower_bound(&typeid(ComponentType)); it != _components.upper_bound(&typeid(ComponentType)); ++it)
+                auto range = _components.equal_range(&typeid(ComponentType));
+                boost::container::vector<ComponentType*> components(static_cast<usize>(std::distance(range.first, range.second)));
+                for (auto it = range.first; it != range.second; ++it)
                     components[i++] = static_cast<ComponentType*>(it->second);
 
                 return components;
@@ -72,7 +81,7 @@ namespace Re
             Entity();
 
         private:
-            boost::container::multimap<const std::type_info*, Component*> _components;
+            Memory::MultiMap<const std::type_info*, Component*, Memory::MemoryTag::ECS> _components;
             u32 _id;
             World* _owner;
         };
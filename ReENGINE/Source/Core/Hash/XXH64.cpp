@@ -0,0 +1,121 @@
+/*
+ * XXH64.cpp
+ *
+ * This source file defines the functions declared in the XXH64.hpp
+ * header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "XXH64.hpp"
+
+#include <cstring>
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+namespace Re
+{
+	namespace Core
+	{
+		namespace Hash
+		{
+			namespace
+			{
+				FORCEINLINE u64 RotateLeft(u64 value, u32 count) {
+					return (value << count) | (value >> (64 - count));
+				}
+
+				// Objects need not be aligned, so words are copied out rather than dereferenced.
+				FORCEINLINE u64 Read64(const u8* pBytes) {
+					u64 value;
+					std::memcpy(&value, pBytes, sizeof(value));
+					return value;
+				}
+
+				FORCEINLINE u32 Read32(const u8* pBytes) {
+					u32 value;
+					std::memcpy(&value, pBytes, sizeof(value));
+					return value;
+				}
+
+				FORCEINLINE u64 Round(u64 accumulator, u64 input) {
+					accumulator += input * XXH_PRIME64_2;
+					accumulator = RotateLeft(accumulator, 31);
+					return accumulator * XXH_PRIME64_1;
+				}
+
+				FORCEINLINE u64 MergeRound(u64 accumulator, u64 value) {
+					accumulator ^= Round(0, value);
+					return accumulator * XXH_PRIME64_1 + XXH_PRIME64_4;
+				}
+			}
+
+			u64 XXH64(const void* pMem, usize length, u64 seed) {
+				const u8* pBytes = reinterpret_cast<const u8*>(pMem);
+				const u8* pEnd = pBytes + length;
+				u64 result;
+
+				if (length >= 32) {
+					// Four independent lanes keep the multipliers busy, 32 bytes per iteration.
+					u64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+					u64 v2 = seed + XXH_PRIME64_2;
+					u64 v3 = seed;
+					u64 v4 = seed - XXH_PRIME64_1;
+
+					const u8* pLimit = pEnd - 32;
+					do {
+						v1 = Round(v1, Read64(pBytes));
+						v2 = Round(v2, Read64(pBytes + 8));
+						v3 = Round(v3, Read64(pBytes + 16));
+						v4 = Round(v4, Read64(pBytes + 24));
+						pBytes += 32;
+					} while (pBytes <= pLimit);
+
+					result = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+					result = MergeRound(result, v1);
+					result = MergeRound(result, v2);
+					result = MergeRound(result, v3);
+					result = MergeRound(result, v4);
+				}
+				else {
+					result = seed + XXH_PRIME64_5;
+				}
+
+				result += static_cast<u64>(length);
+
+				// Consume whatever is left of the object, eight, four and then one byte at a time.
+				while (pBytes + 8 <= pEnd) {
+					result ^= Round(0, Read64(pBytes));
+					result = RotateLeft(result, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+					pBytes += 8;
+				}
+
+				if (pBytes + 4 <= pEnd) {
+					result ^= static_cast<u64>(Read32(pBytes)) * XXH_PRIME64_1;
+					result = RotateLeft(result, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+					pBytes += 4;
+				}
+
+				while (pBytes < pEnd) {
+					result ^= static_cast<u64>(*pBytes) * XXH_PRIME64_5;
+					result = RotateLeft(result, 11) * XXH_PRIME64_1;
+					pBytes++;
+				}
+
+				// Avalanche, so every input bit affects every output bit.
+				result ^= result >> 33;
+				result *= XXH_PRIME64_2;
+				result ^= result >> 29;
+				result *= XXH_PRIME64_3;
+				result ^= result >> 32;
+
+				return result;
+			}
+		}
+	}
+}
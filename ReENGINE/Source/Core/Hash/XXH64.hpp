@@ -0,0 +1,39 @@
+/*
+ * XXH64.hpp
+ *
+ * This header file defines the XXH64 hash used in ReENGINE for
+ * hashing large objects, such as the contents of meshes.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+namespace Re
+{
+	namespace Core
+	{
+		namespace Hash
+		{
+			/*
+			 * XXH64 Function
+			 *
+			 * This function is responsible for hashing any kind of object
+			 * using the 64-bit xxHash. It consumes eight bytes at a time,
+			 * rather than one like FNV, which makes it the better choice
+			 * for objects of more than a few dozen bytes.
+			 *
+			 * const void* pMem: the pointer to the object to hash.
+			 * usize length: the length, in bytes, of the object to hash.
+			 * u64 seed: the seed of the hash, which allows chaining hashes.
+			 *
+			 * return: an unsigned integer representing the object.
+			 *
+			 */
+			u64 XXH64(const void* pMem, usize length, u64 seed = 0);
+		}
+	}
+}
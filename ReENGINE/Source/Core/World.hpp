@@ -21,7 +21,6 @@
 #include <boost/container/map.hpp>
 #include <boost/container/vector.hpp>
 #include <boost/function.hpp>
-#include <boost/iterator/transform_iterator.hpp>
 #include <boost/lockfree/queue.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/thread.hpp>
@@ -65,7 +64,8 @@ namespace Re
 			{
 				static_assert(boost::is_base_of<Entity, EntityType>::value, "EntityType passed for SpawnEntity does not inherit from Entity.");
 
-				auto newEntity = boost::shared_ptr<EntityType>(new EntityType(std::forward<EntityArgs>(args)...));
+				auto newEntity = boost::shared_ptr<EntityType>(Memory::ObjectPool<EntityType>::Shared().Create(std::forward<EntityArgs>(args)...),
+					[](EntityType* InEntity) { Memory::ObjectPool<EntityType>::Shared().Destroy(InEntity); });
 				_entities.emplace(&typeid(EntityType), newEntity);
 				newEntity->_owner = this;
 				newEntity->Initialize();
@@ -76,12 +76,13 @@ namespace Re
 			template <typename EntityType>
 			boost::container::vector<boost::weak_ptr<EntityType>> GetEntities()
 			{
-				typedef boost::container::multimap<const std::type_info*, boost::shared_ptr<Entity>>::value_type value_type;
-				boost::function<boost::weak_ptr<EntityType>(value_type&)> f = boost::bind(&value_type::second, _1);
-				return boost::container::vector<boost::weak_ptr<EntityType>>(
-					boost::make_transform_iterator(_entities.lower_bound(&typeid(EntityType)), f),
-					boost::make_transform_iterator(_entities.upper_bound(&typeid(EntityType)), f)
-				);
+				auto range = _entities.equal_range(&typeid(EntityType));
+				boost::container::vector<boost::weak_ptr<EntityType>> entities;
+				entities.reserve(static_cast<usize>(std::distance(range.first, range.second)));
+				for (auto it = range.first; it != range.second; ++it)
+					entities.emplace_back(boost::static_pointer_cast<EntityType>(it->second));
+
+				return entities;
 			}
 
 		private:
@@ -91,7 +92,7 @@ namespace Re
 			boost::condition_variable _shouldDispatch;
 			bool _dispatchThreadShouldClose;
 
-			boost::container::multimap<const std::type_info*, boost::shared_ptr<Entity>> _entities;
+			Memory::MultiMap<const std::type_info*, boost::shared_ptr<Entity>, Memory::MemoryTag::ECS> _entities;
 			
 			Graphics::Renderer _renderer;
 			Platform::Win32Window _window;
@@ -12,11 +12,11 @@
 #include "Graphics/Texture.hpp"
 #include "Graphics/Vertex.hpp"
 #include "Math/Vector3.hpp"
+#include "Memory/Containers.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
-#include <boost/container/deque.hpp>
 #include <boost/container/vector.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
@@ -89,7 +89,7 @@ namespace Re
                             // Attempt to remove directory information from the texture path and create texture.
                             usize id = std::string(texturePath.data).rfind("\\");
                             std::string textureFilename = "Textures/" + std::string(texturePath.data).substr(id + 1);
-                            boost::shared_ptr<Graphics::Texture> texture = boost::make_shared<Graphics::Texture>(textureFilename.c_str());
+                            boost::shared_ptr<Graphics::Texture> texture = Graphics::Texture::Acquire(textureFilename.c_str());
 
                             // Create the material using the retrieved parameters and texture.
                             materials[i] = boost::make_shared<Graphics::Material>(specularPower, specularStrength, texture);
@@ -108,7 +108,7 @@ namespace Re
                 }
 
                 // Go through every single mesh in every node and create render components for them.
-                boost::container::deque<aiNode*> nodes = { scene->mRootNode };
+                Memory::Deque<aiNode*, Memory::MemoryTag::Assets> nodes = { scene->mRootNode };
                 while (!nodes.empty())
                 {
                     // Retrieve and remove first element from deque.
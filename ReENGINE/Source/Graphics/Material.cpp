@@ -45,5 +45,17 @@ namespace Re
         {
             return _diffuseTexture.get();
         }
+
+        void Material::SetSpecularPower(f32 specularPower)
+        {
+            _specularPower = specularPower;
+            OnParameterChanged();
+        }
+
+        void Material::SetSpecularStrength(f32 specularStrength)
+        {
+            _specularStrength = specularStrength;
+            OnParameterChanged();
+        }
     }
 }
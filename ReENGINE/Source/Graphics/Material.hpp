@@ -27,6 +27,9 @@ namespace Re
             f32 GetSpecularStrength() const;
             Texture* GetDiffuseTexture() const;
 
+            void SetSpecularPower(f32 specularPower);
+            void SetSpecularStrength(f32 specularStrength);
+
         public:
             boost::signals2::signal<void()> OnParameterChanged;
             
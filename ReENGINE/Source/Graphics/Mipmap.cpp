@@ -0,0 +1,111 @@
+/*
+ * Mipmap.cpp
+ *
+ * This source file defines the functions declared in the
+ * Mipmap.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Mipmap.hpp"
+
+namespace Re
+{
+	namespace Graphics
+	{
+		namespace
+		{
+			const u32 TEXEL_SIZE = 4;
+
+			// Every channel is read before any is written, so the compiler only has to check once that the output doesn't overlap the input.
+			FORCEINLINE void AverageTexel(const u8* InTopLeft, const u8* InTopRight, const u8* InBottomLeft, const u8* InBottomRight, u8* OutTexel)
+			{
+				const u8 red = static_cast<u8>((InTopLeft[0] + InTopRight[0] + InBottomLeft[0] + InBottomRight[0] + 2) >> 2);
+				const u8 green = static_cast<u8>((InTopLeft[1] + InTopRight[1] + InBottomLeft[1] + InBottomRight[1] + 2) >> 2);
+				const u8 blue = static_cast<u8>((InTopLeft[2] + InTopRight[2] + InBottomLeft[2] + InBottomRight[2] + 2) >> 2);
+				const u8 alpha = static_cast<u8>((InTopLeft[3] + InTopRight[3] + InBottomLeft[3] + InBottomRight[3] + 2) >> 2);
+
+				OutTexel[0] = red;
+				OutTexel[1] = green;
+				OutTexel[2] = blue;
+				OutTexel[3] = alpha;
+			}
+		}
+
+		u32 GetMipLevelCount(u32 InWidth, u32 InHeight)
+		{
+			u32 extent = InWidth > InHeight ? InWidth : InHeight;
+			u32 levels = 1;
+
+			while (extent > 1)
+			{
+				extent >>= 1;
+				levels++;
+			}
+
+			return levels;
+		}
+
+		usize GetMipChainSize(u32 InWidth, u32 InHeight, u32 InBPP)
+		{
+			const u32 levels = GetMipLevelCount(InWidth, InHeight);
+			usize size = 0;
+
+			for (u32 level = 0; level < levels; ++level)
+				size += static_cast<usize>(GetMipExtent(InWidth, level)) * GetMipExtent(InHeight, level) * InBPP;
+
+			return size;
+		}
+
+		void DownsampleBox(const u8* InSource, u32 InWidth, u32 InHeight, u8* OutDestination)
+		{
+			ASSERT(InSource && OutDestination);
+
+			const u32 width = GetMipExtent(InWidth, 1);
+			const u32 height = GetMipExtent(InHeight, 1);
+			const usize pitch = static_cast<usize>(InWidth) * TEXEL_SIZE;
+
+			// A source one texel wide or tall averages its only column or row with itself.
+			const usize rowStep = InHeight > 1 ? pitch : 0;
+
+			for (u32 y = 0; y < height; ++y)
+			{
+				const u8* top = InSource + static_cast<usize>(y) * 2 * rowStep;
+				const u8* bottom = top + rowStep;
+				u8* destination = OutDestination + static_cast<usize>(y) * width * TEXEL_SIZE;
+
+				if (InWidth == 1)
+				{
+					AverageTexel(top, top, bottom, bottom, destination);
+					continue;
+				}
+
+				// A plain loop over fixed strides, which the compiler vectorizes.
+				for (usize x = 0; x < width; ++x)
+				{
+					const usize column = x * 2 * TEXEL_SIZE;
+					AverageTexel(top + column, top + column + TEXEL_SIZE, bottom + column, bottom + column + TEXEL_SIZE, destination + x * TEXEL_SIZE);
+				}
+			}
+		}
+
+		void GenerateMipChain(const u8* InSource, u32 InWidth, u32 InHeight, u8* OutLevels)
+		{
+			ASSERT(InSource && OutLevels);
+
+			const u32 levels = GetMipLevelCount(InWidth, InHeight);
+			const u8* source = InSource;
+			u8* destination = OutLevels;
+
+			// Each level is filtered from the one before it, which is still warm in the cache.
+			for (u32 level = 1; level < levels; ++level)
+			{
+				DownsampleBox(source, GetMipExtent(InWidth, level - 1), GetMipExtent(InHeight, level - 1), destination);
+
+				source = destination;
+				destination += static_cast<usize>(GetMipExtent(InWidth, level)) * GetMipExtent(InHeight, level) * TEXEL_SIZE;
+			}
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/*
+ * Mipmap.hpp
+ *
+ * This header file declares the functions used by the ReENGINE to build
+ * the mip chains of textures on the CPU, before they are uploaded.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+namespace Re
+{
+	namespace Graphics
+	{
+		/*
+		 * @brief This function calculates the number of levels in the full mip chain of an image,
+		 * down to and including the 1x1 level.
+		 *
+		 * @param InWidth: the width of the image's first level.
+		 * @param InHeight: the height of the image's first level.
+		 *
+		 * @return the number of levels.
+		 *
+		 */
+		u32 GetMipLevelCount(u32 InWidth, u32 InHeight);
+
+		/*
+		 * @brief This function calculates the extent of a level of the mip chain, which halves on
+		 * each level, rounding down, but never drops below one.
+		 *
+		 * @param InExtent: the width or height of the image's first level.
+		 * @param InLevel: the level to calculate the extent of.
+		 *
+		 * @return the width or height of the level.
+		 *
+		 */
+		FORCEINLINE u32 GetMipExtent(u32 InExtent, u32 InLevel)
+		{
+			const u32 extent = InExtent >> InLevel;
+			return extent > 0 ? extent : 1;
+		}
+
+		/*
+		 * @brief This function calculates the size of the full mip chain of an image, with its
+		 * levels tightly packed one after the other, starting with the first level.
+		 *
+		 * @param InWidth: the width of the image's first level.
+		 * @param InHeight: the height of the image's first level.
+		 * @param InBPP: the number of bytes in each texel.
+		 *
+		 * @return the size of the chain, in bytes.
+		 *
+		 */
+		usize GetMipChainSize(u32 InWidth, u32 InHeight, u32 InBPP);
+
+		/*
+		 * @brief This function halves an image of four byte texels with a 2x2 box filter, rounding
+		 * to the nearest value. An odd last row or column is dropped, as Vulkan rounds the extents
+		 * of a mip level down.
+		 *
+		 * @param InSource: the texels of the image, tightly packed.
+		 * @param InWidth: the width of the image.
+		 * @param InHeight: the height of the image.
+		 * @param OutDestination: the location to store the texels of the halved image.
+		 *
+		 */
+		void DownsampleBox(const u8* InSource, u32 InWidth, u32 InHeight, u8* OutDestination);
+
+		/*
+		 * @brief This function builds every level after the first of the mip chain of an image of
+		 * four byte texels, each from the one before it. The levels are tightly packed one after
+		 * the other, so the destination must hold GetMipChainSize minus the size of the first level.
+		 *
+		 * @param InSource: the texels of the image's first level, tightly packed.
+		 * @param InWidth: the width of the image's first level.
+		 * @param InHeight: the height of the image's first level.
+		 * @param OutLevels: the location to store the texels of the remaining levels.
+		 *
+		 */
+		void GenerateMipChain(const u8* InSource, u32 InWidth, u32 InHeight, u8* OutLevels);
+	}
+}
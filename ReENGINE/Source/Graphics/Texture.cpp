@@ -7,9 +7,16 @@
 
 #include "Texture.hpp"
 
+#include "Core/Hash/XXH64.hpp"
+#include "Memory/Containers.hpp"
 #include "String/Character.hpp"
 
 #include <FreeImage.h>
+#include <algorithm>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+#include <cctype>
 
 const u32 defaultBPP = 32;
 const u32 defaultWidth = 2048;
@@ -55,12 +62,70 @@ u8* buildDefaultImage()
 
 static u8* defaultImage = buildDefaultImage();
 
+static u64 hashImage(u32 width, u32 height, u32 bpp, const u8* pixels)
+{
+    // The size goes into the seed, so images of equal bytes but different shapes do not collide.
+    const u32 size[] = { width, height, bpp };
+    u64 seed = Re::Core::Hash::XXH64(size, sizeof(size));
+
+    return Re::Core::Hash::XXH64(pixels, static_cast<usize>(width) * height * bpp, seed);
+}
+
+static std::string normalizePath(const utf8* filename)
+{
+    std::string path(filename);
+    std::replace(path.begin(), path.end(), '\\', '/');
+
+#if PLATFORM_WINDOWS
+    // Paths on Windows are not case sensitive.
+    std::transform(path.begin(), path.end(), path.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+#endif
+
+    // Drop empty and "." segments, and resolve ".." against the segment before it, if there is one.
+    Re::Memory::Vector<std::string, Re::Memory::MemoryTag::Assets> segments;
+    usize start = 0;
+    while (start <= path.size())
+    {
+        usize end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+
+        std::string segment = path.substr(start, end - start);
+        if (segment == ".." && !segments.empty() && segments.back() != "..")
+            segments.pop_back();
+        else if (!segment.empty() && segment != ".")
+            segments.push_back(segment);
+
+        start = end + 1;
+    }
+
+    std::string normalized = (!path.empty() && path[0] == '/') ? "/" : "";
+    for (usize i = 0; i < segments.size(); ++i)
+    {
+        if (i > 0) normalized += '/';
+        normalized += segments[i];
+    }
+
+    return normalized;
+}
+
+struct TextureCache
+{
+    boost::mutex _mutex;
+    Re::Memory::Map<std::string, boost::weak_ptr<Re::Graphics::Texture>, Re::Memory::MemoryTag::Assets> _textures;
+};
+
+static TextureCache& getTextureCache()
+{
+    static TextureCache cache;
+    return cache;
+}
+
 namespace Re
 {
     namespace Graphics
     {
         Texture::Texture()
-            : _filename(""), _isLoaded(false), _width(0), _height(0), _pixels(), _handle(nullptr)
+            : _filename(""), _isLoaded(false), _width(0), _height(0), _pixels(), _handle(nullptr), _contentHash(0), _hasContentHash(false)
         {}
 
         Texture::Texture(const utf8* filename)
@@ -72,7 +137,41 @@ namespace Re
         }
 
         Texture::~Texture()
-        {}
+        {
+            Unload();
+        }
+
+        boost::shared_ptr<Texture> Texture::Acquire(const utf8* filename)
+        {
+            std::string path = normalizePath(filename);
+
+            TextureCache& cache = getTextureCache();
+            boost::lock_guard<boost::mutex> lock(cache._mutex);
+
+            auto it = cache._textures.find(path);
+            if (it != cache._textures.end())
+            {
+                boost::shared_ptr<Texture> texture = it->second.lock();
+                if (texture) return texture;
+            }
+
+            // The texture leaves the cache along with its last holder, unless it has been acquired anew in the meantime.
+            boost::shared_ptr<Texture> texture(new Texture(path.c_str()), [](Texture* released) {
+                TextureCache& cache = getTextureCache();
+                {
+                    boost::lock_guard<boost::mutex> lock(cache._mutex);
+
+                    auto it = cache._textures.find(released->_filename);
+                    if (it != cache._textures.end() && it->second.expired())
+                        cache._textures.erase(it);
+                }
+
+                delete released;
+            });
+
+            cache._textures[path] = texture;
+            return texture;
+        }
 
         void Texture::Load()
         {
@@ -102,6 +201,9 @@ namespace Re
                         _pixels = FreeImage_GetBits(img);
                         _handle = img;
                         _isLoaded = true;
+
+                        _contentHash = hashImage(_width, _height, _bpp, _pixels);
+                        _hasContentHash = true;
                         return;
                     }
                 }
@@ -122,7 +224,7 @@ namespace Re
                 FreeImage_Unload(img);
             }
 
-            // Reset texture data to nothingness, except filename.
+            // Reset texture data to nothingness, except filename and content hash.
             _bpp = 0;
             _width = 0;
             _height = 0;
@@ -156,6 +258,16 @@ namespace Re
             return _pixels;
         }
 
+        bool Texture::HasContentHash() const
+        {
+            return _hasContentHash;
+        }
+
+        u64 Texture::GetContentHash() const
+        {
+            return _contentHash;
+        }
+
         void Texture::LoadDefaultTexture()
         {
             // Save default information (grid pattern) into texture.
@@ -165,6 +277,11 @@ namespace Re
             _pixels = defaultImage;
             _handle = nullptr;
             _isLoaded = true;
+
+            // Every texture falling back to the default shares its hash, which is computed once.
+            static const u64 defaultHash = hashImage(defaultWidth, defaultHeight, defaultBPP / 8, defaultImage);
+            _contentHash = defaultHash;
+            _hasContentHash = true;
         }
     }
 }
@@ -9,6 +9,7 @@
 
 #include "Core/Debug/Assert.hpp"
 
+#include <boost/shared_ptr.hpp>
 #include <string>
 
 namespace Re
@@ -22,6 +23,9 @@ namespace Re
             explicit Texture(const utf8* filename);
             virtual ~Texture();
 
+            // Returns the texture of a file, shared with everyone holding it already, so each file is decoded once while in use.
+            static boost::shared_ptr<Texture> Acquire(const utf8* filename);
+
             void Load();
             void Unload();
 
@@ -31,6 +35,10 @@ namespace Re
             usize GetBPP() const;
             u8* GetPixels() const;
 
+            // The hash of the size and pixels, which stays known once the texture has been loaded.
+            bool HasContentHash() const;
+            u64 GetContentHash() const;
+
         private:
             void LoadDefaultTexture();
 
@@ -47,6 +55,9 @@ namespace Re
             
             void* _handle;
 
+            u64 _contentHash;
+            bool _hasContentHash;
+
         };
     }
 }
@@ -23,7 +23,7 @@ namespace Re
 				// Calculate lines to find normal, using the cross-product.
 				Math::Vector3 v1 = vertices[in1]._position - vertices[in0]._position;
 				Math::Vector3 v2 = vertices[in2]._position - vertices[in0]._position;
-				Math::Vector3 normal = Math::Vector3::Cross(v1, v2).Normalize();
+				Math::Vector3 normal = Math::Vector3::Cross(v1, v2).Normalize(Math::Fast::Accuracy::Medium);
 
 				// Add the normal to the vertices it belongs.
 				vertices[in0]._normal += normal;
@@ -33,7 +33,7 @@ namespace Re
 
 			// Normalize the normal of each vertex.
 			for (usize i = 0; i < vertices.size(); ++i)
-				vertices[i]._normal.Normalize();
+				vertices[i]._normal.Normalize(Math::Fast::Accuracy::Medium);
 		}
     }
 }
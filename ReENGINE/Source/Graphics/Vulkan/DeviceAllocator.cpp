@@ -0,0 +1,395 @@
+/*
+ * DeviceAllocator.cpp
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "DeviceAllocator.hpp"
+
+#ifdef PLATFORM_USE_VULKAN
+
+#include <algorithm>
+
+namespace Re
+{
+	namespace Graphics
+	{
+		DeviceAllocator::DeviceAllocator()
+			: _device(VK_NULL_HANDLE), _memoryProperties{}, _blockSize(DEFAULT_BLOCK_SIZE), _blockPool(16, Memory::MemoryTag::Renderer),
+			  _dedicatedCount{}, _dedicatedBytes{}
+		{}
+
+		DeviceAllocator::~DeviceAllocator()
+		{
+			Shutdown();
+		}
+
+		void DeviceAllocator::Startup(VkPhysicalDevice physical, VkDevice logical, VkDeviceSize blockSize)
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			_device = logical;
+			_blockSize = blockSize;
+			vkGetPhysicalDeviceMemoryProperties(physical, &_memoryProperties);
+		}
+
+		void DeviceAllocator::Shutdown()
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			// Every resource should be gone by now, whatever is left is released with its block.
+			for (u32 i = 0; i < VK_MAX_MEMORY_TYPES; ++i)
+			{
+				for (DeviceBlock* block : _blocks[i])
+				{
+					ASSERT(block->_ranges.IsEmpty());
+					DestroyBlock(block);
+				}
+
+				_blocks[i].clear();
+			}
+		}
+
+		VkResult DeviceAllocator::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation)
+		{
+			if (!outAllocation) return VK_ERROR_INITIALIZATION_FAILED;
+
+			// Ask whether the driver would rather keep the buffer in an allocation of its own.
+			VkMemoryDedicatedRequirements dedicatedRequirements = {};
+			dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+			VkMemoryRequirements2 requirements = {};
+			requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			requirements.pNext = &dedicatedRequirements;
+
+			VkBufferMemoryRequirementsInfo2 requirementsInfo = {};
+			requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+			requirementsInfo.buffer = buffer;
+
+			vkGetBufferMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+			bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+			VkResult result = Allocate(requirements.memoryRequirements, dedicated, buffer, VK_NULL_HANDLE, properties, DeviceResourceKind::Buffer, outAllocation);
+			if (result != VK_SUCCESS) return result;
+
+			result = vkBindBufferMemory(_device, buffer, outAllocation->_memory, outAllocation->_offset);
+			if (result != VK_SUCCESS) Free(outAllocation);
+
+			return result;
+		}
+
+		VkResult DeviceAllocator::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation)
+		{
+			if (!outAllocation) return VK_ERROR_INITIALIZATION_FAILED;
+
+			// Ask whether the driver would rather keep the image in an allocation of its own, as it often does for render targets.
+			VkMemoryDedicatedRequirements dedicatedRequirements = {};
+			dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+			VkMemoryRequirements2 requirements = {};
+			requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			requirements.pNext = &dedicatedRequirements;
+
+			VkImageMemoryRequirementsInfo2 requirementsInfo = {};
+			requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+			requirementsInfo.image = image;
+
+			vkGetImageMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+			bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+			VkResult result = Allocate(requirements.memoryRequirements, dedicated, VK_NULL_HANDLE, image, properties, DeviceResourceKind::Image, outAllocation);
+			if (result != VK_SUCCESS) return result;
+
+			result = vkBindImageMemory(_device, image, outAllocation->_memory, outAllocation->_offset);
+			if (result != VK_SUCCESS) Free(outAllocation);
+
+			return result;
+		}
+
+		void DeviceAllocator::Free(DeviceAllocation* allocation)
+		{
+			if (!allocation || allocation->_memory == VK_NULL_HANDLE) return;
+
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			DeviceBlock* block = allocation->_block;
+			if (block)
+			{
+				block->_ranges.Free(static_cast<usize>(allocation->_offset));
+
+				// Return empty blocks to the driver, but keep the last one of its kind around to
+				// avoid allocating it again right away, unless it is being evacuated.
+				if (block->_ranges.IsEmpty())
+				{
+					auto& blocks = _blocks[block->_memoryType];
+					usize siblings = std::count_if(blocks.begin(), blocks.end(), [block](const DeviceBlock* other) {
+						return other->_kind == block->_kind;
+					});
+
+					if (block->_evacuating || siblings > 1)
+					{
+						blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+						DestroyBlock(block);
+					}
+				}
+			}
+			else
+			{
+				if (allocation->_mapped)
+					vkUnmapMemory(_device, allocation->_memory);
+
+				vkFreeMemory(_device, allocation->_memory, nullptr);
+				_dedicatedCount[allocation->_memoryType]--;
+				_dedicatedBytes[allocation->_memoryType] -= allocation->_size;
+			}
+
+			*allocation = DeviceAllocation();
+		}
+
+		void DeviceAllocator::BeginDefragmentation(f32 maximumUsage)
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			for (u32 i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+			{
+				for (usize kind = 0; kind < static_cast<usize>(DeviceResourceKind::Count); ++kind)
+				{
+					// Find the fullest block of this kind, which is kept as a destination.
+					DeviceBlock* fullest = nullptr;
+					for (DeviceBlock* block : _blocks[i])
+					{
+						if (static_cast<usize>(block->_kind) == kind && (!fullest || block->_ranges.GetUsedSize() > fullest->_ranges.GetUsedSize()))
+							fullest = block;
+					}
+
+					// Evacuate every other block that is mostly empty.
+					for (DeviceBlock* block : _blocks[i])
+					{
+						if (static_cast<usize>(block->_kind) != kind || block == fullest) continue;
+
+						f32 usage = static_cast<f32>(block->_ranges.GetUsedSize()) / static_cast<f32>(block->_ranges.GetSize());
+						block->_evacuating = usage < maximumUsage;
+					}
+				}
+			}
+		}
+
+		bool DeviceAllocator::ShouldMove(const DeviceAllocation& allocation) const
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return allocation._block && allocation._block->_evacuating;
+		}
+
+		void DeviceAllocator::EndDefragmentation()
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			// Blocks that could not be emptied go back to serving allocations.
+			for (u32 i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+			{
+				for (DeviceBlock* block : _blocks[i])
+					block->_evacuating = false;
+			}
+		}
+
+		DeviceMemoryStatistics DeviceAllocator::GetStatistics() const
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			DeviceMemoryStatistics statistics = {};
+			for (u32 i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+				AddStatistics(i, &statistics);
+
+			return statistics;
+		}
+
+		DeviceMemoryStatistics DeviceAllocator::GetStatistics(u32 memoryType) const
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			DeviceMemoryStatistics statistics = {};
+			if (memoryType < _memoryProperties.memoryTypeCount)
+				AddStatistics(memoryType, &statistics);
+
+			return statistics;
+		}
+
+		u32 DeviceAllocator::GetMemoryTypeCount() const
+		{
+			return _memoryProperties.memoryTypeCount;
+		}
+
+		VkResult DeviceAllocator::Allocate(const VkMemoryRequirements& requirements, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage,
+			VkMemoryPropertyFlags properties, DeviceResourceKind kind, DeviceAllocation* outAllocation)
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			u32 memoryType = FindMemoryTypeIndex(requirements.memoryTypeBits, properties);
+			if (memoryType == static_cast<u32>(-1)) return VK_ERROR_FEATURE_NOT_PRESENT;
+
+			// Resources that would take up most of a block are better off on their own.
+			if (dedicated || requirements.size > GetBlockSize(memoryType) / 2)
+				return AllocateDedicated(requirements, memoryType, dedicatedBuffer, dedicatedImage, outAllocation);
+
+			// Take the first block of the same kind with a range that fits, then a new block.
+			DeviceBlock* found = nullptr;
+			usize offset = 0;
+			for (DeviceBlock* block : _blocks[memoryType])
+			{
+				if (block->_kind == kind && !block->_evacuating && block->_ranges.Allocate(static_cast<usize>(requirements.size), static_cast<usize>(requirements.alignment), &offset))
+				{
+					found = block;
+					break;
+				}
+			}
+
+			if (!found)
+			{
+				// When the heap has no room for another block, the resource may still fit by itself.
+				if (CreateBlock(memoryType, kind, &found) != VK_SUCCESS)
+					return AllocateDedicated(requirements, memoryType, dedicatedBuffer, dedicatedImage, outAllocation);
+
+				// A block of a small heap may still be too small for the resource.
+				if (!found->_ranges.Allocate(static_cast<usize>(requirements.size), static_cast<usize>(requirements.alignment), &offset))
+					return AllocateDedicated(requirements, memoryType, dedicatedBuffer, dedicatedImage, outAllocation);
+			}
+
+			outAllocation->_memory = found->_memory;
+			outAllocation->_offset = offset;
+			outAllocation->_size = requirements.size;
+			outAllocation->_mapped = found->_mapped ? static_cast<u8*>(found->_mapped) + offset : nullptr;
+			outAllocation->_block = found;
+			outAllocation->_memoryType = memoryType;
+
+			return VK_SUCCESS;
+		}
+
+		VkResult DeviceAllocator::AllocateDedicated(const VkMemoryRequirements& requirements, u32 memoryType, VkBuffer dedicatedBuffer, VkImage dedicatedImage,
+			DeviceAllocation* outAllocation)
+		{
+			// Tell the driver which resource the memory is for, so it can place it as it sees fit.
+			VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+			dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+			dedicatedInfo.buffer = dedicatedBuffer;
+			dedicatedInfo.image = dedicatedImage;
+
+			VkMemoryAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.pNext = &dedicatedInfo;
+			allocateInfo.allocationSize = requirements.size;
+			allocateInfo.memoryTypeIndex = memoryType;
+
+			VkDeviceMemory memory;
+			VkResult result = vkAllocateMemory(_device, &allocateInfo, nullptr, &memory);
+			if (result != VK_SUCCESS) return result;
+
+			void* mapped = nullptr;
+			if (IsHostVisible(memoryType))
+			{
+				result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+				if (result != VK_SUCCESS)
+				{
+					vkFreeMemory(_device, memory, nullptr);
+					return result;
+				}
+			}
+
+			outAllocation->_memory = memory;
+			outAllocation->_offset = 0;
+			outAllocation->_size = requirements.size;
+			outAllocation->_mapped = mapped;
+			outAllocation->_block = nullptr;
+			outAllocation->_memoryType = memoryType;
+
+			_dedicatedCount[memoryType]++;
+			_dedicatedBytes[memoryType] += requirements.size;
+
+			return VK_SUCCESS;
+		}
+
+		VkResult DeviceAllocator::CreateBlock(u32 memoryType, DeviceResourceKind kind, DeviceBlock** outBlock)
+		{
+			VkDeviceSize size = GetBlockSize(memoryType);
+
+			VkMemoryAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocateInfo.allocationSize = size;
+			allocateInfo.memoryTypeIndex = memoryType;
+
+			VkDeviceMemory memory;
+			VkResult result = vkAllocateMemory(_device, &allocateInfo, nullptr, &memory);
+			if (result != VK_SUCCESS) return result;
+
+			// Map host visible blocks once, every allocation in them shares the mapping.
+			void* mapped = nullptr;
+			if (IsHostVisible(memoryType))
+			{
+				result = vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+				if (result != VK_SUCCESS)
+				{
+					vkFreeMemory(_device, memory, nullptr);
+					return result;
+				}
+			}
+
+			*outBlock = _blockPool.Create(memory, size, mapped, memoryType, kind);
+			_blocks[memoryType].push_back(*outBlock);
+
+			return VK_SUCCESS;
+		}
+
+		void DeviceAllocator::DestroyBlock(DeviceBlock* block)
+		{
+			if (block->_mapped)
+				vkUnmapMemory(_device, block->_memory);
+
+			vkFreeMemory(_device, block->_memory, nullptr);
+			_blockPool.Destroy(block);
+		}
+
+		u32 DeviceAllocator::FindMemoryTypeIndex(u32 allowedTypes, VkMemoryPropertyFlags flags) const
+		{
+			for (u32 i = 0; i < _memoryProperties.memoryTypeCount; ++i)
+			{
+				// Find a memory type that is allowed and has the desired property flags.
+				if ((allowedTypes & (1 << i)) && ((_memoryProperties.memoryTypes[i].propertyFlags & flags) == flags))
+				{
+					return i;
+				}
+			}
+
+			return -1;
+		}
+
+		VkDeviceSize DeviceAllocator::GetBlockSize(u32 memoryType) const
+		{
+			// Small heaps, such as the host visible window into device memory, get smaller blocks.
+			VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+			return std::min(_blockSize, heapSize / 8);
+		}
+
+		bool DeviceAllocator::IsHostVisible(u32 memoryType) const
+		{
+			return (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+		}
+
+		void DeviceAllocator::AddStatistics(u32 memoryType, DeviceMemoryStatistics* statistics) const
+		{
+			for (const DeviceBlock* block : _blocks[memoryType])
+			{
+				statistics->_blockCount++;
+				statistics->_allocationCount += block->_ranges.GetAllocationCount();
+				statistics->_blockBytes += block->_ranges.GetSize();
+				statistics->_usedBytes += block->_ranges.GetUsedSize();
+				statistics->_largestFreeRange = std::max<VkDeviceSize>(statistics->_largestFreeRange, block->_ranges.GetLargestFreeRange());
+			}
+
+			statistics->_dedicatedCount += _dedicatedCount[memoryType];
+			statistics->_allocationCount += _dedicatedCount[memoryType];
+			statistics->_dedicatedBytes += _dedicatedBytes[memoryType];
+		}
+	}
+}
+
+#endif
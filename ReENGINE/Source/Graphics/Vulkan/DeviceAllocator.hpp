@@ -0,0 +1,158 @@
+/*
+ * DeviceAllocator.hpp
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+#ifdef PLATFORM_USE_VULKAN
+
+#include "Memory/Containers.hpp"
+#include "Memory/ObjectPool.hpp"
+#include "Memory/RangeAllocator.hpp"
+
+#include <boost/thread.hpp>
+
+#if PLATFORM_WINDOWS
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+
+#include <vulkan/vulkan.h>
+
+namespace Re
+{
+	namespace Graphics
+	{
+		// Buffers and optimally tiled images never share a block, so no two neighbours can
+		// fall within the same page of bufferImageGranularity.
+		enum class DeviceResourceKind : u8
+		{
+			Buffer = 0,
+			Image = 1,
+			Count
+		};
+
+		struct DeviceBlock
+		{
+			DeviceBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped, u32 memoryType, DeviceResourceKind kind)
+				: _memory(memory), _mapped(mapped), _memoryType(memoryType), _kind(kind), _evacuating(false), _ranges(static_cast<usize>(size))
+			{}
+
+			VkDeviceMemory _memory;
+			void* _mapped;
+			u32 _memoryType;
+			DeviceResourceKind _kind;
+			bool _evacuating;
+			Memory::RangeAllocator _ranges;
+		};
+
+		struct DeviceAllocation
+		{
+			VkDeviceMemory _memory = VK_NULL_HANDLE;
+			VkDeviceSize _offset = 0;
+			VkDeviceSize _size = 0;
+
+			// Host visible memory stays mapped for as long as it lives, this points at the allocation's first byte.
+			void* _mapped = nullptr;
+
+			// The block the allocation was carved from, or nullptr for a dedicated allocation.
+			DeviceBlock* _block = nullptr;
+			u32 _memoryType = 0;
+		};
+
+		struct DeviceMemoryStatistics
+		{
+			usize _blockCount;
+			usize _dedicatedCount;
+			usize _allocationCount;
+			VkDeviceSize _blockBytes;
+			VkDeviceSize _usedBytes;
+			VkDeviceSize _dedicatedBytes;
+			VkDeviceSize _largestFreeRange;
+		};
+
+		/*
+		 * @brief This class is responsible for the device memory of every buffer and image the
+		 * renderer creates. Each memory type is carved out of large blocks, so the number of
+		 * vkAllocateMemory calls stays far below maxMemoryAllocationCount, and freeing a single
+		 * resource returns its range to the block right away. Images the driver prefers to keep
+		 * on their own, and resources too large for a block, get a dedicated allocation.
+		 *
+		 * Every method may be called from any thread.
+		 *
+		 */
+		class DeviceAllocator
+		{
+		public:
+			static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+			DeviceAllocator();
+			~DeviceAllocator();
+
+			DeviceAllocator(const DeviceAllocator&) = delete;
+			DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+			void Startup(VkPhysicalDevice physical, VkDevice logical, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+			void Shutdown();
+
+			/*
+			 * @brief These methods allocate memory for a resource and bind it.
+			 *
+			 * @param properties: the properties the memory type must have.
+			 * @param outAllocation: the allocation, which must be passed to Free once the resource is destroyed.
+			 * @return VK_SUCCESS, or the error of the failed Vulkan call.
+			 *
+			 */
+			VkResult AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation);
+			VkResult AllocateImage(VkImage image, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation);
+
+			void Free(DeviceAllocation* allocation);
+
+			/*
+			 * @brief These methods drive a defragmentation pass. Beginning one marks the blocks
+			 * filled below the given ratio for evacuation, except the fullest of each kind, and
+			 * no new allocation lands on them. The caller moves every resource for which
+			 * ShouldMove returns true into a new allocation and frees the old one, then ends the
+			 * pass, by which point the evacuated blocks have been returned to the driver.
+			 *
+			 */
+			void BeginDefragmentation(f32 maximumUsage = 0.5f);
+			bool ShouldMove(const DeviceAllocation& allocation) const;
+			void EndDefragmentation();
+
+			DeviceMemoryStatistics GetStatistics() const;
+			DeviceMemoryStatistics GetStatistics(u32 memoryType) const;
+			u32 GetMemoryTypeCount() const;
+
+		private:
+			VkResult Allocate(const VkMemoryRequirements& requirements, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage,
+				VkMemoryPropertyFlags properties, DeviceResourceKind kind, DeviceAllocation* outAllocation);
+			VkResult AllocateDedicated(const VkMemoryRequirements& requirements, u32 memoryType, VkBuffer dedicatedBuffer, VkImage dedicatedImage,
+				DeviceAllocation* outAllocation);
+			VkResult CreateBlock(u32 memoryType, DeviceResourceKind kind, DeviceBlock** outBlock);
+			void DestroyBlock(DeviceBlock* block);
+			u32 FindMemoryTypeIndex(u32 allowedTypes, VkMemoryPropertyFlags flags) const;
+			VkDeviceSize GetBlockSize(u32 memoryType) const;
+			bool IsHostVisible(u32 memoryType) const;
+			void AddStatistics(u32 memoryType, DeviceMemoryStatistics* statistics) const;
+
+		private:
+			VkDevice _device;
+			VkPhysicalDeviceMemoryProperties _memoryProperties;
+			VkDeviceSize _blockSize;
+
+			Memory::ObjectPool<DeviceBlock> _blockPool;
+			Memory::Vector<DeviceBlock*, Memory::MemoryTag::Renderer> _blocks[VK_MAX_MEMORY_TYPES];
+			usize _dedicatedCount[VK_MAX_MEMORY_TYPES];
+			VkDeviceSize _dedicatedBytes[VK_MAX_MEMORY_TYPES];
+
+			mutable boost::mutex _mutex;
+		};
+	}
+}
+
+#endif
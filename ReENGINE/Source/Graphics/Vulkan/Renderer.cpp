@@ -11,14 +11,22 @@
 
 #include "Components/RenderComponent.hpp"
 #include "Components/TransformComponent.hpp"
+#include "Core/Hash/XXH64.hpp"
+#include "Graphics/Mipmap.hpp"
 #include "Math/Color.hpp"
 #include "Memory/Memory.hpp"
+#include "Memory/MemoryManager.hpp"
 
 #include <boost/container/set.hpp>
 #include <boost/foreach.hpp>
 #include <boost/range/join.hpp>
 
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <string>
+
+static_assert(MAX_FRAME_DRAWS == Re::Memory::FRAME_ARENA_COUNT, "Every frame in flight needs a frame arena of its own.");
 
 static const boost::container::vector<const utf8*> instanceExtensions = {
 	VK_KHR_SURFACE_EXTENSION_NAME,
@@ -76,6 +84,136 @@ static Re::Graphics::RendererResult ReadShader(const utf8* filename, boost::cont
 	return Re::Graphics::RendererResult::Success;
 }
 
+// The pipeline cache is stored behind a header of its own, so data from another device or driver is never handed to the driver.
+static const utf8* PIPELINE_CACHE_PATH = "PipelineCache.bin";
+static const u32 PIPELINE_CACHE_MAGIC = 0x43504552;
+static const u32 PIPELINE_CACHE_VERSION = 1;
+
+struct PipelineCacheHeader
+{
+	u32 _magic;
+	u32 _version;
+	u32 _vendorID;
+	u32 _deviceID;
+	u32 _driverVersion;
+	u8 _pipelineCacheUUID[VK_UUID_SIZE];
+	u64 _dataSize;
+	u64 _dataHash;
+};
+
+static bool ReadPipelineCache(const utf8* filename, const VkPhysicalDeviceProperties& properties, boost::container::vector<char>* outData)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	PipelineCacheHeader header = {};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	// Only data written by the same version, for the same device and driver, is of any use.
+	if (header._magic != PIPELINE_CACHE_MAGIC || header._version != PIPELINE_CACHE_VERSION || header._vendorID != properties.vendorID ||
+		header._deviceID != properties.deviceID || header._driverVersion != properties.driverVersion ||
+		memcmp(header._pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		return false;
+	}
+
+	// A damaged header could claim any size, so it must match what is left of the file before anything is allocated for it.
+	std::streamoff dataOffset = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff fileSize = file.tellg();
+	if (dataOffset < 0 || fileSize < dataOffset || header._dataSize != static_cast<u64>(fileSize - dataOffset))
+	{
+		return false;
+	}
+
+	file.seekg(dataOffset);
+	outData->resize(static_cast<usize>(header._dataSize));
+	if (!file.read(outData->data(), outData->size()))
+	{
+		outData->clear();
+		return false;
+	}
+
+	// A truncated or damaged file is dropped as a whole.
+	if (Re::Core::Hash::XXH64(outData->data(), outData->size()) != header._dataHash)
+	{
+		outData->clear();
+		return false;
+	}
+
+	return true;
+}
+
+static bool WritePipelineCache(const utf8* filename, const VkPhysicalDeviceProperties& properties, const boost::container::vector<char>& data)
+{
+	PipelineCacheHeader header = {};
+	header._magic = PIPELINE_CACHE_MAGIC;
+	header._version = PIPELINE_CACHE_VERSION;
+	header._vendorID = properties.vendorID;
+	header._deviceID = properties.deviceID;
+	header._driverVersion = properties.driverVersion;
+	memcpy(header._pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header._dataSize = data.size();
+	header._dataHash = Re::Core::Hash::XXH64(data.data(), data.size());
+
+	// Write next to the file and move it over once complete, so an interrupted write never leaves a damaged cache behind.
+	std::string temporary = std::string(filename) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::remove(filename);
+	return std::rename(temporary.c_str(), filename) == 0;
+}
+
+static u64 HashMesh(const boost::container::vector<Re::Graphics::Vertex>& vertices, const boost::container::vector<u32>& indices)
+{
+	// Vertices are padded for the shaders, and padding holds whatever was there before, so only their components are hashed.
+	const usize chunkVertices = 256;
+	const usize vertexComponents = 8;
+	f32 chunk[chunkVertices * vertexComponents];
+
+	u64 hash = 0;
+	for (usize first = 0; first < vertices.size(); first += chunkVertices)
+	{
+		usize count = std::min(chunkVertices, vertices.size() - first);
+		for (usize i = 0; i < count; ++i)
+		{
+			const auto& vertex = vertices[first + i];
+			f32* components = chunk + i * vertexComponents;
+			components[0] = vertex._position.X;
+			components[1] = vertex._position.Y;
+			components[2] = vertex._position.Z;
+			components[3] = vertex._normal.X;
+			components[4] = vertex._normal.Y;
+			components[5] = vertex._normal.Z;
+			components[6] = vertex._textureCoordinate.X;
+			components[7] = vertex._textureCoordinate.Y;
+		}
+
+		hash = Re::Core::Hash::XXH64(chunk, count * vertexComponents * sizeof(f32), hash);
+	}
+
+	return Re::Core::Hash::XXH64(indices.data(), indices.size() * sizeof(u32), hash);
+}
+
 Re::Math::Color::operator VkClearColorValue() const
 {
 	return { Red, Green, Blue, Alpha };
@@ -86,7 +224,12 @@ namespace Re
 	namespace Graphics
 	{
 		Renderer::Renderer()
-			: _currentFrame(0), _streamingQueue(512), _streamingThreadShouldClose(false), _releasedImages(512)
+			: _streamingQueue(512), _streamingThreadShouldClose(false), _recordingThreadsShouldClose(false), _recordingFailed(false), _recordingGeneration(0),
+			  _recordingPending(0), _recordingSlices(0), _activeRecordingSlices(0), _recordingImage(0), _staticVersion(1), _staticLayoutVersion(0),
+			  _staticInstanceCount(0), _staticDrawCount(0), _sharedTransferQueue(false), _currentFrame(0), _frameNumber(0),
+			  _pipelineCache(VK_NULL_HANDLE), _pipelineCacheHash(0), _releasedImages(512), _firstUpload(0), _uploadCount(0), _stagingRing(VK_NULL_HANDLE),
+			  _stagingRingHead(0), _stagingRingUsed(0), _fragmentUniformVersion(0), _fragmentDynamicUniformBuffer(VK_NULL_HANDLE), _dynamicUniformSegmentSize(0),
+			  _dynamicUniformOffset(0), _dynamicUniformEnd(0)
 		{}
 
 		bool Renderer::AddEntity(Core::Entity* entity)
@@ -117,12 +260,29 @@ namespace Re
 			CHECK_RESULT(vkWaitForFences(_device._logical, 1, &_drawFences[_currentFrame], VK_TRUE, -1), VK_SUCCESS, RendererResult::Failure)
 			CHECK_RESULT(vkResetFences(_device._logical, 1, &_drawFences[_currentFrame]), VK_SUCCESS, RendererResult::Failure)
 
+			// The frame that last used this arena has finished on the GPU, so its transient memory can be reused.
+			Memory::MemoryManager::GetFrameAllocator().BeginFrame(_currentFrame);
+
+			// The same holds for this frame's segment of the dynamic uniform ring.
+			ResetDynamicUniforms(_currentFrame);
+
+			// Close the allocation counts of the previous frame, when they are being traced.
+			if (Memory::AllocationTracer::IsEnabled())
+				Memory::AllocationTracer::BeginFrame();
+
 			// Get next image to render to (and signal when succeeded).
 			u32 imageIndex;
 			CHECK_RESULT(vkAcquireNextImageKHR(_device._logical, _swapchain, -1, _imageAvailable[_currentFrame], VK_NULL_HANDLE, &imageIndex), VK_SUCCESS, RendererResult::Failure)
 
+			// Update the view of the acquired image, which changes every frame with the camera.
+			_vertexUniform._view = _activeCamera ? _activeCamera->GetView() : Math::Matrix::Identity();
+			UpdateVertexUniformBuffer(imageIndex);
+
+			// Upload the lights of the acquired image once, if they changed since it was last used.
+			UpdateFragmentUniformBuffer(imageIndex);
+
 			// Re-write the command buffers to update values, if not already rerecording.
-			CHECK_RESULT(RecordCommands(imageIndex, 1), RendererResult::Success, RendererResult::Failure);
+			CHECK_RESULT(RecordCommands(imageIndex), RendererResult::Success, RendererResult::Failure);
 
 			// Define stages that we need to wait for semaphores.
 			VkPipelineStageFlags waitStages[] = {
@@ -139,9 +299,17 @@ namespace Re
 			submitInfo.pCommandBuffers = &_commandBuffers[imageIndex];
 			submitInfo.signalSemaphoreCount = 1;
 			submitInfo.pSignalSemaphores = &_renderFinished[_currentFrame];
+
+			// A queue shared with the streaming thread must not be used by both threads at once.
+			boost::unique_lock<boost::mutex> queueLock(_queueMutex, boost::defer_lock);
+			if (_sharedTransferQueue)
+				queueLock.lock();
 			
 			CHECK_RESULT(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _drawFences[_currentFrame]), VK_SUCCESS, RendererResult::Failure)
 
+			// Count the submitted frame, which the streaming thread retires resources against.
+			++_frameNumber;
+
 			// Present rendered image to screen.
 			VkPresentInfoKHR presentInfo = {};
 			presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -172,30 +340,49 @@ namespace Re
 			#endif
 			CHECK_RESULT_WITH_ERROR(RetrievePhysicalDevice(), RendererResult::Success, NTEXT("Failed to retrieve appropriate physical device!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateLogicalDevice(), RendererResult::Success, NTEXT("Failed to create logical device!\n"), RendererResult::Failure)
+			_deviceAllocator.Startup(_device._physical, _device._logical);
 			CHECK_RESULT_WITH_ERROR(CreateSwapchain(), RendererResult::Success, NTEXT("Failed to create swapchain!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateDepthBufferImage(), RendererResult::Success, NTEXT("Failed to create depth buffer image!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateRenderPass(), RendererResult::Success, NTEXT("Failed to create renderpass!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateDescriptorSetLayouts(), RendererResult::Success, NTEXT("Failed to create descriptor set layout!\n"), RendererResult::Failure)
-			CHECK_RESULT_WITH_ERROR(CreatePushConstantRanges(), RendererResult::Success, NTEXT("Failed to create push constant range!\n"), RendererResult::Failure)
+			CHECK_RESULT_WITH_ERROR(CreatePipelineCache(), RendererResult::Success, NTEXT("Failed to create pipeline cache!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateGraphicsPipeline(), RendererResult::Success, NTEXT("Failed to create graphics pipeline!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateFramebuffers(), RendererResult::Success, NTEXT("Failed to create framebuffers!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateCommandPools(), RendererResult::Success, NTEXT("Failed to create command pools!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateCommandBuffers(), RendererResult::Success, NTEXT("Failed to create command buffers!\n"), RendererResult::Failure)
+			CHECK_RESULT_WITH_ERROR(CreateRecordingCommandBuffers(), RendererResult::Success, NTEXT("Failed to create recording command buffers!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateTextureSampler(), RendererResult::Success, NTEXT("Failed to create texture sampler!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateUniformBuffers(), RendererResult::Success, NTEXT("Failed to create uniform buffers!\n"), RendererResult::Failure)
+			CHECK_RESULT_WITH_ERROR(CreateInstanceBuffers(), RendererResult::Success, NTEXT("Failed to create instance buffers!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateDescriptorPools(), RendererResult::Success, NTEXT("Failed to create descriptor pool!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateDescriptorSets(), RendererResult::Success, NTEXT("Failed to create descriptor sets!\n"), RendererResult::Failure)
 			CHECK_RESULT_WITH_ERROR(CreateSynchronization(), RendererResult::Success, NTEXT("Failed to create synchronization!\n"), RendererResult::Failure)
+			CHECK_RESULT_WITH_ERROR(CreateUploads(), RendererResult::Success, NTEXT("Failed to create uploads!\n"), RendererResult::Failure)
 
 			// Transfer thread startup
 			_streamingThreadShouldClose.store(false, boost::memory_order_release);
 			_streamingThread = boost::thread(boost::bind(&Renderer::EntityStreaming, this));
 
+			// Recording threads startup, the render thread records the first slice itself.
+			_recordingThreadsShouldClose = false;
+			for (usize slice = 1; slice < _recordingSlices; ++slice)
+			{
+				_recordingThreads.create_thread(boost::bind(&Renderer::RecordingWorker, this, slice));
+			}
+
 			return RendererResult::Success;
 		}
 
 		void Renderer::Shutdown()
 		{
+			// Recording threads shutdown
+			{
+				boost::lock_guard<boost::mutex> lock(_recordingMutex);
+				_recordingThreadsShouldClose = true;
+			}
+			_recordingRequested.notify_all();
+			_recordingThreads.join_all();
+
 			// Transfer thread shutdown
 			_streamingThreadShouldClose.store(true, boost::memory_order_release);
 			_streamingRequested.notify_all();
@@ -203,7 +390,10 @@ namespace Re
 
 			// Vulkan shutdown
 			vkDeviceWaitIdle(_device._logical);
-			
+
+			// Every upload has finished by now, so their entities are destroyed with the rest.
+			RetireUploads(false);
+			DestroyUploads();
 			DestroyEntities();
 			DestroySynchronization();
 			vkDestroyDescriptorPool(_device._logical, _samplerDescriptorPool, nullptr);
@@ -211,14 +401,18 @@ namespace Re
 			vkDestroyDescriptorSetLayout(_device._logical, _samplerDescriptorSetLayout, nullptr);
 			vkDestroyDescriptorSetLayout(_device._logical, _bufferDescriptorSetLayout, nullptr);
 			DestroyUniformBuffers();
+			DestroyInstanceBuffers();
 			vkDestroySampler(_device._logical, _textureSampler, nullptr);
 			DestroyCommandPools();
 			DestroyFramebuffers();
 			vkDestroyPipeline(_device._logical, _graphicsPipeline, nullptr);
+			SavePipelineCache();
+			vkDestroyPipelineCache(_device._logical, _pipelineCache, nullptr);
 			vkDestroyPipelineLayout(_device._logical, _pipelineLayout, nullptr);
 			vkDestroyRenderPass(_device._logical, _renderPass, nullptr);
 			DestroyDepthBufferImage();
 			DestroySwapchain();
+			_deviceAllocator.Shutdown();
 			vkDestroyDevice(_device._logical, nullptr);
 			vkDestroySurfaceKHR(_instance, _surface, nullptr);
 			#if _DEBUG
@@ -232,14 +426,14 @@ namespace Re
 			// Update the fragment uniform with the directional light configuration.
 			UpdateDirectionalLight(&_fragmentUniform._directionalLight, light);
 
-			// Update the fragment uniform buffer values.
-			UpdateFragmentUniformBuffers();
+			// Mark the fragment uniform buffers to be uploaded before the next frame.
+			InvalidateFragmentUniform();
 
 			// Store specified light as active light.
 			_directionalLight = light;
 			_directionalLight->OnParameterChanged.connect([this]() {
 				UpdateDirectionalLight(&_fragmentUniform._directionalLight, _directionalLight);
-				UpdateFragmentUniformBuffers();
+				InvalidateFragmentUniform();
 			});
 
 			return RendererResult::Success;
@@ -277,14 +471,14 @@ namespace Re
 			// Update light count value in the uniform.
 			_fragmentUniform._pointLightCount = lightCount;
 
-			// Update the fragment uniform buffer values.
-			UpdateFragmentUniformBuffers();
+			// Mark the fragment uniform buffers to be uploaded before the next frame.
+			InvalidateFragmentUniform();
 
 			// Add new light to the list of point lights.
 			_pointLights[availableIndex] = light;
 			_pointLights[availableIndex]->OnParameterChanged.connect([this, availableIndex]() {
 				UpdatePointLight(&_fragmentUniform._pointLights[availableIndex], _pointLights[availableIndex]);
-				UpdateFragmentUniformBuffers();
+				InvalidateFragmentUniform();
 			});
 
 			return RendererResult::Success;
@@ -322,14 +516,14 @@ namespace Re
 			// Update light count value in the uniform.
 			_fragmentUniform._spotLightCount = lightCount;
 
-			// Update the fragment uniform buffer values.
-			UpdateFragmentUniformBuffers();
+			// Mark the fragment uniform buffers to be uploaded before the next frame.
+			InvalidateFragmentUniform();
 
 			// Add new light to the list of spot lights.
 			_spotLights[availableIndex] = light;
 			_spotLights[availableIndex]->OnParameterChanged.connect([this, availableIndex]() {
 				UpdateSpotLight(&_fragmentUniform._spotLights[availableIndex], _spotLights[availableIndex]);
-				UpdateFragmentUniformBuffers();
+				InvalidateFragmentUniform();
 			});
 
 			return RendererResult::Success;
@@ -349,8 +543,8 @@ namespace Re
 				}
 			}
 
-			// Update the fragment uniform buffer values.
-			UpdateFragmentUniformBuffers();
+			// Mark the fragment uniform buffers to be uploaded before the next frame.
+			InvalidateFragmentUniform();
 		}
 
 		void Renderer::DeactivateLight(const boost::shared_ptr<Entities::SpotLight>& light)
@@ -367,8 +561,8 @@ namespace Re
 				}
 			}
 
-			// Update the fragment uniform buffer values.
-			UpdateFragmentUniformBuffers();
+			// Mark the fragment uniform buffers to be uploaded before the next frame.
+			InvalidateFragmentUniform();
 		}
 
 		void Renderer::SetActiveCamera(const boost::shared_ptr<Entities::Camera>& newCamera)
@@ -383,15 +577,95 @@ namespace Re
 			_activeCamera = newCamera;
 		}
 
+		RendererResult Renderer::DefragmentDeviceMemory()
+		{
+			// Keep the streaming thread from creating or destroying resources while they move.
+			boost::lock_guard<boost::mutex> streamingLock(_streamingMutex);
+			boost::lock_guard<boost::mutex> transferLock(_transferMutex);
+
+			// Buffers can only move once the frames in flight are done reading them.
+			CHECK_RESULT(vkDeviceWaitIdle(_device._logical), VK_SUCCESS, RendererResult::Failure)
+
+			_deviceAllocator.BeginDefragmentation();
+
+			// Allocate a one-time command buffer to record the copies in.
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = _graphicsPool;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, &commandBuffer), VK_SUCCESS, RendererResult::Failure)
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo), VK_SUCCESS, RendererResult::Failure)
+
+			// Copy every geometry page that sits on an evacuated block into a fresh allocation, renderables keep their ranges.
+			Memory::Vector<VkBuffer, Memory::MemoryTag::Renderer> retiredBuffers;
+			for (auto& page : _vertexPages)
+			{
+				CHECK_RESULT(RelocateBuffer(commandBuffer, &page._buffer, page._ranges.GetSize() * sizeof(Vertex),
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &retiredBuffers), RendererResult::Success, RendererResult::Failure)
+			}
+
+			for (auto& page : _indexPages)
+			{
+				CHECK_RESULT(RelocateBuffer(commandBuffer, &page._buffer, page._ranges.GetSize() * sizeof(u32),
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &retiredBuffers), RendererResult::Success, RendererResult::Failure)
+			}
+
+			CHECK_RESULT(vkEndCommandBuffer(commandBuffer), VK_SUCCESS, RendererResult::Failure)
+
+			if (!retiredBuffers.empty())
+			{
+				// Submit the copies and wait for them, before the old buffers go away.
+				VkSubmitInfo submitInfo = {};
+				submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &commandBuffer;
+
+				CHECK_RESULT(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE), VK_SUCCESS, RendererResult::Failure)
+				CHECK_RESULT(vkQueueWaitIdle(_graphicsQueue), VK_SUCCESS, RendererResult::Failure)
+			}
+
+			vkFreeCommandBuffers(_device._logical, _graphicsPool, 1, &commandBuffer);
+
+			// Freeing the last buffers of an evacuated block returns the block to the driver.
+			for (VkBuffer buffer : retiredBuffers)
+				DestroyBuffer(buffer);
+
+			_deviceAllocator.EndDefragmentation();
+
+			// The static command buffers bind the pages that moved.
+			_staticVersion++;
+			return RendererResult::Success;
+		}
+
+		DeviceMemoryStatistics Renderer::GetDeviceMemoryStatistics() const
+		{
+			return _deviceAllocator.GetStatistics();
+		}
+
 		void Renderer::EntityStreaming()
 		{
 			static usize it = 0;
 			while (true)
 			{
 				boost::unique_lock<boost::mutex> lock(_streamingMutex);
-				_streamingRequested.wait(lock, [this] {
+				auto streamingRequested = [this] {
 					return _streamingThreadShouldClose.load(boost::memory_order_acquire) || !_streamingQueue.empty(); 
-				});
+				};
+
+				// While uploads are in flight or retired images and meshes wait to be destroyed, wake up every now and then, even with nothing to stream.
+				if (_uploadCount > 0)
+					_streamingRequested.wait_for(lock, boost::chrono::milliseconds(UPLOAD_POLL_INTERVAL_MS), streamingRequested);
+				else if (!_retiredImages.empty() || !_retiredMeshes.empty())
+					_streamingRequested.wait_for(lock, boost::chrono::milliseconds(RETIRE_INTERVAL_MS), streamingRequested);
+				else
+					_streamingRequested.wait(lock, streamingRequested);
 
 				if (_streamingThreadShouldClose.load(boost::memory_order_acquire))
 				{
@@ -400,9 +674,11 @@ namespace Re
 				else
 				{
 					// Perform transfer operations that were requested.
+					bool transferRequested = false;
 					TransferInfo transferInfo;
 					while (_streamingQueue.pop(transferInfo))
 					{
+						transferRequested = true;
 						if (!transferInfo._isRemoval)
 						{
 							if (transferInfo._entity->HasComponent<Components::RenderComponent>())
@@ -418,8 +694,8 @@ namespace Re
 								entityInfo._renderables.resize(renderComponents.size());
 								for (auto& renderComponent : renderComponents)
 								{
-									auto indices = renderComponent->GetIndices();
-									auto vertices = renderComponent->GetVertices();
+									const auto& indices = renderComponent->GetIndices();
+									const auto& vertices = renderComponent->GetVertices();
 									if (indices.size() == 0 || vertices.size() == 0) continue;
 
 									// Create rendering information for renderable entity.
@@ -428,15 +704,22 @@ namespace Re
 									renderableInfo._vertexCount = static_cast<i32>(vertices.size());
 									renderableInfo._material = renderComponent->GetMaterial();
 
-									// Create required buffers and images for the rendering.
-									CreateIndexBuffer(indices, &renderableInfo._indexBuffer);
-									CreateVertexBuffer(vertices, &renderableInfo._vertexBuffer);
+									// Share the geometry of an equal mesh, or reserve ranges of the geometry pages for it, and create required images for the rendering.
+									if (AcquireMesh(vertices, indices, &renderableInfo) == RendererResult::Failure)
+									{
+										Core::Debug::Error("Failed to allocate geometry for a renderable.");
+										continue;
+									}
+
 									CreateTextureImage(renderableInfo._material->GetDiffuseTexture(), &renderableInfo._diffuseImage);
 
 									// Assign renderable information to the entity.
 									entityInfo._renderables[i++] = renderableInfo;
 								}
 
+								// Drop the slots of render components that had nothing to render.
+								entityInfo._renderables.resize(i);
+
 								// Record the model matrix of the entity.
 								if (transferInfo._entity->HasComponent<Components::TransformComponent>())
 								{
@@ -450,24 +733,44 @@ namespace Re
 						}
 						else
 						{
+							// The render thread reads the entities and their batches while recording, under the transfer lock.
+							boost::lock_guard<boost::mutex> transferLock(_transferMutex);
+
 							auto entity = _entitiesToRender.find(transferInfo._entity);
 							if (entity != _entitiesToRender.end())
 							{
 								for (auto& renderableInfo : entity->second._renderables)
 								{
-									// Destroy buffers and images created for the rendering.
-									DestroyBuffer(renderableInfo._indexBuffer);
-									DestroyBuffer(renderableInfo._vertexBuffer);
-									DestroyImage(renderableInfo._diffuseImage);
+									// Leave the batch, release the mesh, whose ranges go back to the pages some frames after its last user is gone, and release images created for the rendering.
+									RemoveFromBatch(renderableInfo);
+									ReleaseMesh(renderableInfo._mesh);
+									ReleaseTextureImage(renderableInfo._diffuseImage);
 								}
 
 								_entitiesToRender.erase(entity);
 							}
+							else if (IsEntityPending(transferInfo._entity))
+							{
+								// The entity is still on its way, so it is dropped once its upload retires.
+								_cancelledEntities.insert(transferInfo._entity);
+							}
 						}
 					}
 
+					// Make the entities of the uploads the device is done with visible.
+					if (RetireUploads(false) == RendererResult::Failure)
+					{
+						Core::Debug::Error("Failed to retire uploads.");
+					}
+
+					// Destroy the images and free the meshes that no frame in flight draws with anymore.
+					{
+						boost::lock_guard<boost::mutex> transferLock(_transferMutex);
+						DestroyRetiredImages(false);
+					}
+
 					// Execute pending transfer operations.
-					if (ExecuteTransferOperations() == RendererResult::Failure)
+					if (transferRequested && ExecuteTransferOperations() == RendererResult::Failure)
 					{
 						Core::Debug::Error("Failed to execute transfer operations.");
 					}
@@ -557,23 +860,6 @@ namespace Re
 			return queueFamilies.IsValid() && extensionsSupported && swapchainValid;
 		}
 
-		u32 Renderer::FindMemoryTypeIndex(u32 allowedTypes, VkMemoryPropertyFlags flags) const
-		{
-			VkPhysicalDeviceMemoryProperties memoryProperties;
-			vkGetPhysicalDeviceMemoryProperties(_device._physical, &memoryProperties);
-
-			for (u32 i = 0; i < memoryProperties.memoryTypeCount; ++i)
-			{
-				// Find a memory type that is allowed and has the desired property flags.
-				if ((allowedTypes & (1 << i)) && ((memoryProperties.memoryTypes[i].propertyFlags & flags) == flags))
-				{
-					return i;
-				}
-			}
-
-			return -1;
-		}
-
 		Renderer::QueueFamilyInfo Renderer::GetQueueFamilyInfo(VkPhysicalDevice device) const
 		{
 			u32 familyCount = 0;
@@ -588,6 +874,7 @@ namespace Re
 				if (familyProperties[i].queueCount > 0 && familyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 				{
 					familyInfo._graphicsFamily = i;
+					familyInfo._graphicsQueueCount = familyProperties[i].queueCount;
 				}
 
 				// Check if queue family supports presentation.
@@ -614,7 +901,7 @@ namespace Re
 			// Fallback to using graphics as transfer family if no dedicated family is found.
 			if (familyInfo._graphicsFamily != -1 && familyInfo._transferFamily == -1)
 			{
-				familyInfo._transferFamily == familyInfo._graphicsFamily;
+				familyInfo._transferFamily = familyInfo._graphicsFamily;
 			}
 
 			return familyInfo;
@@ -650,41 +937,21 @@ namespace Re
 			return (dataSize + dataAlignment - 1) & ~(dataAlignment - 1);
 		}
 
-		RendererResult Renderer::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VkDeviceMemory* outMemory)
+		RendererResult Renderer::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation)
 		{
-			if (!outMemory) return RendererResult::Failure;
-
-			// Get buffer memory requirements.
-			VkMemoryRequirements requirements;
-			vkGetBufferMemoryRequirements(_device._logical, buffer, &requirements);
+			if (!outAllocation) return RendererResult::Failure;
 
-			// Allocate memory to buffer.
-			VkMemoryAllocateInfo allocateInfo = {};
-			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocateInfo.allocationSize = requirements.size;
-			allocateInfo.memoryTypeIndex = FindMemoryTypeIndex(requirements.memoryTypeBits, properties);
-
-			CHECK_RESULT(vkAllocateMemory(_device._logical, &allocateInfo, nullptr, outMemory), VK_SUCCESS, RendererResult::Failure)
-			CHECK_RESULT(vkBindBufferMemory(_device._logical, buffer, *outMemory, 0), VK_SUCCESS, RendererResult::Failure);
+			// Sub-allocate memory for the buffer and bind it.
+			CHECK_RESULT(_deviceAllocator.AllocateBuffer(buffer, properties, outAllocation), VK_SUCCESS, RendererResult::Failure)
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, VkDeviceMemory* outMemory)
+		RendererResult Renderer::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation)
 		{
-			if (!outMemory) return RendererResult::Failure;
-			
-			// Retrieve memory requirements for the created image.
-			VkMemoryRequirements memoryRequirements = {};
-			vkGetImageMemoryRequirements(_device._logical, image, &memoryRequirements);
-
-			// Allocate memory to image.
-			VkMemoryAllocateInfo allocateInfo = {};
-			allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocateInfo.allocationSize = memoryRequirements.size;
-			allocateInfo.memoryTypeIndex = FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, properties);
-
-			CHECK_RESULT(vkAllocateMemory(_device._logical, &allocateInfo, nullptr, outMemory), VK_SUCCESS, RendererResult::Failure);
-			CHECK_RESULT(vkBindImageMemory(_device._logical, image, *outMemory, 0), VK_SUCCESS, RendererResult::Failure);
+			if (!outAllocation) return RendererResult::Failure;
+
+			// Sub-allocate memory for the image and bind it.
+			CHECK_RESULT(_deviceAllocator.AllocateImage(image, properties, outAllocation), VK_SUCCESS, RendererResult::Failure)
 			return RendererResult::Success;
 		}
 
@@ -703,7 +970,7 @@ namespace Re
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::CreateImage(u32 width, u32 height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage* outImage)
+		RendererResult Renderer::CreateImage(u32 width, u32 height, u32 mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage* outImage)
 		{
 			if (!outImage) return RendererResult::Failure;
 
@@ -714,7 +981,7 @@ namespace Re
 			createInfo.extent.width = width;
 			createInfo.extent.height = height;
 			createInfo.extent.depth = 1;
-			createInfo.mipLevels = 1;
+			createInfo.mipLevels = mipLevels;
 			createInfo.arrayLayers = 1;
 			createInfo.format = format;
 			createInfo.tiling = tiling;
@@ -743,10 +1010,10 @@ namespace Re
 			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
 			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
-			// Subresources that control the part you view of an image.
+			// Subresources that control the part you view of an image, which spans every mip level it has.
 			createInfo.subresourceRange.aspectMask = flags;
 			createInfo.subresourceRange.baseMipLevel = 0;
-			createInfo.subresourceRange.levelCount = 1;
+			createInfo.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
 			createInfo.subresourceRange.baseArrayLayer = 0;
 			createInfo.subresourceRange.layerCount = 1;
 
@@ -767,71 +1034,244 @@ namespace Re
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::CreateIndexBuffer(boost::container::vector<u32>& indices, VkBuffer* outBuffer)
+		RendererResult Renderer::CreateGeometryBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* outBuffer)
 		{
 			if (!outBuffer) return RendererResult::Failure;
 
-			// Create the actual index buffer located in the GPU.
-			VkDeviceSize size = sizeof(u32) * indices.size();
-			CHECK_RESULT(CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, outBuffer), RendererResult::Success, RendererResult::Failure)
+			u32 families[] = {
+				_graphicsQueueFamily,
+				_transferQueueFamily
+			};
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = size;
+			bufferInfo.usage = usage;
+
+			// Geometry pages are written by the transfer queue while the graphics queue draws other ranges from them.
+			if (_graphicsQueueFamily != _transferQueueFamily)
+			{
+				bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+				bufferInfo.queueFamilyIndexCount = 2;
+				bufferInfo.pQueueFamilyIndices = families;
+			}
+			else
+			{
+				bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			}
+
+			CHECK_RESULT(vkCreateBuffer(_device._logical, &bufferInfo, nullptr, outBuffer), VK_SUCCESS, RendererResult::Failure)
+			return RendererResult::Success;
+		}
+
+		RendererResult Renderer::CreateIndexRange(const boost::container::vector<u32>& indices, u32* outPage, u32* outFirstIndex)
+		{
+			if (!outPage || !outFirstIndex) return RendererResult::Failure;
+
+			// Reserve a range of an index page for the indices.
+			usize offset;
+			CHECK_RESULT(AllocateGeometryRange(&_indexPages, indices.size(), sizeof(u32), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+				outPage, &offset), RendererResult::Success, RendererResult::Failure)
 
 			// Create index information to be able to transfer.
 			IndexInfo indexInfo = {};
-			indexInfo._buffer = *outBuffer;
+			indexInfo._page = *outPage;
+			indexInfo._offset = offset;
 			indexInfo._size = 0;
-			indexInfo._indices = indices;
+			indexInfo._indices.assign(indices.begin(), indices.end());
 
 			_indexBuffersToTransfer.emplace_back(indexInfo);
+			*outFirstIndex = static_cast<u32>(offset);
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::CreateVertexBuffer(boost::container::vector<Vertex>& vertices, VkBuffer* outBuffer)
+		RendererResult Renderer::CreateVertexRange(const boost::container::vector<Vertex>& vertices, u32* outPage, i32* outVertexOffset)
 		{
-			if (!outBuffer) return RendererResult::Failure;
+			if (!outPage || !outVertexOffset) return RendererResult::Failure;
 
-			// Create the actual vertex buffer located in the GPU.
-			VkDeviceSize size = sizeof(Vertex) * vertices.size();
-			CHECK_RESULT(CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, outBuffer), RendererResult::Success, RendererResult::Failure)
+			// Reserve a range of a vertex page for the vertices.
+			usize offset;
+			CHECK_RESULT(AllocateGeometryRange(&_vertexPages, vertices.size(), sizeof(Vertex), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				outPage, &offset), RendererResult::Success, RendererResult::Failure)
 
 			// Create vertex information to be able to transfer.
 			VertexInfo vertexInfo = {};
-			vertexInfo._buffer = *outBuffer;
+			vertexInfo._page = *outPage;
+			vertexInfo._offset = offset;
 			vertexInfo._size = 0;
-			vertexInfo._vertices = vertices;
+			vertexInfo._vertices.assign(vertices.begin(), vertices.end());
 
 			_vertexBuffersToTransfer.emplace_back(vertexInfo);
+			*outVertexOffset = static_cast<i32>(offset);
+			return RendererResult::Success;
+		}
+
+		RendererResult Renderer::AcquireMesh(const boost::container::vector<Vertex>& vertices, const boost::container::vector<u32>& indices, RenderableInfo* renderableInfo)
+		{
+			MeshKey key = {};
+			key._hash = HashMesh(vertices, indices);
+			key._vertexCount = static_cast<u32>(vertices.size());
+			key._indexCount = static_cast<u32>(indices.size());
+
+			// Meshes already in the pages, or queued to be transferred into them, are only referenced again.
+			auto it = _meshes.find(key);
+			if (it == _meshes.end())
+			{
+				MeshInfo mesh = {};
+				CHECK_RESULT(CreateIndexRange(indices, &mesh._indexPage, &mesh._firstIndex), RendererResult::Success, RendererResult::Failure)
+
+				if (CreateVertexRange(vertices, &mesh._vertexPage, &mesh._vertexOffset) == RendererResult::Failure)
+				{
+					// Give back the index range, along with its pending transfer.
+					_indexPages[mesh._indexPage]._ranges.Free(mesh._firstIndex);
+					_indexBuffersToTransfer.pop_back();
+					return RendererResult::Failure;
+				}
+
+				it = _meshes.emplace(key, mesh).first;
+			}
+
+			it->second._references++;
+
+			renderableInfo->_mesh = key;
+			renderableInfo->_vertexPage = it->second._vertexPage;
+			renderableInfo->_vertexOffset = it->second._vertexOffset;
+			renderableInfo->_indexPage = it->second._indexPage;
+			renderableInfo->_firstIndex = it->second._firstIndex;
 			return RendererResult::Success;
 		}
 
+		void Renderer::ReleaseMesh(const MeshKey& mesh)
+		{
+			auto it = _meshes.find(mesh);
+			if (it == _meshes.end()) return;
+
+			// Evict the mesh with its last user. Frames in flight may still draw from its ranges, so they are returned to the pages once they have finished.
+			if (--it->second._references == 0)
+			{
+				RetiredMesh retiredMesh = {};
+				retiredMesh._vertexPage = it->second._vertexPage;
+				retiredMesh._vertexOffset = it->second._vertexOffset;
+				retiredMesh._indexPage = it->second._indexPage;
+				retiredMesh._firstIndex = it->second._firstIndex;
+				retiredMesh._frameNumber = _frameNumber.load();
+				_retiredMeshes.push_back(retiredMesh);
+				_meshes.erase(it);
+			}
+		}
+
+		void Renderer::AddToBatch(RenderableInfo* renderableInfo, bool isStatic)
+		{
+			BatchKey key = {};
+			key._static = isStatic;
+			key._mesh = renderableInfo->_mesh;
+			key._diffuseImage = renderableInfo->_diffuseImage;
+			key._specularPower = renderableInfo->_material->GetSpecularPower();
+			key._specularStrength = renderableInfo->_material->GetSpecularStrength();
+
+			auto it = _batches.find(key);
+			if (it == _batches.end())
+			{
+				// Every renderable of the batch reads the same ranges of the geometry pages.
+				BatchInfo batch = {};
+				batch._vertexPage = renderableInfo->_vertexPage;
+				batch._vertexOffset = renderableInfo->_vertexOffset;
+				batch._indexPage = renderableInfo->_indexPage;
+				batch._firstIndex = renderableInfo->_firstIndex;
+				batch._indexCount = static_cast<u32>(renderableInfo->_indexCount);
+
+				it = _batches.emplace(key, batch).first;
+			}
+
+			it->second._renderables++;
+			renderableInfo->_batch = it;
+
+			// Any change to the static batches invalidates the static command buffers.
+			if (isStatic)
+				_staticVersion++;
+		}
+
+		void Renderer::RemoveFromBatch(const RenderableInfo& renderableInfo)
+		{
+			if (renderableInfo._batch->first._static)
+				_staticVersion++;
+
+			if (--renderableInfo._batch->second._renderables == 0)
+				_batches.erase(renderableInfo._batch);
+		}
+
+		RendererResult Renderer::AllocateGeometryRange(GeometryPages* pages, usize count, VkDeviceSize stride, VkBufferUsageFlags usage, u32* outPage, usize* outOffset)
+		{
+			// Ranges are counted in vertices or indices, so offsets can be handed to the draw as they are.
+			for (usize i = 0; i < pages->size(); ++i)
+			{
+				if ((*pages)[i]._ranges.Allocate(count, 1, outOffset))
+				{
+					*outPage = static_cast<u32>(i);
+					return RendererResult::Success;
+				}
+			}
+
+			// None of the pages has room left, so add another one, large enough for the range if it exceeds a page.
+			usize capacity = std::max(static_cast<usize>(GEOMETRY_PAGE_SIZE / stride), count);
+
+			VkBuffer buffer;
+			DeviceAllocation allocation;
+			CHECK_RESULT(CreateGeometryBuffer(capacity * stride, usage, &buffer), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation), RendererResult::Success, RendererResult::Failure)
+			_bufferMemory.emplace(buffer, allocation);
+
+			// The render thread reads the pages while recording, under the transfer lock.
+			_transferMutex.lock();
+			pages->emplace_back(buffer, capacity);
+			_transferMutex.unlock();
+
+			*outPage = static_cast<u32>(pages->size() - 1);
+			return pages->back()._ranges.Allocate(count, 1, outOffset) ? RendererResult::Success : RendererResult::Failure;
+		}
+
 		RendererResult Renderer::CreateTextureImage(Texture* texture, VkImage* outImage)
 		{
 			if (!outImage) return RendererResult::Failure;
 
-			if (_textureImage.left.find(texture) != _textureImage.left.end())
+			// Textures keep their content hash once decoded, so an image of equal content already on the device is found without decoding again.
+			bool decoded = !texture->HasContentHash();
+			if (decoded)
+				texture->Load();
+
+			auto it = _textureImage.left.find(texture->GetContentHash());
+			if (it != _textureImage.left.end())
 			{
-				*outImage = _textureImage.left.at(texture);
+				*outImage = it->second;
 				_textureReferences[*outImage] += 1;
+
+				// The pixels that were just decoded are already on the device.
+				if (decoded)
+					texture->Unload();
+
 				return RendererResult::Success;
 			}
 			else
 			{
-				// Load texture into memory.
+				// Load texture into memory, unless it still is.
 				texture->Load();
 
 				// Calculate image size.
 				VkDeviceSize size = texture->GetWidth() * texture->GetHeight() * texture->GetBPP() * sizeof(u8);
-				CHECK_RESULT(CreateImage(texture->GetWidth(), texture->GetHeight(), VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, outImage), RendererResult::Success, RendererResult::Failure)
+				CHECK_RESULT(CreateImage(texture->GetWidth(), texture->GetHeight(), GetMipLevelCount(texture->GetWidth(), texture->GetHeight()), VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, outImage), RendererResult::Success, RendererResult::Failure)
 
 				// Create texture information to be able to transfer.
 				TextureInfo textureInfo = {};
+				textureInfo._texture = texture;
 				textureInfo._image = *outImage;
 				textureInfo._size = 0;
 				textureInfo._bpp = texture->GetBPP();
 				textureInfo._width = texture->GetWidth();
 				textureInfo._height = texture->GetHeight();
+				textureInfo._mipLevels = GetMipLevelCount(textureInfo._width, textureInfo._height);
 				textureInfo._pixels = texture->GetPixels();
 
-				_textureImage.insert(boost::bimap<Texture*, VkImage>::value_type(texture, *outImage));
+				_textureImage.insert(boost::bimap<u64, VkImage>::value_type(texture->GetContentHash(), *outImage));
 				_textureReferences.emplace_unique(*outImage, 1);
 				_textureImagesToTransfer.emplace_back(textureInfo);
 			}
@@ -917,466 +1357,530 @@ namespace Re
 
 		void Renderer::DestroyBuffer(VkBuffer buffer)
 		{
-			if (_bufferMemory.left.find(buffer) != _bufferMemory.left.end())
-			{
-				VkDeviceMemory memory = _bufferMemory.left.at(buffer);
-				usize distance = std::distance(_bufferMemory.right.lower_bound(memory), _bufferMemory.right.upper_bound(memory));
-				
-				vkDestroyBuffer(_device._logical, buffer, nullptr);
-				_bufferMemory.left.erase(buffer);
+			vkDestroyBuffer(_device._logical, buffer, nullptr);
 
-				if (distance <= 1)
-				{
-					vkFreeMemory(_device._logical, memory, nullptr);
-					_bufferMemory.right.erase(memory);
-				}
-			}
-			else
+			// Return the buffer's range to its block.
+			auto it = _bufferMemory.find(buffer);
+			if (it != _bufferMemory.end())
 			{
-				vkDestroyBuffer(_device._logical, buffer, nullptr);
-				_bufferMemory.left.erase(buffer);
+				_deviceAllocator.Free(&it->second);
+				_bufferMemory.erase(it);
 			}
 		}
 
-		void Renderer::DestroyImage(VkImage image)
+		void Renderer::ReleaseTextureImage(VkImage image)
 		{
-			if (_imageMemory.left.find(image) != _imageMemory.left.end())
-			{
-				if (_textureReferences.contains(image) && _textureReferences[image] <= 1)
-				{
-					VkDeviceMemory memory = _imageMemory.left.at(image);
-					usize distance = std::distance(_imageMemory.right.lower_bound(memory), _imageMemory.right.upper_bound(memory));
+			auto it = _textureReferences.find(image);
+			if (it == _textureReferences.end()) return;
+			if (--it->second > 0) return;
 
-					// Free the descriptor set.
-					if (_textureDescriptorSets.contains(image))
-						vkFreeDescriptorSets(_device._logical, _samplerDescriptorPool, 1, &_textureDescriptorSets[image]);
+			// No renderable may share the image from now on.
+			_textureReferences.erase(it);
+			_textureImage.right.erase(image);
 
-					// Destroy the image view.
-					if (_textureImageView.contains(image))
-						vkDestroyImageView(_device._logical, _textureImageView[image], nullptr);
+			// Frames in flight may still sample the image, so it is destroyed once they have finished.
+			RetiredImage retiredImage = {};
+			retiredImage._image = image;
+			retiredImage._frameNumber = _frameNumber.load();
+			_retiredImages.push_back(retiredImage);
+		}
 
-					// Destroy the image and remove it from references.
-					vkDestroyImage(_device._logical, image, nullptr);
-					_imageMemory.left.erase(image);
-					_textureReferences.erase(image);
+		void Renderer::DestroyRetiredImages(bool all)
+		{
+			// The last frame that may sample a retired image, or draw from the ranges of a retired mesh, is the one after
+			// it was retired, which is finished once MAX_FRAME_DRAWS more frames have waited on their fences.
+			u64 frameNumber = _frameNumber.load();
 
-					// Free the image memory.
-					if (distance <= 1)
-					{
-						vkFreeMemory(_device._logical, memory, nullptr);
-						_imageMemory.right.erase(memory);
-					}
-				}
+			usize kept = 0;
+			for (usize i = 0; i < _retiredImages.size(); ++i)
+			{
+				if (all || frameNumber > _retiredImages[i]._frameNumber + MAX_FRAME_DRAWS)
+					DestroyTextureImage(_retiredImages[i]._image);
 				else
-				{
-					if (_textureReferences.contains(image))
-					{
-						_textureReferences[image]--;
-					}
-				}
+					_retiredImages[kept++] = _retiredImages[i];
 			}
-			else
+
+			_retiredImages.resize(kept);
+
+			kept = 0;
+			for (usize i = 0; i < _retiredMeshes.size(); ++i)
 			{
-				if (_textureReferences.contains(image) && _textureReferences[image] <= 1)
+				const RetiredMesh& retiredMesh = _retiredMeshes[i];
+				if (all || frameNumber > retiredMesh._frameNumber + MAX_FRAME_DRAWS)
 				{
-					// Free the descriptor set.
-					if (_textureDescriptorSets.contains(image))
-						vkFreeDescriptorSets(_device._logical, _samplerDescriptorPool, 1, &_textureDescriptorSets[image]);
-
-					// Destroy the image view.
-					if (_textureImageView.contains(image))
-						vkDestroyImageView(_device._logical, _textureImageView[image], nullptr);
-
-					// Destroy the image and remove it from references.
-					vkDestroyImage(_device._logical, image, nullptr);
-					_imageMemory.left.erase(image);
-					_textureReferences.erase(image);
+					_indexPages[retiredMesh._indexPage]._ranges.Free(retiredMesh._firstIndex);
+					_vertexPages[retiredMesh._vertexPage]._ranges.Free(retiredMesh._vertexOffset);
 				}
 				else
 				{
-					if (_textureReferences.contains(image))
-					{
-						_textureReferences[image]--;
-					}
+					_retiredMeshes[kept++] = retiredMesh;
 				}
 			}
+
+			_retiredMeshes.resize(kept);
 		}
 
-		RendererResult Renderer::ExecuteTransferOperations()
+		void Renderer::DestroyTextureImage(VkImage image)
 		{
-			// Calculate proper memory size and type for index and vertex buffers.
-			//usize indexAllocationSize = 0, vertexAllocationSize = 0;
-			//u32 indexAllowedTypes = 0, vertexAllowedTypes = 0;
-			//for (auto& entity : _entitiesToTransfer)
-			//{
-			//	auto& renderInfo = entity.second;
-			//	VkMemoryRequirements indexMemoryRequirements;
-			//	VkMemoryRequirements vertexMemoryRequirements;
-
-			//	// Get buffer memory requirements.
-			//	vkGetBufferMemoryRequirements(_device._logical, renderInfo._indexBuffer, &indexMemoryRequirements);
-			//	vkGetBufferMemoryRequirements(_device._logical, renderInfo._vertexBuffer, &vertexMemoryRequirements);
-
-			//	// Update size of individual buffer.
-			//	renderInfo._indexSize = indexMemoryRequirements.size;
-			//	renderInfo._vertexSize = vertexMemoryRequirements.size;
-
-			//	// Update general values for big chunk of memory.
-			//	indexAllocationSize += indexMemoryRequirements.size;
-			//	indexAllowedTypes |= indexMemoryRequirements.memoryTypeBits;
-			//	vertexAllocationSize += vertexMemoryRequirements.size;
-			//	vertexAllowedTypes |= vertexMemoryRequirements.memoryTypeBits;
-			//}
-
-			// Calculate proper memory size and type for vertex buffer.
-			usize vertexAllocationSize = 0;
-			u32 vertexAllowedTypes = 0;
-			for (auto& vInfo : _vertexBuffersToTransfer)
+			// Free the descriptor set.
+			auto descriptorSet = _textureDescriptorSets.find(image);
+			if (descriptorSet != _textureDescriptorSets.end())
 			{
-				// Get buffer memory requirements.
-				VkMemoryRequirements memoryRequirements;
-				vkGetBufferMemoryRequirements(_device._logical, vInfo._buffer, &memoryRequirements);
-
-				// Update size of individual buffer.
-				vInfo._size = GetAlignedSize(memoryRequirements.size, memoryRequirements.alignment);
-
-				// Update general values for big chunk of memory.
-				vertexAllocationSize += vInfo._size;
-				vertexAllowedTypes |= memoryRequirements.memoryTypeBits;
+				vkFreeDescriptorSets(_device._logical, _samplerDescriptorPool, 1, &descriptorSet->second);
+				_textureDescriptorSets.erase(descriptorSet);
 			}
 
-			// Calculate proper memory size and type for index buffer.
-			usize indexAllocationSize = 0;
-			u32 indexAllowedTypes = 0;
-			for (auto& iInfo : _indexBuffersToTransfer)
+			// Destroy the image view.
+			auto imageView = _textureImageView.find(image);
+			if (imageView != _textureImageView.end())
 			{
-				// Get buffer memory requirements.
-				VkMemoryRequirements memoryRequirements;
-				vkGetBufferMemoryRequirements(_device._logical, iInfo._buffer, &memoryRequirements);
+				vkDestroyImageView(_device._logical, imageView->second, nullptr);
+				_textureImageView.erase(imageView);
+			}
 
-				// Update size of individual buffer.
-				iInfo._size = GetAlignedSize(memoryRequirements.size, memoryRequirements.alignment);
+			// Destroy the image.
+			vkDestroyImage(_device._logical, image, nullptr);
 
-				// Update general values for big chunk of memory.
-				indexAllocationSize += iInfo._size;
-				indexAllowedTypes |= memoryRequirements.memoryTypeBits;
+			// Return the image's range to its block.
+			auto it = _imageMemory.find(image);
+			if (it != _imageMemory.end())
+			{
+				_deviceAllocator.Free(&it->second);
+				_imageMemory.erase(it);
 			}
+		}
 
-			// Calculate proper memory size and type for textures.
-			usize imageAllocationSize = 0;
-			u32 imageAllowedTypes = 0;
-			for (auto& tInfo : _textureImagesToTransfer)
-			{
-				// Get image memory requirements.
-				VkMemoryRequirements memoryRequirements;
-				vkGetImageMemoryRequirements(_device._logical, tInfo._image, &memoryRequirements);
+		RendererResult Renderer::RelocateBuffer(VkCommandBuffer commandBuffer, VkBuffer* buffer, VkDeviceSize size, VkBufferUsageFlags usage,
+			Memory::Vector<VkBuffer, Memory::MemoryTag::Renderer>* retiredBuffers)
+		{
+			auto it = _bufferMemory.find(*buffer);
+			if (it == _bufferMemory.end() || !_deviceAllocator.ShouldMove(it->second)) return RendererResult::Success;
 
-				// Update size of individual image.
-				tInfo._size = GetAlignedSize(memoryRequirements.size, memoryRequirements.alignment);
+			// Create the buffer again, on memory outside of the evacuated blocks.
+			VkBuffer newBuffer;
+			DeviceAllocation newAllocation;
+			CHECK_RESULT(CreateGeometryBuffer(size, usage, &newBuffer), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(newBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &newAllocation), RendererResult::Success, RendererResult::Failure)
+			_bufferMemory.emplace(newBuffer, newAllocation);
 
-				// Update general values for big chunk of memory.
-				imageAllocationSize += tInfo._size;
-				imageAllowedTypes |= memoryRequirements.memoryTypeBits;
-			}
+			// Copy the contents over, the old buffer is destroyed once the copy completes.
+			VkBufferCopy region = {};
+			region.size = size;
+			vkCmdCopyBuffer(commandBuffer, *buffer, newBuffer, 1, &region);
+
+			retiredBuffers->push_back(*buffer);
+			*buffer = newBuffer;
+			return RendererResult::Success;
+		}
 
-			// Create staging buffers, allocate memory and copy data over to them.
-			// u32 i = sizeof(Vertex);
-			VkBuffer vertexStagingBuffer = VK_NULL_HANDLE, indexStagingBuffer = VK_NULL_HANDLE, imageStagingBuffer = VK_NULL_HANDLE;
-			VkDeviceMemory vertexStagingMemory = VK_NULL_HANDLE, indexStagingMemory = VK_NULL_HANDLE, imageStagingMemory = VK_NULL_HANDLE;
-			CHECK_RESULT(StageVertexBuffer(vertexAllocationSize, &vertexStagingBuffer, &vertexStagingMemory), RendererResult::Success, RendererResult::Failure)
-			CHECK_RESULT(StageIndexBuffer(indexAllocationSize, &indexStagingBuffer, &indexStagingMemory), RendererResult::Success, RendererResult::Failure)
-			CHECK_RESULT(StageImageBuffer(imageAllocationSize, &imageStagingBuffer, &imageStagingMemory), RendererResult::Success, RendererResult::Failure)
+		RendererResult Renderer::ExecuteTransferOperations()
+		{
+			// Removals alone wake the streaming thread up with nothing to upload.
+			if (_entitiesToTransfer.empty() && _vertexBuffersToTransfer.empty() && _indexBuffersToTransfer.empty() && _textureImagesToTransfer.empty())
+				return RendererResult::Success;
 
-			// Allocate memory to real vertex buffer.
-			VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
-			if (vertexAllocationSize > 0)
+			// Calculate the staging size for the vertex ranges.
+			VkDeviceSize vertexAllocationSize = 0;
+			for (auto& vInfo : _vertexBuffersToTransfer)
 			{
-				VkMemoryAllocateInfo vertexAllocateInfo = {};
-				vertexAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				vertexAllocateInfo.allocationSize = vertexAllocationSize;
-				vertexAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(vertexAllowedTypes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-				CHECK_RESULT(vkAllocateMemory(_device._logical, &vertexAllocateInfo, nullptr, &vertexMemory), VK_SUCCESS, RendererResult::Failure)
+				vInfo._size = vInfo._vertices.size() * sizeof(Vertex);
+				vertexAllocationSize += vInfo._size;
 			}
 
-			// Allocate memory to real index buffer.
-			VkDeviceMemory indexMemory = VK_NULL_HANDLE;
-			if (indexAllocationSize > 0)
+			// Calculate the staging size for the index ranges.
+			VkDeviceSize indexAllocationSize = 0;
+			for (auto& iInfo : _indexBuffersToTransfer)
 			{
-				VkMemoryAllocateInfo indexAllocateInfo = {};
-				indexAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				indexAllocateInfo.allocationSize = indexAllocationSize;
-				indexAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(indexAllowedTypes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-				CHECK_RESULT(vkAllocateMemory(_device._logical, &indexAllocateInfo, nullptr, &indexMemory), VK_SUCCESS, RendererResult::Failure)
+				iInfo._size = iInfo._indices.size() * sizeof(u32);
+				indexAllocationSize += iInfo._size;
 			}
 
-			// Allocate memory to real image.
-			VkDeviceMemory imageMemory = VK_NULL_HANDLE;
-			if (imageAllocationSize > 0)
+			// Calculate the staging size for the textures.
+			VkDeviceSize imageAllocationSize = 0;
+			for (auto& tInfo : _textureImagesToTransfer)
 			{
-				VkMemoryAllocateInfo imageAllocateInfo = {};
-				imageAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				imageAllocateInfo.allocationSize = imageAllocationSize;
-				imageAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(imageAllowedTypes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				// Update size of individual image, its whole mip chain tightly packed and aligned for the transfer queue.
+				tInfo._size = GetAlignedSize(GetMipChainSize(tInfo._width, tInfo._height, tInfo._bpp), STAGING_ALIGNMENT);
 
-				CHECK_RESULT(vkAllocateMemory(_device._logical, &imageAllocateInfo, nullptr, &imageMemory), VK_SUCCESS, RendererResult::Failure);
+				// Update the size of the staging buffer.
+				imageAllocationSize += tInfo._size;
 			}
 
-			// Bind memory to real buffers.
-			//VkDeviceSize indexOffset = 0, vertexOffset = 0;
-			//for (const auto& entity : _entitiesToTransfer)
-			//{
-			//	const auto& renderInfo = entity.second;
+			// Lay the images, the vertices and the indices out in a single range of staging memory.
+			VkDeviceSize imageStagingOffset = 0;
+			VkDeviceSize vertexStagingOffset = imageAllocationSize;
+			VkDeviceSize indexStagingOffset = GetAlignedSize(vertexStagingOffset + vertexAllocationSize, STAGING_ALIGNMENT);
+			VkDeviceSize stagingSize = GetAlignedSize(indexStagingOffset + indexAllocationSize, STAGING_ALIGNMENT);
 
-			//	// Bind memory to index buffer.
-			//	CHECK_RESULT(vkBindBufferMemory(_device._logical, renderInfo._indexBuffer, indexMemory, indexOffset), VK_SUCCESS, RendererResult::Failure)
+			// Take a batch for the transfers, which may wait for the oldest upload to finish.
+			UploadInfo* upload = nullptr;
+			if (AcquireUpload(stagingSize, &upload) == RendererResult::Failure)
+				return AbortUpload(upload);
 
-			//	// Store index memory into bimap for tracking and increase offset.
-			//	_bufferMemory.insert(boost::bimap<VkBuffer, VkDeviceMemory>::value_type(renderInfo._indexBuffer, indexMemory));
-			//	indexOffset += renderInfo._indexSize;
+			// Copy data over to the staging memory, through its persistent mapping.
+			VkBuffer stagingBuffer = upload->_stagingBuffer != VK_NULL_HANDLE ? upload->_stagingBuffer : _stagingRing;
+			VkDeviceSize stagingBase = upload->_stagingBuffer != VK_NULL_HANDLE ? 0 : upload->_stagingOffset;
+			u8* staging = static_cast<u8*>(upload->_stagingBuffer != VK_NULL_HANDLE ? upload->_stagingMemory._mapped : _stagingRingMemory._mapped) + stagingBase;
 
-			//	// Bind memory to vertex buffer.
-			//	CHECK_RESULT(vkBindBufferMemory(_device._logical, renderInfo._vertexBuffer, vertexMemory, vertexOffset), VK_SUCCESS, RendererResult::Failure)
+			StageImageBuffer(staging + imageStagingOffset);
+			StageVertexBuffer(staging + vertexStagingOffset);
+			StageIndexBuffer(staging + indexStagingOffset);
 
-			//	// Store vertex memory into bimap for tracking and increase offset.
-			//	_bufferMemory.insert(boost::bimap<VkBuffer, VkDeviceMemory>::value_type(renderInfo._vertexBuffer, vertexMemory));
-			//	vertexOffset += renderInfo._vertexSize;
-			//}
-
-			// Bind memory to real vertex buffer.
-			VkDeviceSize vertexOffset = 0;
-			for (const auto& vInfo : _vertexBuffersToTransfer)
+			// Allocate memory to the real images.
+			for (const auto& tInfo : _textureImagesToTransfer)
 			{
-				CHECK_RESULT(vkBindBufferMemory(_device._logical, vInfo._buffer, vertexMemory, vertexOffset), VK_SUCCESS, RendererResult::Failure)
-				
-				_bufferMemory.insert(boost::bimap<VkBuffer, VkDeviceMemory>::value_type(vInfo._buffer, vertexMemory));
-				vertexOffset += vInfo._size;
-			}
+				DeviceAllocation allocation;
+				if (AllocateImage(tInfo._image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation) == RendererResult::Failure)
+					return AbortUpload(upload);
 
-			// Bind memory to real index buffer.
-			VkDeviceSize indexOffset = 0;
-			for (const auto& iInfo : _indexBuffersToTransfer)
-			{
-				CHECK_RESULT(vkBindBufferMemory(_device._logical, iInfo._buffer, indexMemory, indexOffset), VK_SUCCESS, RendererResult::Failure)
-				
-				_bufferMemory.insert(boost::bimap<VkBuffer, VkDeviceMemory>::value_type(iInfo._buffer, indexMemory));
-				indexOffset += iInfo._size;
+				_imageMemory.emplace(tInfo._image, allocation);
+				if (CreateTextureImageView(tInfo._image) == RendererResult::Failure)
+					return AbortUpload(upload);
 			}
 
-			// Bind memory to real image.
-			VkDeviceSize imageOffset = 0;
-			for (const auto& tInfo : _textureImagesToTransfer)
-			{
-				CHECK_RESULT(vkBindImageMemory(_device._logical, tInfo._image, imageMemory, imageOffset), VK_SUCCESS, RendererResult::Failure)
-				CHECK_RESULT(CreateTextureImageView(tInfo._image), RendererResult::Success, RendererResult::Failure);
-				
-				_imageMemory.insert(boost::bimap<VkImage, VkDeviceMemory>::value_type(tInfo._image, imageMemory));
-				imageOffset += tInfo._size;
-			}
-
-			CreateTextureDescriptorSets();
+			if (CreateTextureDescriptorSets() == RendererResult::Failure)
+				return AbortUpload(upload);
 
 			// Begin command buffer as optimized for one-time usage.
 			VkCommandBufferBeginInfo beginInfo = {};
 			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-			// Start recording commands for the transfer buffer.
-			CHECK_RESULT(vkResetCommandBuffer(_transferBuffer, 0), VK_SUCCESS, RendererResult::Failure)
-			CHECK_RESULT(vkBeginCommandBuffer(_transferBuffer, &beginInfo), VK_SUCCESS, RendererResult::Failure)
-
-			// Copy data from staging buffers to real buffers.
-			//VkDeviceSize indexSrcOffset = 0, vertexSrcOffset = 0;
-			//for (const auto& entity : _entitiesToTransfer)
-			//{
-			//	const auto& renderInfo = entity.second;
-			//	VkDeviceSize iSize = renderInfo._indexCount * sizeof(u32);
-			//	VkDeviceSize vSize = renderInfo._vertexCount * sizeof(Vertex);
-			//}
+			// Start recording commands for the batch's command buffer.
+			VkCommandBuffer commandBuffer = upload->_commandBuffer;
+			if (vkResetCommandBuffer(commandBuffer, 0) != VK_SUCCESS || vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+				return AbortUpload(upload);
 
-			VkDeviceSize vertexSrcOffset = 0;
+			VkDeviceSize vertexSrcOffset = stagingBase + vertexStagingOffset;
 			for (const auto& vInfo : _vertexBuffersToTransfer)
 			{
-				// Configure region of buffers to copy from.
+				// Configure region of buffers to copy from, into the vertex range of the page.
 				VkBufferCopy region = {};
 				region.srcOffset = vertexSrcOffset;
-				region.dstOffset = 0;
+				region.dstOffset = vInfo._offset * sizeof(Vertex);
 				region.size = vInfo._vertices.size() * sizeof(Vertex);
 
 				// Add copy operation to the command buffer.
-				vkCmdCopyBuffer(_transferBuffer, vertexStagingBuffer, vInfo._buffer, 1, &region);
+				vkCmdCopyBuffer(commandBuffer, stagingBuffer, _vertexPages[vInfo._page]._buffer, 1, &region);
 				vertexSrcOffset += vInfo._size;
 			}
 
-			VkDeviceSize indexSrcOffset = 0;
+			VkDeviceSize indexSrcOffset = stagingBase + indexStagingOffset;
 			for (const auto& iInfo : _indexBuffersToTransfer)
 			{
-				// Configure region of buffers to copy from.
+				// Configure region of buffers to copy from, into the index range of the page.
 				VkBufferCopy region = {};
 				region.srcOffset = indexSrcOffset;
-				region.dstOffset = 0;
+				region.dstOffset = iInfo._offset * sizeof(u32);
 				region.size = iInfo._indices.size() * sizeof(u32);
 
 				// Add copy operation to the command buffer.
-				vkCmdCopyBuffer(_transferBuffer, indexStagingBuffer, iInfo._buffer, 1, &region);
+				vkCmdCopyBuffer(commandBuffer, stagingBuffer, _indexPages[iInfo._page]._buffer, 1, &region);
 				indexSrcOffset += iInfo._size;
 			}
 
-			VkDeviceSize imageSrcOffset = 0;
+			VkDeviceSize imageSrcOffset = stagingBase + imageStagingOffset;
+			boost::array<VkBufferImageCopy, MAX_MIP_LEVELS> regions;
 			for (const auto& tInfo : _textureImagesToTransfer)
 			{
-				// Configure region of buffers to copy from.
-				VkBufferImageCopy region = {};
-				region.bufferOffset = imageSrcOffset;
-				region.bufferRowLength = 0;
-				region.bufferImageHeight = 0;
-				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				region.imageSubresource.mipLevel = 0;
-				region.imageSubresource.baseArrayLayer = 0;
-				region.imageSubresource.layerCount = 1;
-				region.imageOffset = { 0, 0, 0 };
-				region.imageExtent = { tInfo._width, tInfo._height, 1 };
+				// Configure one region for each mip level, which follow one another in the staging memory.
+				VkDeviceSize levelOffset = imageSrcOffset;
+				for (u32 level = 0; level < tInfo._mipLevels; ++level)
+				{
+					VkBufferImageCopy& region = regions[level];
+					region = {};
+					region.bufferOffset = levelOffset;
+					region.bufferRowLength = 0;
+					region.bufferImageHeight = 0;
+					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					region.imageSubresource.mipLevel = level;
+					region.imageSubresource.baseArrayLayer = 0;
+					region.imageSubresource.layerCount = 1;
+					region.imageOffset = { 0, 0, 0 };
+					region.imageExtent = { GetMipExtent(tInfo._width, level), GetMipExtent(tInfo._height, level), 1 };
+
+					levelOffset += static_cast<VkDeviceSize>(region.imageExtent.width) * region.imageExtent.height * tInfo._bpp;
+				}
 				
 				// Request to transition the image to receive data.
-				TransitionImageLayout(_transferBuffer, tInfo._image, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_LAYOUT_UNDEFINED,
+				TransitionImageLayout(commandBuffer, tInfo._image, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_LAYOUT_UNDEFINED,
 					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 				
 				// Add copy operation to the command buffer.
-				vkCmdCopyBufferToImage(_transferBuffer, imageStagingBuffer, tInfo._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, tInfo._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, tInfo._mipLevels, regions.data());
 				
 				// Configure memory barrier to transition the image to be read from the fragment shader.
-				TransitionImageLayout(_transferBuffer, tInfo._image, _transferQueueFamily, _graphicsQueueFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				TransitionImageLayout(commandBuffer, tInfo._image, _transferQueueFamily, _graphicsQueueFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
 				imageSrcOffset += tInfo._size;
 			}
 
-			CHECK_RESULT(vkEndCommandBuffer(_transferBuffer), VK_SUCCESS, RendererResult::Failure)
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+				return AbortUpload(upload);
 
 			// Configure queue submission information.
 			VkSubmitInfo submitInfo = {};
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &_transferBuffer;
+			submitInfo.pCommandBuffers = &commandBuffer;
 
-			// Submit command to queue and wait until it finishes.
-			CHECK_RESULT(vkQueueSubmit(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE), VK_SUCCESS, RendererResult::Failure)
+			// A queue shared with the render thread must not be used by both threads at once.
+			VkResult submitResult;
+			{
+				boost::unique_lock<boost::mutex> queueLock(_queueMutex, boost::defer_lock);
+				if (_sharedTransferQueue)
+					queueLock.lock();
 
-			// TODO: In the future, record secondary command buffers for static objects.
-			
-			UpdateFragmentDynamicUniformBuffers();
+				// Submit without waiting, the batch's fence tells when it is done.
+				submitResult = vkQueueSubmit(_transferQueue, 1, &submitInfo, upload->_fence);
+			}
 
-			// Wait until the transfer operations are completed before proceeding.
-			CHECK_RESULT(vkQueueWaitIdle(_transferQueue), VK_SUCCESS, RendererResult::Failure);
+			if (submitResult != VK_SUCCESS)
+				return AbortUpload(upload);
 
-			// Push texture images after their layout has been released.
-			_transferMutex.lock();
+			// Hand the images and the entities over to the batch, until it retires.
 			for (const auto& tInfo : _textureImagesToTransfer)
-				_releasedImages.push(tInfo._image);
+				upload->_images.push_back(tInfo._image);
 
-			// Add new entities to renderable entities.
-			_entitiesToRender.insert(_entitiesToTransfer.begin(), _entitiesToTransfer.end());
-			_transferMutex.unlock();
+			upload->_entities.swap(_entitiesToTransfer);
+			_uploadCount++;
+
+			// Cleanup data structures containing buffers and entities to transfer.
+			_vertexBuffersToTransfer.clear();
+			_indexBuffersToTransfer.clear();
+			_textureImagesToTransfer.clear();
+			_entitiesToTransfer.clear();
+
+			return RendererResult::Success;
+		}
 
-			// Cleanup stage buffers and free their memory.
-			if (imageStagingBuffer && imageStagingMemory)
+		RendererResult Renderer::AcquireUpload(VkDeviceSize stagingSize, UploadInfo** outUpload)
+		{
+			// Retire the uploads the device is done with, and wait for the oldest one while no batch is free.
+			CHECK_RESULT(RetireUploads(_uploadCount == MAX_UPLOADS), RendererResult::Success, RendererResult::Failure)
+
+			// The batch is handed out before its staging memory is reserved, so a failure can still be rolled back with AbortUpload.
+			UploadInfo* upload = &_uploads[(_firstUpload + _uploadCount) % MAX_UPLOADS];
+			upload->_stagingOffset = 0;
+			upload->_stagingSize = 0;
+			upload->_stagingBuffer = VK_NULL_HANDLE;
+			upload->_stagingMemory = {};
+			*outUpload = upload;
+
+			// A batch larger than the whole ring stages through a buffer of its own.
+			if (stagingSize > STAGING_RING_SIZE)
 			{
-				vkDestroyBuffer(_device._logical, imageStagingBuffer, nullptr);
-				vkFreeMemory(_device._logical, imageStagingMemory, nullptr);
+				VkBuffer stagingBuffer;
+				CHECK_RESULT(CreateBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &stagingBuffer), RendererResult::Success, RendererResult::Failure)
+				upload->_stagingBuffer = stagingBuffer;
+
+				CHECK_RESULT(AllocateBuffer(upload->_stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &upload->_stagingMemory),
+					RendererResult::Success, RendererResult::Failure)
+
+				return RendererResult::Success;
 			}
 
-			if (indexStagingBuffer && indexStagingMemory)
+			while (true)
 			{
-				vkDestroyBuffer(_device._logical, indexStagingBuffer, nullptr);
-				vkFreeMemory(_device._logical, indexStagingMemory, nullptr);
+				// Start over at the front of the ring, whenever nothing is in flight.
+				if (_stagingRingUsed == 0)
+					_stagingRingHead = 0;
+
+				// A range never wraps around, so the rest of the ring is skipped when the range does not fit in it.
+				bool wraps = _stagingRingHead + stagingSize > STAGING_RING_SIZE;
+				VkDeviceSize padding = wraps ? STAGING_RING_SIZE - _stagingRingHead : 0;
+				if (_stagingRingUsed + padding + stagingSize <= STAGING_RING_SIZE)
+				{
+					upload->_stagingOffset = wraps ? 0 : _stagingRingHead;
+					upload->_stagingSize = padding + stagingSize;
+
+					_stagingRingHead = upload->_stagingOffset + stagingSize;
+					_stagingRingUsed += upload->_stagingSize;
+
+					return RendererResult::Success;
+				}
+
+				// The ring is full, so wait for the oldest upload to give its range back. With nothing in flight, the range can never fit.
+				if (_uploadCount == 0)
+				{
+					Core::Debug::Error("Staging ring has no room left for the upload.");
+					return RendererResult::Failure;
+				}
+
+				CHECK_RESULT(RetireUploads(true), RendererResult::Success, RendererResult::Failure)
 			}
+		}
 
-			if (vertexStagingBuffer && vertexStagingMemory)
+		RendererResult Renderer::AbortUpload(UploadInfo* upload)
+		{
+			// Give the batch's staging memory back. Its range was the last one reserved, so the ring's head moves back over it.
+			if (upload)
 			{
-				vkDestroyBuffer(_device._logical, vertexStagingBuffer, nullptr);
-				vkFreeMemory(_device._logical, vertexStagingMemory, nullptr);
+				if (upload->_stagingBuffer != VK_NULL_HANDLE)
+				{
+					vkDestroyBuffer(_device._logical, upload->_stagingBuffer, nullptr);
+					_deviceAllocator.Free(&upload->_stagingMemory);
+					upload->_stagingBuffer = VK_NULL_HANDLE;
+				}
+				else
+				{
+					_stagingRingUsed -= upload->_stagingSize;
+					_stagingRingHead = (_stagingRingHead + STAGING_RING_SIZE - upload->_stagingSize) % STAGING_RING_SIZE;
+				}
+
+				upload->_stagingSize = 0;
+			}
+
+			// The entities never reach the device, so they release what they acquired, like the ones removed while on their way.
+			{
+				boost::lock_guard<boost::mutex> transferLock(_transferMutex);
+				for (auto& entity : _entitiesToTransfer)
+				{
+					_cancelledEntities.erase(entity.first);
+					for (auto& renderableInfo : entity.second._renderables)
+					{
+						ReleaseMesh(renderableInfo._mesh);
+						ReleaseTextureImage(renderableInfo._diffuseImage);
+					}
+				}
 			}
 
-			// Cleanup data structures containing buffers and entities to transfer.
 			_vertexBuffersToTransfer.clear();
 			_indexBuffersToTransfer.clear();
 			_textureImagesToTransfer.clear();
 			_entitiesToTransfer.clear();
 
-			return RendererResult::Success;
+			return RendererResult::Failure;
 		}
 
-		RendererResult Renderer::StageIndexBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory)
+		RendererResult Renderer::RetireUploads(bool waitForOldest)
 		{
-			if (bufferSize <= 0) return RendererResult::Success;
+			if (_uploadCount > 0 && waitForOldest)
+			{
+				CHECK_RESULT(vkWaitForFences(_device._logical, 1, &_uploads[_firstUpload]._fence, VK_TRUE, -1), VK_SUCCESS, RendererResult::Failure)
+			}
 
-			// Create staging buffer.
-			CHECK_RESULT(CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, stagingBuffer), RendererResult::Success, RendererResult::Failure)
-			CHECK_RESULT(AllocateBuffer(*stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingMemory), RendererResult::Success, RendererResult::Failure)
+			// Uploads retire in the order they were submitted, so an entity never shows up before the geometry or images it shares with an earlier one.
+			while (_uploadCount > 0)
+			{
+				UploadInfo& upload = _uploads[_firstUpload];
 
-			// Map pointer to staging buffer location and transfer data.
-			void* data;
-			CHECK_RESULT(vkMapMemory(_device._logical, *stagingMemory, 0, bufferSize, 0, &data), VK_SUCCESS, RendererResult::Failure)
+				VkResult status = vkGetFenceStatus(_device._logical, upload._fence);
+				if (status == VK_NOT_READY) break;
+				CHECK_RESULT(status, VK_SUCCESS, RendererResult::Failure)
+				CHECK_RESULT(vkResetFences(_device._logical, 1, &upload._fence), VK_SUCCESS, RendererResult::Failure)
 
-			VkDeviceSize stagingOffset = 0;
-			for (const auto& iInfo : _indexBuffersToTransfer)
-			{
-				Memory::Copy((u8*)data + stagingOffset, iInfo._indices.data(), (usize)(iInfo._indices.size() * sizeof(u32)));
-				stagingOffset += iInfo._size;
+				// The render thread reads the entities and their batches while recording, under the transfer lock.
+				_transferMutex.lock();
+
+				// Push texture images after their layout has been released.
+				for (VkImage image : upload._images)
+					_releasedImages.push(image);
+
+				// Add new entities to renderable entities, and their renderables to the batches they are drawn with.
+				for (auto& entity : upload._entities)
+				{
+					// Entities removed while their upload was in flight release what they acquired instead.
+					if (_cancelledEntities.erase(entity.first) > 0)
+					{
+						for (auto& renderableInfo : entity.second._renderables)
+						{
+							ReleaseMesh(renderableInfo._mesh);
+							ReleaseTextureImage(renderableInfo._diffuseImage);
+						}
+
+						continue;
+					}
+
+					auto inserted = _entitiesToRender.insert(entity);
+					if (!inserted.second) continue;
+
+					// Entities start out dynamic, until their transforms have stood still for long enough.
+					for (auto& renderableInfo : inserted.first->second._renderables)
+						AddToBatch(&renderableInfo, false);
+				}
+				_transferMutex.unlock();
+
+				// Give the batch's staging memory back.
+				if (upload._stagingBuffer != VK_NULL_HANDLE)
+				{
+					vkDestroyBuffer(_device._logical, upload._stagingBuffer, nullptr);
+					_deviceAllocator.Free(&upload._stagingMemory);
+					upload._stagingBuffer = VK_NULL_HANDLE;
+				}
+
+				_stagingRingUsed -= upload._stagingSize;
+				upload._images.clear();
+				upload._entities.clear();
+
+				_firstUpload = (_firstUpload + 1) % MAX_UPLOADS;
+				_uploadCount--;
 			}
 
-			vkUnmapMemory(_device._logical, *stagingMemory);
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::StageVertexBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory)
+		bool Renderer::IsEntityPending(Core::Entity* entity) const
 		{
-			if (bufferSize <= 0) return RendererResult::Success;
+			if (_entitiesToTransfer.find(entity) != _entitiesToTransfer.end())
+				return true;
 
-			// Create staging buffer.
-			CHECK_RESULT(CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, stagingBuffer), RendererResult::Success, RendererResult::Failure)
-			CHECK_RESULT(AllocateBuffer(*stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingMemory), RendererResult::Success, RendererResult::Failure)
+			for (usize i = 0; i < _uploadCount; ++i)
+			{
+				const UploadInfo& upload = _uploads[(_firstUpload + i) % MAX_UPLOADS];
+				if (upload._entities.find(entity) != upload._entities.end())
+					return true;
+			}
 
-			// Map pointer to staging buffer location and transfer data.
-			void* data;
-			CHECK_RESULT(vkMapMemory(_device._logical, *stagingMemory, 0, bufferSize, 0, &data), VK_SUCCESS, RendererResult::Failure)
+			return false;
+		}
 
+		void Renderer::StageIndexBuffer(u8* staging)
+		{
+			VkDeviceSize stagingOffset = 0;
+			for (const auto& iInfo : _indexBuffersToTransfer)
+			{
+				Memory::CopyNonTemporal(staging + stagingOffset, iInfo._indices.data(), (usize)(iInfo._indices.size() * sizeof(u32)));
+				stagingOffset += iInfo._size;
+			}
+		}
+
+		void Renderer::StageVertexBuffer(u8* staging)
+		{
 			VkDeviceSize stagingOffset = 0;
 			for (const auto& vInfo : _vertexBuffersToTransfer)
 			{
-				Memory::Copy((u8*)data + stagingOffset, vInfo._vertices.data(), (usize)(vInfo._vertices.size() * sizeof(Vertex)));
+				Memory::CopyNonTemporal(staging + stagingOffset, vInfo._vertices.data(), (usize)(vInfo._vertices.size() * sizeof(Vertex)));
 				stagingOffset += vInfo._size;
 			}
-
-			vkUnmapMemory(_device._logical, *stagingMemory);
-			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::StageImageBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory)
+		void Renderer::StageImageBuffer(u8* staging)
 		{
-			if (bufferSize <= 0) return RendererResult::Success;
-
-			// Create staging buffer.
-			CHECK_RESULT(CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, stagingBuffer), RendererResult::Success, RendererResult::Failure)
-			CHECK_RESULT(AllocateBuffer(*stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingMemory), RendererResult::Success, RendererResult::Failure)
-
-			// Map pointer to staging buffer location and transfer data.
-			void* data;
-			CHECK_RESULT(vkMapMemory(_device._logical, *stagingMemory, 0, bufferSize, 0, &data), VK_SUCCESS, RendererResult::Failure)
+			// The levels are built in cached memory, as reading back from the staging memory would be slow.
+			Memory::Vector<u8, Memory::MemoryTag::Renderer> levels;
 
 			VkDeviceSize stagingOffset = 0;
 			for (const auto& tInfo : _textureImagesToTransfer)
 			{
-				Memory::Copy((u8*)data + stagingOffset, tInfo._pixels, tInfo._width * tInfo._height * tInfo._bpp * sizeof(u8));
+				const usize baseSize = tInfo._width * tInfo._height * tInfo._bpp * sizeof(u8);
+				Memory::CopyNonTemporal(staging + stagingOffset, tInfo._pixels, baseSize);
+
+				// Build the rest of the mip chain and place it right after the first level.
+				if (tInfo._mipLevels > 1)
+				{
+					const usize levelsSize = GetMipChainSize(tInfo._width, tInfo._height, tInfo._bpp) - baseSize;
+					levels.resize(levelsSize);
+					GenerateMipChain(tInfo._pixels, tInfo._width, tInfo._height, levels.data());
+					Memory::CopyNonTemporal(staging + stagingOffset + baseSize, levels.data(), levelsSize);
+				}
+
 			 	stagingOffset += tInfo._size;
 
 				// Release texture image from RAM.
-				_textureImage.right.at(tInfo._image)->Unload();
+				tInfo._texture->Unload();
 			}
-
-			vkUnmapMemory(_device._logical, *stagingMemory);
-
-			return RendererResult::Success;
 		}
 
 		void Renderer::TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, u32 srcQueueFamily, u32 dstQueueFamily, VkImageLayout srcLayout, VkImageLayout dstLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
@@ -1391,7 +1895,7 @@ namespace Re
 			memoryBarrier.image = image;
 			memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			memoryBarrier.subresourceRange.baseMipLevel = 0;
-			memoryBarrier.subresourceRange.levelCount = 1;
+			memoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
 			memoryBarrier.subresourceRange.baseArrayLayer = 0;
 			memoryBarrier.subresourceRange.layerCount = 1;
 			memoryBarrier.srcAccessMask = srcAccess;
@@ -1510,18 +2014,22 @@ namespace Re
 			boost::container::set<i32> queueFamilies = { familyInfo._graphicsFamily, familyInfo._presentationFamily, familyInfo._transferFamily };
 			boost::container::vector<VkDeviceQueueCreateInfo> queueInfos(queueFamilies.size());
 
+			// Families with a single queue, as in software implementations, share it between rendering and streaming.
+			_sharedTransferQueue = !familyInfo.HasDedicatedTransfer() && familyInfo._graphicsQueueCount < 2;
+
+			// Priorities must outlive the loop, as the create information only points at them.
+			float singlePriorities[] = { 1.0f };
+			float doublePriorities[] = { 1.0f, 1.0f };
+
 			// Create the information regarding the queues that will be used from the logical device.
 			for (auto& family : queueFamilies)
 			{
-				float singlePriorities[] = { 1.0f };
-				float doublePriorities[] = { 1.0f, 1.0f };
-
 				// Configure queue info for specified family.
 				queueInfos[family].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 				queueInfos[family].queueFamilyIndex = family;
 
 				// Check if will require two queues from graphics family.
-				if (family == familyInfo._graphicsFamily && !familyInfo.HasDedicatedTransfer())
+				if (family == familyInfo._graphicsFamily && !familyInfo.HasDedicatedTransfer() && !_sharedTransferQueue)
 				{
 					queueInfos[family].queueCount = 2;
 					queueInfos[family].pQueuePriorities = doublePriorities;
@@ -1563,7 +2071,7 @@ namespace Re
 			}
 			else
 			{
-				vkGetDeviceQueue(_device._logical, familyInfo._transferFamily, 1, &_transferQueue);
+				vkGetDeviceQueue(_device._logical, familyInfo._transferFamily, _sharedTransferQueue ? 0 : 1, &_transferQueue);
 			}
 
 			return RendererResult::Success;
@@ -1788,16 +2296,31 @@ namespace Re
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::CreatePushConstantRanges()
+		RendererResult Renderer::CreatePipelineCache()
 		{
-			// Resize the push constant range vector to hold all constants.
-			_pushConstantRanges.resize(1);
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(_device._physical, &properties);
+
+			// Start from the data of the previous run, if it was written for this device and driver.
+			boost::container::vector<char> data;
+			if (!ReadPipelineCache(PIPELINE_CACHE_PATH, properties, &data))
+				data.clear();
+
+			VkPipelineCacheCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			createInfo.initialDataSize = data.size();
+			createInfo.pInitialData = data.empty() ? nullptr : data.data();
 
-			// Configure the values for the vertex push constant.
-			_pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-			_pushConstantRanges[0].offset = 0;
-			_pushConstantRanges[0].size = sizeof(VertexPush);
+			// The driver may still turn the data down, in which case the cache starts out empty.
+			if (vkCreatePipelineCache(_device._logical, &createInfo, nullptr, &_pipelineCache) != VK_SUCCESS)
+			{
+				createInfo.initialDataSize = 0;
+				createInfo.pInitialData = nullptr;
+				CHECK_RESULT(vkCreatePipelineCache(_device._logical, &createInfo, nullptr, &_pipelineCache), VK_SUCCESS, RendererResult::Failure)
+				data.clear();
+			}
 
+			_pipelineCacheHash = Core::Hash::XXH64(data.data(), data.size());
 			return RendererResult::Success;
 		}
 
@@ -1835,14 +2358,17 @@ namespace Re
 
 			#pragma region Vertex Input Stage
 
-			// Definitions of how data for a single vertex is a whole.
-			VkVertexInputBindingDescription bindingDescription = {};
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			// Definitions of how data for a single vertex, and for a single instance, is a whole.
+			boost::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {};
+			bindingDescriptions[0].binding = 0;
+			bindingDescriptions[0].stride = sizeof(Vertex);
+			bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			bindingDescriptions[1].binding = 1;
+			bindingDescriptions[1].stride = sizeof(InstanceData);
+			bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-			// How the data for an attribute is defined within the vertex.
-			boost::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
+			// How the data for an attribute is defined within the vertex, or within the instance.
+			boost::array<VkVertexInputAttributeDescription, 11> attributeDescriptions = {};
 
 			// Position attribute.
 			attributeDescriptions[0].binding = 0;
@@ -1862,11 +2388,25 @@ namespace Re
 			attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
 			attributeDescriptions[2].offset = offsetof(Vertex, _textureCoordinate);
 
+			// Model and normal matrix attributes, each taking a location per column.
+			for (u32 column = 0; column < 4; ++column)
+			{
+				attributeDescriptions[3 + column].binding = 1;
+				attributeDescriptions[3 + column].location = 3 + column;
+				attributeDescriptions[3 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				attributeDescriptions[3 + column].offset = static_cast<u32>(offsetof(InstanceData, _model) + column * 4 * sizeof(f32));
+
+				attributeDescriptions[7 + column].binding = 1;
+				attributeDescriptions[7 + column].location = 7 + column;
+				attributeDescriptions[7 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+				attributeDescriptions[7 + column].offset = static_cast<u32>(offsetof(InstanceData, _normal) + column * 4 * sizeof(f32));
+			}
+
 			// Vertex input stage.
 			VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
 			vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-			vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-			vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<u32>(bindingDescriptions.size());
+			vertexInputCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 			vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<u32>(attributeDescriptions.size());
 			vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -1967,8 +2507,8 @@ namespace Re
 			layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 			layoutCreateInfo.setLayoutCount = static_cast<u32>(descriptorSetLayouts.size());
 			layoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-			layoutCreateInfo.pushConstantRangeCount = static_cast<u32>(_pushConstantRanges.size());
-			layoutCreateInfo.pPushConstantRanges = _pushConstantRanges.data();
+			layoutCreateInfo.pushConstantRangeCount = 0;
+			layoutCreateInfo.pPushConstantRanges = nullptr;
 
 			// Create pipeline layout.
 			CHECK_RESULT(vkCreatePipelineLayout(_device._logical, &layoutCreateInfo, nullptr, &_pipelineLayout), VK_SUCCESS, RendererResult::Failure)
@@ -2009,7 +2549,7 @@ namespace Re
 			pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 			pipelineCreateInfo.basePipelineIndex = -1;
 
-			CHECK_RESULT(vkCreateGraphicsPipelines(_device._logical, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_graphicsPipeline), VK_SUCCESS, RendererResult::Failure)
+			CHECK_RESULT(vkCreateGraphicsPipelines(_device._logical, _pipelineCache, 1, &pipelineCreateInfo, nullptr, &_graphicsPipeline), VK_SUCCESS, RendererResult::Failure)
 			
 			// Destroy shader modules (no longer needed after creating pipeline).
 			vkDestroyShaderModule(_device._logical, fragmentShader, nullptr);
@@ -2027,7 +2567,7 @@ namespace Re
 			);
 
 			// Create and allocate image and view, using the appropriate depth stencil format.
-			CHECK_RESULT(CreateImage(_swapchainExtent.width, _swapchainExtent.height, _depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &_depthBufferImage), RendererResult::Success, RendererResult::Failure);
+			CHECK_RESULT(CreateImage(_swapchainExtent.width, _swapchainExtent.height, 1, _depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &_depthBufferImage), RendererResult::Success, RendererResult::Failure);
 			CHECK_RESULT(AllocateImage(_depthBufferImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_depthBufferMemory), RendererResult::Success, RendererResult::Failure);
 			CHECK_RESULT(CreateImageView(_depthBufferImage, _depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, &_depthBufferImageView), RendererResult::Success, RendererResult::Failure);
 			return RendererResult::Success;
@@ -2106,11 +2646,54 @@ namespace Re
 			allocateInfo.commandBufferCount = static_cast<u32>(_commandBuffers.size());
 
 			CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, _commandBuffers.data()), VK_SUCCESS, RendererResult::Failure)
-		
-			// Create command buffer for transfer operations.
-			allocateInfo.commandPool = _transferPool;
+
+			return RendererResult::Success;
+		}
+
+		RendererResult Renderer::CreateRecordingCommandBuffers()
+		{
+			// Leave a core to the streaming thread, the render thread and the workers take the rest.
+			usize cores = static_cast<usize>(boost::thread::hardware_concurrency());
+			_recordingSlices = std::min(std::max<usize>(cores, 2) - 1, MAX_RECORDING_SLICES);
+
+			// Each slice of each frame in flight records from a pool of its own, which is reset as a whole every time the frame comes around.
+			VkCommandPoolCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			createInfo.queueFamilyIndex = _graphicsQueueFamily;
+			createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
 			allocateInfo.commandBufferCount = 1;
-			CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, &_transferBuffer), VK_SUCCESS, RendererResult::Failure)
+
+			_recordingPools.assign(MAX_FRAME_DRAWS * _recordingSlices, VK_NULL_HANDLE);
+			_secondaryCommandBuffers.assign(MAX_FRAME_DRAWS * _recordingSlices, VK_NULL_HANDLE);
+
+			for (usize i = 0; i < _recordingPools.size(); ++i)
+			{
+				CHECK_RESULT(vkCreateCommandPool(_device._logical, &createInfo, nullptr, &_recordingPools[i]), VK_SUCCESS, RendererResult::Failure)
+
+				allocateInfo.commandPool = _recordingPools[i];
+				CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, &_secondaryCommandBuffers[i]), VK_SUCCESS, RendererResult::Failure)
+			}
+
+			// The static batches are recorded for each frame in flight and image, into command buffers that are reset one by one.
+			createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			allocateInfo.commandBufferCount = static_cast<u32>(_commandBuffers.size());
+
+			_staticPools.assign(MAX_FRAME_DRAWS, VK_NULL_HANDLE);
+			_staticCommandBuffers.assign(MAX_FRAME_DRAWS * _commandBuffers.size(), VK_NULL_HANDLE);
+			_staticCommandVersions.assign(MAX_FRAME_DRAWS * _commandBuffers.size(), 0);
+			_staticInstanceVersions.assign(MAX_FRAME_DRAWS, 0);
+
+			for (usize i = 0; i < MAX_FRAME_DRAWS; ++i)
+			{
+				CHECK_RESULT(vkCreateCommandPool(_device._logical, &createInfo, nullptr, &_staticPools[i]), VK_SUCCESS, RendererResult::Failure)
+
+				allocateInfo.commandPool = _staticPools[i];
+				CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, &_staticCommandBuffers[i * _commandBuffers.size()]), VK_SUCCESS, RendererResult::Failure)
+			}
 
 			return RendererResult::Success;
 		}
@@ -2119,7 +2702,12 @@ namespace Re
 		{
 			VkDeviceSize vertexBufferSize = sizeof(VertexUniform);
 			VkDeviceSize fragmentBufferSize = sizeof(FragmentUniform);
-			VkDeviceSize fragmentDynamicBufferSize = GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment) * MAX_RENDERABLES;
+
+			// The dynamic uniform ring holds a segment for each frame in flight, grown with the batch count.
+			_dynamicUniformSegmentSize = GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment) * INITIAL_BATCHES;
+			VkDeviceSize fragmentDynamicBufferSize = _dynamicUniformSegmentSize * MAX_FRAME_DRAWS;
+
+			// Uniform memory is host visible, so the device allocator keeps it mapped for as long as it lives.
 
 			// Create one vertex uniform buffer for each swapchain image.
 			_vertexUniformBuffers.resize(_swapchainImages.size());
@@ -2139,13 +2727,26 @@ namespace Re
 				CHECK_RESULT(AllocateBuffer(_fragmentUniformBuffers[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_fragmentUniformBuffersMemory[i]), RendererResult::Success, RendererResult::Failure)
 			}
 
-			// Create one fragment dynamic uniform buffer for each swapchain image.
-			_fragmentDynamicUniformBuffers.resize(_swapchainImages.size());
-			_fragmentDynamicUniformBuffersMemory.resize(_swapchainImages.size());
-			for (usize i = 0; i < _fragmentDynamicUniformBuffers.size(); ++i)
+			// Every image starts out of date, so its lights are uploaded before it is first rendered.
+			_fragmentUniformBuffersVersion.assign(_swapchainImages.size(), 0);
+			_fragmentUniformVersion = 1;
+
+			// Create a single fragment dynamic uniform buffer, shared by every swapchain image.
+			CHECK_RESULT(CreateBuffer(fragmentDynamicBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &_fragmentDynamicUniformBuffer), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(_fragmentDynamicUniformBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_fragmentDynamicUniformBufferMemory), RendererResult::Success, RendererResult::Failure)
+
+			return RendererResult::Success;
+		}
+
+		RendererResult Renderer::CreateInstanceBuffers()
+		{
+			_instanceBuffers.assign(MAX_FRAME_DRAWS, VK_NULL_HANDLE);
+			_instanceBuffersMemory.resize(MAX_FRAME_DRAWS);
+			_instanceCapacities.assign(MAX_FRAME_DRAWS, 0);
+
+			for (usize i = 0; i < MAX_FRAME_DRAWS; ++i)
 			{
-				CHECK_RESULT(CreateBuffer(fragmentDynamicBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &_fragmentDynamicUniformBuffers[i]), RendererResult::Success, RendererResult::Failure)
-				CHECK_RESULT(AllocateBuffer(_fragmentDynamicUniformBuffers[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_fragmentDynamicUniformBuffersMemory[i]), RendererResult::Success, RendererResult::Failure)
+				CHECK_RESULT(ReserveInstances(i, INITIAL_INSTANCES), RendererResult::Success, RendererResult::Failure)
 			}
 
 			return RendererResult::Success;
@@ -2262,7 +2863,7 @@ namespace Re
 				descriptorWrite[i + _bufferDescriptorSets.size()].pBufferInfo = &descriptorBuffer[i + _bufferDescriptorSets.size()];
 
 				// Fragment dynamic descriptor buffer information.
-				descriptorBuffer[i + 2 * _bufferDescriptorSets.size()].buffer = _fragmentDynamicUniformBuffers[i];
+				descriptorBuffer[i + 2 * _bufferDescriptorSets.size()].buffer = _fragmentDynamicUniformBuffer;
 				descriptorBuffer[i + 2 * _bufferDescriptorSets.size()].offset = 0;
 				descriptorBuffer[i + 2 * _bufferDescriptorSets.size()].range = GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment);
 
@@ -2307,6 +2908,36 @@ namespace Re
 			return RendererResult::Success;
 		}
 
+		RendererResult Renderer::CreateUploads()
+		{
+			// Every upload in flight records into a command buffer of its own, and signals a fence of its own once done.
+			VkCommandBufferAllocateInfo allocateInfo = {};
+			allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocateInfo.commandPool = _transferPool;
+			allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocateInfo.commandBufferCount = 1;
+
+			VkFenceCreateInfo fenceCreateInfo = {};
+			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			for (auto& upload : _uploads)
+			{
+				CHECK_RESULT(vkAllocateCommandBuffers(_device._logical, &allocateInfo, &upload._commandBuffer), VK_SUCCESS, RendererResult::Failure)
+				CHECK_RESULT(vkCreateFence(_device._logical, &fenceCreateInfo, nullptr, &upload._fence), VK_SUCCESS, RendererResult::Failure)
+				upload._stagingBuffer = VK_NULL_HANDLE;
+			}
+
+			// The staging ring stays mapped for as long as it lives, and the uploads take their ranges from it in turn.
+			CHECK_RESULT(CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &_stagingRing), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(_stagingRing, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_stagingRingMemory), RendererResult::Success, RendererResult::Failure)
+
+			_firstUpload = 0;
+			_uploadCount = 0;
+			_stagingRingHead = 0;
+			_stagingRingUsed = 0;
+			return RendererResult::Success;
+		}
+
 		RendererResult Renderer::CreateTextureSampler()
 		{
 			// Sampler creation information.
@@ -2322,7 +2953,7 @@ namespace Re
 			createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 			createInfo.mipLodBias = 0.0f;
 			createInfo.minLod = 0.0f;
-			createInfo.maxLod = 0.0f;
+			createInfo.maxLod = VK_LOD_CLAMP_NONE;
 			createInfo.anisotropyEnable = VK_TRUE;
 			createInfo.maxAnisotropy = 16.0f;
 
@@ -2330,10 +2961,10 @@ namespace Re
 			return RendererResult::Success;
 		}
 
-		RendererResult Renderer::RecordCommands(usize offset, usize size)
+		RendererResult Renderer::RecordCommands(usize imageIndex)
 		{
-			ASSERT(offset >= 0);
-			ASSERT(size <= _commandBuffers.size());
+			ASSERT(imageIndex < _commandBuffers.size());
+			VkCommandBuffer commandBuffer = _commandBuffers[imageIndex];
 
 			// Information about how to begin a command buffer.
 			VkCommandBufferBeginInfo bufferBeginInfo = {};
@@ -2352,88 +2983,258 @@ namespace Re
 			passBeginInfo.renderArea.extent = _swapchainExtent;
 			passBeginInfo.clearValueCount = static_cast<u32>(clearValues.size());
 			passBeginInfo.pClearValues = clearValues.data();
-			
-			for (usize i = offset; i < (offset + size); ++i)
-			{
-				// Set the correct framebuffer for the render pass.
-				passBeginInfo.framebuffer = _swapchainFramebuffers[i];
-				
-				// Reset the command buffer.
-				CHECK_RESULT(vkResetCommandBuffer(_commandBuffers[i], 0), VK_SUCCESS, RendererResult::Failure)
-				CHECK_RESULT(vkBeginCommandBuffer(_commandBuffers[i], &bufferBeginInfo), VK_SUCCESS, RendererResult::Failure)
+			passBeginInfo.framebuffer = _swapchainFramebuffers[imageIndex];
 
-				// Acquire lock to stop transfers from taking place.
-				_transferMutex.lock();
+			// Reset the command buffer.
+			CHECK_RESULT(vkResetCommandBuffer(commandBuffer, 0), VK_SUCCESS, RendererResult::Failure)
+			CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo), VK_SUCCESS, RendererResult::Failure)
 
-				// Acquire images released by the transfer queue.
-                _releasedImages.consume_all([this, i](VkImage image) {
-                    TransitionImageLayout(_commandBuffers[i], image, _transferQueueFamily, _graphicsQueueFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-                    });
+			// Acquire lock to stop transfers from taking place, the recording threads read the batches under it as well.
+			boost::unique_lock<boost::mutex> transferLock(_transferMutex);
 
-				vkCmdBeginRenderPass(_commandBuffers[i], &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-				
-				if (_entitiesToRender.size() > 0)
+			// Acquire images released by the transfer queue.
+			_releasedImages.consume_all([this, commandBuffer](VkImage image) {
+				TransitionImageLayout(commandBuffer, image, _transferQueueFamily, _graphicsQueueFamily, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+				});
+
+			// Move entities between the static and the dynamic batches, as they stand still or start moving.
+			UpdateMobility();
+
+			// Write the instances of every batch into this frame's instance buffer.
+			if (WriteInstances(_currentFrame) == RendererResult::Failure)
+				return RendererResult::Failure;
+
+			// Write the material of every batch into this frame's segment of the dynamic uniform ring, so the recording threads only read.
+			// The static batches come first, so their materials land on the same offsets for as long as the static set is unchanged.
+			// The draws only live for this frame, so they are built in the frame's arena rather than on the heap.
+			_batchDraws = Memory::FrameVector<BatchDraw>(Memory::FrameAllocatorAdapter<BatchDraw>(Memory::MemoryManager::GetFrameAllocator().GetArena(_currentFrame)));
+			_batchDraws.reserve(_batches.size());
+			_staticDrawCount = 0;
+			if (ReserveDynamicUniforms(_batches.size()) == RendererResult::Failure)
+				return RendererResult::Failure;
+
+			for (auto& batch : _batches)
+			{
+				const BatchKey& batchKey = batch.first;
+
+				u32 dynamicOffset;
+				FragmentDynamicUniform* dynamicUniform = static_cast<FragmentDynamicUniform*>(AllocateDynamicUniform(sizeof(FragmentDynamicUniform), &dynamicOffset));
+				if (!dynamicUniform)
 				{
-					vkCmdBindPipeline(_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+					Core::Debug::Error("Failed to allocate the dynamic uniform of a batch.");
+					return RendererResult::Failure;
+				}
 
-					usize j = 0;
-					for (auto& entity : _entitiesToRender)
-					{
-						// Retrieve the entity information.
-						const EntityInfo& entityInfo = entity.second;
+				dynamicUniform->_material._specularPower = batchKey._specularPower;
+				dynamicUniform->_material._specularStrength = batchKey._specularStrength;
+
+				BatchDraw draw = {};
+				draw._batch = &batch.second;
+				draw._textureSet = _textureDescriptorSets[batchKey._diffuseImage];
+				draw._dynamicOffset = dynamicOffset;
+				_batchDraws.push_back(draw);
+
+				if (batchKey._static)
+					_staticDrawCount++;
+			}
+
+			if (_batchDraws.empty())
+			{
+				vkCmdBeginRenderPass(commandBuffer, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdEndRenderPass(commandBuffer);
+			}
+			else
+			{
+				// Only split the dynamic batches among as many threads as have enough of them to pay for waking up.
+				usize dynamicDrawCount = _batchDraws.size() - _staticDrawCount;
+				usize slices = std::min(_recordingSlices, (dynamicDrawCount + BATCHES_PER_SLICE - 1) / BATCHES_PER_SLICE);
+
+				// Idle workers read the slice count when woken, so it only changes under the lock.
+				{
+					boost::lock_guard<boost::mutex> lock(_recordingMutex);
+					_recordingImage = imageIndex;
+					_activeRecordingSlices = slices;
+					_recordingPending = slices > 1 ? slices - 1 : 0;
+					_recordingFailed = false;
+
+					if (slices > 1)
+						_recordingGeneration++;
+				}
 
-						// Create vertex push constant from object and camera information.
-						VertexPush vp = {};
-						vp._model = entityInfo._transformComponent ? entityInfo._transformComponent->GetModel() : Math::Matrix::Identity();
-						vp._view = _activeCamera ? _activeCamera->GetView() : Math::Matrix::Identity();
+				if (slices > 1)
+					_recordingRequested.notify_all();
 
-						// Push constants into the shaders.
-						vkCmdPushConstants(_commandBuffers[i], _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPush), &vp);
+				RendererResult result = RendererResult::Success;
+				boost::array<VkCommandBuffer, MAX_RECORDING_SLICES + 1> secondaryCommandBuffers;
+				usize secondaryCount = 0;
 
-						for (auto& renderableInfo : entityInfo._renderables)
+				// Record the static batches again only if the static set changed since this frame and image last drew them.
+				if (_staticDrawCount > 0)
+				{
+					usize index = _currentFrame * _commandBuffers.size() + imageIndex;
+					if (_staticCommandVersions[index] != _staticVersion)
+					{
+						if (vkResetCommandBuffer(_staticCommandBuffers[index], 0) != VK_SUCCESS ||
+							RecordDraws(_staticCommandBuffers[index], 0, 0, _staticDrawCount) == RendererResult::Failure)
 						{
-							// Acquire required information from the entities to be rendered.
-							VkBuffer vertexBuffer = renderableInfo._vertexBuffer;
-							VkBuffer indexBuffer = renderableInfo._indexBuffer;
-							u32 indexCount = renderableInfo._indexCount;
-							VkImage diffuseImage = renderableInfo._diffuseImage;
-							VkDeviceSize offsets[] = { 0 };
-
-							// Bind vertex and index buffers.
-							vkCmdBindVertexBuffers(_commandBuffers[i], 0, 1, &vertexBuffer, offsets);
-							vkCmdBindIndexBuffer(_commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-							// Configure dynamic offsets for dynamic buffers.
-							u32 dynamicOffset = static_cast<u32>(GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment)) * j;
-
-							// Assemble descriptor sets into a single array.
-							boost::array<VkDescriptorSet, 2> descriptorSets = {
-								_bufferDescriptorSets[i], _textureDescriptorSets[diffuseImage]
-							};
-
-							// Bind descriptor sets.
-							vkCmdBindDescriptorSets(_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
-								0, descriptorSets.size(), descriptorSets.data(), 1, &dynamicOffset);
-
-							// Add rendering commands to the buffer.
-							vkCmdDrawIndexed(_commandBuffers[i], indexCount, 1, 0, 0, 0);
-							j++;
+							result = RendererResult::Failure;
+						}
+						else
+						{
+							_staticCommandVersions[index] = _staticVersion;
 						}
 					}
+
+					secondaryCommandBuffers[secondaryCount++] = _staticCommandBuffers[index];
 				}
 
-				vkCmdEndRenderPass(_commandBuffers[i]);
+				// Record the first dynamic slice on this thread, while the workers record the others.
+				if (slices > 0 && RecordBatches(0) == RendererResult::Failure)
+					result = RendererResult::Failure;
 
-				// Release mutex after recording commands for this frame.
-				_transferMutex.unlock();
+				if (slices > 1)
+				{
+					boost::unique_lock<boost::mutex> lock(_recordingMutex);
+					_recordingFinished.wait(lock, [this]() {
+						return _recordingPending == 0;
+						});
 
-				CHECK_RESULT(vkEndCommandBuffer(_commandBuffers[i]), VK_SUCCESS, RendererResult::Failure)
+					if (_recordingFailed)
+						result = RendererResult::Failure;
+				}
+
+				if (result == RendererResult::Failure)
+					return RendererResult::Failure;
+
+				for (usize slice = 0; slice < slices; ++slice)
+					secondaryCommandBuffers[secondaryCount++] = _secondaryCommandBuffers[_currentFrame * _recordingSlices + slice];
+
+				// Execute the static batches, then the dynamic slices in order, which keeps the draws in the order of the batches.
+				vkCmdBeginRenderPass(commandBuffer, &passBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				vkCmdExecuteCommands(commandBuffer, static_cast<u32>(secondaryCount), secondaryCommandBuffers.data());
+				vkCmdEndRenderPass(commandBuffer);
 			}
-			
+
+			// Release mutex after recording commands for this frame.
+			transferLock.unlock();
+
+			CHECK_RESULT(vkEndCommandBuffer(commandBuffer), VK_SUCCESS, RendererResult::Failure)
 			return RendererResult::Success;
 		}
 
+		RendererResult Renderer::RecordBatches(usize slice)
+		{
+			ASSERT(slice < _activeRecordingSlices);
+
+			// The frame that last recorded into this pool has finished on the GPU, so the pool can be reset as a whole.
+			usize index = _currentFrame * _recordingSlices + slice;
+			CHECK_RESULT(vkResetCommandPool(_device._logical, _recordingPools[index], 0), VK_SUCCESS, RendererResult::Failure)
+
+			// Each slice takes an even share of the dynamic batches, the last one also takes what is left over.
+			usize share = (_batchDraws.size() - _staticDrawCount) / _activeRecordingSlices;
+			usize first = _staticDrawCount + share * slice;
+			usize last = (slice + 1 == _activeRecordingSlices) ? _batchDraws.size() : first + share;
+
+			return RecordDraws(_secondaryCommandBuffers[index], VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, first, last);
+		}
+
+		RendererResult Renderer::RecordDraws(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags flags, usize first, usize last)
+		{
+			// The commands continue the render pass the primary command buffer begins on the same framebuffer.
+			VkCommandBufferInheritanceInfo inheritanceInfo = {};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = _renderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = _swapchainFramebuffers[_recordingImage];
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo), VK_SUCCESS, RendererResult::Failure)
+
+			// Secondary command buffers inherit no state, so each one binds the pipeline and the instance buffer itself.
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+
+			// Every batch reads its instances from its own range of the same buffer.
+			VkDeviceSize instanceOffsets[] = { 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 1, 1, &_instanceBuffers[_currentFrame], instanceOffsets);
+
+			// Geometry pages are only bound when a draw reads from a page other than the bound one.
+			u32 boundVertexPage = std::numeric_limits<u32>::max();
+			u32 boundIndexPage = std::numeric_limits<u32>::max();
+
+			for (usize i = first; i < last; ++i)
+			{
+				const BatchDraw& draw = _batchDraws[i];
+				const BatchInfo& batchInfo = *draw._batch;
+				VkDeviceSize offsets[] = { 0 };
+
+				// Bind vertex and index pages, if not already bound.
+				if (batchInfo._vertexPage != boundVertexPage)
+				{
+					boundVertexPage = batchInfo._vertexPage;
+					vkCmdBindVertexBuffers(commandBuffer, 0, 1, &_vertexPages[boundVertexPage]._buffer, offsets);
+				}
+
+				if (batchInfo._indexPage != boundIndexPage)
+				{
+					boundIndexPage = batchInfo._indexPage;
+					vkCmdBindIndexBuffer(commandBuffer, _indexPages[boundIndexPage]._buffer, 0, VK_INDEX_TYPE_UINT32);
+				}
+
+				// Assemble descriptor sets into a single array.
+				boost::array<VkDescriptorSet, 2> descriptorSets = {
+					_bufferDescriptorSets[_recordingImage], draw._textureSet
+				};
+
+				// Bind descriptor sets.
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+					0, descriptorSets.size(), descriptorSets.data(), 1, &draw._dynamicOffset);
+
+				// Draw every instance of the batch at once, reading the batch's ranges of the pages and of the instance buffer.
+				vkCmdDrawIndexed(commandBuffer, batchInfo._indexCount, batchInfo._instanceCount, batchInfo._firstIndex, batchInfo._vertexOffset, batchInfo._firstInstance);
+			}
+
+			CHECK_RESULT(vkEndCommandBuffer(commandBuffer), VK_SUCCESS, RendererResult::Failure)
+			return RendererResult::Success;
+		}
+
+		void Renderer::RecordingWorker(usize slice)
+		{
+			u64 generation = 0;
+			boost::unique_lock<boost::mutex> lock(_recordingMutex);
+
+			while (true)
+			{
+				// Wait until a frame hands out its slices, or the renderer shuts down.
+				_recordingRequested.wait(lock, [this, &generation]() {
+					return _recordingThreadsShouldClose || _recordingGeneration != generation;
+					});
+
+				if (_recordingThreadsShouldClose)
+					return;
+
+				generation = _recordingGeneration;
+
+				// Frames with few batches are split into fewer slices than there are threads.
+				if (slice >= _activeRecordingSlices)
+					continue;
+
+				lock.unlock();
+				RendererResult result = RecordBatches(slice);
+				lock.lock();
+
+				if (result == RendererResult::Failure)
+					_recordingFailed = true;
+
+				if (--_recordingPending == 0)
+					_recordingFinished.notify_one();
+			}
+		}
+
 		void Renderer::UpdateDirectionalLight(FragmentUniform::FragmentDirectionalLight* dstLight, const boost::shared_ptr<Entities::DirectionalLight>& srcLight)
 		{
 			dstLight->_base._color = srcLight->GetColor();
@@ -2464,76 +3265,276 @@ namespace Re
 		{
 			for (usize i = 0; i < _vertexUniformBuffersMemory.size(); ++i)
 			{
-				// Map pointer to buffer location.
-				void* data;
-				vkMapMemory(_device._logical, _vertexUniformBuffersMemory[i], 0, sizeof(VertexUniform), 0, &data);
+				UpdateVertexUniformBuffer(i);
+			}
+		}
 
-				// Transfer data to buffer memory.
-				Memory::Copy(data, &_vertexUniform, sizeof(VertexUniform));
+		void Renderer::UpdateVertexUniformBuffer(usize index)
+		{
+			// Transfer data to the persistently mapped buffer memory.
+			Memory::Copy(_vertexUniformBuffersMemory[index]._mapped, &_vertexUniform, sizeof(VertexUniform));
+		}
 
-				// Unmap memory from pointer.
-				vkUnmapMemory(_device._logical, _vertexUniformBuffersMemory[i]);
-			}
+		void Renderer::UpdateFragmentUniformBuffer(usize index)
+		{
+			// Skip the upload when the buffer already holds the latest lights.
+			if (_fragmentUniformBuffersVersion[index] == _fragmentUniformVersion)
+				return;
+
+			// Transfer data to the persistently mapped buffer memory.
+			Memory::Copy(_fragmentUniformBuffersMemory[index]._mapped, &_fragmentUniform, sizeof(FragmentUniform));
+			_fragmentUniformBuffersVersion[index] = _fragmentUniformVersion;
 		}
 
-		void Renderer::UpdateFragmentUniformBuffers()
+		void Renderer::InvalidateFragmentUniform()
 		{
-			for (usize i = 0; i < _fragmentUniformBuffersMemory.size(); ++i)
+			// Changes are coalesced, each image is uploaded at most once per frame it is rendered in.
+			_fragmentUniformVersion++;
+		}
+
+		void Renderer::ResetDynamicUniforms(usize frame)
+		{
+			ASSERT(frame < MAX_FRAME_DRAWS);
+
+			// Rewind to the start of the segment owned by the frame.
+			_dynamicUniformOffset = _dynamicUniformSegmentSize * frame;
+			_dynamicUniformEnd = _dynamicUniformOffset + _dynamicUniformSegmentSize;
+		}
+
+		void* Renderer::AllocateDynamicUniform(usize size, u32* offset)
+		{
+			// Dynamic offsets must be aligned to the device's minimum uniform alignment.
+			VkDeviceSize alignedSize = GetAlignedSize(size, _minUniformBufferAlignment);
+
+			// The segment is reserved for every batch before the frame is written, so running past it is a bug.
+			ASSERT(_dynamicUniformOffset + alignedSize <= _dynamicUniformEnd);
+			if (_dynamicUniformOffset + alignedSize > _dynamicUniformEnd)
+				return nullptr;
+
+			*offset = static_cast<u32>(_dynamicUniformOffset);
+			_dynamicUniformOffset += alignedSize;
+
+			return static_cast<u8*>(_fragmentDynamicUniformBufferMemory._mapped) + *offset;
+		}
+		
+		RendererResult Renderer::ReserveDynamicUniforms(usize count)
+		{
+			VkDeviceSize alignedSize = GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment);
+			usize capacity = static_cast<usize>(_dynamicUniformSegmentSize / alignedSize);
+			if (count <= capacity) return RendererResult::Success;
+
+			// Grow by doubling, like the instance buffers.
+			capacity = std::max(INITIAL_BATCHES, capacity);
+			while (capacity < count)
+				capacity *= 2;
+
+			// Unlike the instance buffers the ring is shared by every frame, so the other frames in flight must be done with it.
+			for (usize i = 0; i < MAX_FRAME_DRAWS; ++i)
 			{
-				// Map pointer to buffer location.
-				void* data;
-				vkMapMemory(_device._logical, _fragmentUniformBuffersMemory[i], 0, sizeof(FragmentUniform), 0, &data);
+				if (i != _currentFrame)
+					CHECK_RESULT(vkWaitForFences(_device._logical, 1, &_drawFences[i], VK_TRUE, -1), VK_SUCCESS, RendererResult::Failure)
+			}
+
+			vkDestroyBuffer(_device._logical, _fragmentDynamicUniformBuffer, nullptr);
+			_deviceAllocator.Free(&_fragmentDynamicUniformBufferMemory);
+			_fragmentDynamicUniformBuffer = VK_NULL_HANDLE;
+
+			_dynamicUniformSegmentSize = alignedSize * capacity;
+			CHECK_RESULT(CreateBuffer(_dynamicUniformSegmentSize * MAX_FRAME_DRAWS, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &_fragmentDynamicUniformBuffer), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(_fragmentDynamicUniformBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_fragmentDynamicUniformBufferMemory), RendererResult::Success, RendererResult::Failure)
+
+			// Point every buffer descriptor set at the new ring.
+			VkDescriptorBufferInfo descriptorBuffer = {};
+			descriptorBuffer.buffer = _fragmentDynamicUniformBuffer;
+			descriptorBuffer.offset = 0;
+			descriptorBuffer.range = alignedSize;
+
+			boost::container::vector<VkWriteDescriptorSet> descriptorWrite(_bufferDescriptorSets.size());
+			for (usize i = 0; i < _bufferDescriptorSets.size(); ++i)
+			{
+				descriptorWrite[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptorWrite[i].dstSet = _bufferDescriptorSets[i];
+				descriptorWrite[i].dstBinding = 2;
+				descriptorWrite[i].dstArrayElement = 0;
+				descriptorWrite[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				descriptorWrite[i].descriptorCount = 1;
+				descriptorWrite[i].pBufferInfo = &descriptorBuffer;
+			}
+
+			vkUpdateDescriptorSets(_device._logical, descriptorWrite.size(), descriptorWrite.data(), 0, nullptr);
+
+			// The segments moved, so rewind into this frame's new one.
+			ResetDynamicUniforms(_currentFrame);
+
+			// Every static command buffer bound the old descriptor sets at the old offsets.
+			_staticCommandVersions.assign(_staticCommandVersions.size(), 0);
+
+			return RendererResult::Success;
+		}
+
+		RendererResult Renderer::ReserveInstances(usize frame, usize count)
+		{
+			ASSERT(frame < MAX_FRAME_DRAWS);
+			if (count <= _instanceCapacities[frame]) return RendererResult::Success;
 
-				// Transfer data to buffer memory.
-				Memory::Copy(data, &_fragmentUniform, sizeof(FragmentUniform));
+			// Grow by doubling, so a steadily growing scene reallocates rarely.
+			usize capacity = std::max(INITIAL_INSTANCES, _instanceCapacities[frame]);
+			while (capacity < count)
+				capacity *= 2;
 
-				// Unmap memory from pointer.
-				vkUnmapMemory(_device._logical, _fragmentUniformBuffersMemory[i]);
+			// The frame's fence has been waited on, so the buffer it drew with last is no longer in use.
+			if (_instanceBuffers[frame] != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(_device._logical, _instanceBuffers[frame], nullptr);
+				_deviceAllocator.Free(&_instanceBuffersMemory[frame]);
+				_instanceBuffers[frame] = VK_NULL_HANDLE;
+				_instanceCapacities[frame] = 0;
 			}
+
+			// Instance memory is host visible, so the device allocator keeps it mapped for as long as it lives.
+			CHECK_RESULT(CreateBuffer(capacity * sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &_instanceBuffers[frame]), RendererResult::Success, RendererResult::Failure)
+			CHECK_RESULT(AllocateBuffer(_instanceBuffers[frame], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_instanceBuffersMemory[frame]), RendererResult::Success, RendererResult::Failure)
+
+			_instanceCapacities[frame] = capacity;
+
+			// The frame's static instances and static command buffers were left behind with the old buffer.
+			_staticInstanceVersions[frame] = 0;
+			for (usize i = 0; i < _commandBuffers.size(); ++i)
+				_staticCommandVersions[frame * _commandBuffers.size() + i] = 0;
+
+			return RendererResult::Success;
 		}
 
-		void Renderer::UpdateFragmentDynamicUniformBuffers()
+		RendererResult Renderer::WriteInstances(usize frame)
 		{
-			const usize uniformAlignment = GetAlignedSize(sizeof(FragmentDynamicUniform), _minUniformBufferAlignment);
-			for (usize i = 0; i < _fragmentDynamicUniformBuffersMemory.size(); ++i)
+			// Static batches come first and keep their ranges for as long as the static set is unchanged.
+			usize instanceCount = 0;
+			auto batch = _batches.begin();
+			if (_staticLayoutVersion != _staticVersion)
+			{
+				for (; batch != _batches.end() && batch->first._static; ++batch)
+				{
+					batch->second._firstInstance = static_cast<u32>(instanceCount);
+					instanceCount += batch->second._renderables;
+				}
+
+				_staticInstanceCount = instanceCount;
+				_staticLayoutVersion = _staticVersion;
+			}
+			else
+			{
+				while (batch != _batches.end() && batch->first._static)
+					++batch;
+
+				instanceCount = _staticInstanceCount;
+			}
+
+			// Lay the dynamic batches out back to back behind them, in the order they are drawn.
+			for (; batch != _batches.end(); ++batch)
+			{
+				batch->second._firstInstance = static_cast<u32>(instanceCount);
+				batch->second._instanceCount = 0;
+				instanceCount += batch->second._renderables;
+			}
+
+			CHECK_RESULT(ReserveInstances(frame, instanceCount), RendererResult::Success, RendererResult::Failure)
+
+			// This frame's copy of the static instances is only written again once the static set has changed.
+			bool writeStatic = _staticInstanceVersions[frame] != _staticVersion;
+			if (writeStatic)
+			{
+				for (batch = _batches.begin(); batch != _batches.end() && batch->first._static; ++batch)
+					batch->second._instanceCount = 0;
+			}
+
+			// Scatter each renderable's matrices into the range of its batch.
+			InstanceData* instances = static_cast<InstanceData*>(_instanceBuffersMemory[frame]._mapped);
+			for (auto& entity : _entitiesToRender)
 			{
-				// Map pointer to buffer location.
-				void* data;
-				vkMapMemory(_device._logical, _fragmentDynamicUniformBuffersMemory[i], 0, uniformAlignment *
-					_entitiesToRender.size() + _entitiesToTransfer.size(), 0, &data);
+				const EntityInfo& entityInfo = entity.second;
+				if (entityInfo._renderables.empty() || (entityInfo._static && !writeStatic)) continue;
+
+				// The model and normal matrices are cached by the transform, once per change.
+				Math::Matrix model = entityInfo._transformComponent ? entityInfo._transformComponent->GetModel() : Math::Matrix::Identity();
+				Math::Matrix normal = entityInfo._transformComponent ? entityInfo._transformComponent->GetNormal() : Math::Matrix::Identity();
 
-				// Copy entity data over to fragment dynamic buffer.
-				usize j = 0;
-				BOOST_FOREACH(const auto& entity, boost::join(_entitiesToRender, _entitiesToTransfer))
+				for (auto& renderableInfo : entityInfo._renderables)
 				{
-					for (auto& renderableInfo : entity.second._renderables)
-					{
-						// Construct data to place into shader.
-						FragmentDynamicUniform::FragmentMaterial material = {};
-						material._specularPower = renderableInfo._material->GetSpecularPower();
-						material._specularStrength = renderableInfo._material->GetSpecularStrength();
+					BatchInfo& batchInfo = renderableInfo._batch->second;
+					InstanceData& instance = instances[batchInfo._firstInstance + batchInfo._instanceCount++];
+					instance._model = model;
+					instance._normal = normal;
+				}
+			}
 
-						FragmentDynamicUniform dynamicUniform = {};
-						dynamicUniform._material = material;
+			_staticInstanceVersions[frame] = _staticVersion;
+			return RendererResult::Success;
+		}
+
+		void Renderer::UpdateMobility()
+		{
+			u64 frameNumber = _frameNumber.load(boost::memory_order_relaxed);
 
-						// Read memory with specified alignment.
-						FragmentDynamicUniform* dynamicMemory = (FragmentDynamicUniform*)((usize)data + (j * uniformAlignment));
-						*dynamicMemory = dynamicUniform;
+			for (auto& entity : _entitiesToRender)
+			{
+				EntityInfo& entityInfo = entity.second;
 
-						// Move index over to next dynamic uniform location.
-						j++;
+				// Entities without a transform never move.
+				u64 transformVersion = entityInfo._transformComponent ? entityInfo._transformComponent->GetVersion() : 0;
+				if (transformVersion != entityInfo._transformVersion)
+				{
+					entityInfo._transformVersion = transformVersion;
+					entityInfo._changedFrame = frameNumber;
+				}
+
+				// A static entity turns dynamic as soon as it moves, a dynamic one turns static after standing still for long enough.
+				bool isStatic = !entityInfo._transformComponent || frameNumber >= entityInfo._changedFrame + STATIC_AFTER_FRAMES;
+
+				// Renderables whose material changed no longer belong in their batch.
+				bool materialChanged = false;
+				for (const auto& renderableInfo : entityInfo._renderables)
+				{
+					const BatchKey& batchKey = renderableInfo._batch->first;
+					if (batchKey._specularPower != renderableInfo._material->GetSpecularPower() ||
+						batchKey._specularStrength != renderableInfo._material->GetSpecularStrength())
+					{
+						materialChanged = true;
+						break;
 					}
 				}
 
-				// Unmap memory from pointer.
-				vkUnmapMemory(_device._logical, _fragmentDynamicUniformBuffersMemory[i]);
+				if (isStatic == entityInfo._static && !materialChanged) continue;
+
+				for (auto& renderableInfo : entityInfo._renderables)
+				{
+					RemoveFromBatch(renderableInfo);
+					AddToBatch(&renderableInfo, isStatic);
+				}
+
+				entityInfo._static = isStatic;
 			}
 		}
-		
+
 		void Renderer::DestroyCommandPools()
 		{
 			vkDestroyCommandPool(_device._logical, _graphicsPool, nullptr);
 			vkDestroyCommandPool(_device._logical, _transferPool, nullptr);
+
+			// Destroying the recording pools frees their secondary command buffers as well.
+			for (auto pool : _recordingPools)
+			{
+				vkDestroyCommandPool(_device._logical, pool, nullptr);
+			}
+
+			for (auto pool : _staticPools)
+			{
+				vkDestroyCommandPool(_device._logical, pool, nullptr);
+			}
+
+			_recordingPools.clear();
+			_secondaryCommandBuffers.clear();
+			_staticPools.clear();
+			_staticCommandBuffers.clear();
 		}
 
 		void Renderer::DestroyEntities()
@@ -2543,13 +3544,31 @@ namespace Re
 			{
 				for (auto& renderableInfo : entity.second._renderables)
 				{
-					DestroyBuffer(renderableInfo._vertexBuffer);
-					DestroyBuffer(renderableInfo._indexBuffer);
-					DestroyImage(renderableInfo._diffuseImage);
+					ReleaseTextureImage(renderableInfo._diffuseImage);
 				}
 			}
 			
 			_entitiesToRender.clear();
+
+			// The device is idle, so every retired image and mesh can go right away.
+			DestroyRetiredImages(true);
+			_batches.clear();
+
+			// The geometry of every entity goes along with the pages.
+			DestroyGeometryPages();
+		}
+
+		void Renderer::DestroyGeometryPages()
+		{
+			for (auto& page : _vertexPages)
+				DestroyBuffer(page._buffer);
+
+			for (auto& page : _indexPages)
+				DestroyBuffer(page._buffer);
+
+			_vertexPages.clear();
+			_indexPages.clear();
+			_meshes.clear();
 		}
 
 		void Renderer::DestroySwapchain()
@@ -2567,7 +3586,7 @@ namespace Re
 		{
 			vkDestroyImageView(_device._logical, _depthBufferImageView, nullptr);
 			vkDestroyImage(_device._logical, _depthBufferImage, nullptr);
-			vkFreeMemory(_device._logical, _depthBufferMemory, nullptr);
+			_deviceAllocator.Free(&_depthBufferMemory);
 		}
 
 		void Renderer::DestroyFramebuffers()
@@ -2579,6 +3598,45 @@ namespace Re
 			}
 		}
 
+		void Renderer::SavePipelineCache()
+		{
+			usize size = 0;
+			if (vkGetPipelineCacheData(_device._logical, _pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+				return;
+
+			boost::container::vector<char> data(size);
+			if (vkGetPipelineCacheData(_device._logical, _pipelineCache, &size, data.data()) != VK_SUCCESS)
+				return;
+
+			data.resize(size);
+
+			// Leave the file alone when no pipeline was added to the cache since it was loaded.
+			if (Core::Hash::XXH64(data.data(), data.size()) == _pipelineCacheHash)
+				return;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(_device._physical, &properties);
+
+			if (!WritePipelineCache(PIPELINE_CACHE_PATH, properties, data))
+				Core::Debug::Error("Failed to save the pipeline cache.");
+		}
+
+		void Renderer::DestroyUploads()
+		{
+			for (auto& upload : _uploads)
+			{
+				vkDestroyFence(_device._logical, upload._fence, nullptr);
+			}
+
+			// The upload command buffers are freed along with the transfer pool.
+			if (_stagingRing != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(_device._logical, _stagingRing, nullptr);
+				_deviceAllocator.Free(&_stagingRingMemory);
+				_stagingRing = VK_NULL_HANDLE;
+			}
+		}
+
 		void Renderer::DestroySynchronization()
 		{
 			for (usize i = 0; i < MAX_FRAME_DRAWS; ++i)
@@ -2595,22 +3653,32 @@ namespace Re
 			for (usize i = 0; i < _vertexUniformBuffers.size(); ++i)
 			{
 				vkDestroyBuffer(_device._logical, _vertexUniformBuffers[i], nullptr);
-				vkFreeMemory(_device._logical, _vertexUniformBuffersMemory[i], nullptr);
+				_deviceAllocator.Free(&_vertexUniformBuffersMemory[i]);
 			}
 
 			// Destroy fragment uniform buffers.
 			for (usize i = 0; i < _fragmentUniformBuffers.size(); ++i)
 			{
 				vkDestroyBuffer(_device._logical, _fragmentUniformBuffers[i], nullptr);
-				vkFreeMemory(_device._logical, _fragmentUniformBuffersMemory[i], nullptr);
+				_deviceAllocator.Free(&_fragmentUniformBuffersMemory[i]);
 			}
 
-			// Destroy fragment dynamic uniform buffers.
-			for (usize i = 0; i < _fragmentDynamicUniformBuffers.size(); ++i)
+			// Destroy the fragment dynamic uniform ring.
+			vkDestroyBuffer(_device._logical, _fragmentDynamicUniformBuffer, nullptr);
+			_deviceAllocator.Free(&_fragmentDynamicUniformBufferMemory);
+		}
+
+		void Renderer::DestroyInstanceBuffers()
+		{
+			for (usize i = 0; i < _instanceBuffers.size(); ++i)
 			{
-				vkDestroyBuffer(_device._logical, _fragmentDynamicUniformBuffers[i], nullptr);
-				vkFreeMemory(_device._logical, _fragmentDynamicUniformBuffersMemory[i], nullptr);
+				vkDestroyBuffer(_device._logical, _instanceBuffers[i], nullptr);
+				_deviceAllocator.Free(&_instanceBuffersMemory[i]);
 			}
+
+			_instanceBuffers.clear();
+			_instanceBuffersMemory.clear();
+			_instanceCapacities.clear();
 		}
 
 		#if PLATFORM_WINDOWS
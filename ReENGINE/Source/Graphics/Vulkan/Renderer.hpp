@@ -23,6 +23,9 @@
 #include "Math/Matrix.hpp"
 #include "Math/Transform.hpp"
 #include "Math/Vector3.hpp"
+#include "Memory/Containers.hpp"
+#include "Memory/FrameAllocator.hpp"
+#include "Memory/RangeAllocator.hpp"
 
 #include <boost/atomic.hpp>
 #include <boost/bimap.hpp>
@@ -42,11 +45,24 @@
 
 #include <vulkan/vulkan.h>
 
+#include "DeviceAllocator.hpp"
+
 const usize MAX_FRAME_DRAWS		= 3;
-const usize MAX_RENDERABLES		= 8192;
+const usize INITIAL_BATCHES		= 8192;
+const usize INITIAL_INSTANCES	= 16384;
 const usize MAX_TEXTURES		= 4096;
+const usize MAX_MIP_LEVELS		= 32;
 const usize MAX_POINT_LIGHTS	= 4;
 const usize MAX_SPOT_LIGHTS		= 4;
+const usize GEOMETRY_PAGE_SIZE	= 32 * 1024 * 1024;
+const usize RETIRE_INTERVAL_MS	= 100;
+const usize MAX_RECORDING_SLICES	= 8;
+const usize BATCHES_PER_SLICE	= 128;
+const u64 STATIC_AFTER_FRAMES	= 60;
+const usize MAX_UPLOADS			= 4;
+const usize STAGING_RING_SIZE	= 64 * 1024 * 1024;
+const usize STAGING_ALIGNMENT	= 16;
+const usize UPLOAD_POLL_INTERVAL_MS = 1;
 
 namespace Re
 {
@@ -66,6 +82,7 @@ namespace Re
 			struct VertexUniform 
 			{
 				alignas(16)	Math::Matrix _projection;
+				alignas(16)	Math::Matrix _view;
 			} _vertexUniform;
 
 			struct FragmentUniform 
@@ -117,37 +134,122 @@ namespace Re
 				FragmentMaterial _material;
 			};
 
-			struct VertexPush 
+			// Per-instance data, read by the vertex shader from the instance buffer of the frame.
+			struct InstanceData
 			{
-				alignas(16)	Math::Matrix _view;
 				alignas(16)	Math::Matrix _model;
+				alignas(16)	Math::Matrix _normal;
+			};
+
+			// Mesh-related structures.
+
+			// Identifies a mesh by its contents, so renderables of equal meshes share their geometry.
+			struct MeshKey
+			{
+				u64 _hash;
+				u32 _vertexCount;
+				u32 _indexCount;
+
+				bool operator<(const MeshKey& other) const
+				{
+					if (_hash != other._hash) return _hash < other._hash;
+					if (_vertexCount != other._vertexCount) return _vertexCount < other._vertexCount;
+					return _indexCount < other._indexCount;
+				}
+			};
+
+			struct MeshInfo
+			{
+				u32 _vertexPage;
+				i32 _vertexOffset;
+				u32 _indexPage;
+				u32 _firstIndex;
+				usize _references;
+			};
+
+			// Batch-related structures.
+
+			// Renderables that share a mesh, a diffuse image and material parameters are drawn by a single instanced draw.
+			// Renderables of static entities are batched apart, and their batches come first.
+			struct BatchKey
+			{
+				bool _static;
+				MeshKey _mesh;
+				VkImage _diffuseImage;
+				f32 _specularPower;
+				f32 _specularStrength;
+
+				bool operator<(const BatchKey& other) const
+				{
+					if (_static != other._static) return _static;
+					if (_mesh < other._mesh) return true;
+					if (other._mesh < _mesh) return false;
+					if (_diffuseImage != other._diffuseImage) return _diffuseImage < other._diffuseImage;
+					if (_specularPower != other._specularPower) return _specularPower < other._specularPower;
+					return _specularStrength < other._specularStrength;
+				}
+			};
+
+			struct BatchInfo
+			{
+				u32 _vertexPage;
+				i32 _vertexOffset;
+				u32 _indexPage;
+				u32 _firstIndex;
+				u32 _indexCount;
+				usize _renderables;
+
+				// The batch's range of the instance buffer, laid out anew every time commands are recorded, or whenever the static set changes for static batches.
+				u32 _firstInstance;
+				u32 _instanceCount;
+			};
+
+			using Batches = Memory::Map<BatchKey, BatchInfo, Memory::MemoryTag::Renderer>;
+
+			// A batch as the recording threads see it, with its material already written to the dynamic uniform ring.
+			struct BatchDraw
+			{
+				const BatchInfo* _batch;
+				VkDescriptorSet _textureSet;
+				u32 _dynamicOffset;
 			};
 
 			// Transfer-related structures.
 
             struct RenderableInfo
             {
-				// Vertex-related information.
-                VkBuffer _vertexBuffer;
-                i32 _vertexCount;
-				VkDeviceSize _vertexSize;
+				// Mesh-related information, the ranges below are shared with every renderable of an equal mesh.
+				MeshKey _mesh;
+
+				// Vertex-related information, as a range of a vertex page.
+				u32 _vertexPage;
+				i32 _vertexOffset;
+				i32 _vertexCount;
 
-				// Index-related information.
-                VkBuffer _indexBuffer;
-                i32 _indexCount;
-				VkDeviceSize _indexSize;
+				// Index-related information, as a range of an index page.
+				u32 _indexPage;
+				u32 _firstIndex;
+				i32 _indexCount;
 
 				// Texture-related information.
 				VkImage _diffuseImage;
 
 				// Descriptor-related information.
 				Material* _material;
+
+				// Batch-related information, valid once the renderable is rendered.
+				Batches::iterator _batch;
             };
 
 			struct EntityInfo
 			{
-				boost::container::vector<RenderableInfo> _renderables;
+				Memory::Vector<RenderableInfo, Memory::MemoryTag::Renderer> _renderables;
 				Components::TransformComponent* _transformComponent;
+
+				// Mobility-related information, an entity turns static once its transform has stood still for STATIC_AFTER_FRAMES frames.
+				u64 _transformVersion;
+				u64 _changedFrame;
+				bool _static;
 			};
 
 			struct TransferInfo
@@ -156,30 +258,83 @@ namespace Re
 				bool _isRemoval;
 			};
 
+			// A batch of transfers in flight on the transfer queue, whose entities become visible once its fence is signaled.
+			// Timeline semaphores are core in Vulkan 1.2, but the device is created without their optional feature, so each batch polls a fence of its own.
+			struct UploadInfo
+			{
+				VkCommandBuffer _commandBuffer;
+				VkFence _fence;
+
+				// The batch's range of the staging ring, including the padding skipped at the ring's end, or a buffer of its own if it outgrew the ring.
+				VkDeviceSize _stagingOffset;
+				VkDeviceSize _stagingSize;
+				VkBuffer _stagingBuffer;
+				DeviceAllocation _stagingMemory;
+
+				Memory::Vector<VkImage, Memory::MemoryTag::Renderer> _images;
+				Memory::Map<Core::Entity*, EntityInfo, Memory::MemoryTag::Renderer> _entities;
+			};
+
 			struct VertexInfo
 			{
-				VkBuffer _buffer;
+				u32 _page;
+				usize _offset;
 				VkDeviceSize _size;
-				boost::container::vector<Vertex> _vertices;
+				Memory::Vector<Vertex, Memory::MemoryTag::Renderer> _vertices;
 			};
 
 			struct IndexInfo
 			{
-				VkBuffer _buffer;
+				u32 _page;
+				usize _offset;
 				VkDeviceSize _size;
-				boost::container::vector<u32> _indices;
+				Memory::Vector<u32, Memory::MemoryTag::Renderer> _indices;
 			};
 
 			struct TextureInfo
 			{
+				Texture* _texture;
 				VkImage _image;
 				VkDeviceSize _size;
 				u32 _bpp;
 				u32 _width;
 				u32 _height;
+				u32 _mipLevels;
 				u8* _pixels;
 			};
 
+			// An image no renderable uses anymore, along with the frame number at the time it was released.
+			struct RetiredImage
+			{
+				VkImage _image;
+				u64 _frameNumber;
+			};
+
+			// The ranges of a mesh no renderable uses anymore, along with the frame number at the time it was released.
+			struct RetiredMesh
+			{
+				u32 _vertexPage;
+				i32 _vertexOffset;
+				u32 _indexPage;
+				u32 _firstIndex;
+				u64 _frameNumber;
+			};
+
+			// Geometry-related structures.
+
+			// A large device local buffer, whose ranges of vertices or indices are shared out among the renderables.
+			struct GeometryPage
+			{
+				GeometryPage(VkBuffer buffer, usize capacity)
+					: _buffer(buffer), _ranges(capacity)
+				{}
+
+				VkBuffer _buffer;
+				Memory::RangeAllocator _ranges;
+			};
+
+			using GeometryPages = Memory::Vector<GeometryPage, Memory::MemoryTag::Renderer>;
+
 			// Vulkan-related structures.
 
 			struct QueueFamilyInfo
@@ -187,6 +342,7 @@ namespace Re
 				i32 _graphicsFamily = -1;
 				i32 _presentationFamily = -1;
 				i32 _transferFamily = -1;
+				u32 _graphicsQueueCount = 0;
 
 				bool HasDedicatedPresentation() const
 				{
@@ -235,6 +391,9 @@ namespace Re
 
 			void SetActiveCamera(const boost::shared_ptr<Entities::Camera>& newCamera);
 
+			RendererResult DefragmentDeviceMemory();
+			DeviceMemoryStatistics GetDeviceMemoryStatistics() const;
+
 		private:
 			// Transfer thread private methods.
 			void EntityStreaming();
@@ -247,33 +406,49 @@ namespace Re
 			// Support functions.
 			bool CheckDeviceExtensionSupport(VkPhysicalDevice device) const;
 			bool CheckPhysicalDeviceSuitable(VkPhysicalDevice device) const;
-			u32 FindMemoryTypeIndex(u32 allowedTypes, VkMemoryPropertyFlags flags) const;
 			QueueFamilyInfo GetQueueFamilyInfo(VkPhysicalDevice device) const;
 			SwapchainInfo GetSwapchainInfo(VkPhysicalDevice device) const;
 			usize GetAlignedSize(usize dataSize, usize dataAlignment) const;
 
 			// Support create functions.
-			RendererResult AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VkDeviceMemory* outMemory);
-			RendererResult AllocateImage(VkImage image, VkMemoryPropertyFlags properties, VkDeviceMemory* outMemory);
+			RendererResult AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation);
+			RendererResult AllocateImage(VkImage image, VkMemoryPropertyFlags properties, DeviceAllocation* outAllocation);
 			RendererResult CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* outBuffer);
-			RendererResult CreateImage(u32 width, u32 height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage* outImage);
+			RendererResult CreateImage(u32 width, u32 height, u32 mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImage* outImage);
 			RendererResult CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags flags, VkImageView* outView) const;
 			RendererResult CreateShaderModule(const boost::container::vector<char>& raw, VkShaderModule* outModule) const;
-			RendererResult CreateIndexBuffer(boost::container::vector<u32>& indices, VkBuffer* outBuffer);
-			RendererResult CreateVertexBuffer(boost::container::vector<Vertex>& vertices, VkBuffer* outBuffer);
+			RendererResult CreateGeometryBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* outBuffer);
+			RendererResult CreateIndexRange(const boost::container::vector<u32>& indices, u32* outPage, u32* outFirstIndex);
+			RendererResult CreateVertexRange(const boost::container::vector<Vertex>& vertices, u32* outPage, i32* outVertexOffset);
+			RendererResult AllocateGeometryRange(GeometryPages* pages, usize count, VkDeviceSize stride, VkBufferUsageFlags usage, u32* outPage, usize* outOffset);
+			RendererResult AcquireMesh(const boost::container::vector<Vertex>& vertices, const boost::container::vector<u32>& indices, RenderableInfo* renderableInfo);
+			void ReleaseMesh(const MeshKey& mesh);
+			void AddToBatch(RenderableInfo* renderableInfo, bool isStatic);
+			void RemoveFromBatch(const RenderableInfo& renderableInfo);
 			RendererResult CreateTextureImage(Texture* texture, VkImage* outImage);
 			RendererResult CreateTextureImageView(VkImage image);
 			RendererResult CreateTextureDescriptorSets();
 
 			// Support destroy functions.
 			void DestroyBuffer(VkBuffer buffer);
-			void DestroyImage(VkImage image);
+			void ReleaseTextureImage(VkImage image);
+			void DestroyRetiredImages(bool all);
+			void DestroyTextureImage(VkImage image);
+			void DestroyGeometryPages();
+
+			// Support defragmentation functions, which move geometry pages.
+			RendererResult RelocateBuffer(VkCommandBuffer commandBuffer, VkBuffer* buffer, VkDeviceSize size, VkBufferUsageFlags usage,
+				Memory::Vector<VkBuffer, Memory::MemoryTag::Renderer>* retiredBuffers);
 
 			// Support transfer functions.
 			RendererResult ExecuteTransferOperations();
-			RendererResult StageIndexBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory);
-			RendererResult StageVertexBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory);
-			RendererResult StageImageBuffer(VkDeviceSize bufferSize, VkBuffer* stagingBuffer, VkDeviceMemory* stagingMemory);
+			void StageIndexBuffer(u8* staging);
+			void StageVertexBuffer(u8* staging);
+			void StageImageBuffer(u8* staging);
+			RendererResult AcquireUpload(VkDeviceSize stagingSize, UploadInfo** outUpload);
+			RendererResult AbortUpload(UploadInfo* upload);
+			RendererResult RetireUploads(bool waitForOldest);
+			bool IsEntityPending(Core::Entity* entity) const;
 			void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, u32 srcQueueFamily, u32 dstQueueFamily, VkImageLayout srcLayout, VkImageLayout dstLayout, 
 				VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
 
@@ -289,28 +464,45 @@ namespace Re
 			RendererResult CreateSwapchain();
 			RendererResult CreateRenderPass();
 			RendererResult CreateDescriptorSetLayouts();
-			RendererResult CreatePushConstantRanges();
+			RendererResult CreatePipelineCache();
 			RendererResult CreateGraphicsPipeline();
 			RendererResult CreateDepthBufferImage();
 			RendererResult CreateFramebuffers();
 			RendererResult CreateCommandPools();
 			RendererResult CreateCommandBuffers();
+			RendererResult CreateRecordingCommandBuffers();
 			RendererResult CreateTextureSampler();
 			RendererResult CreateUniformBuffers();
+			RendererResult CreateInstanceBuffers();
 			RendererResult CreateDescriptorPools();
 			RendererResult CreateDescriptorSets();
 			RendererResult CreateSynchronization();
+			RendererResult CreateUploads();
 
 			// Record functions.
-			RendererResult RecordCommands(usize offset, usize size);
+			RendererResult RecordCommands(usize imageIndex);
+			RendererResult RecordBatches(usize slice);
+			RendererResult RecordDraws(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags flags, usize first, usize last);
+			void UpdateMobility();
+			void RecordingWorker(usize slice);
 
 			// Update functions.
 			void UpdateDirectionalLight(FragmentUniform::FragmentDirectionalLight* dstLight, const boost::shared_ptr<Entities::DirectionalLight>& srcLight);
 			void UpdatePointLight(FragmentUniform::FragmentPointLight* dstLight, const boost::shared_ptr<Entities::PointLight>& srcLight);
 			void UpdateSpotLight(FragmentUniform::FragmentSpotLight* dstLight, const boost::shared_ptr<Entities::SpotLight>& srcLight);
 			void UpdateVertexUniformBuffers();
-			void UpdateFragmentUniformBuffers();
-			void UpdateFragmentDynamicUniformBuffers();
+			void UpdateVertexUniformBuffer(usize index);
+			void UpdateFragmentUniformBuffer(usize index);
+			void InvalidateFragmentUniform();
+
+			// Dynamic uniform functions.
+			void ResetDynamicUniforms(usize frame);
+			void* AllocateDynamicUniform(usize size, u32* offset);
+			RendererResult ReserveDynamicUniforms(usize count);
+
+			// Instance functions.
+			RendererResult ReserveInstances(usize frame, usize count);
+			RendererResult WriteInstances(usize frame);
 
 			// Destroy functions.
 			void DestroyCommandPools();
@@ -320,6 +512,9 @@ namespace Re
 			void DestroyFramebuffers();
 			void DestroySynchronization();
 			void DestroyUniformBuffers();
+			void DestroyInstanceBuffers();
+			void DestroyUploads();
+			void SavePipelineCache();
 
 			#if PLATFORM_WINDOWS
 			RendererResult CreateWindowsSurface(const Platform::Win32Window& window);
@@ -337,6 +532,34 @@ namespace Re
 			boost::mutex _streamingMutex;
 			boost::condition_variable _streamingRequested;
 			boost::atomic<bool> _streamingThreadShouldClose;
+
+			// Recording-related members, where the render thread records the first slice of the batches and each worker one of the others,
+			// into a secondary command buffer from a command pool of its own for each frame in flight.
+			boost::thread_group _recordingThreads;
+			boost::mutex _recordingMutex;
+			boost::condition_variable _recordingRequested;
+			boost::condition_variable _recordingFinished;
+			bool _recordingThreadsShouldClose;
+			bool _recordingFailed;
+			u64 _recordingGeneration;
+			usize _recordingPending;
+			usize _recordingSlices;
+			usize _activeRecordingSlices;
+			usize _recordingImage;
+			boost::container::vector<VkCommandPool> _recordingPools;
+			boost::container::vector<VkCommandBuffer> _secondaryCommandBuffers;
+			Memory::FrameVector<BatchDraw> _batchDraws;
+
+			// Static-related members, where the static batches are recorded once into a secondary command buffer for each frame in flight
+			// and image, and recorded again only when the static set changes. The static instances are written likewise.
+			u64 _staticVersion;
+			u64 _staticLayoutVersion;
+			usize _staticInstanceCount;
+			usize _staticDrawCount;
+			boost::container::vector<u64> _staticInstanceVersions;
+			boost::container::vector<u64> _staticCommandVersions;
+			boost::container::vector<VkCommandPool> _staticPools;
+			boost::container::vector<VkCommandBuffer> _staticCommandBuffers;
 			
 			// Vulkan-related members.
 			VkInstance _instance;
@@ -348,20 +571,30 @@ namespace Re
 			u32 _graphicsQueueFamily;
 			VkQueue _graphicsQueue;
 			VkQueue _presentationQueue;
+			bool _sharedTransferQueue;
+			boost::mutex _queueMutex;
 			VkSwapchainKHR _swapchain;
 			boost::container::vector<SwapchainImage> _swapchainImages;
 			boost::container::vector<VkFramebuffer> _swapchainFramebuffers;
 			boost::container::vector<VkCommandBuffer> _commandBuffers;
 			usize _currentFrame;
 
+			// Read by the streaming thread, to tell when frames in flight are done with a retired image.
+			boost::atomic<u64> _frameNumber;
+
 			// Depth-related members.
 			VkImage _depthBufferImage;
 			VkImageView _depthBufferImageView;
-			VkDeviceMemory _depthBufferMemory;
+			DeviceAllocation _depthBufferMemory;
+
+			// Device memory members.
+			DeviceAllocator _deviceAllocator;
 
 			// Pipeline-related members.
 			VkPipeline _graphicsPipeline;
 			VkPipelineLayout _pipelineLayout;
+			VkPipelineCache _pipelineCache;
+			u64 _pipelineCacheHash;
 			VkRenderPass _renderPass;
 			VkCommandPool _graphicsPool;
 
@@ -369,31 +602,56 @@ namespace Re
 			u32 _transferQueueFamily;
 			VkQueue _transferQueue;
 			VkCommandPool _transferPool;
-			VkCommandBuffer _transferBuffer;
-			boost::bimap<VkBuffer, VkDeviceMemory> _bufferMemory;
-			boost::bimap<VkImage, VkDeviceMemory> _imageMemory;
-			boost::container::vector<VertexInfo> _vertexBuffersToTransfer;
-			boost::container::vector<IndexInfo> _indexBuffersToTransfer;
-			boost::container::vector<TextureInfo> _textureImagesToTransfer;
-			boost::container::map<Core::Entity*, EntityInfo> _entitiesToTransfer;
+			Memory::Map<VkBuffer, DeviceAllocation, Memory::MemoryTag::Renderer> _bufferMemory;
+			Memory::Map<VkImage, DeviceAllocation, Memory::MemoryTag::Renderer> _imageMemory;
+			GeometryPages _vertexPages;
+			GeometryPages _indexPages;
+			Memory::Map<MeshKey, MeshInfo, Memory::MemoryTag::Renderer> _meshes;
+			Memory::Vector<RetiredMesh, Memory::MemoryTag::Renderer> _retiredMeshes;
+			Memory::Vector<VertexInfo, Memory::MemoryTag::Renderer> _vertexBuffersToTransfer;
+			Memory::Vector<IndexInfo, Memory::MemoryTag::Renderer> _indexBuffersToTransfer;
+			Memory::Vector<TextureInfo, Memory::MemoryTag::Renderer> _textureImagesToTransfer;
+			Memory::Map<Core::Entity*, EntityInfo, Memory::MemoryTag::Renderer> _entitiesToTransfer;
 			boost::lockfree::spsc_queue<VkImage> _releasedImages;
 			boost::mutex _transferMutex;
 
+			// Upload-related members, where the uploads in flight form a ring of MAX_UPLOADS batches that retire in the order they were submitted,
+			// along with the staging ring they copy from. Only the streaming thread touches them.
+			boost::array<UploadInfo, MAX_UPLOADS> _uploads;
+			usize _firstUpload;
+			usize _uploadCount;
+			VkBuffer _stagingRing;
+			DeviceAllocation _stagingRingMemory;
+			VkDeviceSize _stagingRingHead;
+			VkDeviceSize _stagingRingUsed;
+			boost::container::set<Core::Entity*> _cancelledEntities;
+
 			// Descriptor-related members.
 			VkDescriptorSetLayout _bufferDescriptorSetLayout;
 			VkDescriptorSetLayout _samplerDescriptorSetLayout;
 			VkDescriptorPool _bufferDescriptorPool;
 			VkDescriptorPool _samplerDescriptorPool;
 			boost::container::vector<VkDescriptorSet> _bufferDescriptorSets;
-			boost::container::vector<VkPushConstantRange> _pushConstantRanges;
 
 			// Uniform buffer members.
 			boost::container::vector<VkBuffer> _vertexUniformBuffers;
-			boost::container::vector<VkDeviceMemory> _vertexUniformBuffersMemory;
+			boost::container::vector<DeviceAllocation> _vertexUniformBuffersMemory;
 			boost::container::vector<VkBuffer> _fragmentUniformBuffers;
-			boost::container::vector<VkDeviceMemory> _fragmentUniformBuffersMemory;
-			boost::container::vector<VkBuffer> _fragmentDynamicUniformBuffers;
-			boost::container::vector<VkDeviceMemory> _fragmentDynamicUniformBuffersMemory;
+			boost::container::vector<DeviceAllocation> _fragmentUniformBuffersMemory;
+			boost::container::vector<u64> _fragmentUniformBuffersVersion;
+			u64 _fragmentUniformVersion;
+
+			// Dynamic uniform ring members, with one segment for each frame in flight.
+			VkBuffer _fragmentDynamicUniformBuffer;
+			DeviceAllocation _fragmentDynamicUniformBufferMemory;
+			VkDeviceSize _dynamicUniformSegmentSize;
+			VkDeviceSize _dynamicUniformOffset;
+			VkDeviceSize _dynamicUniformEnd;
+
+			// Instance buffer members, with one buffer for each frame in flight that grows with the instances drawn.
+			boost::container::vector<VkBuffer> _instanceBuffers;
+			boost::container::vector<DeviceAllocation> _instanceBuffersMemory;
+			boost::container::vector<usize> _instanceCapacities;
 
 			// Vulkan configuration members.
 			VkFormat _depthFormat;
@@ -407,14 +665,17 @@ namespace Re
 			boost::container::vector<VkFence> _drawFences;
 			
 			// Asset-related members.
-			boost::bimap<Texture*, VkImage> _textureImage;
+			// Images are shared by every texture of equal content, and destroyed some frames after their last user is gone.
+			boost::bimap<u64, VkImage> _textureImage;
 			boost::container::map<VkImage, VkImageView> _textureImageView;
 			boost::container::map<VkImage, VkDescriptorSet> _textureDescriptorSets;
 			boost::container::map<VkImage, usize> _textureReferences;
 			VkSampler _textureSampler;
+			Memory::Vector<RetiredImage, Memory::MemoryTag::Renderer> _retiredImages;
 
 			// Entity-related members.
-			boost::container::map<Core::Entity*, EntityInfo> _entitiesToRender;
+			Memory::Map<Core::Entity*, EntityInfo, Memory::MemoryTag::Renderer> _entitiesToRender;
+			Batches _batches;
 
 			// Camera-related members.
 			boost::shared_ptr<Entities::Camera> _activeCamera;
@@ -0,0 +1,99 @@
+/*
+ * Fast.cpp
+ *
+ * This source file defines the batched variants of the approximations
+ * declared in the Fast.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "Fast.hpp"
+
+namespace Re
+{
+	namespace Math
+	{
+		namespace Fast
+		{
+			template <Accuracy Tier>
+			void SinCos(const f32* InAngles, f32* OutSines, f32* OutCosines, usize InCount)
+			{
+				__m128 sines, cosines;
+				usize i = 0;
+
+				for (; i + 4 <= InCount; i += 4)
+				{
+					SinCos4<Tier>(_mm_loadu_ps(InAngles + i), &sines, &cosines);
+					_mm_storeu_ps(OutSines + i, sines);
+					_mm_storeu_ps(OutCosines + i, cosines);
+				}
+
+				// Process the remaining elements through a padded block.
+				if (i < InCount)
+				{
+					alignas(16) f32 angles[4] = {}, tailSines[4], tailCosines[4];
+					for (usize j = i; j < InCount; ++j)
+						angles[j - i] = InAngles[j];
+
+					SinCos4<Tier>(_mm_load_ps(angles), &sines, &cosines);
+					_mm_store_ps(tailSines, sines);
+					_mm_store_ps(tailCosines, cosines);
+
+					for (usize j = i; j < InCount; ++j)
+					{
+						OutSines[j] = tailSines[j - i];
+						OutCosines[j] = tailCosines[j - i];
+					}
+				}
+			}
+
+			template <Accuracy Tier>
+			void RSqrt(const f32* InValues, f32* OutValues, usize InCount)
+			{
+				usize i = 0;
+				for (; i + 4 <= InCount; i += 4)
+					_mm_storeu_ps(OutValues + i, RSqrt4<Tier>(_mm_loadu_ps(InValues + i)));
+
+				for (; i < InCount; ++i)
+					OutValues[i] = RSqrt<Tier>(InValues[i]);
+			}
+
+			template <Accuracy Tier>
+			void Atan2(const f32* InY, const f32* InX, f32* OutAngles, usize InCount)
+			{
+				usize i = 0;
+				for (; i + 4 <= InCount; i += 4)
+					_mm_storeu_ps(OutAngles + i, Atan24<Tier>(_mm_loadu_ps(InY + i), _mm_loadu_ps(InX + i)));
+
+				for (; i < InCount; ++i)
+					OutAngles[i] = Atan2<Tier>(InY[i], InX[i]);
+			}
+
+			template <Accuracy Tier>
+			void Exp(const f32* InValues, f32* OutValues, usize InCount)
+			{
+				usize i = 0;
+				for (; i + 4 <= InCount; i += 4)
+					_mm_storeu_ps(OutValues + i, Exp4<Tier>(_mm_loadu_ps(InValues + i)));
+
+				for (; i < InCount; ++i)
+					OutValues[i] = Exp<Tier>(InValues[i]);
+			}
+
+			// Explicit instantiations for every accuracy tier.
+			template void SinCos<Accuracy::Low>(const f32*, f32*, f32*, usize);
+			template void SinCos<Accuracy::Medium>(const f32*, f32*, f32*, usize);
+			template void SinCos<Accuracy::Full>(const f32*, f32*, f32*, usize);
+			template void RSqrt<Accuracy::Low>(const f32*, f32*, usize);
+			template void RSqrt<Accuracy::Medium>(const f32*, f32*, usize);
+			template void RSqrt<Accuracy::Full>(const f32*, f32*, usize);
+			template void Atan2<Accuracy::Low>(const f32*, const f32*, f32*, usize);
+			template void Atan2<Accuracy::Medium>(const f32*, const f32*, f32*, usize);
+			template void Atan2<Accuracy::Full>(const f32*, const f32*, f32*, usize);
+			template void Exp<Accuracy::Low>(const f32*, f32*, usize);
+			template void Exp<Accuracy::Medium>(const f32*, f32*, usize);
+			template void Exp<Accuracy::Full>(const f32*, f32*, usize);
+		}
+	}
+}
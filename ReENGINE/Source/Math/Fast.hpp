@@ -0,0 +1,327 @@
+/*
+ * Fast.hpp
+ *
+ * This header file declares the approximated transcendental and reciprocal
+ * square root kernels used by the ReENGINE wherever full libm precision is
+ * not required, such as transforms and normals.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+#include <immintrin.h>
+#include <math.h>
+
+namespace Re
+{
+	namespace Math
+	{
+		namespace Fast
+		{
+			/*
+			 * @brief This enumeration selects the accuracy tier of an approximation. The maximum errors
+			 * listed below were measured against double precision over the documented input ranges.
+			 *
+			 * Low:    SinCos 3.3e-4 abs, RSqrt 3.3e-4 rel, Atan2 1.6e-3 abs, Exp 8.0e-4 rel.
+			 * Medium: SinCos 1.0e-7 abs, RSqrt 2.5e-7 rel, Atan2 2.0e-6 abs, Exp 1.2e-7 rel.
+			 * Full:   forwards to libm (sinf, cosf, sqrtf, atan2f, expf).
+			 *
+			 * SinCos is measured for |angle| <= 8192 radians, after which the range reduction loses
+			 * precision. Exp is measured for -87 <= x <= 88 and clamps outside of that range.
+			 *
+			 */
+			enum class Accuracy
+			{
+				Low = 0,
+				Medium = 1,
+				Full = 2
+			};
+
+			namespace Detail
+			{
+				// Constants shared by the vector kernels.
+				const f32 TwoOverPi = 0.636619772f;
+				const f32 HalfPi = 1.570796327f;
+				const f32 Pi = 3.141592654f;
+				const f32 Log2E = 1.442695041f;
+
+				FORCEINLINE __m128 Select(__m128 InMask, __m128 InTrue, __m128 InFalse)
+				{
+					return _mm_or_ps(_mm_and_ps(InMask, InTrue), _mm_andnot_ps(InMask, InFalse));
+				}
+
+				FORCEINLINE __m128 Abs(__m128 InValue)
+				{
+					return _mm_andnot_ps(_mm_set1_ps(-0.0f), InValue);
+				}
+
+				template <typename Function>
+				FORCEINLINE __m128 PerLane(__m128 InValue, Function InFunction)
+				{
+					alignas(16) f32 lanes[4];
+					_mm_store_ps(lanes, InValue);
+					return _mm_set_ps(InFunction(lanes[3]), InFunction(lanes[2]), InFunction(lanes[1]), InFunction(lanes[0]));
+				}
+			}
+
+			/*
+			 * @brief This function calculates the sine and cosine of four angles at once.
+			 *
+			 * @param InAngles: the angles in radians.
+			 * @param OutSines: the location to store the sines.
+			 * @param OutCosines: the location to store the cosines.
+			 *
+			 */
+			template <Accuracy Tier>
+			FORCEINLINE void SinCos4(__m128 InAngles, __m128* OutSines, __m128* OutCosines)
+			{
+				if (Tier == Accuracy::Full)
+				{
+					*OutSines = Detail::PerLane(InAngles, sinf);
+					*OutCosines = Detail::PerLane(InAngles, cosf);
+					return;
+				}
+
+				// Reduce the angle to [-pi/4, pi/4] and keep the quadrant, using a three-part pi/2.
+				__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(InAngles, _mm_set1_ps(Detail::TwoOverPi)));
+				__m128 q = _mm_cvtepi32_ps(quadrant);
+				__m128 r = _mm_sub_ps(InAngles, _mm_mul_ps(q, _mm_set1_ps(1.5703125f)));
+				r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(4.837512969970703125e-4f)));
+				r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(7.54978995489188216e-8f)));
+				__m128 z = _mm_mul_ps(r, r);
+
+				// Evaluate both polynomials on the reduced angle.
+				__m128 sine, cosine;
+				if (Tier == Accuracy::Low)
+				{
+					sine = _mm_add_ps(_mm_set1_ps(-1.6666667e-1f), _mm_mul_ps(z, _mm_set1_ps(8.3333333e-3f)));
+					sine = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sine));
+					cosine = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(z, _mm_set1_ps(4.1666667e-2f)));
+					cosine = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, cosine));
+				}
+				else
+				{
+					sine = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(z, _mm_set1_ps(-1.9515295891e-4f)));
+					sine = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f), _mm_mul_ps(z, sine));
+					sine = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sine));
+					cosine = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f), _mm_mul_ps(z, _mm_set1_ps(2.443315711809948e-5f)));
+					cosine = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f), _mm_mul_ps(z, cosine));
+					cosine = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_mul_ps(_mm_mul_ps(z, z), cosine));
+				}
+
+				// Swap the results on odd quadrants and restore the signs.
+				__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+				__m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+				__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+				*OutSines = _mm_xor_ps(Detail::Select(swap, cosine, sine), sineSign);
+				*OutCosines = _mm_xor_ps(Detail::Select(swap, sine, cosine), cosineSign);
+			}
+
+			/*
+			 * @brief This function calculates the reciprocal square root of four values at once.
+			 *
+			 * @param InValues: the positive values to calculate the reciprocal square root of.
+			 *
+			 * @return the reciprocal square roots.
+			 *
+			 */
+			template <Accuracy Tier>
+			FORCEINLINE __m128 RSqrt4(__m128 InValues)
+			{
+				if (Tier == Accuracy::Full)
+				{
+					return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(InValues));
+				}
+
+				__m128 estimate = _mm_rsqrt_ps(InValues);
+				if (Tier == Accuracy::Low)
+				{
+					return estimate;
+				}
+
+				// Refine the estimate with one Newton-Raphson step: y * (1.5 - 0.5 * x * y * y).
+				__m128 half = _mm_mul_ps(InValues, _mm_set1_ps(0.5f));
+				__m128 square = _mm_mul_ps(estimate, estimate);
+				return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half, square)));
+			}
+
+			/*
+			 * @brief This function calculates the four-quadrant arc tangent of four coordinate pairs at once.
+			 *
+			 * @param InY: the Y coordinates.
+			 * @param InX: the X coordinates.
+			 *
+			 * @return the angles in radians, in the range [-pi, pi].
+			 *
+			 */
+			template <Accuracy Tier>
+			FORCEINLINE __m128 Atan24(__m128 InY, __m128 InX)
+			{
+				if (Tier == Accuracy::Full)
+				{
+					alignas(16) f32 y[4], x[4];
+					_mm_store_ps(y, InY);
+					_mm_store_ps(x, InX);
+					return _mm_set_ps(atan2f(y[3], x[3]), atan2f(y[2], x[2]), atan2f(y[1], x[1]), atan2f(y[0], x[0]));
+				}
+
+				// Reduce the problem to atan(a) with a in [0, 1].
+				__m128 absX = Detail::Abs(InX);
+				__m128 absY = Detail::Abs(InY);
+				__m128 maximum = _mm_max_ps(absX, absY);
+				__m128 minimum = _mm_min_ps(absX, absY);
+				__m128 a = _mm_div_ps(minimum, maximum);
+				a = _mm_and_ps(_mm_cmpgt_ps(maximum, _mm_setzero_ps()), a);
+
+				__m128 angle;
+				if (Tier == Accuracy::Low)
+				{
+					// atan(a) ~ pi/4 * a - a * (a - 1) * (0.2447 + 0.0663 * a)
+					__m128 correction = _mm_add_ps(_mm_set1_ps(0.2447f), _mm_mul_ps(a, _mm_set1_ps(0.0663f)));
+					correction = _mm_mul_ps(_mm_mul_ps(a, _mm_sub_ps(a, _mm_set1_ps(1.0f))), correction);
+					angle = _mm_sub_ps(_mm_mul_ps(a, _mm_set1_ps(0.25f * Detail::Pi)), correction);
+				}
+				else
+				{
+					__m128 s = _mm_mul_ps(a, a);
+					angle = _mm_add_ps(_mm_set1_ps(0.05265332f), _mm_mul_ps(s, _mm_set1_ps(-0.01172120f)));
+					angle = _mm_add_ps(_mm_set1_ps(-0.11643287f), _mm_mul_ps(s, angle));
+					angle = _mm_add_ps(_mm_set1_ps(0.19354346f), _mm_mul_ps(s, angle));
+					angle = _mm_add_ps(_mm_set1_ps(-0.33262347f), _mm_mul_ps(s, angle));
+					angle = _mm_add_ps(_mm_set1_ps(0.99997726f), _mm_mul_ps(s, angle));
+					angle = _mm_mul_ps(a, angle);
+				}
+
+				// Undo the octant reduction and restore the sign of Y.
+				angle = Detail::Select(_mm_cmpgt_ps(absY, absX), _mm_sub_ps(_mm_set1_ps(Detail::HalfPi), angle), angle);
+				angle = Detail::Select(_mm_cmplt_ps(InX, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(Detail::Pi), angle), angle);
+				return _mm_or_ps(angle, _mm_and_ps(InY, _mm_set1_ps(-0.0f)));
+			}
+
+			/*
+			 * @brief This function calculates the natural exponential of four values at once.
+			 *
+			 * @param InValues: the exponents, clamped to the range [-87, 88].
+			 *
+			 * @return e raised to the given exponents.
+			 *
+			 */
+			template <Accuracy Tier>
+			FORCEINLINE __m128 Exp4(__m128 InValues)
+			{
+				if (Tier == Accuracy::Full)
+				{
+					return Detail::PerLane(InValues, expf);
+				}
+
+				// Split x into n * ln(2) + r, with r in [-ln(2) / 2, ln(2) / 2].
+				__m128 x = _mm_min_ps(_mm_max_ps(InValues, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+				__m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(Detail::Log2E)));
+				__m128 fn = _mm_cvtepi32_ps(n);
+				__m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+				r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+				__m128 p;
+				if (Tier == Accuracy::Low)
+				{
+					p = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(r, _mm_set1_ps(1.6666667e-1f)));
+				}
+				else
+				{
+					p = _mm_add_ps(_mm_set1_ps(1.3981999507e-3f), _mm_mul_ps(r, _mm_set1_ps(1.9875691500e-4f)));
+					p = _mm_add_ps(_mm_set1_ps(8.3334519073e-3f), _mm_mul_ps(r, p));
+					p = _mm_add_ps(_mm_set1_ps(4.1665795894e-2f), _mm_mul_ps(r, p));
+					p = _mm_add_ps(_mm_set1_ps(1.6666665459e-1f), _mm_mul_ps(r, p));
+					p = _mm_add_ps(_mm_set1_ps(5.0000001201e-1f), _mm_mul_ps(r, p));
+				}
+				p = _mm_add_ps(_mm_add_ps(_mm_set1_ps(1.0f), r), _mm_mul_ps(_mm_mul_ps(r, r), p));
+
+				// Scale by 2^n by building the exponent bits directly.
+				__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+				return _mm_mul_ps(p, scale);
+			}
+
+			/*
+			 * @brief This function calculates the sine and cosine of a single angle.
+			 *
+			 * @param InAngle: the angle in radians.
+			 * @param OutSine: the location to store the sine.
+			 * @param OutCosine: the location to store the cosine.
+			 *
+			 */
+			template <Accuracy Tier = Accuracy::Medium>
+			FORCEINLINE void SinCos(f32 InAngle, f32* OutSine, f32* OutCosine)
+			{
+				__m128 sines, cosines;
+				SinCos4<Tier>(_mm_set_ss(InAngle), &sines, &cosines);
+				*OutSine = _mm_cvtss_f32(sines);
+				*OutCosine = _mm_cvtss_f32(cosines);
+			}
+
+			/*
+			 * @brief This function calculates the reciprocal square root of a single value.
+			 *
+			 * @param InValue: the positive value to calculate the reciprocal square root of.
+			 *
+			 * @return the reciprocal square root.
+			 *
+			 */
+			template <Accuracy Tier = Accuracy::Medium>
+			FORCEINLINE f32 RSqrt(f32 InValue)
+			{
+				return _mm_cvtss_f32(RSqrt4<Tier>(_mm_set1_ps(InValue)));
+			}
+
+			/*
+			 * @brief This function calculates the four-quadrant arc tangent of a single coordinate pair.
+			 *
+			 * @param InY: the Y coordinate.
+			 * @param InX: the X coordinate.
+			 *
+			 * @return the angle in radians, in the range [-pi, pi].
+			 *
+			 */
+			template <Accuracy Tier = Accuracy::Medium>
+			FORCEINLINE f32 Atan2(f32 InY, f32 InX)
+			{
+				return _mm_cvtss_f32(Atan24<Tier>(_mm_set_ss(InY), _mm_set_ss(InX)));
+			}
+
+			/*
+			 * @brief This function calculates the natural exponential of a single value.
+			 *
+			 * @param InValue: the exponent, clamped to the range [-87, 88].
+			 *
+			 * @return e raised to the given exponent.
+			 *
+			 */
+			template <Accuracy Tier = Accuracy::Medium>
+			FORCEINLINE f32 Exp(f32 InValue)
+			{
+				return _mm_cvtss_f32(Exp4<Tier>(_mm_set_ss(InValue)));
+			}
+
+			/*
+			 * @brief These functions apply the kernels above to whole arrays, four elements at a time. The
+			 * arrays do not need to be aligned and the count does not need to be a multiple of four.
+			 *
+			 */
+			template <Accuracy Tier = Accuracy::Medium>
+			void SinCos(const f32* InAngles, f32* OutSines, f32* OutCosines, usize InCount);
+
+			template <Accuracy Tier = Accuracy::Medium>
+			void RSqrt(const f32* InValues, f32* OutValues, usize InCount);
+
+			template <Accuracy Tier = Accuracy::Medium>
+			void Atan2(const f32* InY, const f32* InX, f32* OutAngles, usize InCount);
+
+			template <Accuracy Tier = Accuracy::Medium>
+			void Exp(const f32* InValues, f32* OutValues, usize InCount);
+		}
+	}
+}
@@ -7,6 +7,36 @@
 
 #include "Matrix.hpp"
 
+#include <immintrin.h>
+
+#define SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, SHUFFLE_MASK(x, y, z, w))
+#define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, SHUFFLE_MASK(x, y, z, w))
+
+namespace
+{
+	// Multiplies two 2x2 matrices stored as (m00, m01, m10, m11).
+	FORCEINLINE __m128 Multiply2x2(__m128 InLeft, __m128 InRight)
+	{
+		return _mm_add_ps(_mm_mul_ps(InLeft, SWIZZLE(InRight, 0, 3, 0, 3)),
+			_mm_mul_ps(SWIZZLE(InLeft, 1, 0, 3, 2), SWIZZLE(InRight, 2, 1, 2, 1)));
+	}
+
+	// Multiplies the adjugate of the left 2x2 matrix by the right one.
+	FORCEINLINE __m128 AdjugateMultiply2x2(__m128 InLeft, __m128 InRight)
+	{
+		return _mm_sub_ps(_mm_mul_ps(SWIZZLE(InLeft, 3, 3, 0, 0), InRight),
+			_mm_mul_ps(SWIZZLE(InLeft, 1, 1, 2, 2), SWIZZLE(InRight, 2, 3, 0, 1)));
+	}
+
+	// Multiplies the left 2x2 matrix by the adjugate of the right one.
+	FORCEINLINE __m128 MultiplyAdjugate2x2(__m128 InLeft, __m128 InRight)
+	{
+		return _mm_sub_ps(_mm_mul_ps(InLeft, SWIZZLE(InRight, 3, 0, 3, 0)),
+			_mm_mul_ps(SWIZZLE(InLeft, 1, 0, 3, 2), SWIZZLE(InRight, 2, 1, 2, 1)));
+	}
+}
+
 namespace Re 
 {
 	namespace Math
@@ -44,6 +74,79 @@ namespace Re
 			return Result;
 		}
 
+		Matrix Matrix::Inverse() const
+		{
+			// The inverse of the transpose is the transpose of the inverse, so the column-major storage
+			// can be processed as if it were row-major.
+			__m128 column0 = _mm_loadu_ps(&Elements[0]);
+			__m128 column1 = _mm_loadu_ps(&Elements[4]);
+			__m128 column2 = _mm_loadu_ps(&Elements[8]);
+			__m128 column3 = _mm_loadu_ps(&Elements[12]);
+
+			// Split the matrix into four 2x2 blocks | A B |
+			//                                       | C D |
+			__m128 A = _mm_movelh_ps(column0, column1);
+			__m128 B = _mm_movehl_ps(column1, column0);
+			__m128 C = _mm_movelh_ps(column2, column3);
+			__m128 D = _mm_movehl_ps(column3, column2);
+
+			// Calculate the determinants of the blocks as (|A|, |B|, |C|, |D|).
+			__m128 determinants = _mm_sub_ps(
+				_mm_mul_ps(SHUFFLE(column0, column2, 0, 2, 0, 2), SHUFFLE(column1, column3, 1, 3, 1, 3)),
+				_mm_mul_ps(SHUFFLE(column0, column2, 1, 3, 1, 3), SHUFFLE(column1, column3, 0, 2, 0, 2)));
+			__m128 determinantA = SWIZZLE(determinants, 0, 0, 0, 0);
+			__m128 determinantB = SWIZZLE(determinants, 1, 1, 1, 1);
+			__m128 determinantC = SWIZZLE(determinants, 2, 2, 2, 2);
+			__m128 determinantD = SWIZZLE(determinants, 3, 3, 3, 3);
+
+			// Calculate the adjugates of the blocks of the inverse.
+			__m128 DC = AdjugateMultiply2x2(D, C);
+			__m128 AB = AdjugateMultiply2x2(A, B);
+			__m128 X = _mm_sub_ps(_mm_mul_ps(determinantD, A), Multiply2x2(B, DC));
+			__m128 W = _mm_sub_ps(_mm_mul_ps(determinantA, D), Multiply2x2(C, AB));
+			__m128 Y = _mm_sub_ps(_mm_mul_ps(determinantB, C), MultiplyAdjugate2x2(D, AB));
+			__m128 Z = _mm_sub_ps(_mm_mul_ps(determinantC, B), MultiplyAdjugate2x2(A, DC));
+
+			// Calculate the determinant as |A||D| + |B||C| - tr((A#B)(D#C)).
+			__m128 trace = _mm_mul_ps(AB, SWIZZLE(DC, 0, 2, 1, 3));
+			trace = _mm_hadd_ps(trace, trace);
+			trace = _mm_hadd_ps(trace, trace);
+			__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinantA, determinantD), _mm_mul_ps(determinantB, determinantC)), trace);
+			ASSERT(_mm_cvtss_f32(determinant) != 0.0f);
+
+			__m128 reciprocal = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+			X = _mm_mul_ps(X, reciprocal);
+			Y = _mm_mul_ps(Y, reciprocal);
+			Z = _mm_mul_ps(Z, reciprocal);
+			W = _mm_mul_ps(W, reciprocal);
+
+			// Apply the adjugate and store the blocks back as columns.
+			Matrix Result;
+			_mm_storeu_ps(&Result.Elements[0], SHUFFLE(X, Y, 3, 1, 3, 1));
+			_mm_storeu_ps(&Result.Elements[4], SHUFFLE(X, Y, 2, 0, 2, 0));
+			_mm_storeu_ps(&Result.Elements[8], SHUFFLE(Z, W, 3, 1, 3, 1));
+			_mm_storeu_ps(&Result.Elements[12], SHUFFLE(Z, W, 2, 0, 2, 0));
+
+			return Result;
+		}
+
+		Matrix Matrix::Transposed() const
+		{
+			__m128 column0 = _mm_loadu_ps(&Elements[0]);
+			__m128 column1 = _mm_loadu_ps(&Elements[4]);
+			__m128 column2 = _mm_loadu_ps(&Elements[8]);
+			__m128 column3 = _mm_loadu_ps(&Elements[12]);
+			_MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+			Matrix Result;
+			_mm_storeu_ps(&Result.Elements[0], column0);
+			_mm_storeu_ps(&Result.Elements[4], column1);
+			_mm_storeu_ps(&Result.Elements[8], column2);
+			_mm_storeu_ps(&Result.Elements[12], column3);
+
+			return Result;
+		}
+
 		Matrix Matrix::Identity(void) {
 			return Matrix(1.0f);
 		}
@@ -64,13 +167,50 @@ namespace Re
 			return Result;
 		}
 
+		Matrix Matrix::Normal(const Matrix& InModel)
+		{
+			Vector3 X(InModel.Elements[0], InModel.Elements[1], InModel.Elements[2]);
+			Vector3 Y(InModel.Elements[4], InModel.Elements[5], InModel.Elements[6]);
+			Vector3 Z(InModel.Elements[8], InModel.Elements[9], InModel.Elements[10]);
+
+			// Detect rotations with uniform scale, whose axes are orthogonal and of equal length.
+			const f32 Epsilon = 1e-4f;
+			f32 LengthSquared = X.Dot(X);
+			f32 Tolerance = Epsilon * LengthSquared;
+			bool bUniform = fabsf(Y.Dot(Y) - LengthSquared) <= Tolerance && fabsf(Z.Dot(Z) - LengthSquared) <= Tolerance &&
+				fabsf(X.Dot(Y)) <= Tolerance && fabsf(X.Dot(Z)) <= Tolerance && fabsf(Y.Dot(Z)) <= Tolerance;
+
+			Matrix Result;
+			if (bUniform)
+			{
+				// The inverse transpose of a rotation scaled by s is the same rotation scaled by 1 / s, which is the model divided by s squared.
+				f32 InverseLengthSquared = 1.0f / LengthSquared;
+				for (u32 Column = 0; Column < 3; ++Column)
+					for (u32 Row = 0; Row < 3; ++Row)
+						Result.Elements[Row + Column * 4] = InModel.Elements[Row + Column * 4] * InverseLengthSquared;
+			}
+			else
+			{
+				Result = InModel.Inverse().Transposed();
+			}
+
+			// Clear the translation and projective parts.
+			Result.Elements[3] = Result.Elements[7] = Result.Elements[11] = 0.0f;
+			Result.Elements[12] = Result.Elements[13] = Result.Elements[14] = 0.0f;
+			Result.Elements[15] = 1.0f;
+
+			return Result;
+		}
+
 		Matrix Matrix::Perspective(f32 AspectRatio, f32 FoV, f32 Near, f32 Far)
 		{
 			Matrix Result;
 
 			// Calculate auxiliary values.
 			FoV = ToRadians(FoV);
-			f32 Tangent = tanf(FoV / 2.0f);
+			f32 Sine, Cosine;
+			Fast::SinCos<Fast::Accuracy::Medium>(FoV / 2.0f, &Sine, &Cosine);
+			f32 Tangent = Sine / Cosine;
 
 			// Main Diagonal
 			Result.Elements[0 * 4 + 0] = 1.0f / (AspectRatio * Tangent);
@@ -88,8 +228,8 @@ namespace Re
 			Matrix Result = Matrix::Identity();
 
 			// Basic Vectors
-			Vector3 F = (Center - Eye).Normalize();
-			Vector3 S = Vector3::Cross(F, Up).Normalize();
+			Vector3 F = (Center - Eye).Normalize(Fast::Accuracy::Medium);
+			Vector3 S = Vector3::Cross(F, Up).Normalize(Fast::Accuracy::Medium);
 			Vector3 U = Vector3::Cross(S, F);
 
 			// First Row
@@ -118,8 +258,8 @@ namespace Re
 		Matrix Matrix::Rotation(f32 InAngle, const Vector3& InAxis) {
 			Matrix Result = Matrix::Identity();
 			f32 Radian = ToRadians(InAngle);
-			f32 Cosine = cosf(Radian);
-			f32 Sine = sinf(Radian);
+			f32 Sine, Cosine;
+			Fast::SinCos<Fast::Accuracy::Medium>(Radian, &Sine, &Cosine);
 			f32 OMC = 1.0f - Cosine;
 
 			// First Column
@@ -162,7 +302,7 @@ namespace Re
 			return Result;
 		}
 
-		Matrix& Matrix::operator*=(const Matrix& InOther) { return Multiply(InOther); }
+		Matrix& Matrix::operator*=(const Matrix& InOther) { *this = Multiply(InOther); return *this; }
 		Matrix operator*(Matrix InLeft, const Matrix& InRight) { return InLeft.Multiply(InRight); }
 	}
 }
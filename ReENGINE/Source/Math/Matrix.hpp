@@ -54,6 +54,23 @@ namespace Re
 			 */
 			Matrix Multiply(const Matrix& InOther);
 
+			/*
+			 * @brief This method calculates the inverse of the current matrix using SSE, through the
+			 * 2x2 block decomposition of the matrix.
+			 *
+			 * @return the inverse of the current matrix, which must not be singular.
+			 *
+			 */
+			Matrix Inverse() const;
+
+			/*
+			 * @brief This method calculates the transpose of the current matrix.
+			 *
+			 * @return the transpose of the current matrix.
+			 *
+			 */
+			Matrix Transposed() const;
+
 			/*
 			 * @brief This static method initializes a matrix with the main diagonal holding one and everywhere else
 			 * holding zero.
@@ -78,6 +95,19 @@ namespace Re
 			 */
 			static Matrix Orthographic(f32 InLeft, f32 InRight, f32 InBottom, f32 InTop, f32 InNear, f32 InFar);
 
+			/*
+			 * @brief This static method initializes the matrix that transforms normals by the given model matrix,
+			 * which is the inverse transpose of it's upper 3x3 block. When the model matrix only scales uniformly,
+			 * that block is already orthogonal up to a factor and is returned as is, skipping the inverse.
+			 *
+			 * @param InModel: the model matrix to derive the normal matrix of.
+			 *
+			 * @return a initialized normal matrix, with the translation and projective parts cleared. The result
+			 * is only correct up to a positive factor, so transformed normals must be normalized.
+			 *
+			 */
+			static Matrix Normal(const Matrix& InModel);
+
 			static Matrix Perspective(f32 AspectRatio, f32 FoV, f32 Near, f32 Far);
 
 			/*
@@ -13,11 +13,15 @@ namespace Re
 	{
 		Vector3 Transform::Forward() const
 		{
+			f32 pitchSine, pitchCosine, yawSine, yawCosine;
+			Fast::SinCos<Fast::Accuracy::Medium>(ToRadians(_rotation._pitch), &pitchSine, &pitchCosine);
+			Fast::SinCos<Fast::Accuracy::Medium>(ToRadians(_rotation._yaw), &yawSine, &yawCosine);
+
 			return Vector3(
-				  cosf(ToRadians(_rotation._pitch)) * sinf(ToRadians(_rotation._yaw)),
-				  sinf(ToRadians(_rotation._pitch)),
-				- cosf(ToRadians(_rotation._pitch)) * cosf(ToRadians(_rotation._yaw))
-			).Normalize();
+				  pitchCosine * yawSine,
+				  pitchSine,
+				- pitchCosine * yawCosine
+			).Normalize(Fast::Accuracy::Medium);
 		}
 
 		Vector3 Transform::Right() const
@@ -25,7 +29,7 @@ namespace Re
 			return Vector3::Cross(
 				Forward(),
 				Math::WorldUp
-			).Normalize();
+			).Normalize(Fast::Accuracy::Medium);
 		}
 
 		Vector3 Transform::Up() const
@@ -33,7 +37,7 @@ namespace Re
 			return Vector3::Cross(
 				Right(), 
 				Forward()
-			).Normalize();
+			).Normalize(Fast::Accuracy::Medium);
 		}
 
 		Matrix Transform::ToModel() const
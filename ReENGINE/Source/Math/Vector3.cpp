@@ -68,6 +68,28 @@ namespace Re
 			return *this;
 		}
 
+		Vector3& Vector3::Normalize(Fast::Accuracy InAccuracy)
+		{
+			f32 Reciprocal;
+
+			switch (InAccuracy)
+			{
+			case Fast::Accuracy::Low:
+				Reciprocal = Fast::RSqrt<Fast::Accuracy::Low>(Dot(*this));
+				break;
+			case Fast::Accuracy::Medium:
+				Reciprocal = Fast::RSqrt<Fast::Accuracy::Medium>(Dot(*this));
+				break;
+			default:
+				return Normalize();
+			}
+
+			X *= Reciprocal;
+			Y *= Reciprocal;
+			Z *= Reciprocal;
+			return *this;
+		}
+
 		Vector3& Vector3::Multiply(const f32 InScalar) 
 		{
 			// Perform element-wise vector multiplication.
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Core/Debug/Assert.hpp"
+#include "Math/Fast.hpp"
 
 namespace Re 
 {
@@ -117,6 +118,17 @@ namespace Re
 			 */
 			Vector3& Normalize();
 
+			/**
+			 * @brief This method normalizes the vector by multiplying it by an approximated reciprocal
+			 * of it's length, computed at the given accuracy tier.
+			 *
+			 * @param Fast::Accuracy InAccuracy: The accuracy tier of the reciprocal square root.
+			 *
+			 * @return Vector3&: A reference to self.
+			 *
+			 */
+			Vector3& Normalize(Fast::Accuracy InAccuracy);
+
 			/**
 			 * @brief This method subtracts a vector by another.
 			 *
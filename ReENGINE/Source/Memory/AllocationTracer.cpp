@@ -0,0 +1,550 @@
+/*
+ * AllocationTracer.cpp
+ *
+ * This source file defines the methods declared in the
+ * AllocationTracer.hpp header file, and the hooks of the global operator new
+ * and delete when the engine is built with ALLOCATION_TRACING.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "AllocationTracer.hpp"
+
+#include <immintrin.h>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if !PLATFORM_WINDOWS
+#include <execinfo.h>
+#endif
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u32 NO_SITE = 0xFFFFFFFF;
+			const usize SAMPLE_STRIPES = 64;
+			const usize SAMPLE_STRIPE_SLOTS = 512;
+			const usize KIND_COUNT = 2;
+
+			// The frames of the tracer itself, which every stack starts with.
+			const u32 SKIPPED_FRAMES = 2;
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. It is only
+			 * taken to add call sites and to track sampled chunks, never for every allocation.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			/*
+			 * @brief This structure holds the stack of a call site and what it allocated. The
+			 * hash is written last, so a site whose hash is set can be read without the lock.
+			 *
+			 */
+			struct SiteCounters
+			{
+				boost::atomic<u64> Hash;
+				u32 Depth;
+				void* Stack[AllocationTracer::MAX_STACK_DEPTH];
+				boost::atomic<u64> LiveCount;
+				boost::atomic<u64> LiveBytes;
+				boost::atomic<u64> TotalCount;
+				boost::atomic<u64> TotalBytes;
+			};
+
+			/*
+			 * @brief This structure holds a sampled heap chunk until it is freed, so its call
+			 * site can be credited back.
+			 *
+			 */
+			struct SampleSlot
+			{
+				void* Address;
+				usize Size;
+				u32 Site;
+			};
+
+			/*
+			 * @brief This structure holds a stripe of the sampled chunks, so frees on different
+			 * threads rarely take the same lock.
+			 *
+			 */
+			struct alignas(64) SampleStripe
+			{
+				boost::atomic_flag Lock;
+				usize Count;
+				SampleSlot Slots[SAMPLE_STRIPE_SLOTS];
+			};
+
+			/*
+			 * @brief This structure holds the counters of a thread, which only ever grow. They
+			 * are never released, so the counts of threads that have exited remain in the totals.
+			 *
+			 */
+			struct ThreadCounters
+			{
+				boost::atomic<u64> Count[KIND_COUNT];
+				boost::atomic<u64> Bytes[KIND_COUNT];
+				u32 SinceSample;
+				ThreadCounters* Next;
+			};
+
+			// Zero initialized before any constructor runs, so the hooks work during static initialization.
+			SiteCounters sites[AllocationTracer::MAX_SITES];
+			boost::atomic_flag siteLock;
+
+			SampleStripe stripes[SAMPLE_STRIPES];
+			boost::atomic<usize> liveSamples;
+
+			boost::atomic<u32> sampleRate;
+
+			boost::atomic<ThreadCounters*> threadCountersList;
+			thread_local ThreadCounters* threadCounters;
+			thread_local bool recording;
+
+			FrameAllocations history[AllocationTracer::FRAME_HISTORY];
+			u64 frameCount;
+			u64 previousCount[KIND_COUNT];
+			u64 previousBytes[KIND_COUNT];
+			boost::atomic_flag historyLock;
+
+			ThreadCounters& GetThreadCounters()
+			{
+				if (threadCounters)
+					return *threadCounters;
+
+				// Value initialized, so every counter starts at zero.
+				ThreadCounters* counters = new ThreadCounters();
+				ThreadCounters* head = threadCountersList.load(boost::memory_order_relaxed);
+				do
+				{
+					counters->Next = head;
+				} while (!threadCountersList.compare_exchange_weak(head, counters, boost::memory_order_release, boost::memory_order_relaxed));
+
+				threadCounters = counters;
+				return *counters;
+			}
+
+			// Only the owning thread writes its counters, so a plain increment is enough.
+			FORCEINLINE void Increment(boost::atomic<u64>& InCounter, u64 InValue)
+			{
+				InCounter.store(InCounter.load(boost::memory_order_relaxed) + InValue, boost::memory_order_relaxed);
+			}
+
+			u32 CaptureStack(void** OutStack)
+			{
+				void* stack[AllocationTracer::MAX_STACK_DEPTH + SKIPPED_FRAMES];
+
+#if PLATFORM_WINDOWS
+				u32 depth = static_cast<u32>(CaptureStackBackTrace(0, AllocationTracer::MAX_STACK_DEPTH + SKIPPED_FRAMES, stack, nullptr));
+#else
+				u32 depth = static_cast<u32>(backtrace(stack, AllocationTracer::MAX_STACK_DEPTH + SKIPPED_FRAMES));
+#endif
+
+				if (depth <= SKIPPED_FRAMES)
+					return 0;
+
+				depth -= SKIPPED_FRAMES;
+				memcpy(OutStack, stack + SKIPPED_FRAMES, depth * sizeof(void*));
+				return depth;
+			}
+
+			FORCEINLINE bool IsSameStack(const SiteCounters& InSite, void* const* InStack, u32 InDepth)
+			{
+				return InSite.Depth == InDepth && memcmp(InSite.Stack, InStack, InDepth * sizeof(void*)) == 0;
+			}
+
+			u32 FindSite(void* const* InStack, u32 InDepth)
+			{
+				// FNV-1a over the return addresses, with zero reserved for free entries.
+				u64 hash = 0xCBF29CE484222325ull;
+				for (u32 i = 0; i < InDepth; ++i)
+					hash = (hash ^ reinterpret_cast<usize>(InStack[i])) * 0x100000001B3ull;
+
+				hash = hash ? hash : 1;
+
+				for (usize i = 0; i < AllocationTracer::MAX_SITES; ++i)
+				{
+					usize index = (hash + i) % AllocationTracer::MAX_SITES;
+					SiteCounters& site = sites[index];
+
+					u64 key = site.Hash.load(boost::memory_order_acquire);
+					if (key == 0)
+					{
+						SpinLockGuard guard(siteLock);
+						key = site.Hash.load(boost::memory_order_relaxed);
+						if (key == 0)
+						{
+							site.Depth = InDepth;
+							memcpy(site.Stack, InStack, InDepth * sizeof(void*));
+							site.Hash.store(hash, boost::memory_order_release);
+							return static_cast<u32>(index);
+						}
+					}
+
+					if (key == hash && IsSameStack(site, InStack, InDepth))
+						return static_cast<u32>(index);
+				}
+
+				return NO_SITE;
+			}
+
+			FORCEINLINE SampleStripe& GetStripe(const void* InAddress, usize* OutSlot)
+			{
+				usize hash = (reinterpret_cast<usize>(InAddress) >> 4) * 0x9E3779B97F4A7C15ull;
+				*OutSlot = (hash >> 16) % SAMPLE_STRIPE_SLOTS;
+				return stripes[(hash >> 58) % SAMPLE_STRIPES];
+			}
+
+			bool InsertSample(void* InAddress, usize InSize, u32 InSite)
+			{
+				usize slot;
+				SampleStripe& stripe = GetStripe(InAddress, &slot);
+				SpinLockGuard guard(stripe.Lock);
+
+				// A full stripe drops the sample, which keeps the chunk out of the live counts.
+				if (stripe.Count == SAMPLE_STRIPE_SLOTS - 1)
+					return false;
+
+				while (stripe.Slots[slot].Address)
+					slot = (slot + 1) % SAMPLE_STRIPE_SLOTS;
+
+				stripe.Slots[slot] = { InAddress, InSize, InSite };
+				stripe.Count++;
+				liveSamples.fetch_add(1, boost::memory_order_relaxed);
+				return true;
+			}
+
+			bool RemoveSample(void* InAddress, SampleSlot* OutSample)
+			{
+				usize slot;
+				SampleStripe& stripe = GetStripe(InAddress, &slot);
+				SpinLockGuard guard(stripe.Lock);
+
+				while (stripe.Slots[slot].Address != InAddress)
+				{
+					if (!stripe.Slots[slot].Address)
+						return false;
+
+					slot = (slot + 1) % SAMPLE_STRIPE_SLOTS;
+				}
+
+				*OutSample = stripe.Slots[slot];
+
+				// Shift the following entries back, so probing never stops at a hole.
+				usize hole = slot;
+				for (usize next = (hole + 1) % SAMPLE_STRIPE_SLOTS; stripe.Slots[next].Address; next = (next + 1) % SAMPLE_STRIPE_SLOTS)
+				{
+					usize home;
+					GetStripe(stripe.Slots[next].Address, &home);
+
+					// The entry may only move back if its home is not between the hole and itself.
+					bool between = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+					if (!between)
+					{
+						stripe.Slots[hole] = stripe.Slots[next];
+						hole = next;
+					}
+				}
+
+				stripe.Slots[hole].Address = nullptr;
+				stripe.Count--;
+				liveSamples.fetch_sub(1, boost::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		const u32 AllocationTracer::MAX_STACK_DEPTH;
+		const usize AllocationTracer::MAX_SITES;
+		const usize AllocationTracer::FRAME_HISTORY;
+
+		boost::atomic<bool> AllocationTracer::_enabled(false);
+
+		void AllocationTracer::Enable(u32 InSampleRate)
+		{
+			sampleRate.store(InSampleRate ? InSampleRate : 1, boost::memory_order_relaxed);
+			_enabled.store(true, boost::memory_order_release);
+		}
+
+		void AllocationTracer::Disable()
+		{
+			_enabled.store(false, boost::memory_order_release);
+		}
+
+		u32 AllocationTracer::GetSampleRate()
+		{
+			u32 rate = sampleRate.load(boost::memory_order_relaxed);
+			return rate ? rate : 1;
+		}
+
+		void AllocationTracer::BeginFrame()
+		{
+			u64 count[KIND_COUNT] = {};
+			u64 bytes[KIND_COUNT] = {};
+			for (ThreadCounters* counters = threadCountersList.load(boost::memory_order_acquire); counters; counters = counters->Next)
+			{
+				for (usize k = 0; k < KIND_COUNT; ++k)
+				{
+					count[k] += counters->Count[k].load(boost::memory_order_relaxed);
+					bytes[k] += counters->Bytes[k].load(boost::memory_order_relaxed);
+				}
+			}
+
+			SpinLockGuard guard(historyLock);
+			FrameAllocations& frame = history[frameCount % FRAME_HISTORY];
+			frame.Frame = frameCount++;
+			frame.HeapCount = count[0] - previousCount[0];
+			frame.HeapBytes = bytes[0] - previousBytes[0];
+			frame.PooledCount = count[1] - previousCount[1];
+			frame.PooledBytes = bytes[1] - previousBytes[1];
+
+			for (usize k = 0; k < KIND_COUNT; ++k)
+			{
+				previousCount[k] = count[k];
+				previousBytes[k] = bytes[k];
+			}
+		}
+
+		usize AllocationTracer::GetFrameHistory(FrameAllocations* OutFrames, usize InMaxFrames)
+		{
+			SpinLockGuard guard(historyLock);
+
+			usize count = 0;
+			for (u64 frame = frameCount; frame > 0 && count < InMaxFrames && count < FRAME_HISTORY; --frame)
+				OutFrames[count++] = history[(frame - 1) % FRAME_HISTORY];
+
+			return count;
+		}
+
+		void AllocationTracer::ResetSites()
+		{
+			for (usize i = 0; i < MAX_SITES; ++i)
+			{
+				sites[i].TotalCount.store(0, boost::memory_order_relaxed);
+				sites[i].TotalBytes.store(0, boost::memory_order_relaxed);
+			}
+		}
+
+		bool AllocationTracer::WriteHeapProfile(const utf8* InPath)
+		{
+			FILE* file = fopen(InPath, "w");
+			if (!file)
+				return false;
+
+			// Samples stand for as many allocations as the rate, so scale them back up.
+			u64 rate = GetSampleRate();
+			u64 liveCount = 0, liveBytes = 0, totalCount = 0, totalBytes = 0;
+			for (usize i = 0; i < MAX_SITES; ++i)
+			{
+				liveCount += sites[i].LiveCount.load(boost::memory_order_relaxed);
+				liveBytes += sites[i].LiveBytes.load(boost::memory_order_relaxed);
+				totalCount += sites[i].TotalCount.load(boost::memory_order_relaxed);
+				totalBytes += sites[i].TotalBytes.load(boost::memory_order_relaxed);
+			}
+
+			fprintf(file, "heap profile: %llu: %llu [%llu: %llu] @ heapprofile\n",
+				static_cast<unsigned long long>(liveCount * rate), static_cast<unsigned long long>(liveBytes * rate),
+				static_cast<unsigned long long>(totalCount * rate), static_cast<unsigned long long>(totalBytes * rate));
+
+			for (usize i = 0; i < MAX_SITES; ++i)
+			{
+				const SiteCounters& site = sites[i];
+				u64 total = site.TotalCount.load(boost::memory_order_relaxed);
+				u64 live = site.LiveCount.load(boost::memory_order_relaxed);
+				if (!site.Hash.load(boost::memory_order_acquire) || (!total && !live))
+					continue;
+
+				fprintf(file, "%llu: %llu [%llu: %llu] @",
+					static_cast<unsigned long long>(live * rate), static_cast<unsigned long long>(site.LiveBytes.load(boost::memory_order_relaxed) * rate),
+					static_cast<unsigned long long>(total * rate), static_cast<unsigned long long>(site.TotalBytes.load(boost::memory_order_relaxed) * rate));
+
+				for (u32 j = 0; j < site.Depth; ++j)
+					fprintf(file, " 0x%llx", static_cast<unsigned long long>(reinterpret_cast<usize>(site.Stack[j])));
+
+				fputc('\n', file);
+			}
+
+#if !PLATFORM_WINDOWS
+			// pprof maps the addresses back to the binaries with the process' own memory map.
+			fputs("\nMAPPED_LIBRARIES:\n", file);
+			FILE* maps = fopen("/proc/self/maps", "r");
+			if (maps)
+			{
+				char buffer[4096];
+				usize read;
+				while ((read = fread(buffer, 1, sizeof(buffer), maps)) > 0)
+					fwrite(buffer, 1, read, file);
+
+				fclose(maps);
+			}
+#endif
+
+			return fclose(file) == 0;
+		}
+
+		bool AllocationTracer::WriteFrameHistory(const utf8* InPath)
+		{
+			FILE* file = fopen(InPath, "w");
+			if (!file)
+				return false;
+
+			fputs("frame,heap_allocations,heap_bytes,pooled_allocations,pooled_bytes\n", file);
+
+			SpinLockGuard guard(historyLock);
+			u64 first = frameCount > FRAME_HISTORY ? frameCount - FRAME_HISTORY : 0;
+			for (u64 i = first; i < frameCount; ++i)
+			{
+				const FrameAllocations& frame = history[i % FRAME_HISTORY];
+				fprintf(file, "%llu,%llu,%llu,%llu,%llu\n", static_cast<unsigned long long>(frame.Frame),
+					static_cast<unsigned long long>(frame.HeapCount), static_cast<unsigned long long>(frame.HeapBytes),
+					static_cast<unsigned long long>(frame.PooledCount), static_cast<unsigned long long>(frame.PooledBytes));
+			}
+
+			return fclose(file) == 0;
+		}
+
+		bool AllocationTracer::Enter()
+		{
+			if (recording)
+				return false;
+
+			recording = true;
+			return true;
+		}
+
+		void AllocationTracer::Leave()
+		{
+			recording = false;
+		}
+
+		void AllocationTracer::RecordAllocation(void* InAddress, usize InSize, AllocationKind InKind)
+		{
+			ThreadCounters& counters = GetThreadCounters();
+			usize kind = static_cast<usize>(InKind);
+			Increment(counters.Count[kind], 1);
+			Increment(counters.Bytes[kind], InSize);
+
+			if (++counters.SinceSample < GetSampleRate())
+				return;
+
+			counters.SinceSample = 0;
+
+			void* stack[MAX_STACK_DEPTH];
+			u32 depth = CaptureStack(stack);
+			u32 index = FindSite(stack, depth);
+			if (index == NO_SITE)
+				return;
+
+			SiteCounters& site = sites[index];
+			site.TotalCount.fetch_add(1, boost::memory_order_relaxed);
+			site.TotalBytes.fetch_add(InSize, boost::memory_order_relaxed);
+
+			if (InKind == AllocationKind::Heap && InsertSample(InAddress, InSize, index))
+			{
+				site.LiveCount.fetch_add(1, boost::memory_order_relaxed);
+				site.LiveBytes.fetch_add(InSize, boost::memory_order_relaxed);
+			}
+		}
+
+		void AllocationTracer::RecordPooled(void* InAddress, usize InSize)
+		{
+			// Pools refilled by a heap allocation are already accounted to it.
+			if (!Enter())
+				return;
+
+			RecordAllocation(InAddress, InSize, AllocationKind::Pooled);
+			Leave();
+		}
+
+		void AllocationTracer::RecordFree(void* InAddress)
+		{
+			if (liveSamples.load(boost::memory_order_relaxed) == 0)
+				return;
+
+			SampleSlot sample;
+			if (!RemoveSample(InAddress, &sample))
+				return;
+
+			SiteCounters& site = sites[sample.Site];
+			site.LiveCount.fetch_sub(1, boost::memory_order_relaxed);
+			site.LiveBytes.fetch_sub(sample.Size, boost::memory_order_relaxed);
+		}
+	}
+}
+
+#if defined(ALLOCATION_TRACING)
+
+/*
+ * The global operator new and delete, replaced so allocations made with new are traced
+ * like any other heap allocation. The array and sized forms route to these by default.
+ *
+ */
+void* operator new(std::size_t InSize)
+{
+	Re::Memory::AllocationTracer::Scope trace;
+	void* address = malloc(InSize ? InSize : 1);
+	if (!address)
+		throw std::bad_alloc();
+
+	return trace.Allocated(address, InSize);
+}
+
+void* operator new(std::size_t InSize, const std::nothrow_t&) noexcept
+{
+	Re::Memory::AllocationTracer::Scope trace;
+	return trace.Allocated(malloc(InSize ? InSize : 1), InSize);
+}
+
+void* operator new[](std::size_t InSize)
+{
+	return operator new(InSize);
+}
+
+void* operator new[](std::size_t InSize, const std::nothrow_t& InTag) noexcept
+{
+	return operator new(InSize, InTag);
+}
+
+void operator delete(void* InAddress) noexcept
+{
+	Re::Memory::AllocationTracer::Scope trace;
+	trace.Freed(InAddress);
+	free(InAddress);
+}
+
+void operator delete(void* InAddress, const std::nothrow_t&) noexcept
+{
+	operator delete(InAddress);
+}
+
+void operator delete[](void* InAddress) noexcept
+{
+	operator delete(InAddress);
+}
+
+void operator delete[](void* InAddress, const std::nothrow_t&) noexcept
+{
+	operator delete(InAddress);
+}
+
+#endif
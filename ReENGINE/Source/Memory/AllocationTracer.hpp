@@ -0,0 +1,241 @@
+/*
+ * AllocationTracer.hpp
+ *
+ * This header file declares the AllocationTracer, an optional instrumentation
+ * layer that records where the engine allocates memory, frame by frame, and
+ * writes heap profiles readable by pprof.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Memory.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This enumeration lists the kinds of allocations the tracer tells apart. Heap
+		 * allocations reach a general purpose heap and are tracked until freed, while pooled
+		 * allocations are served from memory an allocator already holds, such as pools, stacks
+		 * and arenas, and are only counted.
+		 *
+		 */
+		enum class AllocationKind : u8
+		{
+			Heap,
+			Pooled
+		};
+
+		/*
+		 * @brief This structure holds the allocations made during a frame, by every thread.
+		 *
+		 */
+		struct FrameAllocations
+		{
+			u64 Frame;
+			u64 HeapCount;
+			u64 HeapBytes;
+			u64 PooledCount;
+			u64 PooledBytes;
+		};
+
+		/*
+		 * @brief This class is responsible for finding the call sites that allocate memory,
+		 * so steady state frames can be driven to allocate nothing from the heap.
+		 *
+		 * Every allocator calls into the tracer, which does nothing but a single load until it
+		 * is enabled. Once enabled, every allocation is counted towards the current frame, and
+		 * one in every few, per thread, has its stack captured and accounted to its call site.
+		 * Allocators built on top of others only record the outermost call, so a chunk is never
+		 * counted twice. Global operator new and delete are hooked as well when the engine is
+		 * built with ALLOCATION_TRACING defined.
+		 *
+		 * Heap profiles are written in the text format of gperftools, which pprof reads, with
+		 * the counts scaled back up by the sample rate. The history of the last frames is
+		 * written as comma separated values.
+		 *
+		 */
+		class AllocationTracer
+		{
+		public:
+			/*
+			 * @brief This constant holds the deepest stack captured for a call site.
+			 *
+			 */
+			static const u32 MAX_STACK_DEPTH = 32;
+
+			/*
+			 * @brief This constant holds the maximum number of distinct call sites recorded.
+			 * Stacks beyond it are counted towards the frames, but not to any call site.
+			 *
+			 */
+			static const usize MAX_SITES = 4096;
+
+			/*
+			 * @brief This constant holds the number of frames kept in the history.
+			 *
+			 */
+			static const usize FRAME_HISTORY = 1024;
+
+			/*
+			 * @brief This class records a heap allocation or free for the duration of an
+			 * allocator's method. Only the outermost scope on a thread records anything, so
+			 * heaps called by other allocators stay silent.
+			 *
+			 */
+			class Scope
+			{
+			public:
+				FORCEINLINE Scope()
+					: _outer(AllocationTracer::IsEnabled() && AllocationTracer::Enter())
+				{}
+
+				FORCEINLINE ~Scope()
+				{
+					if (_outer)
+						AllocationTracer::Leave();
+				}
+
+				Scope(const Scope&) = delete;
+				Scope& operator=(const Scope&) = delete;
+
+				/*
+				 * @brief This method records a chunk allocated within the scope.
+				 *
+				 * @param InAddress: the pointer to the chunk, or nullptr if it failed.
+				 * @param InSize: the size requested.
+				 * @return the pointer to the chunk, unchanged.
+				 *
+				 */
+				FORCEINLINE void* Allocated(void* InAddress, usize InSize)
+				{
+					if (_outer && InAddress)
+						AllocationTracer::RecordAllocation(InAddress, InSize, AllocationKind::Heap);
+
+					return InAddress;
+				}
+
+				/*
+				 * @brief This method records a chunk freed within the scope.
+				 *
+				 * @param InAddress: the pointer to the chunk, or nullptr.
+				 *
+				 */
+				FORCEINLINE void Freed(void* InAddress)
+				{
+					if (_outer && InAddress)
+						AllocationTracer::RecordFree(InAddress);
+				}
+
+			private:
+				bool _outer;
+			};
+
+			/*
+			 * @brief This method records a chunk handed out by a pool, stack or arena, unless
+			 * it was made on behalf of a heap allocation.
+			 *
+			 * @param InAddress: the pointer to the chunk, or nullptr if it failed.
+			 * @param InSize: the size requested.
+			 * @return the pointer to the chunk, unchanged.
+			 *
+			 */
+			static FORCEINLINE void* TracePooled(void* InAddress, usize InSize)
+			{
+				if (IsEnabled() && InAddress)
+					RecordPooled(InAddress, InSize);
+
+				return InAddress;
+			}
+
+			/*
+			 * @brief This method starts recording allocations. Chunks allocated before are
+			 * not tracked, so freeing them is not recorded either.
+			 *
+			 * @param InSampleRate: the number of allocations per thread for every stack captured.
+			 *
+			 */
+			static void Enable(u32 InSampleRate = 1);
+
+			/*
+			 * @brief This method stops recording allocations. What was recorded is kept.
+			 *
+			 */
+			static void Disable();
+
+			/*
+			 * @brief This method returns whether allocations are being recorded.
+			 *
+			 */
+			static FORCEINLINE bool IsEnabled() { return _enabled.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the number of allocations per thread for every stack captured.
+			 *
+			 */
+			static u32 GetSampleRate();
+
+			/*
+			 * @brief This method closes the current frame, adding its allocations to the history.
+			 * It should be called once per frame, from a single thread.
+			 *
+			 */
+			static void BeginFrame();
+
+			/*
+			 * @brief This method fills an array with the most recent frames in the history, the
+			 * most recent first.
+			 *
+			 * @param OutFrames: the array to fill.
+			 * @param InMaxFrames: the capacity of the array.
+			 * @return the number of frames written.
+			 *
+			 */
+			static usize GetFrameHistory(FrameAllocations* OutFrames, usize InMaxFrames);
+
+			/*
+			 * @brief This method clears the allocation counts of every call site, so a profile
+			 * only covers what comes next, such as the steady state after loading. The chunks
+			 * still in use remain tracked.
+			 *
+			 */
+			static void ResetSites();
+
+			/*
+			 * @brief This method writes a heap profile of every call site, with the chunks it
+			 * holds and the chunks it allocated, followed by the mapped libraries pprof needs to
+			 * symbolize it on Linux.
+			 *
+			 * @param InPath: the path of the file to write.
+			 * @return true if the file was written, false otherwise.
+			 *
+			 */
+			static bool WriteHeapProfile(const utf8* InPath);
+
+			/*
+			 * @brief This method writes the history of frames as comma separated values, the
+			 * oldest first.
+			 *
+			 * @param InPath: the path of the file to write.
+			 * @return true if the file was written, false otherwise.
+			 *
+			 */
+			static bool WriteFrameHistory(const utf8* InPath);
+
+		private:
+			static bool Enter();
+			static void Leave();
+			static void RecordAllocation(void* InAddress, usize InSize, AllocationKind InKind);
+			static void RecordPooled(void* InAddress, usize InSize);
+			static void RecordFree(void* InAddress);
+
+			static boost::atomic<bool> _enabled;
+		};
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * AllocatorAdapter.hpp
+ *
+ * This header file declares the AllocatorAdapter, which lets the boost and
+ * standard containers allocate their storage through any IAllocator.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "MemoryManager.hpp"
+
+#include <boost/type_traits/integral_constant.hpp>
+#include <cstddef>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class adapts an IAllocator to the allocator interface of the boost and
+		 * standard containers. It is stateful: a default constructed adapter allocates from
+		 * the MemoryManager's allocator of its tag, and any other IAllocator, such as a pool
+		 * or a frame arena, can be passed in instead.
+		 *
+		 * The allocator must outlive the container, and must be able to free blocks in any
+		 * order unless the container never frees before it is destroyed.
+		 *
+		 */
+		template <typename Type, MemoryTag Tag = MemoryTag::General>
+		class AllocatorAdapter
+		{
+		public:
+			typedef Type value_type;
+			typedef Type* pointer;
+			typedef const Type* const_pointer;
+			typedef Type& reference;
+			typedef const Type& const_reference;
+			typedef usize size_type;
+			typedef std::ptrdiff_t difference_type;
+
+			// Moving or swapping a container keeps its elements, so the allocator goes with them.
+			typedef boost::false_type propagate_on_container_copy_assignment;
+			typedef boost::true_type propagate_on_container_move_assignment;
+			typedef boost::true_type propagate_on_container_swap;
+			typedef boost::false_type is_always_equal;
+
+			template <typename Other>
+			struct rebind
+			{
+				typedef AllocatorAdapter<Other, Tag> other;
+			};
+
+			/*
+			 * @brief This constructor binds the adapter to the MemoryManager's allocator of Tag.
+			 *
+			 */
+			AllocatorAdapter()
+				: _allocator(&MemoryManager::GetAllocator(Tag)) {}
+
+			/*
+			 * @brief This constructor binds the adapter to the given allocator.
+			 *
+			 */
+			AllocatorAdapter(IAllocator& InAllocator)
+				: _allocator(&InAllocator) {}
+
+			template <typename Other>
+			AllocatorAdapter(const AllocatorAdapter<Other, Tag>& InOther)
+				: _allocator(InOther.GetAllocator()) {}
+
+			Type* allocate(usize InCount)
+			{
+				return static_cast<Type*>(_allocator->AllocateAligned(InCount * sizeof(Type), alignof(Type) > 16 ? alignof(Type) : 16));
+			}
+
+			void deallocate(Type* InAddress, usize InCount)
+			{
+				_allocator->FreeAligned(InAddress);
+			}
+
+			INLINE IAllocator* GetAllocator() const { return _allocator; }
+
+		private:
+			IAllocator* _allocator;
+		};
+
+		template <typename Type, typename Other, MemoryTag Tag>
+		INLINE bool operator==(const AllocatorAdapter<Type, Tag>& InLeft, const AllocatorAdapter<Other, Tag>& InRight)
+		{
+			return InLeft.GetAllocator() == InRight.GetAllocator();
+		}
+
+		template <typename Type, typename Other, MemoryTag Tag>
+		INLINE bool operator!=(const AllocatorAdapter<Type, Tag>& InLeft, const AllocatorAdapter<Other, Tag>& InRight)
+		{
+			return InLeft.GetAllocator() != InRight.GetAllocator();
+		}
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * Containers.hpp
+ *
+ * This header file declares the containers of the ReENGINE, which are the
+ * boost containers allocating through an AllocatorAdapter.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "AllocatorAdapter.hpp"
+
+#include <boost/container/deque.hpp>
+#include <boost/container/map.hpp>
+#include <boost/container/vector.hpp>
+#include <functional>
+#include <utility>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief These types are the boost containers with their memory accounted to a tag. A
+		 * container can be pointed at a faster allocator by constructing it with one, such as
+		 * Memory::Vector<u32> indices(pool), without changing its type.
+		 *
+		 */
+		template <typename Type, MemoryTag Tag = MemoryTag::General>
+		using Vector = boost::container::vector<Type, AllocatorAdapter<Type, Tag>>;
+
+		template <typename Type, MemoryTag Tag = MemoryTag::General>
+		using Deque = boost::container::deque<Type, AllocatorAdapter<Type, Tag>>;
+
+		template <typename Key, typename Value, MemoryTag Tag = MemoryTag::General, typename Compare = std::less<Key>>
+		using Map = boost::container::map<Key, Value, Compare, AllocatorAdapter<std::pair<const Key, Value>, Tag>>;
+
+		template <typename Key, typename Value, MemoryTag Tag = MemoryTag::General, typename Compare = std::less<Key>>
+		using MultiMap = boost::container::multimap<Key, Value, Compare, AllocatorAdapter<std::pair<const Key, Value>, Tag>>;
+	}
+}
@@ -9,18 +9,26 @@
  */
 
 #include "DefaultAllocator.hpp"
+#include "AllocationTracer.hpp"
 
 namespace Re {
 namespace Memory {
 
 void* DefaultAllocator::Allocate(usize Size) 
 {
-	return malloc(Size);
+	AllocationTracer::Scope trace;
+	return trace.Allocated(malloc(Size), Size);
 }
 
 void* DefaultAllocator::AllocateAligned(usize Size, usize Alignment) 
 {
-	return _aligned_malloc(Size, Alignment);
+	AllocationTracer::Scope trace;
+#if PLATFORM_WINDOWS
+	return trace.Allocated(_aligned_malloc(Size, Alignment), Size);
+#else
+	void* Address = nullptr;
+	return trace.Allocated(posix_memalign(&Address, Alignment < sizeof(void*) ? sizeof(void*) : Alignment, Size) == 0 ? Address : nullptr, Size);
+#endif
 	/*
 	ASSERT(alignment >= 1);
 	ASSERT(alignment <= 128);
@@ -51,12 +59,20 @@ void* DefaultAllocator::AllocateAligned(usize Size, usize Alignment)
 
 void DefaultAllocator::Free(void* Address) 
 {
+	AllocationTracer::Scope trace;
+	trace.Freed(Address);
 	free(Address);
 }
 
 void DefaultAllocator::FreeAligned(void* Address) 
 {
+	AllocationTracer::Scope trace;
+	trace.Freed(Address);
+#if PLATFORM_WINDOWS
 	_aligned_free(Address);
+#else
+	free(Address);
+#endif
 	/*
 	const u8* pAlignedMem = reinterpret_cast<const u8*>(pAddress);
 
@@ -0,0 +1,230 @@
+/*
+ * FrameAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * FrameAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "FrameAllocator.hpp"
+#include "AllocationTracer.hpp"
+#include "MemoryManager.hpp"
+
+#include <immintrin.h>
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u8 RESET_PATTERN = 0xDD;
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. Spans are
+			 * only taken once every few dozen kilobytes, so contention is rare and short.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+
+			/*
+			 * @brief This structure holds the span a thread is allocating from in an arena.
+			 * Arenas take a new identifier every time they are reset, so a span left behind
+			 * by a previous frame simply never matches again.
+			 *
+			 */
+			struct SpanSlot
+			{
+				u64 Arena;
+				u8* Current;
+				u8* End;
+			};
+
+			const usize SPAN_SLOTS = 16;
+			const usize SPAN_ALIGNMENT = 64;
+
+			boost::atomic<u64> nextArenaId(1);
+
+			thread_local SpanSlot spanSlots[SPAN_SLOTS];
+		}
+
+		const usize FrameArena::SPAN_SIZE;
+
+		FrameArena::FrameArena(usize InBlockSize)
+			: _blockSize(InBlockSize), _blocks(nullptr), _current(nullptr), _offset(0), _used(0), _capacity(0), _highWater(0),
+			_id(nextArenaId.fetch_add(1, boost::memory_order_relaxed))
+		{
+			ASSERT(InBlockSize >= SPAN_SIZE);
+			_lock.clear();
+		}
+
+		FrameArena::~FrameArena()
+		{
+			TrackingAllocator& allocator = MemoryManager::GetAllocator(MemoryTag::Frame);
+			while (_blocks)
+			{
+				Block* next = _blocks->Next;
+				allocator.FreeAligned(_blocks);
+				_blocks = next;
+			}
+		}
+
+		void* FrameArena::Allocate(usize Size)
+		{
+			return AllocateAligned(Size, 16);
+		}
+
+		void* FrameArena::AllocateAligned(usize Size, usize Alignment)
+		{
+			ASSERT(Alignment >= 1 && (Alignment & (Alignment - 1)) == 0);
+
+			u64 id = _id.load(boost::memory_order_relaxed);
+			SpanSlot& slot = spanSlots[id % SPAN_SLOTS];
+			if (slot.Arena == id)
+			{
+				u8* address = reinterpret_cast<u8*>(AlignUp(reinterpret_cast<usize>(slot.Current), Alignment));
+				if (address + Size <= slot.End)
+				{
+					slot.Current = address + Size;
+					return AllocationTracer::TracePooled(address, Size);
+				}
+			}
+
+			// Large allocations take a span of their own, so they don't waste the thread's span.
+			usize size = Size + Alignment - 1;
+			if (size > SPAN_SIZE / 2)
+			{
+				u8* end;
+				u8* span = AcquireSpan(size, &end);
+				return AllocationTracer::TracePooled(span ? reinterpret_cast<u8*>(AlignUp(reinterpret_cast<usize>(span), Alignment)) : nullptr, Size);
+			}
+
+			u8* end;
+			u8* span = AcquireSpan(SPAN_SIZE, &end);
+			if (!span)
+				return nullptr;
+
+			u8* address = reinterpret_cast<u8*>(AlignUp(reinterpret_cast<usize>(span), Alignment));
+			slot.Arena = id;
+			slot.Current = address + Size;
+			slot.End = end;
+			return AllocationTracer::TracePooled(address, Size);
+		}
+
+		void FrameArena::Free(void* Address)
+		{}
+
+		void FrameArena::FreeAligned(void* Address)
+		{}
+
+		void FrameArena::Reset()
+		{
+			SpinLockGuard guard(_lock);
+
+			usize used = _used.load(boost::memory_order_relaxed);
+			_highWater = used > _highWater ? used : _highWater;
+
+#if defined(ASSERTIONS)
+			// Poison everything handed out, so memory used past its frame stands out.
+			const usize header = AlignUp(sizeof(Block), SPAN_ALIGNMENT);
+			for (Block* block = _blocks; block; block = block->Next)
+			{
+				usize end = block == _current ? _offset : block->Size;
+				Set(reinterpret_cast<u8*>(block) + header, RESET_PATTERN, end - header);
+				if (block == _current)
+					break;
+			}
+#endif
+
+			_current = _blocks;
+			_offset = AlignUp(sizeof(Block), SPAN_ALIGNMENT);
+			_used.store(0, boost::memory_order_relaxed);
+			_id.store(nextArenaId.fetch_add(1, boost::memory_order_relaxed), boost::memory_order_relaxed);
+		}
+
+		u8* FrameArena::AcquireSpan(usize InSize, u8** OutEnd)
+		{
+			const usize header = AlignUp(sizeof(Block), SPAN_ALIGNMENT);
+			usize size = AlignUp(InSize, SPAN_ALIGNMENT);
+
+			SpinLockGuard guard(_lock);
+
+			// Move on to the next block when the span doesn't fit, keeping blocks in order so
+			// the same blocks are walked again after a reset.
+			while (_current && _offset + size > _current->Size)
+			{
+				_current = _current->Next;
+				_offset = header;
+			}
+
+			if (!_current)
+			{
+				usize blockSize = header + size > _blockSize ? header + size : _blockSize;
+
+				TrackingAllocator& allocator = MemoryManager::GetAllocator(MemoryTag::Frame);
+				Block* block = static_cast<Block*>(allocator.AllocateAligned(blockSize, SPAN_ALIGNMENT));
+				ASSERT(block);
+				if (!block)
+					return nullptr;
+
+				block->Next = nullptr;
+				block->Size = blockSize;
+				_capacity.fetch_add(blockSize, boost::memory_order_relaxed);
+
+				Block** tail = &_blocks;
+				while (*tail)
+					tail = &(*tail)->Next;
+
+				*tail = block;
+				_current = block;
+				_offset = header;
+			}
+
+			u8* span = reinterpret_cast<u8*>(_current) + _offset;
+			_offset += size;
+			_used.fetch_add(size, boost::memory_order_relaxed);
+
+			*OutEnd = span + size;
+			return span;
+		}
+
+		FrameAllocator::FrameAllocator()
+			: _current(0)
+		{}
+
+		void FrameAllocator::BeginFrame(usize InFrame)
+		{
+			usize frame = InFrame % FRAME_ARENA_COUNT;
+			_arenas[frame].Reset();
+			_current.store(frame, boost::memory_order_release);
+		}
+
+		FrameAllocator& FrameAllocator::Shared()
+		{
+			static FrameAllocator* allocator = new FrameAllocator();
+			return *allocator;
+		}
+	}
+}
@@ -0,0 +1,305 @@
+/*
+ * FrameAllocator.hpp
+ *
+ * This header file declares the FrameArena and the FrameAllocator, which
+ * hand out transient memory that lives for a frame and is released all at
+ * once, instead of one allocation at a time.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/container/vector.hpp>
+#include <cstddef>
+#include <type_traits>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This constant holds the number of frame arenas, one for each frame that can
+		 * be in flight at once. It must match the renderer's MAX_FRAME_DRAWS.
+		 *
+		 */
+		const usize FRAME_ARENA_COUNT = 3;
+
+		/*
+		 * @brief This constant holds the default size of the blocks a frame arena grows by.
+		 *
+		 */
+		const usize FRAME_ARENA_BLOCK_SIZE = 4 * 1024 * 1024;
+
+		/*
+		 * @brief This class is responsible for allocating transient memory linearly, releasing
+		 * all of it at once when the arena is reset.
+		 *
+		 * Each thread carves a private span out of the arena and allocates from it without
+		 * synchronization, so worker threads only take the arena's lock once per span. The
+		 * arena grows by whole blocks when it runs out, and keeps them across resets.
+		 *
+		 */
+		class FrameArena : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the size of the span each thread takes from the arena
+			 * at a time. Larger allocations take a span of their own.
+			 *
+			 */
+			static const usize SPAN_SIZE = 64 * 1024;
+
+			/*
+			 * @brief This constructor sets up an empty arena. No memory is allocated until the
+			 * first allocation is requested.
+			 *
+			 * @param InBlockSize: the size, in bytes, of the blocks the arena grows by.
+			 *
+			 */
+			explicit FrameArena(usize InBlockSize = FRAME_ARENA_BLOCK_SIZE);
+
+			/*
+			 * @brief This destructor returns every block to the operating system.
+			 *
+			 */
+			virtual ~FrameArena();
+
+			FrameArena(const FrameArena&) = delete;
+			FrameArena& operator=(const FrameArena&) = delete;
+
+			/*
+			 * @brief This method allocates a chunk of memory aligned to 16 bytes.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @return a void pointer to the chunk, or nullptr if the arena could not grow.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates a chunk of memory from the calling thread's span.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if the arena could not grow.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method does nothing, since memory is only released by Reset.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method does nothing, since memory is only released by Reset.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method releases every allocation made from the arena. No thread may
+			 * be allocating from, or still using memory of, the arena while it is reset.
+			 *
+			 */
+			void Reset();
+
+			/*
+			 * @brief This method returns the number of bytes handed out as spans since the
+			 * last reset, which includes the unused tails of the threads' spans.
+			 *
+			 */
+			INLINE usize GetUsed() const { return _used.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the total size, in bytes, of the blocks owned by the arena.
+			 *
+			 */
+			INLINE usize GetCapacity() const { return _capacity.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the largest number of bytes used between two resets.
+			 *
+			 */
+			INLINE usize GetHighWaterMark() const { return _highWater; }
+
+		private:
+			struct Block
+			{
+				Block* Next;
+				usize Size;
+			};
+
+			/*
+			 * @brief This method takes a span of at least InSize bytes from the current block,
+			 * moving on to the next block or growing the arena when it does not fit.
+			 *
+			 * @param InSize: the minimum size of the span.
+			 * @param OutEnd: the end of the span.
+			 * @return the beginning of the span, or nullptr if the arena could not grow.
+			 *
+			 */
+			u8* AcquireSpan(usize InSize, u8** OutEnd);
+
+			usize _blockSize;
+
+			boost::atomic_flag _lock;
+			Block* _blocks;
+			Block* _current;
+			usize _offset;
+			boost::atomic<usize> _used;
+			boost::atomic<usize> _capacity;
+			usize _highWater;
+
+			boost::atomic<u64> _id;
+		};
+
+		/*
+		 * @brief This class is responsible for the frame arenas of the engine, one for each
+		 * frame in flight. An arena is reset when the frame that last used it is known to be
+		 * finished, so memory allocated during a frame stays valid until the same arena comes
+		 * around again, FRAME_ARENA_COUNT frames later.
+		 *
+		 */
+		class FrameAllocator
+		{
+		public:
+			/*
+			 * @brief This constructor sets up the frame arenas, starting at the first one.
+			 *
+			 */
+			FrameAllocator();
+
+			FrameAllocator(const FrameAllocator&) = delete;
+			FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+			/*
+			 * @brief This method resets the arena of a frame and makes it the current one. It
+			 * must be called once the frame's fence has signaled, before anything is allocated
+			 * for the new frame.
+			 *
+			 * @param InFrame: the index of the frame in flight that is about to be recorded.
+			 *
+			 */
+			void BeginFrame(usize InFrame);
+
+			/*
+			 * @brief This method returns the arena of the current frame.
+			 *
+			 */
+			INLINE FrameArena& GetCurrent() { return _arenas[_current.load(boost::memory_order_acquire)]; }
+
+			/*
+			 * @brief This method returns the arena of a frame in flight.
+			 *
+			 */
+			INLINE FrameArena& GetArena(usize InFrame) { return _arenas[InFrame % FRAME_ARENA_COUNT]; }
+
+			/*
+			 * @brief This method allocates a chunk of memory from the current frame's arena.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if the arena could not grow.
+			 *
+			 */
+			INLINE void* Allocate(usize Size, usize Alignment = 16) { return GetCurrent().AllocateAligned(Size, Alignment); }
+
+			/*
+			 * @brief This method returns the frame allocator shared by the whole engine. It is
+			 * intentionally never destroyed, like the shared object pools.
+			 *
+			 */
+			static FrameAllocator& Shared();
+
+		private:
+			FrameArena _arenas[FRAME_ARENA_COUNT];
+			boost::atomic<usize> _current;
+		};
+
+		/*
+		 * @brief This class adapts a frame arena to the allocator interface of the standard
+		 * and boost containers. A container must not be used once the arena it was created
+		 * with has been reset, and freeing its memory does nothing.
+		 *
+		 */
+		template <typename Type>
+		class FrameAllocatorAdapter
+		{
+		public:
+			typedef Type value_type;
+			typedef Type* pointer;
+			typedef const Type* const_pointer;
+			typedef Type& reference;
+			typedef const Type& const_reference;
+			typedef usize size_type;
+			typedef std::ptrdiff_t difference_type;
+
+			// A container assigned from one built in another arena takes that arena along.
+			typedef std::true_type propagate_on_container_copy_assignment;
+			typedef std::true_type propagate_on_container_move_assignment;
+			typedef std::true_type propagate_on_container_swap;
+
+			template <typename Other>
+			struct rebind
+			{
+				typedef FrameAllocatorAdapter<Other> other;
+			};
+
+			/*
+			 * @brief This constructor binds the adapter to the arena of the current frame.
+			 *
+			 */
+			FrameAllocatorAdapter()
+				: _arena(&FrameAllocator::Shared().GetCurrent()) {}
+
+			/*
+			 * @brief This constructor binds the adapter to the given arena.
+			 *
+			 */
+			explicit FrameAllocatorAdapter(FrameArena& InArena)
+				: _arena(&InArena) {}
+
+			template <typename Other>
+			FrameAllocatorAdapter(const FrameAllocatorAdapter<Other>& InOther)
+				: _arena(InOther.GetArena()) {}
+
+			Type* allocate(usize InCount)
+			{
+				return static_cast<Type*>(_arena->AllocateAligned(InCount * sizeof(Type), alignof(Type) > 16 ? alignof(Type) : 16));
+			}
+
+			void deallocate(Type* InAddress, usize InCount) {}
+
+			INLINE FrameArena* GetArena() const { return _arena; }
+
+		private:
+			FrameArena* _arena;
+		};
+
+		template <typename Type, typename Other>
+		INLINE bool operator==(const FrameAllocatorAdapter<Type>& InLeft, const FrameAllocatorAdapter<Other>& InRight)
+		{
+			return InLeft.GetArena() == InRight.GetArena();
+		}
+
+		template <typename Type, typename Other>
+		INLINE bool operator!=(const FrameAllocatorAdapter<Type>& InLeft, const FrameAllocatorAdapter<Other>& InRight)
+		{
+			return InLeft.GetArena() != InRight.GetArena();
+		}
+
+		/*
+		 * @brief This type is a vector whose storage lives in a frame arena.
+		 *
+		 */
+		template <typename Type>
+		using FrameVector = boost::container::vector<Type, FrameAllocatorAdapter<Type>>;
+	}
+}
@@ -4,91 +4,432 @@
  * This source file defines the functions and methods relative to the Memory subsystem
  * described in the Memory.hpp header file.
  *
+ * The primitives dispatch at runtime to SSE2 or AVX2 kernels, depending on what the
+ * processor supports, unless SetKernelLevel picks a level. Regions shorter than a vector are handled by loading every byte
+ * before storing any of them, which also makes them safe for overlapping moves.
+ *
  * Copyright (c) Giovanni Giacomo. All Rights Reserved.
  *
  */
 
 #include "Memory.hpp"
+#include "Platform/CPU.hpp"
+
+#include <boost/atomic.hpp>
 
-#define lmask (sizeof(long) - 1)
+#include <cstring>
+#include <immintrin.h>
 
 namespace Re {
 	namespace Memory {
-		bool MEMCALL Compare(const void* left, const void* right, u32 size) {
-			bool res = true;
+		namespace {
+			typedef void (*CopyFunction)(u8* d, const u8* s, usize size);
+			typedef void (*SetFunction)(u8* d, u8 value, usize size);
+			typedef bool (*CompareFunction)(const u8* l, const u8* r, usize size);
+
+			/* Scalar Kernels */
+
+			FORCEINLINE void CopySmall(u8* d, const u8* s, usize size) {
+				// Copies 0 to 15 bytes with two possibly overlapping loads and stores.
+				if (size >= 8) {
+					u64 head, tail;
+					std::memcpy(&head, s, 8);
+					std::memcpy(&tail, s + size - 8, 8);
+					std::memcpy(d, &head, 8);
+					std::memcpy(d + size - 8, &tail, 8);
+				} else if (size >= 4) {
+					u32 head, tail;
+					std::memcpy(&head, s, 4);
+					std::memcpy(&tail, s + size - 4, 4);
+					std::memcpy(d, &head, 4);
+					std::memcpy(d + size - 4, &tail, 4);
+				} else if (size >= 2) {
+					u16 head, tail;
+					std::memcpy(&head, s, 2);
+					std::memcpy(&tail, s + size - 2, 2);
+					std::memcpy(d, &head, 2);
+					std::memcpy(d + size - 2, &tail, 2);
+				} else if (size == 1) {
+					*d = *s;
+				}
+			}
+
+			FORCEINLINE void SetSmall(u8* d, u8 value, usize size) {
+				u64 pattern = 0x0101010101010101ull * value;
+
+				if (size >= 8) {
+					std::memcpy(d, &pattern, 8);
+					std::memcpy(d + size - 8, &pattern, 8);
+				} else if (size >= 4) {
+					std::memcpy(d, &pattern, 4);
+					std::memcpy(d + size - 4, &pattern, 4);
+				} else if (size >= 2) {
+					std::memcpy(d, &pattern, 2);
+					std::memcpy(d + size - 2, &pattern, 2);
+				} else if (size == 1) {
+					*d = value;
+				}
+			}
+
+			FORCEINLINE bool CompareSmall(const u8* l, const u8* r, usize size) {
+				if (size >= 8) {
+					u64 a, b, c, e;
+					std::memcpy(&a, l, 8);
+					std::memcpy(&b, r, 8);
+					std::memcpy(&c, l + size - 8, 8);
+					std::memcpy(&e, r + size - 8, 8);
+					return ((a ^ b) | (c ^ e)) == 0;
+				}
+
+				for (usize i = 0; i < size; i++)
+					if (l[i] != r[i])
+						return false;
+
+				return true;
+			}
+
+			/* SSE2 Kernels */
+
+			void CopyForwardSSE2(u8* d, const u8* s, usize size) {
+				// Load the head and tail first and store them last, so the kernel is also valid for moves
+				// to lower addresses, while the loop in between stores to aligned destination addresses.
+				__m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+				__m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + size - 16));
+				usize i = 16 - (reinterpret_cast<usize>(d) & 15);
+
+				for (; i + 64 <= size; i += 64) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16));
+					__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 32));
+					__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 48));
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i), a);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 16), b);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 32), c);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 48), e);
+				}
+
+				for (; i + 16 <= size; i += 16)
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d), head);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d + size - 16), tail);
+			}
+
+			void CopyBackwardSSE2(u8* d, const u8* s, usize size) {
+				// Load the head first, so the kernel is valid for moves to higher addresses.
+				__m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+				usize i = size;
+
+				for (; i >= 64; i -= 64) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 16));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 32));
+					__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 48));
+					__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 64));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i - 16), a);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i - 32), b);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i - 48), c);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i - 64), e);
+				}
+
+				for (; i >= 16; i -= 16)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i - 16), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i - 16)));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d), head);
+			}
+
+			void CopyNonTemporalSSE2(u8* d, const u8* s, usize size) {
+				// Store the unaligned head normally, then stream from the first aligned destination address.
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+				usize i = 16 - (reinterpret_cast<usize>(d) & 15);
+
+				for (; i + 64 <= size; i += 64) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16));
+					__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 32));
+					__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 48));
+					_mm_stream_si128(reinterpret_cast<__m128i*>(d + i), a);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 16), b);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 32), c);
+					_mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 48), e);
+				}
+
+				for (; i + 16 <= size; i += 16)
+					_mm_stream_si128(reinterpret_cast<__m128i*>(d + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+
+				// Make the streamed stores visible before any later store.
+				_mm_sfence();
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d + size - 16), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + size - 16)));
+			}
+
+			void SetSSE2(u8* d, u8 value, usize size) {
+				__m128i pattern = _mm_set1_epi8(static_cast<char>(value));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d), pattern);
+				usize i = 16 - (reinterpret_cast<usize>(d) & 15);
+
+				for (; i + 64 <= size; i += 64) {
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i), pattern);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 16), pattern);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 32), pattern);
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i + 48), pattern);
+				}
+
+				for (; i + 16 <= size; i += 16)
+					_mm_store_si128(reinterpret_cast<__m128i*>(d + i), pattern);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d + size - 16), pattern);
+			}
+
+			bool CompareSSE2(const u8* l, const u8* r, usize size) {
+				usize i = 0;
+
+				for (; i + 32 <= size; i += 32) {
+					__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i)));
+					__m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i + 16)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i + 16)));
+					if (_mm_movemask_epi8(_mm_and_si128(a, b)) != 0xFFFF)
+						return false;
+				}
+
+				for (; i + 16 <= size; i += 16) {
+					__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i)));
+					if (_mm_movemask_epi8(a) != 0xFFFF)
+						return false;
+				}
+
+				__m128i tail = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(l + size - 16)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + size - 16)));
+				return _mm_movemask_epi8(tail) == 0xFFFF;
+			}
+
+			/* AVX2 Kernels */
+
+			TARGET_AVX2 void CopyForwardAVX2(u8* d, const u8* s, usize size) {
+				if (size < 32) {
+					CopyForwardSSE2(d, s, size);
+					return;
+				}
+
+				__m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+				__m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + size - 32));
+				usize i = 32 - (reinterpret_cast<usize>(d) & 31);
+
+				for (; i + 128 <= size; i += 128) {
+					__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+					__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 32));
+					__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 64));
+					__m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 96));
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i), a);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 32), b);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 64), c);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 96), e);
+				}
+
+				for (; i + 32 <= size; i += 32)
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d), head);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + size - 32), tail);
+			}
+
+			TARGET_AVX2 void CopyBackwardAVX2(u8* d, const u8* s, usize size) {
+				if (size < 32) {
+					CopyBackwardSSE2(d, s, size);
+					return;
+				}
+
+				__m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+				usize i = size;
+
+				for (; i >= 128; i -= 128) {
+					__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 32));
+					__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 64));
+					__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 96));
+					__m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 128));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i - 32), a);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i - 64), b);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i - 96), c);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i - 128), e);
+				}
 
-			// Read Memory as Bytes
-			const u8* l = reinterpret_cast<const u8*>(left);
-			const u8* r = reinterpret_cast<const u8*>(right);
+				for (; i >= 32; i -= 32)
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i - 32), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i - 32)));
 
-			for (u32 i = 0; i < size; i++)
-				res = l[i] == r[i] ? res : false;
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d), head);
+			}
+
+			TARGET_AVX2 void CopyNonTemporalAVX2(u8* d, const u8* s, usize size) {
+				if (size < 64) {
+					CopyForwardAVX2(d, s, size);
+					return;
+				}
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)));
+				usize i = 32 - (reinterpret_cast<usize>(d) & 31);
+
+				for (; i + 128 <= size; i += 128) {
+					__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+					__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 32));
+					__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 64));
+					__m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 96));
+					_mm256_stream_si256(reinterpret_cast<__m256i*>(d + i), a);
+					_mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 32), b);
+					_mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 64), c);
+					_mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 96), e);
+				}
+
+				for (; i + 32 <= size; i += 32)
+					_mm256_stream_si256(reinterpret_cast<__m256i*>(d + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+
+				_mm_sfence();
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + size - 32), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + size - 32)));
+			}
+
+			TARGET_AVX2 void SetAVX2(u8* d, u8 value, usize size) {
+				if (size < 32) {
+					SetSSE2(d, value, size);
+					return;
+				}
+
+				__m256i pattern = _mm256_set1_epi8(static_cast<char>(value));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d), pattern);
+				usize i = 32 - (reinterpret_cast<usize>(d) & 31);
+
+				for (; i + 128 <= size; i += 128) {
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i), pattern);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 32), pattern);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 64), pattern);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 96), pattern);
+				}
+
+				for (; i + 32 <= size; i += 32)
+					_mm256_store_si256(reinterpret_cast<__m256i*>(d + i), pattern);
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + size - 32), pattern);
+			}
+
+			TARGET_AVX2 bool CompareAVX2(const u8* l, const u8* r, usize size) {
+				if (size < 32)
+					return CompareSSE2(l, r, size);
+
+				usize i = 0;
+
+				for (; i + 64 <= size; i += 64) {
+					__m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i)));
+					__m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i + 32)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i + 32)));
+					if (_mm256_movemask_epi8(_mm256_and_si256(a, b)) != -1)
+						return false;
+				}
+
+				for (; i + 32 <= size; i += 32) {
+					__m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + i)));
+					if (_mm256_movemask_epi8(a) != -1)
+						return false;
+				}
+
+				__m256i tail = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(l + size - 32)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + size - 32)));
+				return _mm256_movemask_epi8(tail) == -1;
+			}
+
+			/* Runtime Dispatch */
+
+			struct Kernels {
+				CopyFunction CopyForward;
+				CopyFunction CopyBackward;
+				CopyFunction CopyNonTemporal;
+				SetFunction Set;
+				CompareFunction Compare;
+			};
+
+			const Kernels SSE2_KERNELS = { CopyForwardSSE2, CopyBackwardSSE2, CopyNonTemporalSSE2, SetSSE2, CompareSSE2 };
+			const Kernels AVX2_KERNELS = { CopyForwardAVX2, CopyBackwardAVX2, CopyNonTemporalAVX2, SetAVX2, CompareAVX2 };
+
+			// Chosen on first use rather than during static initialization, which may already call the primitives.
+			boost::atomic<const Kernels*> selectedKernels(nullptr);
+
+			FORCEINLINE const Kernels* GetSupportedKernels(KernelLevel level) {
+				return level == KernelLevel::AVX2 && Platform::GetCPUFeatures().AVX2 ? &AVX2_KERNELS : &SSE2_KERNELS;
+			}
+
+			FORCEINLINE const Kernels& GetKernels() {
+				const Kernels* kernels = selectedKernels.load(boost::memory_order_relaxed);
+				if (!kernels) {
+					kernels = GetSupportedKernels(KernelLevel::AVX2);
+					selectedKernels.store(kernels, boost::memory_order_relaxed);
+				}
+
+				return *kernels;
+			}
+		}
+
+		KernelLevel SetKernelLevel(KernelLevel level) {
+			selectedKernels.store(GetSupportedKernels(level), boost::memory_order_relaxed);
+			return GetKernelLevel();
+		}
+
+		KernelLevel GetKernelLevel() {
+			return &GetKernels() == &AVX2_KERNELS ? KernelLevel::AVX2 : KernelLevel::SSE2;
+		}
 
-			return res;
+		bool MEMCALL Compare(const void* left, const void* right, usize size) {
+			const u8* l = static_cast<const u8*>(left);
+			const u8* r = static_cast<const u8*>(right);
+
+			if (l == r)
+				return true;
+			if (size < 16)
+				return CompareSmall(l, r, size);
+
+			return GetKernels().Compare(l, r, size);
 		}
 
 		void MEMCALL Copy(void* destination, const void* source, usize size) {
 			const u8* s = static_cast<const u8*>(source);
 			u8* d = static_cast<u8*>(destination);
-			i32 len;
 
 			if (size == 0 || destination == source)
 				return;
 
-			if (((long)d | (long)s) & lmask) {
-				if ((((long)d ^ (long)s) & lmask) || (size < sizeof(long)))
-					len = size;
-				else
-					len = sizeof(long) - ((long)d & lmask);
-
-				size -= len;
-				for (; len > 0; len--)
-					*d++ = *s++;
-			}
+			if (size < 16)
+				CopySmall(d, s, size);
+			else if (size >= NON_TEMPORAL_THRESHOLD)
+				GetKernels().CopyNonTemporal(d, s, size);
+			else
+				GetKernels().CopyForward(d, s, size);
+		}
 
-			for (len = size / sizeof(long); len > 0; len--) {
-				*(long*)d = *(long*)s;
-				d += sizeof(long);
-				s += sizeof(long);
-			}
+		void MEMCALL CopyNonTemporal(void* destination, const void* source, usize size) {
+			const u8* s = static_cast<const u8*>(source);
+			u8* d = static_cast<u8*>(destination);
 
-			for (len = size & lmask; len > 0; len--)
-				*d++ = *s++;
-				
-			// Read Memory as Bytes
-			/*const u8* src = reinterpret_cast<const u8*>(source);
-			u8* dst = reinterpret_cast<u8*>(destination);
+			if (size == 0 || destination == source)
+				return;
 
-			for (u32 i = 0; i < size; i++)
-				dst[i] = src[i];
-			*/
+			if (size < 16)
+				CopySmall(d, s, size);
+			else
+				GetKernels().CopyNonTemporal(d, s, size);
 		}
 
-		void MEMCALL Move(void* destination, void* source, usize size) {
-			// Read Memory as Bytes
-			u8* src = static_cast<u8*>(source);
-			u8* dst = static_cast<u8*>(destination);
+		void MEMCALL Move(void* destination, const void* source, usize size) {
+			const u8* s = static_cast<const u8*>(source);
+			u8* d = static_cast<u8*>(destination);
 
-			if (src == dst) {
-				// If Already Equal
+			if (size == 0 || d == s)
 				return;
-			} else if (src < dst) {
-				// Copy From Back
-				for (src = src + size - 1, dst = dst + size - 1; size > 0; size--)
-					*dst-- = *src--;
-			} else {
-				// Copy From Front
-				for (; size > 0; size--)
-					*dst++ = *src++;
-			}
+
+			if (size < 16)
+				CopySmall(d, s, size);
+			else if (d < s || d >= s + size)
+				GetKernels().CopyForward(d, s, size);
+			else
+				GetKernels().CopyBackward(d, s, size);
 		}
 
-		void MEMCALL Set(void* destination, u8 value, u32 size) {
-			// Read Memory as Bytes
-			u8* dst = reinterpret_cast<u8*>(destination);
+		void MEMCALL Set(void* destination, u8 value, usize size) {
+			u8* d = static_cast<u8*>(destination);
 
-			for (u32 i = 0; i < size; i++)
-				dst[i] = value;
+			if (size < 16)
+				SetSmall(d, value, size);
+			else
+				GetKernels().Set(d, value, size);
 		}
 	}
 }
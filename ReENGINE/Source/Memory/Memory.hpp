@@ -13,44 +13,96 @@ namespace Re
 {
 	namespace Memory 
 	{
+		/*
+		 * @brief The size, in bytes, from which Copy bypasses the caches with non-temporal stores, since
+		 * a copy this large would evict most of the cache anyway.
+		 *
+		 */
+		const usize NON_TEMPORAL_THRESHOLD = 2 * 1024 * 1024;
+
+		/*
+		 * @brief This enumeration lists the instruction sets the primitives have kernels for.
+		 *
+		 */
+		enum class KernelLevel : u8
+		{
+			SSE2,
+			AVX2
+		};
+
+		/*
+		 * @brief This function selects the kernels the primitives dispatch to, which otherwise are
+		 * the best ones the processor supports. A level the processor doesn't support is lowered to
+		 * one it does. It is meant for validations that must exercise every kernel, and must not run
+		 * concurrently with the primitives.
+		 *
+		 * @param KernelLevel level: the instruction set to dispatch to.
+		 *
+		 * @return: the level actually selected.
+		 *
+		 */
+		extern KernelLevel SetKernelLevel(KernelLevel level);
+
+		/*
+		 * @brief This function returns the instruction set the primitives currently dispatch to.
+		 *
+		 * @return: the selected level.
+		 *
+		 */
+		extern KernelLevel GetKernelLevel();
+
 		/*
 		 * @brief This function compares whether two memory regions are equal, given their
-		 * size and pointers to their initial addressess.
+		 * size and pointers to their initial addressess. It returns at the first differing block.
 		 *
 		 * @param const void* left: the pointer to the left-hand side of the comparison.
 		 * @param const void* right: the pointer to the right-hand side of the comparison.
-		 * @param u32 size: the size of the memory region to cover.
+		 * @param usize size: the size of the memory region to cover.
 		 *
-		 * @return: nothing.
+		 * @return: true if the regions are equal, false otherwise.
 		 *
 		 */
-		extern bool MEMCALL Compare(const void* left, const void* right, u32 size);
+		extern bool MEMCALL Compare(const void* left, const void* right, usize size);
 
 		/*
 		 * @brief This function copies the contents of a region in memory to another region
-		 * in memory, given pointers to those regions and their size.
+		 * in memory, given pointers to those regions and their size. The regions must not overlap.
 		 *
 		 * @param void* destination: the pointer to the destination location.
 		 * @param const void* source: the pointer to the source location.
-		 * @param u32 size: the amount of memory to copy.
+		 * @param usize size: the amount of memory to copy.
 		 *
 		 * @return: nothing.
 		 *
 		 */
 		extern void MEMCALL Copy(void* destination, const void* source, usize size);
 
+		/*
+		 * @brief This function copies the contents of a region in memory to another region in
+		 * memory with non-temporal stores, which bypass the caches. It is meant for destinations
+		 * the CPU will not read back, such as mapped GPU staging memory. The regions must not overlap.
+		 *
+		 * @param void* destination: the pointer to the destination location.
+		 * @param const void* source: the pointer to the source location.
+		 * @param usize size: the amount of memory to copy.
+		 *
+		 * @return: nothing.
+		 *
+		 */
+		extern void MEMCALL CopyNonTemporal(void* destination, const void* source, usize size);
+
 		/*
 		 * @brief This function moves contents from a region in memory to another region
-		 * in memory, given pointers to the regions and the size.
+		 * in memory, given pointers to the regions and the size. The regions may overlap.
 		 *
 		 * @param void* destination: the pointer to the destination location.
-		 * @param void* source: the pointer to the source location.
-		 * @param u32 size: the amount of memory to move.
+		 * @param const void* source: the pointer to the source location.
+		 * @param usize size: the amount of memory to move.
 		 *
 		 * @return: nothing.
 		 *
 		 */
-		extern void MEMCALL Move(void* destination, void* source, usize size);
+		extern void MEMCALL Move(void* destination, const void* source, usize size);
 
 		/*
 		 * @brief This function sets the contents from a region in memory to a specified
@@ -58,11 +110,11 @@ namespace Re
 		 *
 		 * @param void* destination: the pointer to the destination location.
 		 * @param u8 value: the value to fill the region with.
-		 * @param u32 size: the amount of memory to set.
+		 * @param usize size: the amount of memory to set.
 		 *
 		 * @return: nothing.
 		 *
 		 */
-		extern void MEMCALL Set(void* destination, u8 value, u32 size);
+		extern void MEMCALL Set(void* destination, u8 value, usize size);
 	}
 }
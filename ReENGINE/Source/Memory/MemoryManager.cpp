@@ -10,14 +10,318 @@
 
 #include "MemoryManager.hpp"
 
+#include <boost/atomic.hpp>
+#include <immintrin.h>
+#include <algorithm>
+#include <new>
+
 namespace Re {
 	namespace Memory {
+		namespace {
+			const usize CALL_SITE_REPORT = 16;
+
+			/*
+			 * @brief This structure holds the shared counters of a tag. Only the live bytes
+			 * are needed right away, for the peak and the budget, so they are the only counter
+			 * every thread updates. Tags take a cache line each, so they don't contend.
+			 *
+			 */
+			struct alignas(64) TagCounters {
+				boost::atomic<usize> LiveBytes;
+				boost::atomic<usize> PeakBytes;
+				boost::atomic<usize> Budget;
+				boost::atomic<bool> Enforce;
+				boost::atomic<u64> BudgetOverruns;
+			};
+
+			/*
+			 * @brief This structure holds the counters of every tag that only ever grow, kept
+			 * by each thread for itself and summed when read. They are never released, so the
+			 * counts of threads that have exited remain in the totals.
+			 *
+			 */
+			struct ThreadCounters {
+				boost::atomic<u64> TotalBytes[MEMORY_TAG_COUNT];
+				boost::atomic<u64> TotalCount[MEMORY_TAG_COUNT];
+				boost::atomic<u64> FreedCount[MEMORY_TAG_COUNT];
+				ThreadCounters* Next;
+			};
+
+			struct CallSiteCounters {
+				const utf8* File;
+				u32 Line;
+				MemoryTag Tag;
+				boost::atomic<usize> LiveBytes;
+				boost::atomic<usize> LiveCount;
+				boost::atomic<u64> TotalCount;
+			};
+
+			// Zero initialized before any constructor runs, so allocations made during static
+			// initialization are accounted as well.
+			TagCounters tagCounters[MEMORY_TAG_COUNT];
+
+			CallSiteCounters callSites[MemoryManager::MAX_CALL_SITES];
+			boost::atomic_flag callSiteLock;
+			boost::atomic<bool> callSiteCapture;
+
+			boost::atomic<u8> heap;
+
+			boost::atomic<ThreadCounters*> threadCountersList;
+			thread_local ThreadCounters* threadCounters;
+
+			ThreadCounters& GetThreadCounters() {
+				if (threadCounters)
+					return *threadCounters;
+
+				// Value initialized, so every counter starts at zero.
+				ThreadCounters* counters = new ThreadCounters();
+				ThreadCounters* head = threadCountersList.load(boost::memory_order_relaxed);
+				do {
+					counters->Next = head;
+				} while (!threadCountersList.compare_exchange_weak(head, counters, boost::memory_order_release, boost::memory_order_relaxed));
+
+				threadCounters = counters;
+				return *counters;
+			}
+
+			// Only the owning thread writes its counters, so a plain increment is enough.
+			FORCEINLINE void Increment(boost::atomic<u64>& InCounter, u64 InValue) {
+				InCounter.store(InCounter.load(boost::memory_order_relaxed) + InValue, boost::memory_order_relaxed);
+			}
+
+			FORCEINLINE TagCounters& GetCounters(MemoryTag InTag) {
+				ASSERT(static_cast<usize>(InTag) < MEMORY_TAG_COUNT);
+				return tagCounters[static_cast<usize>(InTag)];
+			}
+
+			u32 FindCallSite(MemoryTag InTag, const utf8* InFile, u32 InLine) {
+				while (callSiteLock.test_and_set(boost::memory_order_acquire))
+					_mm_pause();
+
+				// Open addressing on the address of the file name, which is a static string.
+				usize hash = (reinterpret_cast<usize>(InFile) >> 3) * 31 + InLine * 17 + static_cast<usize>(InTag);
+				u32 site = MemoryManager::NO_CALL_SITE;
+				for (usize i = 0; i < MemoryManager::MAX_CALL_SITES; i++) {
+					usize index = (hash + i) % MemoryManager::MAX_CALL_SITES;
+					CallSiteCounters& entry = callSites[index];
+					if (!entry.File) {
+						entry.File = InFile;
+						entry.Line = InLine;
+						entry.Tag = InTag;
+						site = static_cast<u32>(index);
+						break;
+					}
+
+					if (entry.File == InFile && entry.Line == InLine && entry.Tag == InTag) {
+						site = static_cast<u32>(index);
+						break;
+					}
+				}
+
+				callSiteLock.clear(boost::memory_order_release);
+				return site;
+			}
+		}
+
+		const u32 MemoryManager::NO_CALL_SITE;
+		const usize MemoryManager::MAX_CALL_SITES;
+
 		NRESULT MemoryManager::StartUp() {
+			ResetPeaks();
 			return NSUCCESS;
 		}
-			
+
 		NRESULT MemoryManager::ShutDown() {
+			// Whatever is still live at this point is either leaked or owned by a static object.
+			Report();
 			return NSUCCESS;
 		}
+
+		TrackingAllocator& MemoryManager::GetAllocator(MemoryTag InTag) {
+			ASSERT(static_cast<usize>(InTag) < MEMORY_TAG_COUNT);
+
+			// Intentionally never destroyed, so memory can be freed during static destruction.
+			static TrackingAllocator* allocators = [] {
+				TrackingAllocator* result = static_cast<TrackingAllocator*>(::operator new(sizeof(TrackingAllocator) * MEMORY_TAG_COUNT));
+				for (usize i = 0; i < MEMORY_TAG_COUNT; i++)
+					new (&result[i]) TrackingAllocator(static_cast<MemoryTag>(i));
+
+				return result;
+			}();
+
+			return allocators[static_cast<usize>(InTag)];
+		}
+
+		void MemoryManager::SetHeap(HeapType InHeap) {
+			heap.store(static_cast<u8>(InHeap), boost::memory_order_relaxed);
+		}
+
+		HeapType MemoryManager::GetHeap() {
+			return static_cast<HeapType>(heap.load(boost::memory_order_relaxed));
+		}
+
+		FrameAllocator& MemoryManager::GetFrameAllocator() {
+			return FrameAllocator::Shared();
+		}
+
+		MemoryStats MemoryManager::GetStats(MemoryTag InTag) {
+			TagCounters& counters = GetCounters(InTag);
+
+			usize tag = static_cast<usize>(InTag);
+
+			MemoryStats stats;
+			stats.LiveBytes = counters.LiveBytes.load(boost::memory_order_relaxed);
+			stats.PeakBytes = counters.PeakBytes.load(boost::memory_order_relaxed);
+			stats.TotalBytes = 0;
+			stats.TotalCount = 0;
+
+			u64 freed = 0;
+			for (ThreadCounters* thread = threadCountersList.load(boost::memory_order_acquire); thread; thread = thread->Next) {
+				stats.TotalBytes += thread->TotalBytes[tag].load(boost::memory_order_relaxed);
+				stats.TotalCount += thread->TotalCount[tag].load(boost::memory_order_relaxed);
+				freed += thread->FreedCount[tag].load(boost::memory_order_relaxed);
+			}
+
+			stats.LiveCount = static_cast<usize>(stats.TotalCount - freed);
+			stats.Budget = counters.Budget.load(boost::memory_order_relaxed);
+			stats.BudgetOverruns = counters.BudgetOverruns.load(boost::memory_order_relaxed);
+			return stats;
+		}
+
+		void MemoryManager::SetBudget(MemoryTag InTag, usize InBytes, bool InEnforce) {
+			TagCounters& counters = GetCounters(InTag);
+			counters.Budget.store(InBytes, boost::memory_order_relaxed);
+			counters.Enforce.store(InEnforce, boost::memory_order_relaxed);
+		}
+
+		void MemoryManager::ResetPeaks() {
+			for (usize i = 0; i < MEMORY_TAG_COUNT; i++)
+				tagCounters[i].PeakBytes.store(tagCounters[i].LiveBytes.load(boost::memory_order_relaxed), boost::memory_order_relaxed);
+		}
+
+		void MemoryManager::SetCallSiteCapture(bool InEnabled) {
+			callSiteCapture.store(InEnabled, boost::memory_order_relaxed);
+		}
+
+		bool MemoryManager::IsCallSiteCaptureEnabled() {
+			return callSiteCapture.load(boost::memory_order_relaxed);
+		}
+
+		usize MemoryManager::GetCallSites(MemoryCallSite* OutSites, usize InMaxSites) {
+			while (callSiteLock.test_and_set(boost::memory_order_acquire))
+				_mm_pause();
+
+			usize count = 0;
+			for (usize i = 0; i < MAX_CALL_SITES && count < InMaxSites; i++) {
+				const CallSiteCounters& entry = callSites[i];
+				if (!entry.File)
+					continue;
+
+				MemoryCallSite& site = OutSites[count++];
+				site.File = entry.File;
+				site.Line = entry.Line;
+				site.Tag = entry.Tag;
+				site.LiveBytes = entry.LiveBytes.load(boost::memory_order_relaxed);
+				site.LiveCount = entry.LiveCount.load(boost::memory_order_relaxed);
+				site.TotalCount = entry.TotalCount.load(boost::memory_order_relaxed);
+			}
+
+			callSiteLock.clear(boost::memory_order_release);
+			return count;
+		}
+
+		void MemoryManager::Report() {
+			Core::Debug::Log(NTEXT("Memory report:\n"));
+			Core::Debug::Log(NTEXT("  %-10s %14s %14s %16s %10s %12s %14s\n"), "Tag", "Live", "Peak", "Total", "Count", "Allocations", "Budget");
+
+			for (usize i = 0; i < MEMORY_TAG_COUNT; i++) {
+				MemoryStats stats = GetStats(static_cast<MemoryTag>(i));
+				Core::Debug::Log(NTEXT("  %-10s %14zu %14zu %16llu %10zu %12llu %14zu%s\n"), GetMemoryTagName(static_cast<MemoryTag>(i)),
+					stats.LiveBytes, stats.PeakBytes, static_cast<unsigned long long>(stats.TotalBytes), stats.LiveCount,
+					static_cast<unsigned long long>(stats.TotalCount), stats.Budget, stats.BudgetOverruns ? " (over budget)" : "");
+			}
+
+			if (GetHeap() == HeapType::TLSF) {
+				TLSFStats stats = TLSFAllocator::Shared().GetStats();
+				Core::Debug::Log(NTEXT("  TLSF heap: %zu bytes in %zu pools, %zu used in %zu blocks, %zu free in %zu blocks (%.1f%% fragmented)\n"),
+					stats.Capacity, stats.PoolCount, stats.UsedBytes, stats.UsedBlocks, stats.FreeBytes, stats.FreeBlocks, stats.GetFragmentation() * 100.0f);
+			} else if (GetHeap() == HeapType::SmallObject) {
+				SmallObjectAllocator& allocator = SmallObjectAllocator::Shared();
+				Core::Debug::Log(NTEXT("  Small object heap: %zu spans, %zu free, across %zu thread heaps\n"),
+					allocator.GetSpanCount(), allocator.GetFreeSpanCount(), allocator.GetHeapCount());
+			}
+
+			FrameAllocations frame;
+			if (AllocationTracer::IsEnabled() && AllocationTracer::GetFrameHistory(&frame, 1) == 1) {
+				Core::Debug::Log(NTEXT("  Frame %llu: %llu heap allocations of %llu bytes, %llu pooled of %llu bytes\n"),
+					static_cast<unsigned long long>(frame.Frame), static_cast<unsigned long long>(frame.HeapCount), static_cast<unsigned long long>(frame.HeapBytes),
+					static_cast<unsigned long long>(frame.PooledCount), static_cast<unsigned long long>(frame.PooledBytes));
+			}
+
+			MemoryCallSite* sites = static_cast<MemoryCallSite*>(::operator new(sizeof(MemoryCallSite) * MAX_CALL_SITES));
+			usize count = GetCallSites(sites, MAX_CALL_SITES);
+			if (count > 0) {
+				std::sort(sites, sites + count, [](const MemoryCallSite& InLeft, const MemoryCallSite& InRight) {
+					return InLeft.LiveBytes > InRight.LiveBytes;
+				});
+
+				Core::Debug::Log(NTEXT("  Call sites holding the most live memory:\n"));
+				for (usize i = 0; i < count && i < CALL_SITE_REPORT; i++) {
+					Core::Debug::Log(NTEXT("  %14zu bytes in %8zu allocations (%s) at %s:%u\n"), sites[i].LiveBytes, sites[i].LiveCount,
+						GetMemoryTagName(sites[i].Tag), sites[i].File, sites[i].Line);
+				}
+			}
+
+			::operator delete(sites);
+		}
+
+		bool MemoryManager::TrackAllocation(MemoryTag InTag, usize InSize, const utf8* InFile, u32 InLine, u32* OutSite) {
+			TagCounters& counters = GetCounters(InTag);
+
+			usize live = counters.LiveBytes.fetch_add(InSize, boost::memory_order_relaxed) + InSize;
+			usize budget = counters.Budget.load(boost::memory_order_relaxed);
+			if (budget && live > budget) {
+				if (counters.BudgetOverruns.fetch_add(1, boost::memory_order_relaxed) == 0)
+					Core::Debug::Log(NTEXT("Memory budget of %s exceeded: %zu of %zu bytes.\n"), GetMemoryTagName(InTag), live, budget);
+
+				if (counters.Enforce.load(boost::memory_order_relaxed)) {
+					counters.LiveBytes.fetch_sub(InSize, boost::memory_order_relaxed);
+					return false;
+				}
+			}
+
+			usize peak = counters.PeakBytes.load(boost::memory_order_relaxed);
+			while (live > peak && !counters.PeakBytes.compare_exchange_weak(peak, live, boost::memory_order_relaxed));
+
+			ThreadCounters& thread = GetThreadCounters();
+			Increment(thread.TotalBytes[static_cast<usize>(InTag)], InSize);
+			Increment(thread.TotalCount[static_cast<usize>(InTag)], 1);
+
+			*OutSite = NO_CALL_SITE;
+			if (InFile && callSiteCapture.load(boost::memory_order_relaxed)) {
+				*OutSite = FindCallSite(InTag, InFile, InLine);
+				if (*OutSite != NO_CALL_SITE) {
+					CallSiteCounters& site = callSites[*OutSite];
+					site.LiveBytes.fetch_add(InSize, boost::memory_order_relaxed);
+					site.LiveCount.fetch_add(1, boost::memory_order_relaxed);
+					site.TotalCount.fetch_add(1, boost::memory_order_relaxed);
+				}
+			}
+
+			return true;
+		}
+
+		void MemoryManager::TrackFree(MemoryTag InTag, usize InSize, u32 InSite) {
+			TagCounters& counters = GetCounters(InTag);
+			counters.LiveBytes.fetch_sub(InSize, boost::memory_order_relaxed);
+			Increment(GetThreadCounters().FreedCount[static_cast<usize>(InTag)], 1);
+
+			if (InSite != NO_CALL_SITE) {
+				ASSERT(InSite < MAX_CALL_SITES);
+				CallSiteCounters& site = callSites[InSite];
+				site.LiveBytes.fetch_sub(InSize, boost::memory_order_relaxed);
+				site.LiveCount.fetch_sub(1, boost::memory_order_relaxed);
+			}
+		}
 	}
 }
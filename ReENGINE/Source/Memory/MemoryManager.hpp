@@ -13,21 +13,73 @@
 #include "Core/Manager.hpp"
 
 // Allocator Includes
+#include "Memory/AllocationTracer.hpp"
 #include "Memory/DefaultAllocator.hpp"
+#include "Memory/FrameAllocator.hpp"
+#include "Memory/MemoryTag.hpp"
+#include "Memory/SmallObjectAllocator.hpp"
 #include "Memory/StackAllocator.hpp"
+#include "Memory/TLSFAllocator.hpp"
+#include "Memory/TrackingAllocator.hpp"
+
+/*
+ * @brief These macros allocate and free memory accounted to a tag, recording the call site
+ * of the allocation when call site capture is enabled.
+ *
+ */
+#define TRACKED_ALLOCATE(Tag, Size) \
+		Re::Memory::MemoryManager::GetAllocator(Tag).AllocateAt(Size, 16, __FILE__, __LINE__)
+
+#define TRACKED_ALLOCATE_ALIGNED(Tag, Size, Alignment) \
+		Re::Memory::MemoryManager::GetAllocator(Tag).AllocateAt(Size, Alignment, __FILE__, __LINE__)
+
+#define TRACKED_FREE(Tag, Address) \
+		Re::Memory::MemoryManager::GetAllocator(Tag).Free(Address)
 
 namespace Re 
 {
 	namespace Memory 
 	{
+		/* 
+		 * @brief This enumeration lists the heaps the tracking allocators can take memory from.
+		 * The system heap has an unbounded worst case, while the TLSF heap allocates and frees
+		 * in constant time and keeps fragmentation in check over long sessions. The small object
+		 * heap gives every thread its own spans, so threads allocating at once don't contend.
+		 *
+		 */
+		enum class HeapType : u8
+		{
+			System,
+			TLSF,
+			SmallObject
+		};
+
 		/* 
 		 * @brief This class is responsible for managing memory throughout
 		 * the other ReENGINE's subsystems. 
 		 *
+		 * It owns the allocators of the engine and accounts every allocation made
+		 * through them to a tag, keeping live, peak and total statistics for each
+		 * subsystem so that budgets can be enforced and regressions tracked. The
+		 * statistics are kept from the first allocation, so memory allocated before
+		 * StartUp, such as by static objects, is accounted too.
+		 *
 		 */
 		class MemoryManager : public Core::Manager 
 		{
 		public:
+			/* 
+			 * @brief This constant holds the call site of allocations that were not captured.
+			 *
+			 */
+			static const u32 NO_CALL_SITE = 0xFFFFFFFF;
+
+			/* 
+			 * @brief This constant holds the number of distinct call sites that can be captured.
+			 *
+			 */
+			static const usize MAX_CALL_SITES = 1024;
+
 			/* 
 			 * @brief This constructor does nothing, since the method
 			 * StartUp is supposed to be used. 
@@ -54,11 +106,123 @@ namespace Re
 			/* 
 			 * @brief This method shuts down the Memory Management system,
 			 * releasing the memory of the global stack, among other things.
+			 * It reports the memory still live in every tag.
 			 *
 			 * @return NSUCCESS if successful, NFAILURE otherwise. 
 			 *
 			 */
 			NRESULT ShutDown() override;
+
+			/* 
+			 * @brief This method returns the allocator that accounts memory to the given tag.
+			 *
+			 * @param InTag: the tag of the subsystem that allocates.
+			 * @return the allocator of the tag, which lives as long as the program.
+			 *
+			 */
+			static TrackingAllocator& GetAllocator(MemoryTag InTag);
+
+			/* 
+			 * @brief This method selects the heap every tracking allocator takes memory from.
+			 * It may be changed at any time, since memory is always freed to the heap it came from.
+			 *
+			 * @param InHeap: the heap to allocate from.
+			 *
+			 */
+			static void SetHeap(HeapType InHeap);
+
+			/* 
+			 * @brief This method returns the heap the tracking allocators take memory from.
+			 *
+			 */
+			static HeapType GetHeap();
+
+			/* 
+			 * @brief This method returns the allocator of the transient, per-frame memory.
+			 *
+			 */
+			static FrameAllocator& GetFrameAllocator();
+
+			/* 
+			 * @brief This method returns a snapshot of the statistics of a tag.
+			 *
+			 * @param InTag: the tag to query.
+			 * @return the statistics of the tag.
+			 *
+			 */
+			static MemoryStats GetStats(MemoryTag InTag);
+
+			/* 
+			 * @brief This method sets the budget of a tag. Going over the budget is counted and
+			 * logged once, and refused outright if the budget is enforced.
+			 *
+			 * @param InTag: the tag to set the budget of.
+			 * @param InBytes: the budget, in live bytes, or zero to remove it.
+			 * @param InEnforce: whether allocations going over the budget should fail.
+			 *
+			 */
+			static void SetBudget(MemoryTag InTag, usize InBytes, bool InEnforce = false);
+
+			/* 
+			 * @brief This method resets the peak of every tag to its current live bytes.
+			 *
+			 */
+			static void ResetPeaks();
+
+			/* 
+			 * @brief This method enables or disables the capture of call sites. It costs a lock
+			 * per allocation while enabled, so it is meant for investigating regressions.
+			 *
+			 */
+			static void SetCallSiteCapture(bool InEnabled);
+
+			/* 
+			 * @brief This method returns whether call sites are being captured.
+			 *
+			 */
+			static bool IsCallSiteCaptureEnabled();
+
+			/* 
+			 * @brief This method copies a snapshot of the captured call sites.
+			 *
+			 * @param OutSites: the array to copy the call sites to.
+			 * @param InMaxSites: the number of entries in the array.
+			 * @return the number of call sites copied.
+			 *
+			 */
+			static usize GetCallSites(MemoryCallSite* OutSites, usize InMaxSites);
+
+			/* 
+			 * @brief This method logs the statistics of every tag, the state of the heap in
+			 * use, the allocations of the last frame when they are traced and, if any were
+			 * captured, the call sites holding the most live memory.
+			 *
+			 */
+			static void Report();
+
+			/* 
+			 * @brief This method accounts an allocation to a tag. It is called by the allocators
+			 * before they allocate, and fails if the tag's enforced budget would be exceeded.
+			 *
+			 * @param InTag: the tag of the allocation.
+			 * @param InSize: the size of the allocation, in bytes.
+			 * @param InFile: the file of the call site, or nullptr if unknown.
+			 * @param InLine: the line of the call site.
+			 * @param OutSite: the call site to pass back to TrackFree.
+			 * @return true if the allocation may proceed, false otherwise.
+			 *
+			 */
+			static bool TrackAllocation(MemoryTag InTag, usize InSize, const utf8* InFile, u32 InLine, u32* OutSite);
+
+			/* 
+			 * @brief This method accounts the release of an allocation to a tag.
+			 *
+			 * @param InTag: the tag of the allocation.
+			 * @param InSize: the size of the allocation, in bytes.
+			 * @param InSite: the call site returned by TrackAllocation.
+			 *
+			 */
+			static void TrackFree(MemoryTag InTag, usize InSize, u32 InSite);
 		};
 	}
 }
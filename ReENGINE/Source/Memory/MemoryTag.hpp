@@ -0,0 +1,91 @@
+/*
+ * MemoryTag.hpp
+ *
+ * This header file declares the tags used to attribute allocations to the
+ * subsystems of the ReENGINE, along with the statistics kept for each one.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Memory.hpp"
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This enumeration holds the subsystems memory is accounted to.
+		 *
+		 */
+		enum class MemoryTag : u8
+		{
+			General = 0,
+			Renderer = 1,
+			Assets = 2,
+			ECS = 3,
+			Strings = 4,
+			Frame = 5,
+			Count
+		};
+
+		/*
+		 * @brief This constant holds the number of memory tags.
+		 *
+		 */
+		const usize MEMORY_TAG_COUNT = static_cast<usize>(MemoryTag::Count);
+
+		/*
+		 * @brief This function returns the printable name of a memory tag.
+		 *
+		 * @param InTag: the tag to name.
+		 * @return a static string with the name of the tag.
+		 *
+		 */
+		INLINE const utf8* GetMemoryTagName(MemoryTag InTag)
+		{
+			switch (InTag)
+			{
+			case MemoryTag::General: return "General";
+			case MemoryTag::Renderer: return "Renderer";
+			case MemoryTag::Assets: return "Assets";
+			case MemoryTag::ECS: return "ECS";
+			case MemoryTag::Strings: return "Strings";
+			case MemoryTag::Frame: return "Frame";
+			default: return "Unknown";
+			}
+		}
+
+		/*
+		 * @brief This structure holds a snapshot of the statistics of a memory tag.
+		 *
+		 */
+		struct MemoryStats
+		{
+			usize LiveBytes;
+			usize PeakBytes;
+			u64 TotalBytes;
+			usize LiveCount;
+			u64 TotalCount;
+			usize Budget;
+			u64 BudgetOverruns;
+		};
+
+		/*
+		 * @brief This structure holds a snapshot of the allocations made from a single line
+		 * of code, recorded while call site capture is enabled.
+		 *
+		 */
+		struct MemoryCallSite
+		{
+			const utf8* File;
+			u32 Line;
+			MemoryTag Tag;
+			usize LiveBytes;
+			usize LiveCount;
+			u64 TotalCount;
+		};
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ * ObjectPool.hpp
+ *
+ * This header file declares the ObjectPool, a typed wrapper around the
+ * PoolAllocator which constructs and destroys objects in its blocks.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "PoolAllocator.hpp"
+
+#include <new>
+#include <utility>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class is responsible for creating and destroying objects of a single
+		 * type in a PoolAllocator, so that they are packed together in memory.
+		 *
+		 */
+		template <typename Type>
+		class ObjectPool
+		{
+		public:
+			/*
+			 * @brief This constructor sets up an empty pool for objects of Type.
+			 *
+			 * @param InObjectsPerChunk: the number of objects to allocate each time the pool grows.
+			 * @param InTag: the tag the pool's memory is accounted to.
+			 *
+			 */
+			explicit ObjectPool(usize InObjectsPerChunk = 64, MemoryTag InTag = MemoryTag::General)
+				: _allocator(sizeof(Type), InObjectsPerChunk, alignof(Type) > 16 ? alignof(Type) : 16, InTag) {}
+
+			/*
+			 * @brief This method allocates a block and constructs an object of Type in it.
+			 *
+			 * @param InArgs: the arguments forwarded to the constructor of Type.
+			 * @return a pointer to the new object, or nullptr if the pool could not grow.
+			 *
+			 */
+			template <typename... Args>
+			Type* Create(Args&&... InArgs)
+			{
+				void* memory = _allocator.Allocate(sizeof(Type));
+				if (!memory)
+					return nullptr;
+
+				return new (memory) Type(std::forward<Args>(InArgs)...);
+			}
+
+			/*
+			 * @brief This method destroys an object previously returned by Create and returns
+			 * its block to the pool.
+			 *
+			 * @param InObject: the object to destroy, or nullptr.
+			 *
+			 */
+			void Destroy(Type* InObject)
+			{
+				if (!InObject)
+					return;
+
+				InObject->~Type();
+				_allocator.Free(InObject);
+			}
+
+			/*
+			 * @brief This method returns the allocator backing the pool.
+			 *
+			 */
+			INLINE PoolAllocator& GetAllocator() { return _allocator; }
+
+			/*
+			 * @brief This method returns the pool shared by the whole engine for objects of Type.
+			 * It is intentionally never destroyed, so objects released during static destruction
+			 * still find it alive. The shared pools hold the entities and components, so their
+			 * memory is accounted to the ECS.
+			 *
+			 */
+			static ObjectPool& Shared()
+			{
+				static ObjectPool* pool = new ObjectPool(64, MemoryTag::ECS);
+				return *pool;
+			}
+
+		private:
+			PoolAllocator _allocator;
+		};
+	}
+}
@@ -0,0 +1,354 @@
+/*
+ * PoolAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * PoolAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "PoolAllocator.hpp"
+#include "AllocationTracer.hpp"
+#include "MemoryManager.hpp"
+
+#include <immintrin.h>
+#include <new>
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u8 FREED_PATTERN = 0xDD;
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. The critical
+			 * sections of the pool are a handful of pointer swaps, too short to sleep on.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+
+			/*
+			 * @brief This structure maps a pool to the calling thread's cache in that pool.
+			 * Pool identifiers are never reused, so an entry left behind by a destroyed pool
+			 * simply never matches again.
+			 *
+			 */
+			struct CacheSlot
+			{
+				u64 Pool;
+				void* Cache;
+			};
+
+			const usize CACHE_SLOTS = 16;
+			const usize CACHE_ALIGNMENT = 64;
+
+			/*
+			 * @brief These constants hold the states of a thread cache. A cache is active while
+			 * both its thread and its pool are alive, exiting while its thread returns its blocks,
+			 * and orphaned once its pool is destroyed, after which only its thread touches it.
+			 *
+			 */
+			const u8 CACHE_ACTIVE = 0;
+			const u8 CACHE_EXITING = 1;
+			const u8 CACHE_ORPHANED = 2;
+
+			boost::atomic<u64> nextPoolId(1);
+
+			thread_local CacheSlot cacheSlots[CACHE_SLOTS];
+		}
+
+		const u32 PoolAllocator::CACHE_BATCH;
+
+		thread_local PoolAllocator::OwnedCaches PoolAllocator::_ownedCaches;
+
+		PoolAllocator::OwnedCaches::~OwnedCaches()
+		{
+			ThreadCache* cache = Head;
+			while (cache)
+			{
+				// The pool waits for an exiting cache before it goes away, so it is safe to return the blocks.
+				ThreadCache* next = cache->NextOwned;
+				u8 state = CACHE_ACTIVE;
+				if (cache->State.compare_exchange_strong(state, CACHE_EXITING, boost::memory_order_acq_rel))
+					cache->Pool->DetachThreadCache(cache);
+
+				MemoryManager::GetAllocator(cache->Tag).FreeAligned(cache);
+				cache = next;
+			}
+		}
+
+		PoolAllocator::PoolAllocator(usize InBlockSize, usize InBlocksPerChunk, usize InAlignment, MemoryTag InTag)
+			: _blocksPerChunk(InBlocksPerChunk), _alignment(InAlignment), _tag(InTag), _freeList(nullptr), _chunks(nullptr), _chunkCount(0),
+			_id(nextPoolId.fetch_add(1, boost::memory_order_relaxed)), _threadCaches(nullptr)
+		{
+			ASSERT(InBlocksPerChunk > 0);
+			ASSERT(InAlignment >= 1 && (InAlignment & (InAlignment - 1)) == 0);
+
+			// Every block must be able to hold the free list link, and stay aligned when packed.
+			_alignment = _alignment < alignof(FreeBlock) ? alignof(FreeBlock) : _alignment;
+			_blockSize = AlignUp(InBlockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : InBlockSize, _alignment);
+			_chunkHeaderSize = AlignUp(sizeof(Chunk), _alignment);
+
+			_lock.clear();
+		}
+
+		PoolAllocator::~PoolAllocator()
+		{
+			// Leave the caches to their threads, waiting for the ones that are returning their blocks.
+			bool exiting = true;
+			while (exiting)
+			{
+				exiting = false;
+				{
+					SpinLockGuard guard(_lock);
+					for (ThreadCache* cache = _threadCaches; cache; cache = cache->Next)
+					{
+						u8 state = CACHE_ACTIVE;
+						if (!cache->State.compare_exchange_strong(state, CACHE_ORPHANED, boost::memory_order_acq_rel) && state == CACHE_EXITING)
+							exiting = true;
+					}
+				}
+
+				if (exiting)
+					_mm_pause();
+			}
+
+			TrackingAllocator& allocator = MemoryManager::GetAllocator(_tag);
+			while (_chunks)
+			{
+				Chunk* next = _chunks->Next;
+				allocator.FreeAligned(_chunks);
+				_chunks = next;
+			}
+		}
+
+		void* PoolAllocator::Allocate(usize Size)
+		{
+			ASSERT(Size <= _blockSize);
+
+			ThreadCache& cache = GetThreadCache();
+			if (cache.Head)
+			{
+				FreeBlock* block = cache.Head;
+				cache.Head = block->Next;
+				cache.Count--;
+				return AllocationTracer::TracePooled(block, Size);
+			}
+
+			// The cache is empty: refill it with a batch from the shared list, keeping the first block.
+			u32 count = 0;
+			FreeBlock* batch = AcquireBatch(&count);
+			if (!batch)
+				return nullptr;
+
+			if (count > 1)
+			{
+				cache.Head = batch->Next;
+				cache.Count = count - 1;
+			}
+
+			return AllocationTracer::TracePooled(batch, Size);
+		}
+
+		void* PoolAllocator::AllocateAligned(usize Size, usize Alignment)
+		{
+			ASSERT(Alignment <= _alignment);
+			return Allocate(Size);
+		}
+
+		void PoolAllocator::Free(void* Address)
+		{
+			if (!Address)
+				return;
+
+#if defined(ASSERTIONS)
+			Set(Address, FREED_PATTERN, _blockSize);
+#endif
+
+			FreeBlock* block = static_cast<FreeBlock*>(Address);
+			ThreadCache& cache = GetThreadCache();
+			block->Next = cache.Head;
+			cache.Head = block;
+
+			// Keep the cache bounded, so blocks freed on one thread flow back to the others.
+			if (++cache.Count < 2 * CACHE_BATCH)
+				return;
+
+			FreeBlock* head = cache.Head;
+			FreeBlock* tail = head;
+			for (u32 i = 1; i < CACHE_BATCH; i++)
+				tail = tail->Next;
+
+			cache.Head = tail->Next;
+			cache.Count -= CACHE_BATCH;
+			ReleaseBatch(head, tail);
+		}
+
+		void PoolAllocator::FreeAligned(void* Address)
+		{
+			Free(Address);
+		}
+
+		PoolAllocator::FreeBlock* PoolAllocator::AcquireBatch(u32* OutCount)
+		{
+			SpinLockGuard guard(_lock);
+
+			if (!_freeList && !Grow())
+				return nullptr;
+
+			FreeBlock* head = _freeList;
+			FreeBlock* tail = head;
+			u32 count = 1;
+			while (count < CACHE_BATCH && tail->Next)
+			{
+				tail = tail->Next;
+				count++;
+			}
+
+			_freeList = tail->Next;
+			tail->Next = nullptr;
+
+			*OutCount = count;
+			return head;
+		}
+
+		void PoolAllocator::ReleaseBatch(FreeBlock* InHead, FreeBlock* InTail)
+		{
+			SpinLockGuard guard(_lock);
+			InTail->Next = _freeList;
+			_freeList = InHead;
+		}
+
+		bool PoolAllocator::Grow()
+		{
+			TrackingAllocator& allocator = MemoryManager::GetAllocator(_tag);
+			u8* memory = static_cast<u8*>(allocator.AllocateAligned(_chunkHeaderSize + _blocksPerChunk * _blockSize, _alignment));
+			ASSERT(memory);
+			if (!memory)
+				return false;
+
+			Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+			chunk->Next = _chunks;
+			_chunks = chunk;
+			_chunkCount.fetch_add(1, boost::memory_order_relaxed);
+
+			// Link the blocks in address order, so consecutive allocations are adjacent in memory.
+			u8* blocks = memory + _chunkHeaderSize;
+			for (usize i = _blocksPerChunk; i > 0; i--)
+			{
+				FreeBlock* block = reinterpret_cast<FreeBlock*>(blocks + (i - 1) * _blockSize);
+				block->Next = _freeList;
+				_freeList = block;
+			}
+
+			return true;
+		}
+
+		PoolAllocator::ThreadCache& PoolAllocator::GetThreadCache()
+		{
+			CacheSlot& slot = cacheSlots[_id % CACHE_SLOTS];
+			if (slot.Pool == _id)
+				return *static_cast<ThreadCache*>(slot.Cache);
+
+			return AttachThreadCache();
+		}
+
+		PoolAllocator::ThreadCache& PoolAllocator::AttachThreadCache()
+		{
+			// The thread may already own a cache whose slot was taken by another pool. Caches
+			// left behind by destroyed pools are released on the way.
+			ThreadCache* cache = nullptr;
+			ThreadCache** link = &_ownedCaches.Head;
+			while (*link)
+			{
+				ThreadCache* owned = *link;
+				if (owned->PoolId == _id)
+				{
+					cache = owned;
+					break;
+				}
+
+				if (owned->State.load(boost::memory_order_acquire) == CACHE_ORPHANED)
+				{
+					*link = owned->NextOwned;
+					MemoryManager::GetAllocator(owned->Tag).FreeAligned(owned);
+					continue;
+				}
+
+				link = &owned->NextOwned;
+			}
+
+			if (!cache)
+			{
+				// Caches are aligned to cache lines, so threads never write to the same line.
+				TrackingAllocator& allocator = MemoryManager::GetAllocator(_tag);
+				void* memory = allocator.AllocateAligned(sizeof(ThreadCache) < CACHE_ALIGNMENT ? CACHE_ALIGNMENT : sizeof(ThreadCache), CACHE_ALIGNMENT);
+				ASSERT(memory);
+
+				cache = new (memory) ThreadCache();
+				cache->Head = nullptr;
+				cache->Count = 0;
+				cache->State.store(CACHE_ACTIVE, boost::memory_order_relaxed);
+				cache->Tag = _tag;
+				cache->PoolId = _id;
+				cache->Pool = this;
+				{
+					SpinLockGuard guard(_lock);
+					cache->Next = _threadCaches;
+					_threadCaches = cache;
+				}
+
+				cache->NextOwned = _ownedCaches.Head;
+				_ownedCaches.Head = cache;
+			}
+
+			CacheSlot& slot = cacheSlots[_id % CACHE_SLOTS];
+			slot.Pool = _id;
+			slot.Cache = cache;
+			return *cache;
+		}
+
+		void PoolAllocator::DetachThreadCache(ThreadCache* InCache)
+		{
+			SpinLockGuard guard(_lock);
+			if (InCache->Head)
+			{
+				FreeBlock* tail = InCache->Head;
+				while (tail->Next)
+					tail = tail->Next;
+
+				tail->Next = _freeList;
+				_freeList = InCache->Head;
+			}
+
+			ThreadCache** link = &_threadCaches;
+			while (*link != InCache)
+				link = &(*link)->Next;
+
+			*link = InCache->Next;
+		}
+	}
+}
@@ -0,0 +1,223 @@
+/*
+ * PoolAllocator.hpp
+ *
+ * This header file declares the PoolAllocator, which hands out blocks of a
+ * single fixed size in constant time from intrusive free lists, growing by
+ * whole chunks of blocks when it runs out.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+#include "MemoryTag.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class is responsible for allocating blocks of a fixed size, such as
+		 * objects of a single type, without going to the operating system on every call.
+		 *
+		 * Freed blocks are threaded into a free list through their own storage. Each thread
+		 * keeps a private cache of blocks in front of the shared free list, so allocating and
+		 * freeing take no lock and only touch the shared list once per batch of blocks. When
+		 * a thread exits, the blocks left in its cache go back to the shared free list.
+		 *
+		 */
+		class PoolAllocator : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the number of blocks moved at once between a thread's
+			 * cache and the shared free list.
+			 *
+			 */
+			static const u32 CACHE_BATCH = 32;
+
+			/*
+			 * @brief This constructor sets up an empty pool. No memory is allocated until the
+			 * first block is requested.
+			 *
+			 * @param InBlockSize: the size, in bytes, of every block.
+			 * @param InBlocksPerChunk: the number of blocks to allocate each time the pool grows.
+			 * @param InAlignment: the alignment of every block, which must be a power of two.
+			 * @param InTag: the tag the pool's chunks are accounted to.
+			 *
+			 */
+			PoolAllocator(usize InBlockSize, usize InBlocksPerChunk = 64, usize InAlignment = 16, MemoryTag InTag = MemoryTag::General);
+
+			/*
+			 * @brief This destructor returns every chunk to the operating system. Blocks that
+			 * are still in use become invalid.
+			 *
+			 */
+			virtual ~PoolAllocator();
+
+			PoolAllocator(const PoolAllocator&) = delete;
+			PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+			/*
+			 * @brief This method allocates a single block from the pool.
+			 *
+			 * @param Size: the size of the chunk to allocate, which must not exceed the block size.
+			 * @return a void pointer to a block, or nullptr if the pool could not grow.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates a single block from the pool. Every block is aligned
+			 * to the pool's alignment, so this is the same as Allocate.
+			 *
+			 * @param Size: the size of the chunk to allocate, which must not exceed the block size.
+			 * @param Alignment: the alignment of the chunk, which must not exceed the pool's alignment.
+			 * @return a void pointer to a block, or nullptr if the pool could not grow.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method returns a block to the pool. It may be called from any thread.
+			 *
+			 * @param Address: the pointer to the block to free, or nullptr.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method returns a block to the pool, the same as Free.
+			 *
+			 * @param Address: the pointer to the block to free, or nullptr.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method returns the size of every block, in bytes, after rounding up
+			 * to the pool's alignment.
+			 *
+			 */
+			INLINE usize GetBlockSize() const { return _blockSize; }
+
+			/*
+			 * @brief This method returns the number of chunks the pool has grown by so far.
+			 *
+			 */
+			INLINE usize GetChunkCount() const { return _chunkCount.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the total number of blocks owned by the pool, whether
+			 * in use, cached by a thread or in the shared free list.
+			 *
+			 */
+			INLINE usize GetCapacity() const { return GetChunkCount() * _blocksPerChunk; }
+
+		private:
+			struct FreeBlock
+			{
+				FreeBlock* Next;
+			};
+
+			struct Chunk
+			{
+				Chunk* Next;
+			};
+
+			/*
+			 * @brief This structure holds the blocks cached by a thread. It is owned by the
+			 * thread, and linked in the pool's list of caches until either the thread exits
+			 * or the pool is destroyed.
+			 *
+			 */
+			struct ThreadCache
+			{
+				FreeBlock* Head;
+				u32 Count;
+				boost::atomic<u8> State;
+				MemoryTag Tag;
+				u64 PoolId;
+				PoolAllocator* Pool;
+				ThreadCache* Next;
+				ThreadCache* NextOwned;
+			};
+
+			/*
+			 * @brief This structure holds the caches owned by the calling thread, and returns
+			 * their blocks to their pools when the thread exits.
+			 *
+			 */
+			struct OwnedCaches
+			{
+				ThreadCache* Head = nullptr;
+
+				~OwnedCaches();
+			};
+
+			/*
+			 * @brief This method takes a batch of blocks from the shared free list, growing the
+			 * pool if it is empty, and links them together.
+			 *
+			 * @param OutCount: the number of blocks in the returned list.
+			 * @return the head of the batch, or nullptr if the pool could not grow.
+			 *
+			 */
+			FreeBlock* AcquireBatch(u32* OutCount);
+
+			/*
+			 * @brief This method returns a list of blocks to the shared free list.
+			 *
+			 */
+			void ReleaseBatch(FreeBlock* InHead, FreeBlock* InTail);
+
+			/*
+			 * @brief This method allocates a new chunk and pushes all of its blocks on the
+			 * shared free list. It must be called with the shared lock held.
+			 *
+			 */
+			bool Grow();
+
+			/*
+			 * @brief This method returns the cache of the calling thread, looking it up in a
+			 * small thread local table keyed by the pool's unique identifier.
+			 *
+			 */
+			ThreadCache& GetThreadCache();
+
+			/*
+			 * @brief This method finds or creates the cache of the calling thread when it is
+			 * not in the thread local table, and records it there.
+			 *
+			 */
+			ThreadCache& AttachThreadCache();
+
+			/*
+			 * @brief This method returns the blocks of an exiting thread's cache to the shared
+			 * free list, and unlinks the cache from the pool.
+			 *
+			 */
+			void DetachThreadCache(ThreadCache* InCache);
+
+			static thread_local OwnedCaches _ownedCaches;
+
+			usize _blockSize;
+			usize _blocksPerChunk;
+			usize _alignment;
+			usize _chunkHeaderSize;
+			MemoryTag _tag;
+
+			boost::atomic_flag _lock;
+			FreeBlock* _freeList;
+			Chunk* _chunks;
+			boost::atomic<usize> _chunkCount;
+
+			u64 _id;
+			ThreadCache* _threadCaches;
+		};
+	}
+}
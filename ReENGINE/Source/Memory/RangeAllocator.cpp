@@ -0,0 +1,142 @@
+/*
+ * RangeAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * RangeAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "RangeAllocator.hpp"
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+		}
+
+		RangeAllocator::RangeAllocator(usize InSize)
+			: _size(InSize), _usedSize(0), _allocationCount(0)
+		{
+			ASSERT(InSize > 0);
+
+			_ranges.emplace(0, Range{ InSize, true });
+			InsertFree(0, InSize);
+		}
+
+		bool RangeAllocator::Allocate(usize InSize, usize InAlignment, usize* OutOffset)
+		{
+			ASSERT(InSize > 0);
+			ASSERT(InAlignment > 0 && (InAlignment & (InAlignment - 1)) == 0);
+
+			// Walk the free ranges from the smallest that could fit, until one fits once aligned.
+			for (auto it = _freeBySize.lower_bound(InSize); it != _freeBySize.end(); ++it)
+			{
+				const usize freeSize = it->first;
+				const usize freeOffset = it->second;
+				const usize offset = AlignUp(freeOffset, InAlignment);
+				const usize padding = offset - freeOffset;
+
+				if (padding + InSize > freeSize)
+					continue;
+
+				_freeBySize.erase(it);
+
+				// The padding in front stays free, as a range of its own.
+				if (padding > 0)
+				{
+					_ranges[freeOffset].Size = padding;
+					InsertFree(freeOffset, padding);
+					_ranges.emplace(offset, Range{ InSize, false });
+				}
+				else
+				{
+					_ranges[freeOffset] = Range{ InSize, false };
+				}
+
+				// So does whatever is left behind the range.
+				const usize remainder = freeSize - padding - InSize;
+				if (remainder > 0)
+				{
+					_ranges.emplace(offset + InSize, Range{ remainder, true });
+					InsertFree(offset + InSize, remainder);
+				}
+
+				_usedSize += InSize;
+				_allocationCount++;
+
+				*OutOffset = offset;
+				return true;
+			}
+
+			return false;
+		}
+
+		void RangeAllocator::Free(usize InOffset)
+		{
+			auto it = _ranges.find(InOffset);
+			ASSERT(it != _ranges.end() && !it->second.Free);
+
+			_usedSize -= it->second.Size;
+			_allocationCount--;
+
+			usize offset = InOffset;
+			usize size = it->second.Size;
+
+			// Merge with the range behind, if it is free.
+			auto next = it;
+			++next;
+			if (next != _ranges.end() && next->second.Free)
+			{
+				RemoveFree(next->first, next->second.Size);
+				size += next->second.Size;
+				_ranges.erase(next);
+			}
+
+			// Merge with the range in front, if it is free.
+			if (it != _ranges.begin())
+			{
+				auto previous = it;
+				--previous;
+				if (previous->second.Free)
+				{
+					RemoveFree(previous->first, previous->second.Size);
+					offset = previous->first;
+					size += previous->second.Size;
+					_ranges.erase(it);
+					it = previous;
+				}
+			}
+
+			it->second = Range{ size, true };
+			InsertFree(offset, size);
+		}
+
+		void RangeAllocator::InsertFree(usize InOffset, usize InSize)
+		{
+			_freeBySize.emplace(InSize, InOffset);
+		}
+
+		void RangeAllocator::RemoveFree(usize InOffset, usize InSize)
+		{
+			auto range = _freeBySize.equal_range(InSize);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (it->second == InOffset)
+				{
+					_freeBySize.erase(it);
+					return;
+				}
+			}
+
+			ASSERT(false);
+		}
+	}
+}
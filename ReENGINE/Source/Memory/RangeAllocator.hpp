@@ -0,0 +1,115 @@
+/*
+ * RangeAllocator.hpp
+ *
+ * This header file declares the RangeAllocator, which sub-allocates aligned
+ * ranges of offsets within a block of memory it never touches, such as a
+ * block of device memory.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Containers.hpp"
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class is responsible for carving a block of memory the processor can not
+		 * write headers into, such as memory on the graphics device, into aligned ranges.
+		 *
+		 * Every range, used or free, is kept in a map ordered by offset, so a freed range is
+		 * merged with its free neighbours right away. The free ranges are also indexed by size,
+		 * so a request takes the smallest range it fits in, alignment included, which keeps the
+		 * large ranges whole for large requests. The allocator is not thread safe, its owner
+		 * is expected to hold a lock around it.
+		 *
+		 */
+		class RangeAllocator
+		{
+		public:
+			/*
+			 * @brief This constructor sets up a single free range spanning the whole block.
+			 *
+			 * @param InSize: the size of the block, in bytes.
+			 *
+			 */
+			explicit RangeAllocator(usize InSize);
+
+			/*
+			 * @brief This method allocates an aligned range.
+			 *
+			 * @param InSize: the size of the range, which must not be zero.
+			 * @param InAlignment: the alignment of the range's offset, which must be a power of two.
+			 * @param OutOffset: the offset of the range, when it succeeds.
+			 * @return true if the range was allocated, false if no free range fits it.
+			 *
+			 */
+			bool Allocate(usize InSize, usize InAlignment, usize* OutOffset);
+
+			/*
+			 * @brief This method frees a range, merging it with its free neighbours.
+			 *
+			 * @param InOffset: the offset of a range returned by Allocate.
+			 *
+			 */
+			void Free(usize InOffset);
+
+			/*
+			 * @brief This method returns the size of the block.
+			 *
+			 */
+			INLINE usize GetSize() const { return _size; }
+
+			/*
+			 * @brief This method returns the number of bytes in allocated ranges.
+			 *
+			 */
+			INLINE usize GetUsedSize() const { return _usedSize; }
+
+			/*
+			 * @brief This method returns the number of allocated ranges.
+			 *
+			 */
+			INLINE usize GetAllocationCount() const { return _allocationCount; }
+
+			/*
+			 * @brief This method returns the number of free ranges.
+			 *
+			 */
+			INLINE usize GetFreeRangeCount() const { return _freeBySize.size(); }
+
+			/*
+			 * @brief This method returns the size of the largest free range.
+			 *
+			 */
+			INLINE usize GetLargestFreeRange() const { return _freeBySize.empty() ? 0 : _freeBySize.rbegin()->first; }
+
+			/*
+			 * @brief This method returns whether no range is allocated.
+			 *
+			 */
+			INLINE bool IsEmpty() const { return _allocationCount == 0; }
+
+		private:
+			struct Range
+			{
+				usize Size;
+				bool Free;
+			};
+
+			void InsertFree(usize InOffset, usize InSize);
+			void RemoveFree(usize InOffset, usize InSize);
+
+			Map<usize, Range> _ranges;
+			MultiMap<usize, usize> _freeBySize;
+
+			usize _size;
+			usize _usedSize;
+			usize _allocationCount;
+		};
+	}
+}
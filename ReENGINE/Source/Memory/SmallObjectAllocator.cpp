@@ -0,0 +1,517 @@
+/*
+ * SmallObjectAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * SmallObjectAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "SmallObjectAllocator.hpp"
+#include "AllocationTracer.hpp"
+#include "DefaultAllocator.hpp"
+
+#include <immintrin.h>
+#include <new>
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u8 FREED_PATTERN = 0xDD;
+			const usize FULL_BIT = 1;
+			const usize MINIMUM_ALIGNMENT = 16;
+			const usize HEAP_ALIGNMENT = 64;
+			const usize SPAN_HEADER_SIZE = 128;
+
+			const u8 HEAP_ACTIVE = 0;
+			const u8 HEAP_ABANDONED = 1;
+			const u8 HEAP_ORPHANED = 2;
+
+			// Steps of 16 bytes up to 128, then four classes per power of two.
+			const u32 CLASS_SIZES[SmallObjectAllocator::CLASS_COUNT] = {
+				16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024
+			};
+
+			// The class of every size, indexed by the size rounded up to 16 bytes, divided by 16.
+			const u8 CLASS_OF_SIZE[SmallObjectAllocator::MAXIMUM_SMALL_SIZE / 16 + 1] = {
+				0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+				12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15,
+				16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17,
+				18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19
+			};
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. It is only
+			 * taken to hand spans and heaps out, never to allocate nor to free a block.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			/*
+			 * @brief This structure holds the part of a thread heap that may outlive its
+			 * allocator, so the thread that owns it can let go of it when it exits. Whichever
+			 * of the thread and the allocator lets go last releases the heap.
+			 *
+			 */
+			struct HeapLink
+			{
+				boost::atomic<u8> State;
+				HeapLink* NextOwned;
+				u64 Allocator;
+			};
+
+			/*
+			 * @brief This structure holds the heaps owned by the calling thread, and lets go
+			 * of them when the thread exits, so other threads can adopt them.
+			 *
+			 */
+			struct OwnedHeaps
+			{
+				HeapLink* Head = nullptr;
+
+				~OwnedHeaps()
+				{
+					HeapLink* link = Head;
+					while (link)
+					{
+						HeapLink* next = link->NextOwned;
+						if (link->State.exchange(HEAP_ABANDONED, boost::memory_order_acq_rel) == HEAP_ORPHANED)
+							DefaultAllocator().FreeAligned(link);
+
+						link = next;
+					}
+				}
+			};
+
+			/*
+			 * @brief This structure maps an allocator to the calling thread's heap in it.
+			 * Allocator identifiers are never reused, so an entry left behind by a destroyed
+			 * allocator simply never matches again.
+			 *
+			 */
+			struct HeapSlot
+			{
+				u64 Allocator;
+				void* Heap;
+			};
+
+			const usize HEAP_SLOTS = 16;
+
+			boost::atomic<u64> nextAllocatorId(1);
+
+			thread_local HeapSlot heapSlots[HEAP_SLOTS];
+			thread_local OwnedHeaps ownedHeaps;
+		}
+
+		struct SmallObjectAllocator::FreeBlock
+		{
+			FreeBlock* Next;
+		};
+
+		/*
+		 * @brief This structure sits at the start of every span. The first cache line is only
+		 * touched by the thread owning the span, and the second by the threads freeing into it.
+		 * While a span is full it is taken out of its heap's lists, and the FULL_BIT is set in
+		 * its remote list, so the first thread to free into it hands it back to its heap.
+		 *
+		 */
+		struct alignas(64) SmallObjectAllocator::Span
+		{
+			FreeBlock* LocalFree;
+			u8* Bump;
+			u8* End;
+			Span* Next;
+			Span* Previous;
+			ThreadHeap* Heap;
+			Span* NextReturned;
+			u32 Used;
+			u16 Class;
+			bool Full;
+
+			alignas(64) boost::atomic<usize> RemoteFree;
+		};
+
+		/*
+		 * @brief This structure holds the spans a thread allocates from, a list per class
+		 * with the span being allocated from at its head.
+		 *
+		 */
+		struct alignas(64) SmallObjectAllocator::ThreadHeap : HeapLink
+		{
+			Span* Spans[CLASS_COUNT];
+			boost::atomic<Span*> Returned;
+			ThreadHeap* Next;
+		};
+
+		const usize SmallObjectAllocator::SPAN_SIZE;
+		const usize SmallObjectAllocator::MAXIMUM_SMALL_SIZE;
+		const u32 SmallObjectAllocator::CLASS_COUNT;
+		const usize SmallObjectAllocator::DEFAULT_RESERVE_SIZE;
+
+		namespace
+		{
+			template <typename SpanType>
+			FORCEINLINE SpanType* GetSpan(void* InAddress)
+			{
+				return reinterpret_cast<SpanType*>(reinterpret_cast<usize>(InAddress) & ~(SmallObjectAllocator::SPAN_SIZE - 1));
+			}
+
+			template <typename HeapType, typename SpanType>
+			FORCEINLINE void LinkSpan(HeapType& InHeap, SpanType* InSpan)
+			{
+				SpanType*& head = InHeap.Spans[InSpan->Class];
+				InSpan->Previous = nullptr;
+				InSpan->Next = head;
+				if (head)
+					head->Previous = InSpan;
+
+				head = InSpan;
+			}
+
+			template <typename HeapType, typename SpanType>
+			FORCEINLINE void UnlinkSpan(HeapType& InHeap, SpanType* InSpan)
+			{
+				if (InSpan->Previous)
+					InSpan->Previous->Next = InSpan->Next;
+				else
+					InHeap.Spans[InSpan->Class] = InSpan->Next;
+
+				if (InSpan->Next)
+					InSpan->Next->Previous = InSpan->Previous;
+			}
+		}
+
+		SmallObjectAllocator::SmallObjectAllocator(usize InReserveSize)
+			: _arena(InReserveSize, HugePages::None, VirtualArena::Untracked()), _freeSpans(nullptr), _heaps(nullptr), _spanCount(0), _freeSpanCount(0), _heapCount(0),
+			_id(nextAllocatorId.fetch_add(1, boost::memory_order_relaxed))
+		{
+			static_assert(sizeof(Span) <= SPAN_HEADER_SIZE, "The span header must fit before the first block.");
+			_lock.clear();
+		}
+
+		SmallObjectAllocator::~SmallObjectAllocator()
+		{
+			ThreadHeap* heap = _heaps;
+			while (heap)
+			{
+				ThreadHeap* next = heap->Next;
+				if (heap->State.exchange(HEAP_ORPHANED, boost::memory_order_acq_rel) == HEAP_ABANDONED)
+					DefaultAllocator().FreeAligned(static_cast<HeapLink*>(heap));
+
+				heap = next;
+			}
+
+			// The spans go with the arena.
+		}
+
+		void* SmallObjectAllocator::Allocate(usize Size)
+		{
+			AllocationTracer::Scope trace;
+			if (Size > MAXIMUM_SMALL_SIZE)
+				return trace.Allocated(DefaultAllocator().AllocateAligned(Size, MINIMUM_ALIGNMENT), Size);
+
+			ThreadHeap& heap = GetThreadHeap();
+			u32 sizeClass = CLASS_OF_SIZE[(Size + 15) >> 4];
+
+			Span* span = heap.Spans[sizeClass];
+			if (span)
+			{
+				FreeBlock* block = span->LocalFree;
+				if (block)
+				{
+					span->LocalFree = block->Next;
+					span->Used++;
+					return trace.Allocated(block, Size);
+				}
+
+				if (span->Bump < span->End)
+				{
+					u8* address = span->Bump;
+					span->Bump += CLASS_SIZES[sizeClass];
+					span->Used++;
+					return trace.Allocated(address, Size);
+				}
+			}
+
+			return trace.Allocated(AllocateSlow(heap, sizeClass), Size);
+		}
+
+		void* SmallObjectAllocator::AllocateAligned(usize Size, usize Alignment)
+		{
+			ASSERT(Alignment >= 1 && (Alignment & (Alignment - 1)) == 0);
+
+			if (Alignment <= MINIMUM_ALIGNMENT)
+				return Allocate(Size);
+
+			AllocationTracer::Scope trace;
+			return trace.Allocated(DefaultAllocator().AllocateAligned(Size, Alignment), Size);
+		}
+
+		void SmallObjectAllocator::Free(void* Address)
+		{
+			if (!Address)
+				return;
+
+			AllocationTracer::Scope trace;
+			trace.Freed(Address);
+
+			if (!_arena.Contains(Address))
+			{
+				DefaultAllocator().FreeAligned(Address);
+				return;
+			}
+
+			Span* span = GetSpan<Span>(Address);
+			FreeBlock* block = static_cast<FreeBlock*>(Address);
+
+#if defined(ASSERTIONS)
+			ASSERT((static_cast<u8*>(Address) - reinterpret_cast<u8*>(span) - SPAN_HEADER_SIZE) % CLASS_SIZES[span->Class] == 0);
+			Set(Address, FREED_PATTERN, CLASS_SIZES[span->Class]);
+#endif
+
+			ThreadHeap& heap = GetThreadHeap();
+			if (span->Heap != &heap)
+			{
+				FreeRemote(span, block);
+				return;
+			}
+
+			block->Next = span->LocalFree;
+			span->LocalFree = block;
+			span->Used--;
+
+			// A full span has room again. Whoever clears its bit puts it back in the lists.
+			if (span->Full)
+			{
+				if (!(span->RemoteFree.fetch_and(~FULL_BIT, boost::memory_order_acq_rel) & FULL_BIT))
+					return;
+
+				span->Full = false;
+				LinkSpan(heap, span);
+				return;
+			}
+
+			// Spans that empty out go back to the allocator, except the one being allocated from.
+			if (span->Used == 0 && heap.Spans[span->Class] != span)
+				ReleaseSpan(heap, span);
+		}
+
+		void SmallObjectAllocator::FreeAligned(void* Address)
+		{
+			Free(Address);
+		}
+
+		SmallObjectAllocator& SmallObjectAllocator::Shared()
+		{
+			// Intentionally never destroyed, so memory can be freed during static destruction.
+			static SmallObjectAllocator* allocator = new SmallObjectAllocator();
+			return *allocator;
+		}
+
+		void* SmallObjectAllocator::AllocateSlow(ThreadHeap& InHeap, u32 InClass)
+		{
+			// Full spans other threads have freed into come back first.
+			Span* returned = InHeap.Returned.exchange(nullptr, boost::memory_order_acquire);
+			while (returned)
+			{
+				Span* next = returned->NextReturned;
+				returned->Full = false;
+				LinkSpan(InHeap, returned);
+				returned = next;
+			}
+
+			for (Span* span = InHeap.Spans[InClass]; span; span = InHeap.Spans[InClass])
+			{
+				if (!span->LocalFree && span->Bump >= span->End)
+				{
+					// With nothing freed remotely either, the span leaves the lists until it is.
+					usize remote = span->RemoteFree.load(boost::memory_order_relaxed);
+					if (remote == 0 && span->RemoteFree.compare_exchange_strong(remote, FULL_BIT, boost::memory_order_acq_rel))
+					{
+						span->Full = true;
+						UnlinkSpan(InHeap, span);
+						continue;
+					}
+
+					// Take every block freed by other threads at once.
+					FreeBlock* block = reinterpret_cast<FreeBlock*>(span->RemoteFree.exchange(0, boost::memory_order_acquire));
+					span->LocalFree = block;
+					for (; block; block = block->Next)
+						span->Used--;
+				}
+
+				FreeBlock* block = span->LocalFree;
+				if (block)
+				{
+					span->LocalFree = block->Next;
+					span->Used++;
+					return block;
+				}
+
+				u8* address = span->Bump;
+				span->Bump += CLASS_SIZES[InClass];
+				span->Used++;
+				return address;
+			}
+
+			Span* span = AcquireSpan(InHeap, InClass);
+			if (!span)
+				return nullptr;
+
+			u8* address = span->Bump;
+			span->Bump += CLASS_SIZES[InClass];
+			span->Used++;
+			return address;
+		}
+
+		void SmallObjectAllocator::FreeRemote(Span* InSpan, FreeBlock* InBlock)
+		{
+			usize remote = InSpan->RemoteFree.load(boost::memory_order_relaxed);
+			do
+			{
+				InBlock->Next = reinterpret_cast<FreeBlock*>(remote & ~FULL_BIT);
+			} while (!InSpan->RemoteFree.compare_exchange_weak(remote, reinterpret_cast<usize>(InBlock), boost::memory_order_release, boost::memory_order_relaxed));
+
+			// The span was full, and this thread cleared its bit, so it hands the span back.
+			if (remote & FULL_BIT)
+			{
+				ThreadHeap* heap = InSpan->Heap;
+				Span* head = heap->Returned.load(boost::memory_order_relaxed);
+				do
+				{
+					InSpan->NextReturned = head;
+				} while (!heap->Returned.compare_exchange_weak(head, InSpan, boost::memory_order_release, boost::memory_order_relaxed));
+			}
+		}
+
+		SmallObjectAllocator::Span* SmallObjectAllocator::AcquireSpan(ThreadHeap& InHeap, u32 InClass)
+		{
+			Span* span = nullptr;
+			{
+				SpinLockGuard guard(_lock);
+				span = _freeSpans;
+				if (span)
+				{
+					_freeSpans = span->Next;
+					_freeSpanCount.fetch_sub(1, boost::memory_order_relaxed);
+				}
+			}
+
+			if (!span)
+			{
+				span = static_cast<Span*>(_arena.AllocateAligned(SPAN_SIZE, SPAN_SIZE));
+				if (!span)
+					return nullptr;
+
+				_spanCount.fetch_add(1, boost::memory_order_relaxed);
+			}
+
+			u8* blocks = reinterpret_cast<u8*>(span) + SPAN_HEADER_SIZE;
+			usize count = (SPAN_SIZE - SPAN_HEADER_SIZE) / CLASS_SIZES[InClass];
+
+			span->LocalFree = nullptr;
+			span->Bump = blocks;
+			span->End = blocks + count * CLASS_SIZES[InClass];
+			span->Heap = &InHeap;
+			span->NextReturned = nullptr;
+			span->Used = 0;
+			span->Class = static_cast<u16>(InClass);
+			span->Full = false;
+			span->RemoteFree.store(0, boost::memory_order_relaxed);
+
+			LinkSpan(InHeap, span);
+			return span;
+		}
+
+		void SmallObjectAllocator::ReleaseSpan(ThreadHeap& InHeap, Span* InSpan)
+		{
+			// Every block was freed and collected, so no other thread can touch the span anymore.
+			UnlinkSpan(InHeap, InSpan);
+
+			SpinLockGuard guard(_lock);
+			InSpan->Next = _freeSpans;
+			_freeSpans = InSpan;
+			_freeSpanCount.fetch_add(1, boost::memory_order_relaxed);
+		}
+
+		SmallObjectAllocator::ThreadHeap& SmallObjectAllocator::GetThreadHeap()
+		{
+			HeapSlot& slot = heapSlots[_id % HEAP_SLOTS];
+			if (slot.Allocator == _id)
+				return *static_cast<ThreadHeap*>(slot.Heap);
+
+			return AttachThreadHeap();
+		}
+
+		SmallObjectAllocator::ThreadHeap& SmallObjectAllocator::AttachThreadHeap()
+		{
+			// The thread may already own a heap whose slot was taken by another allocator.
+			ThreadHeap* heap = nullptr;
+			for (HeapLink* link = ownedHeaps.Head; link; link = link->NextOwned)
+			{
+				if (link->Allocator == _id)
+				{
+					heap = static_cast<ThreadHeap*>(link);
+					break;
+				}
+			}
+
+			if (!heap)
+			{
+				SpinLockGuard guard(_lock);
+
+				// Adopt the heap of a thread that has exited, along with the blocks it left behind.
+				for (heap = _heaps; heap; heap = heap->Next)
+				{
+					u8 state = HEAP_ABANDONED;
+					if (heap->State.compare_exchange_strong(state, HEAP_ACTIVE, boost::memory_order_acq_rel))
+						break;
+				}
+
+				if (!heap)
+				{
+					void* memory = DefaultAllocator().AllocateAligned(sizeof(ThreadHeap), HEAP_ALIGNMENT);
+					ASSERT(memory);
+
+					heap = new (memory) ThreadHeap();
+					heap->State.store(HEAP_ACTIVE, boost::memory_order_relaxed);
+					heap->Allocator = _id;
+					for (u32 i = 0; i < CLASS_COUNT; ++i)
+						heap->Spans[i] = nullptr;
+
+					heap->Returned.store(nullptr, boost::memory_order_relaxed);
+					heap->Next = _heaps;
+					_heaps = heap;
+					_heapCount.fetch_add(1, boost::memory_order_relaxed);
+				}
+
+				heap->NextOwned = ownedHeaps.Head;
+				ownedHeaps.Head = heap;
+			}
+
+			HeapSlot& slot = heapSlots[_id % HEAP_SLOTS];
+			slot.Allocator = _id;
+			slot.Heap = heap;
+			return *heap;
+		}
+	}
+}
@@ -0,0 +1,172 @@
+/*
+ * SmallObjectAllocator.hpp
+ *
+ * This header file declares the SmallObjectAllocator, a general purpose
+ * allocator for small objects that gives every thread a heap of its own and
+ * returns blocks freed by other threads without taking a lock.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+#include "VirtualArena.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class is responsible for the small allocations made concurrently by the
+		 * engine's threads, such as vertices, entity information and components.
+		 *
+		 * Blocks are grouped in size classes, each served from spans of 64 KiB owned by a
+		 * single thread. Every thread allocates and frees from its own spans without any
+		 * atomic operation, and a block freed by another thread is pushed on its span's remote
+		 * list with a single compare and swap, to be collected by the owner once the span runs
+		 * dry. The spans are carved from a reserved range of address space, so the span of a
+		 * block is found by masking its address. Larger or over aligned requests go to the
+		 * system heap.
+		 *
+		 * A thread's heap outlives the thread, and is adopted by the next thread to need one,
+		 * so blocks freed after their owner has exited are not lost.
+		 *
+		 */
+		class SmallObjectAllocator : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the size of a span, which is also its alignment.
+			 *
+			 */
+			static const usize SPAN_SIZE = 64 * 1024;
+
+			/*
+			 * @brief This constant holds the largest size served from the size classes.
+			 *
+			 */
+			static const usize MAXIMUM_SMALL_SIZE = 1024;
+
+			/*
+			 * @brief This constant holds the number of size classes.
+			 *
+			 */
+			static const u32 CLASS_COUNT = 20;
+
+			/*
+			 * @brief This constant holds the default size of the range reserved for spans.
+			 *
+			 */
+			static const usize DEFAULT_RESERVE_SIZE = static_cast<usize>(4) * 1024 * 1024 * 1024;
+
+			/*
+			 * @brief This constructor reserves the range the spans are carved from. Its memory
+			 * is not accounted to any tag, since the allocator is meant to sit underneath the
+			 * tracking allocators, as the heap selected with MemoryManager::SetHeap.
+			 *
+			 * @param InReserveSize: the size of the range to reserve, in bytes.
+			 *
+			 */
+			explicit SmallObjectAllocator(usize InReserveSize = DEFAULT_RESERVE_SIZE);
+
+			/*
+			 * @brief This destructor releases every span. Blocks that are still in use become
+			 * invalid, and large chunks that are still in use are leaked.
+			 *
+			 */
+			virtual ~SmallObjectAllocator();
+
+			SmallObjectAllocator(const SmallObjectAllocator&) = delete;
+			SmallObjectAllocator& operator=(const SmallObjectAllocator&) = delete;
+
+			/*
+			 * @brief This method allocates a chunk of memory aligned to 16 bytes.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @return a void pointer to the chunk, or nullptr if it failed.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates an aligned chunk of memory. Chunks aligned to more
+			 * than 16 bytes come from the system heap.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if it failed.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method frees a chunk. It may be called from any thread.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method frees a chunk, the same as Free.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method returns the number of spans carved so far, in use or not.
+			 *
+			 */
+			INLINE usize GetSpanCount() const { return _spanCount.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the number of spans waiting to be reused.
+			 *
+			 */
+			INLINE usize GetFreeSpanCount() const { return _freeSpanCount.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the number of thread heaps created so far.
+			 *
+			 */
+			INLINE usize GetHeapCount() const { return _heapCount.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the allocator shared by the whole engine, which
+			 * lives as long as the program.
+			 *
+			 */
+			static SmallObjectAllocator& Shared();
+
+		private:
+			struct FreeBlock;
+			struct Span;
+			struct ThreadHeap;
+
+			void* AllocateSlow(ThreadHeap& InHeap, u32 InClass);
+			void FreeRemote(Span* InSpan, FreeBlock* InBlock);
+			Span* AcquireSpan(ThreadHeap& InHeap, u32 InClass);
+			void ReleaseSpan(ThreadHeap& InHeap, Span* InSpan);
+			ThreadHeap& GetThreadHeap();
+			ThreadHeap& AttachThreadHeap();
+
+			VirtualArena _arena;
+
+			boost::atomic_flag _lock;
+			Span* _freeSpans;
+			ThreadHeap* _heaps;
+
+			boost::atomic<usize> _spanCount;
+			boost::atomic<usize> _freeSpanCount;
+			boost::atomic<usize> _heapCount;
+
+			u64 _id;
+		};
+	}
+}
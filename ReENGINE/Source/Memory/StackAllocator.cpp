@@ -1,16 +1,60 @@
 /*
  * StackAllocator.cpp
- * 
+ *
+ * This source file defines the guard functions declared in the
+ * StackAllocator.hpp header file.
+ *
  * Copyright (c) Giovanni Giacomo. All Rights Reserved.
  *
  */
 
 #include "StackAllocator.hpp"
 
-namespace Re 
+namespace Re
 {
-    namespace Memory 
+    namespace Memory
     {
+        namespace
+        {
+            const u8 GUARD_PATTERN = 0xFD;
+            const u8 RELEASED_PATTERN = 0xDD;
+            const usize GUARD_PATTERN_SIZE = 8;
+        }
+
+        const usize StackGuard::None;
+        const usize StackGuard::Size;
+
+        void StackGuard::Write(u8* InBase, usize InOffset, usize InPrevious)
+        {
+            u8* guard = InBase + InOffset;
+            Set(guard, GUARD_PATTERN, GUARD_PATTERN_SIZE);
+            Copy(guard + GUARD_PATTERN_SIZE, &InPrevious, sizeof(usize));
+        }
+
+        usize StackGuard::Release(u8* InBase, usize InLast, usize InBegin, usize InEnd)
+        {
+            while (InLast != None && InLast >= InBegin && InLast < InEnd)
+            {
+                const u8* guard = InBase + InLast;
+
+                // An overwritten pattern means the allocation below the guard was overrun,
+                // in which case the link to the previous guard cannot be trusted either.
+                bool intact = true;
+                for (usize i = 0; i < GUARD_PATTERN_SIZE; i++)
+                    intact = intact && guard[i] == GUARD_PATTERN;
+
+                ASSERT(intact);
+                if (!intact)
+                {
+                    InLast = None;
+                    break;
+                }
+
+                Copy(&InLast, guard + GUARD_PATTERN_SIZE, sizeof(usize));
+            }
 
+            Set(InBase + InBegin, RELEASED_PATTERN, InEnd - InBegin);
+            return InLast;
+        }
     }
 }
@@ -1,79 +1,233 @@
 /*
  * StackAllocator.hpp
  *
+ * This header file declares the linear allocators of the ReENGINE: the
+ * StackAllocator, which grows from the bottom of its block, and the
+ * DoubleEndedStackAllocator, which also grows from the top. Both can be
+ * rolled back to markers, optionally through RAII scopes.
+ *
  * Copyright (c) Giovanni Giacomo. All Rights Reserved.
  *
  */
 
 #pragma once
 
+#include "AllocationTracer.hpp"
 #include "Allocator.hpp"
 
+// Debug builds surround every allocation with guard bytes, checked when the allocation is released.
+#if defined(ASSERTIONS)
+#define STACK_ALLOCATOR_GUARDS 1
+#else
+#define STACK_ALLOCATOR_GUARDS 0
+#endif
+
 namespace Re
 {
     namespace Memory
     {
+        /**
+         * @brief This type represents a position in a stack, which the stack can later be
+         * rolled back to, releasing everything allocated after it.
+         *
+         */
+        typedef usize StackMarker;
+
+        /**
+         * @brief This structure holds the functions that write and verify the guard bytes
+         * placed after each allocation of a stack when STACK_ALLOCATOR_GUARDS is enabled.
+         *
+         * A guard is a fixed byte pattern followed by the offset of the previous guard,
+         * so the guards of a stack form a chain that can be walked on release.
+         *
+         */
+        struct StackGuard
+        {
+            /**
+             * @brief This constant holds the value that terminates a chain of guards.
+             *
+             */
+            static const usize None = ~static_cast<usize>(0);
+
+            /**
+             * @brief This constant holds the number of bytes taken by a single guard.
+             *
+             */
+            static const usize Size = STACK_ALLOCATOR_GUARDS ? 16 : 0;
+
+            /**
+             * @brief This method writes a guard at the given offset of a stack.
+             *
+             * @param InBase: the base address of the stack.
+             * @param InOffset: the offset of the guard.
+             * @param InPrevious: the offset of the previous guard of the chain, or None.
+             *
+             */
+            static void Write(u8* InBase, usize InOffset, usize InPrevious);
+
+            /**
+             * @brief This method verifies and walks the chain of guards starting at InLast,
+             * for as long as they lie in the released range, and fills that range with a
+             * recognizable pattern so stale pointers into it are easier to spot.
+             *
+             * @param InBase: the base address of the stack.
+             * @param InLast: the offset of the most recently written guard, or None.
+             * @param InBegin: the first offset of the released range.
+             * @param InEnd: the offset one past the end of the released range.
+             *
+             * @return the offset of the first guard outside of the released range, or None.
+             *
+             */
+            static usize Release(u8* InBase, usize InLast, usize InBegin, usize InEnd);
+        };
+
         /**
          * @brief This class is responsible for managing and handling
          * memory that is held on Stack-based allocators.
          *
+         * Allocations are carved linearly from a single block and released in reverse
+         * order, either one at a time through Free or in bulk by rolling back to a marker.
+         *
          */
         template <usize StackSize>
         class StackAllocator : public IAllocator
         {
-        private:
-            u8* Marker;
+        protected:
+            u8* Base;
             usize Offset;
+            usize Limit;
+            usize HighWater;
+            usize LastGuard;
+
+            /**
+             * @brief This method rounds an address up to the given alignment, which must be
+             * a power of two.
+             *
+             */
+            static FORCEINLINE usize AlignUp(usize Address, usize Alignment)
+            {
+                return (Address + Alignment - 1) & ~(Alignment - 1);
+            }
+
+            /**
+             * @brief This method returns the number of bytes currently in use by the stack.
+             *
+             */
+            FORCEINLINE usize GetUsed() const { return Offset + (StackSize - Limit); }
+
+            /**
+             * @brief This method records the current usage in the high-water mark. The peak is
+             * always reached right before the stack shrinks, so it is called on release rather
+             * than on every allocation.
+             *
+             */
+            FORCEINLINE void UpdateHighWater()
+            {
+                usize used = GetUsed();
+                HighWater = used > HighWater ? used : HighWater;
+            }
+
+            /**
+             * @brief This method moves the offset back to the given marker, checking the
+             * guards of every allocation released in the process.
+             *
+             */
+            FORCEINLINE void Rewind(usize InOffset)
+            {
+                ASSERT(InOffset <= Offset);
+                UpdateHighWater();
+
+#if STACK_ALLOCATOR_GUARDS
+                LastGuard = StackGuard::Release(Base, LastGuard, InOffset, Offset);
+#endif
+                Offset = InOffset;
+            }
 
         public:
+            /**
+             * @brief This class rolls its stack back to the marker taken at construction
+             * when it goes out of scope, releasing every allocation made in between.
+             *
+             */
+            class ScopedMarker
+            {
+            private:
+                StackAllocator& Stack;
+                StackMarker Marker;
+
+            public:
+                explicit ScopedMarker(StackAllocator& InStack)
+                    : Stack(InStack), Marker(InStack.GetMarker()) {}
+
+                ~ScopedMarker()
+                {
+                    Stack.FreeToMarker(Marker);
+                }
+
+                ScopedMarker(const ScopedMarker&) = delete;
+                ScopedMarker& operator=(const ScopedMarker&) = delete;
+            };
+
             /**
              * @brief This constructor allocates a block of memory of InStackSize, in
              * bytes, and sets the offset to 0.
              *
              */
             StackAllocator()
-                : Offset(0)
+                : Offset(0), Limit(StackSize), HighWater(0), LastGuard(StackGuard::None)
             {
-                Marker = new u8[StackSize];
+                Base = new u8[StackSize];
             }
 
             /**
              * @brief This destructor frees the block of memory previously allocated.
              *
              */
-            ~StackAllocator()
+            virtual ~StackAllocator()
             {
-                delete[] Marker;
+                delete[] Base;
             }
 
+            StackAllocator(const StackAllocator&) = delete;
+            StackAllocator& operator=(const StackAllocator&) = delete;
+
             /**
              * @brief This method allocates an array in the stack of specified size,
              * in bytes, and increases the offset by that same size.
              *
              * @param Size: the size of the chunk to allocate.
              *
-             * @return a pointer to a block of memory of size (in bytes).
+             * @return a pointer to a block of memory of size (in bytes), or nullptr if
+             * the stack is exhausted.
              *
              */
             INLINE virtual void* Allocate(usize Size) override
             {
-                ASSERT(Size <= StackSize);
-                ASSERT(Size + Offset <= StackSize);
+                usize end = Offset + Size + StackGuard::Size;
+                ASSERT(end <= Limit);
+                if (end > Limit)
+                    return nullptr;
 
-                void* Result = Marker + Offset;
-                Offset += Size;
-                return Result;
+                void* Result = Base + Offset;
+#if STACK_ALLOCATOR_GUARDS
+                StackGuard::Write(Base, end - StackGuard::Size, LastGuard);
+                LastGuard = end - StackGuard::Size;
+#endif
+                Offset = end;
+                return AllocationTracer::TracePooled(Result, Size);
             }
 
             /**
              * @brief This method allocates an array in the stack of specified
              * size and alignment, both in bytes, and calculates the
-             * appropriate address.
+             * appropriate address. The byte before the returned address holds
+             * the adjustment, so it must be freed with FreeAligned.
              *
              * @param Size: the size of the chunk to allocate.
              * @param Alignment: the alignment of the chunk to allocate.
              *
-             * @return a pointer to a aligned block of memory of size and aligment (in bytes).
+             * @return a pointer to a aligned block of memory of size and aligment (in bytes),
+             * or nullptr if the stack is exhausted.
              *
              */
             INLINE virtual void* AllocateAligned(usize Size, usize Alignment) override
@@ -82,26 +236,25 @@ namespace Re
                 ASSERT(Alignment <= 128);
                 ASSERT((Alignment & (Alignment - 1)) == 0);
 
-                // Get Total Memory to Allocate
-                u32 expandedSize = Size + Alignment;
-
-                // Allocate Total Unaligned Memory
-                u32 rawAddress = reinterpret_cast<u32>(Allocate(expandedSize));
+                // Reserve at least one byte before the aligned address for the adjustment.
+                usize rawAddress = reinterpret_cast<usize>(Base) + Offset;
+                usize alignedAddress = AlignUp(rawAddress + 1, Alignment);
+                usize adjustment = alignedAddress - rawAddress;
 
-                // Calculate the Adjustment
-                u32 mask = (Alignment - 1);
-                u32 misalignment = (rawAddress & mask);
-                i32 adjustment = Alignment - misalignment;
+                usize end = Offset + adjustment + Size + StackGuard::Size;
+                ASSERT(end <= Limit);
+                if (end > Limit)
+                    return nullptr;
 
-                // Calculate Adjusted Address
-                u32 alignedAddress = rawAddress + adjustment;
-
-                // Store the Adjustment
-                ASSERT(adjustment < 256);
                 u8* pAligned = reinterpret_cast<u8*>(alignedAddress);
                 pAligned[-1] = static_cast<u8>(adjustment);
 
-                return static_cast<void*>(pAligned);
+#if STACK_ALLOCATOR_GUARDS
+                StackGuard::Write(Base, end - StackGuard::Size, LastGuard);
+                LastGuard = end - StackGuard::Size;
+#endif
+                Offset = end;
+                return AllocationTracer::TracePooled(pAligned, Size);
             }
 
             /**
@@ -111,46 +264,56 @@ namespace Re
              */
             INLINE void Clear()
             {
-                Offset = 0;
+                Rewind(0);
             }
 
             /**
              * @brief This method frees an specified unaligned memory address of the stack,
-             * making it's memory available once again.
+             * making it's memory available once again, along with everything allocated after it.
              *
              * @param Address: a pointer to the memory address to be freed.
              *
              */
             INLINE virtual void Free(void* Address) override
             {
-                // Read Memory as Address
-                u32 address = reinterpret_cast<u32>(Address);
-                u32 offset = address - reinterpret_cast<u32>(Marker);
-
-                // Set Offset
-                Offset = offset;
+                ASSERT(static_cast<u8*>(Address) >= Base && static_cast<u8*>(Address) <= Base + Offset);
+                Rewind(static_cast<usize>(static_cast<u8*>(Address) - Base));
             }
 
             /**
              * @brief This method frees an specific aligned memory address of the stack,
-             * making it's memory available once again.
+             * making it's memory available once again, along with everything allocated after it.
              *
              * @param Address: a pointer to the aligned memory address to be freed.
              *
              */
             INLINE virtual void FreeAligned(void* Address) override
             {
-                const u8* pAlignedMem = reinterpret_cast<const u8*>(Address);
+                u8* pAlignedMem = static_cast<u8*>(Address);
 
-                // Read Aligned Address and Get Adjustment
-                u32 alignedAddress = reinterpret_cast<u32>(Address);
-                i32 adjusment = static_cast<i32>(pAlignedMem[-1]);
+                // Read the Adjustment and Trace the Raw Address
+                usize adjustment = pAlignedMem[-1];
+                Free(pAlignedMem - adjustment);
+            }
 
-                // Trace Raw Address and Obtain Pointer
-                u32 rawAddress = alignedAddress - adjusment;
-                void* pUnalignedMem = reinterpret_cast<void*>(rawAddress);
+            /**
+             * @brief This method returns a marker to the current top of the stack.
+             *
+             * @return the marker to pass to FreeToMarker.
+             *
+             */
+            INLINE StackMarker GetMarker() const { return Offset; }
 
-                Free(pUnalignedMem);
+            /**
+             * @brief This method rolls the stack back to a marker previously returned by
+             * GetMarker, releasing every allocation made after it.
+             *
+             * @param InMarker: the marker to roll back to.
+             *
+             */
+            INLINE void FreeToMarker(StackMarker InMarker)
+            {
+                Rewind(InMarker);
             }
 
             /**
@@ -160,7 +323,180 @@ namespace Re
              * @return a number representing the byte offset from the stack's origin.
              *
              */
-            INLINE u32 GetOffset() const { return Offset; }
+            INLINE usize GetOffset() const { return Offset; }
+
+            /**
+             * @brief This method returns the total size of the stack, in bytes.
+             *
+             */
+            INLINE usize GetCapacity() const { return StackSize; }
+
+            /**
+             * @brief This method returns the largest number of bytes that were in use at
+             * once since construction or the last call to ResetHighWaterMark, guards and
+             * alignment padding included.
+             *
+             */
+            INLINE usize GetHighWaterMark() const
+            {
+                usize used = GetUsed();
+                return used > HighWater ? used : HighWater;
+            }
+
+            /**
+             * @brief This method restarts the high-water mark from the current usage, such
+             * as at the start of a frame.
+             *
+             */
+            INLINE void ResetHighWaterMark() { HighWater = GetUsed(); }
+        };
+
+        /**
+         * @brief This class is a stack which allocates from both ends of its block: the
+         * lower end grows upwards, through the IAllocator interface and the methods it
+         * inherits from StackAllocator, while the upper end grows downwards.
+         *
+         * It fits two lifetimes in one block, such as level data at the bottom and
+         * temporary data at the top. The upper end is only released through markers.
+         *
+         */
+        template <usize StackSize>
+        class DoubleEndedStackAllocator : public StackAllocator<StackSize>
+        {
+        private:
+            typedef StackAllocator<StackSize> Super;
+
+            usize LastUpperGuard;
+
+            /**
+             * @brief This method moves the upper end back up to the given marker, checking
+             * the guards of every allocation released in the process.
+             *
+             */
+            FORCEINLINE void RewindUpper(usize InLimit)
+            {
+                ASSERT(InLimit >= this->Limit && InLimit <= StackSize);
+                this->UpdateHighWater();
+
+#if STACK_ALLOCATOR_GUARDS
+                LastUpperGuard = StackGuard::Release(this->Base, LastUpperGuard, this->Limit, InLimit);
+#endif
+                this->Limit = InLimit;
+            }
+
+        public:
+            /**
+             * @brief This class rolls the upper end of its stack back to the marker taken at
+             * construction when it goes out of scope.
+             *
+             */
+            class ScopedUpperMarker
+            {
+            private:
+                DoubleEndedStackAllocator& Stack;
+                StackMarker Marker;
+
+            public:
+                explicit ScopedUpperMarker(DoubleEndedStackAllocator& InStack)
+                    : Stack(InStack), Marker(InStack.GetUpperMarker()) {}
+
+                ~ScopedUpperMarker()
+                {
+                    Stack.FreeToUpperMarker(Marker);
+                }
+
+                ScopedUpperMarker(const ScopedUpperMarker&) = delete;
+                ScopedUpperMarker& operator=(const ScopedUpperMarker&) = delete;
+            };
+
+            DoubleEndedStackAllocator()
+                : LastUpperGuard(StackGuard::None) {}
+
+            /**
+             * @brief This method allocates an array of specified size and alignment, both
+             * in bytes, from the upper end of the stack.
+             *
+             * @param Size: the size of the chunk to allocate.
+             * @param Alignment: the alignment of the chunk to allocate.
+             *
+             * @return a pointer to the aligned block of memory, or nullptr if the two ends
+             * of the stack would meet.
+             *
+             */
+            INLINE void* AllocateUpper(usize Size, usize Alignment = 1)
+            {
+                ASSERT(Alignment >= 1);
+                ASSERT((Alignment & (Alignment - 1)) == 0);
+
+                // The guard sits above the allocation, between it and the previous upper allocation.
+                usize top = this->Limit - StackGuard::Size;
+                usize address = (reinterpret_cast<usize>(this->Base) + top - Size) & ~(Alignment - 1);
+                bool fits = this->Limit >= this->Offset + StackGuard::Size + Size &&
+                    address >= reinterpret_cast<usize>(this->Base) + this->Offset;
+
+                ASSERT(fits);
+                if (!fits)
+                    return nullptr;
+
+#if STACK_ALLOCATOR_GUARDS
+                StackGuard::Write(this->Base, top, LastUpperGuard);
+                LastUpperGuard = top;
+#endif
+                this->Limit = address - reinterpret_cast<usize>(this->Base);
+                return AllocationTracer::TracePooled(reinterpret_cast<void*>(address), Size);
+            }
+
+            /**
+             * @brief This method clears both ends of the stack.
+             *
+             */
+            INLINE void Clear()
+            {
+                Super::Clear();
+                ClearUpper();
+            }
+
+            /**
+             * @brief This method clears the upper end of the stack, leaving the lower end
+             * untouched.
+             *
+             */
+            INLINE void ClearUpper()
+            {
+                RewindUpper(StackSize);
+            }
+
+            /**
+             * @brief This method returns a marker to the current bottom of the upper end.
+             *
+             * @return the marker to pass to FreeToUpperMarker.
+             *
+             */
+            INLINE StackMarker GetUpperMarker() const { return this->Limit; }
+
+            /**
+             * @brief This method rolls the upper end back to a marker previously returned by
+             * GetUpperMarker, releasing every upper allocation made after it.
+             *
+             * @param InMarker: the marker to roll back to.
+             *
+             */
+            INLINE void FreeToUpperMarker(StackMarker InMarker)
+            {
+                RewindUpper(InMarker);
+            }
+
+            /**
+             * @brief This method returns the number of bytes in use by the upper end.
+             *
+             */
+            INLINE usize GetUpperOffset() const { return StackSize - this->Limit; }
+
+            /**
+             * @brief This method returns the number of bytes still free between both ends.
+             *
+             */
+            INLINE usize GetFreeSpace() const { return this->Limit - this->Offset; }
         };
     }
 }
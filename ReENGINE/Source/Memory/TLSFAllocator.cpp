@@ -0,0 +1,518 @@
+/*
+ * TLSFAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * TLSFAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "TLSFAllocator.hpp"
+#include "AllocationTracer.hpp"
+#include "DefaultAllocator.hpp"
+
+#include <immintrin.h>
+
+#if PLATFORM_WINDOWS
+#include <intrin.h>
+#endif
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const usize FREE_BIT = 1;
+			const usize BLOCK_HEADER_SIZE = 2 * sizeof(usize);
+			const usize BLOCK_MINIMUM_SIZE = 2 * sizeof(usize);
+			const usize POOL_HEADER_SIZE = 32;
+			const usize POOL_OVERHEAD = POOL_HEADER_SIZE + 2 * BLOCK_HEADER_SIZE;
+			const usize POOL_ALIGNMENT = 64;
+			const usize POOL_GRANULARITY = 64 * 1024;
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. Every
+			 * operation under it takes a bounded number of steps, so it is held only briefly.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+
+			FORCEINLINE u32 FindLastSet(usize InValue)
+			{
+#if PLATFORM_WINDOWS
+				unsigned long index;
+				_BitScanReverse64(&index, InValue);
+				return static_cast<u32>(index);
+#else
+				return static_cast<u32>(63 - __builtin_clzll(InValue));
+#endif
+			}
+
+			FORCEINLINE u32 FindFirstSet(u32 InValue)
+			{
+#if PLATFORM_WINDOWS
+				unsigned long index;
+				_BitScanForward(&index, InValue);
+				return static_cast<u32>(index);
+#else
+				return static_cast<u32>(__builtin_ctz(InValue));
+#endif
+			}
+		}
+
+		/*
+		 * @brief This structure sits right before every chunk. The physical neighbours of a
+		 * block are found through its size and its Previous pointer, and only free blocks use
+		 * the links to the other blocks of their list, which overlap the chunk itself.
+		 *
+		 */
+		struct TLSFAllocator::Block
+		{
+			Block* Previous;
+			usize Size;
+			Block* NextFree;
+			Block* PreviousFree;
+
+			FORCEINLINE usize GetSize() const { return Size & ~FREE_BIT; }
+			FORCEINLINE bool IsFree() const { return (Size & FREE_BIT) != 0; }
+			FORCEINLINE void SetSize(usize InSize, bool InFree) { Size = InSize | (InFree ? FREE_BIT : 0); }
+			FORCEINLINE u8* GetChunk() { return reinterpret_cast<u8*>(this) + BLOCK_HEADER_SIZE; }
+			FORCEINLINE Block* GetNext() { return reinterpret_cast<Block*>(GetChunk() + GetSize()); }
+
+			static FORCEINLINE Block* FromChunk(void* InChunk) { return reinterpret_cast<Block*>(static_cast<u8*>(InChunk) - BLOCK_HEADER_SIZE); }
+		};
+
+		/*
+		 * @brief This structure sits at the start of every pool, followed by its blocks and
+		 * by an empty block marked as used, so merging stops at the end of the pool.
+		 *
+		 */
+		struct alignas(32) TLSFAllocator::Pool
+		{
+			Pool* Next;
+			Pool* Previous;
+			usize Size;
+			bool Owned;
+		};
+
+		const usize TLSFAllocator::DEFAULT_POOL_SIZE;
+		const usize TLSFAllocator::ALIGNMENT;
+		const usize TLSFAllocator::MAXIMUM_SIZE;
+
+		namespace
+		{
+			/*
+			 * @brief This function maps a size to its list. Sizes below SMALL_BLOCK_SIZE are
+			 * split linearly, and the rest by their highest bit and the bits right below it.
+			 *
+			 */
+			template <u32 SecondLevelShift, u32 FirstLevelShift, usize SmallBlockSize>
+			FORCEINLINE void MapSize(usize InSize, u32* OutFirst, u32* OutSecond)
+			{
+				if (InSize < SmallBlockSize)
+				{
+					*OutFirst = 0;
+					*OutSecond = static_cast<u32>(InSize / (SmallBlockSize >> SecondLevelShift));
+				}
+				else
+				{
+					u32 bit = FindLastSet(InSize);
+					*OutSecond = static_cast<u32>(InSize >> (bit - SecondLevelShift)) ^ (1u << SecondLevelShift);
+					*OutFirst = bit - (FirstLevelShift - 1);
+				}
+			}
+		}
+
+		TLSFAllocator::TLSFAllocator(usize InPoolSize)
+			: _firstLevelMap(0), _poolSize(InPoolSize), _pools(nullptr), _poolCount(0), _capacity(0), _usedBytes(0), _usedBlocks(0), _freeBlocks(0)
+		{
+			for (u32 i = 0; i < FIRST_LEVEL_COUNT; ++i)
+			{
+				_secondLevelMap[i] = 0;
+				for (u32 j = 0; j < SECOND_LEVEL_COUNT; ++j)
+					_freeLists[i][j] = nullptr;
+			}
+
+			_lock.clear();
+		}
+
+		TLSFAllocator::~TLSFAllocator()
+		{
+			while (_pools)
+			{
+				Pool* next = _pools->Next;
+				if (_pools->Owned)
+					DefaultAllocator().FreeAligned(_pools);
+
+				_pools = next;
+			}
+		}
+
+		bool TLSFAllocator::AddPool(void* InMemory, usize InSize)
+		{
+			ASSERT(reinterpret_cast<usize>(InMemory) % ALIGNMENT == 0);
+
+			if (InSize < POOL_OVERHEAD + BLOCK_MINIMUM_SIZE || InSize - POOL_OVERHEAD >= MAXIMUM_SIZE)
+				return false;
+
+			SpinLockGuard guard(_lock);
+			CreatePool(InMemory, InSize, false);
+			return true;
+		}
+
+		void* TLSFAllocator::Allocate(usize Size)
+		{
+			return AllocateAligned(Size, ALIGNMENT);
+		}
+
+		void* TLSFAllocator::AllocateAligned(usize Size, usize Alignment)
+		{
+			ASSERT(Alignment >= 1 && (Alignment & (Alignment - 1)) == 0);
+			AllocationTracer::Scope trace;
+
+			if (Size > MAXIMUM_SIZE / 2)
+				return nullptr;
+
+			usize size = Size < BLOCK_MINIMUM_SIZE ? BLOCK_MINIMUM_SIZE : AlignUp(Size, ALIGNMENT);
+
+			// Over aligned chunks look for room to cut a free block off the front of the one found.
+			bool aligned = Alignment > ALIGNMENT;
+			usize request = aligned ? size + Alignment + BLOCK_HEADER_SIZE + BLOCK_MINIMUM_SIZE : size;
+
+			SpinLockGuard guard(_lock);
+
+			Block* block = FindFreeBlock(request);
+			if (!block)
+			{
+				if (!Grow(request))
+					return nullptr;
+
+				block = FindFreeBlock(request);
+				ASSERT(block);
+			}
+
+			if (aligned)
+			{
+				usize chunk = reinterpret_cast<usize>(block->GetChunk());
+				usize address = AlignUp(chunk, Alignment);
+				if (address != chunk && address - chunk < BLOCK_HEADER_SIZE + BLOCK_MINIMUM_SIZE)
+					address = AlignUp(chunk + BLOCK_HEADER_SIZE + BLOCK_MINIMUM_SIZE, Alignment);
+
+				if (address != chunk)
+				{
+					usize gap = address - chunk;
+					Block* next = block->GetNext();
+
+					Block* trimmed = Block::FromChunk(reinterpret_cast<void*>(address));
+					trimmed->Previous = block;
+					trimmed->SetSize(block->GetSize() - gap, true);
+					next->Previous = trimmed;
+
+					block->SetSize(gap - BLOCK_HEADER_SIZE, true);
+					InsertFreeBlock(block);
+					block = trimmed;
+				}
+			}
+
+			Block* remainder = Split(block, size);
+			if (remainder)
+				InsertFreeBlock(remainder);
+
+			block->SetSize(block->GetSize(), false);
+			_usedBytes += block->GetSize();
+			++_usedBlocks;
+			return trace.Allocated(block->GetChunk(), Size);
+		}
+
+		void TLSFAllocator::Free(void* Address)
+		{
+			if (!Address)
+				return;
+
+			Block* block = Block::FromChunk(Address);
+			ASSERT(!block->IsFree());
+
+			AllocationTracer::Scope trace;
+			trace.Freed(Address);
+
+			SpinLockGuard guard(_lock);
+
+			_usedBytes -= block->GetSize();
+			--_usedBlocks;
+
+			block = Merge(block);
+
+			// A pool the allocator grew by goes back to the operating system once it is empty,
+			// so a burst of allocations doesn't hold on to memory for the rest of the session.
+			if (!block->Previous && block->GetNext()->GetSize() == 0 && _poolCount > 1)
+			{
+				Pool* pool = reinterpret_cast<Pool*>(reinterpret_cast<u8*>(block) - POOL_HEADER_SIZE);
+				if (pool->Owned)
+				{
+					ReleasePool(pool);
+					return;
+				}
+			}
+
+			InsertFreeBlock(block);
+		}
+
+		void TLSFAllocator::FreeAligned(void* Address)
+		{
+			Free(Address);
+		}
+
+		usize TLSFAllocator::GetSize(void* InAddress)
+		{
+			return Block::FromChunk(InAddress)->GetSize();
+		}
+
+		TLSFStats TLSFAllocator::GetStats()
+		{
+			SpinLockGuard guard(_lock);
+
+			TLSFStats stats;
+			stats.PoolCount = _poolCount;
+			stats.Capacity = _capacity;
+			stats.UsedBytes = _usedBytes;
+			stats.UsedBlocks = _usedBlocks;
+			stats.FreeBlocks = _freeBlocks;
+			stats.FreeBytes = 0;
+			stats.LargestFreeBlock = 0;
+
+			// Only the largest class can hold the largest block, so only its list is walked.
+			if (_firstLevelMap)
+			{
+				u32 first = FindLastSet(_firstLevelMap);
+				u32 second = FindLastSet(_secondLevelMap[first]);
+				for (Block* block = _freeLists[first][second]; block; block = block->NextFree)
+					stats.LargestFreeBlock = block->GetSize() > stats.LargestFreeBlock ? block->GetSize() : stats.LargestFreeBlock;
+			}
+
+			// Everything not used, nor taken by a header or by the pools, is free.
+			usize overhead = _poolCount * POOL_OVERHEAD + (_usedBlocks + _freeBlocks - _poolCount) * BLOCK_HEADER_SIZE;
+			stats.FreeBytes = _capacity - _usedBytes - overhead;
+			return stats;
+		}
+
+		TLSFAllocator& TLSFAllocator::Shared()
+		{
+			// Intentionally never destroyed, so memory can be freed during static destruction.
+			static TLSFAllocator* allocator = new TLSFAllocator();
+			return *allocator;
+		}
+
+		TLSFAllocator::Block* TLSFAllocator::FindFreeBlock(usize InSize)
+		{
+			// Round up to the next list, so any block found in it is large enough.
+			usize size = InSize;
+			if (size >= SMALL_BLOCK_SIZE)
+				size += (static_cast<usize>(1) << (FindLastSet(size) - SECOND_LEVEL_SHIFT)) - 1;
+
+			u32 first, second;
+			MapSize<SECOND_LEVEL_SHIFT, FIRST_LEVEL_SHIFT, SMALL_BLOCK_SIZE>(size, &first, &second);
+			if (first >= FIRST_LEVEL_COUNT)
+				return nullptr;
+
+			u32 secondMap = _secondLevelMap[first] & (~0u << second);
+			if (!secondMap)
+			{
+				u32 firstMap = first + 1 < 32 ? _firstLevelMap & (~0u << (first + 1)) : 0;
+				if (!firstMap)
+					return nullptr;
+
+				first = FindFirstSet(firstMap);
+				secondMap = _secondLevelMap[first];
+			}
+
+			second = FindFirstSet(secondMap);
+			Block* block = _freeLists[first][second];
+			RemoveFreeBlock(block, first, second);
+			return block;
+		}
+
+		void TLSFAllocator::InsertFreeBlock(Block* InBlock)
+		{
+			u32 first, second;
+			MapSize<SECOND_LEVEL_SHIFT, FIRST_LEVEL_SHIFT, SMALL_BLOCK_SIZE>(InBlock->GetSize(), &first, &second);
+
+			Block* head = _freeLists[first][second];
+			InBlock->NextFree = head;
+			InBlock->PreviousFree = nullptr;
+			if (head)
+				head->PreviousFree = InBlock;
+
+			_freeLists[first][second] = InBlock;
+			_firstLevelMap |= 1u << first;
+			_secondLevelMap[first] |= 1u << second;
+			++_freeBlocks;
+		}
+
+		void TLSFAllocator::RemoveFreeBlock(Block* InBlock)
+		{
+			u32 first, second;
+			MapSize<SECOND_LEVEL_SHIFT, FIRST_LEVEL_SHIFT, SMALL_BLOCK_SIZE>(InBlock->GetSize(), &first, &second);
+			RemoveFreeBlock(InBlock, first, second);
+		}
+
+		void TLSFAllocator::RemoveFreeBlock(Block* InBlock, u32 InFirst, u32 InSecond)
+		{
+			if (InBlock->PreviousFree)
+				InBlock->PreviousFree->NextFree = InBlock->NextFree;
+
+			if (InBlock->NextFree)
+				InBlock->NextFree->PreviousFree = InBlock->PreviousFree;
+
+			if (_freeLists[InFirst][InSecond] == InBlock)
+			{
+				_freeLists[InFirst][InSecond] = InBlock->NextFree;
+				if (!InBlock->NextFree)
+				{
+					_secondLevelMap[InFirst] &= ~(1u << InSecond);
+					if (!_secondLevelMap[InFirst])
+						_firstLevelMap &= ~(1u << InFirst);
+				}
+			}
+
+			--_freeBlocks;
+		}
+
+		TLSFAllocator::Block* TLSFAllocator::Split(Block* InBlock, usize InSize)
+		{
+			// Leftovers too small to hold a free block stay with the chunk.
+			if (InBlock->GetSize() < InSize + BLOCK_HEADER_SIZE + BLOCK_MINIMUM_SIZE)
+				return nullptr;
+
+			Block* next = InBlock->GetNext();
+
+			Block* remainder = reinterpret_cast<Block*>(InBlock->GetChunk() + InSize);
+			remainder->Previous = InBlock;
+			remainder->SetSize(InBlock->GetSize() - InSize - BLOCK_HEADER_SIZE, true);
+			next->Previous = remainder;
+
+			InBlock->SetSize(InSize, InBlock->IsFree());
+			return remainder;
+		}
+
+		TLSFAllocator::Block* TLSFAllocator::Merge(Block* InBlock)
+		{
+			Block* block = InBlock;
+			block->SetSize(block->GetSize(), true);
+
+			Block* previous = block->Previous;
+			if (previous && previous->IsFree())
+			{
+				RemoveFreeBlock(previous);
+				previous->SetSize(previous->GetSize() + BLOCK_HEADER_SIZE + block->GetSize(), true);
+				block = previous;
+				block->GetNext()->Previous = block;
+			}
+
+			Block* next = block->GetNext();
+			if (next->IsFree())
+			{
+				RemoveFreeBlock(next);
+				block->SetSize(block->GetSize() + BLOCK_HEADER_SIZE + next->GetSize(), true);
+				block->GetNext()->Previous = block;
+			}
+
+			return block;
+		}
+
+		bool TLSFAllocator::Grow(usize InSize)
+		{
+			if (!_poolSize)
+				return false;
+
+			// Requests larger than a pool get one of their own, rounded up so it is reused. The
+			// search rounds the request up to the next list, so the block must cover that too.
+			usize size = InSize + POOL_OVERHEAD + ALIGNMENT;
+			if (InSize >= SMALL_BLOCK_SIZE)
+				size += static_cast<usize>(1) << (FindLastSet(InSize) - SECOND_LEVEL_SHIFT);
+
+			size = AlignUp(size > _poolSize ? size : _poolSize, POOL_GRANULARITY);
+			if (size - POOL_OVERHEAD >= MAXIMUM_SIZE)
+				return false;
+
+			void* memory = DefaultAllocator().AllocateAligned(size, POOL_ALIGNMENT);
+			if (!memory)
+				return false;
+
+			CreatePool(memory, size, true);
+			return true;
+		}
+
+		TLSFAllocator::Pool* TLSFAllocator::CreatePool(void* InMemory, usize InSize, bool InOwned)
+		{
+			static_assert(sizeof(Pool) == POOL_HEADER_SIZE, "The pool header must keep the blocks aligned.");
+			static_assert(sizeof(Block) == BLOCK_HEADER_SIZE + BLOCK_MINIMUM_SIZE, "A free block must fit in the smallest chunk.");
+			static_assert(BLOCK_HEADER_SIZE == ALIGNMENT, "The block header must preserve the alignment of chunks.");
+
+			Pool* pool = static_cast<Pool*>(InMemory);
+			pool->Next = _pools;
+			pool->Previous = nullptr;
+			pool->Size = InSize;
+			pool->Owned = InOwned;
+			if (_pools)
+				_pools->Previous = pool;
+
+			_pools = pool;
+			++_poolCount;
+			_capacity += InSize;
+
+			Block* block = reinterpret_cast<Block*>(reinterpret_cast<u8*>(pool) + POOL_HEADER_SIZE);
+			block->Previous = nullptr;
+			block->SetSize((InSize - POOL_OVERHEAD) & ~(ALIGNMENT - 1), true);
+
+			// The sentinel is never free, so no block ever merges past the end of the pool.
+			Block* sentinel = block->GetNext();
+			sentinel->Previous = block;
+			sentinel->SetSize(0, false);
+
+			// Any slack from rounding the pool down goes to the overhead, so the stats add up.
+			_capacity -= InSize - POOL_OVERHEAD - block->GetSize();
+
+			InsertFreeBlock(block);
+			return pool;
+		}
+
+		void TLSFAllocator::ReleasePool(Pool* InPool)
+		{
+			if (InPool->Previous)
+				InPool->Previous->Next = InPool->Next;
+			else
+				_pools = InPool->Next;
+
+			if (InPool->Next)
+				InPool->Next->Previous = InPool->Previous;
+
+			Block* block = reinterpret_cast<Block*>(reinterpret_cast<u8*>(InPool) + POOL_HEADER_SIZE);
+			--_poolCount;
+			_capacity -= block->GetSize() + POOL_OVERHEAD;
+
+			DefaultAllocator().FreeAligned(InPool);
+		}
+	}
+}
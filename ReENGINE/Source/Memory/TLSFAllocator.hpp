@@ -0,0 +1,207 @@
+/*
+ * TLSFAllocator.hpp
+ *
+ * This header file declares the TLSFAllocator, a general purpose allocator
+ * based on a two level segregated fit, which allocates and frees in constant
+ * time from one or more pools of memory.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This structure holds a snapshot of the state of a TLSFAllocator.
+		 *
+		 */
+		struct TLSFStats
+		{
+			usize PoolCount;
+			usize Capacity;
+			usize UsedBytes;
+			usize UsedBlocks;
+			usize FreeBytes;
+			usize FreeBlocks;
+			usize LargestFreeBlock;
+
+			/*
+			 * @brief This method returns how fragmented the free memory is, from zero when it
+			 * is all in one block, to almost one when it is scattered in small blocks.
+			 *
+			 */
+			INLINE f32 GetFragmentation() const
+			{
+				return FreeBytes ? 1.0f - static_cast<f32>(LargestFreeBlock) / static_cast<f32>(FreeBytes) : 0.0f;
+			}
+		};
+
+		/*
+		 * @brief This class is responsible for general purpose allocations with a bounded
+		 * worst case, so it can be used on the frame's critical path.
+		 *
+		 * Free blocks are kept in lists segregated by size, in classes that are powers of two
+		 * split linearly in 32. Two levels of bitmaps find a list that fits any request with a
+		 * couple of bit scans, and freed blocks are merged with their physical neighbours right
+		 * away, so neither allocating nor freeing ever walks a list. The allocator is shared
+		 * between threads behind a spin lock, which is held for a bounded number of steps.
+		 *
+		 */
+		class TLSFAllocator : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the default size of the pools the allocator grows by.
+			 *
+			 */
+			static const usize DEFAULT_POOL_SIZE = 16 * 1024 * 1024;
+
+			/*
+			 * @brief This constant holds the alignment of every block, and the granularity of
+			 * their sizes.
+			 *
+			 */
+			static const usize ALIGNMENT = 16;
+
+			/*
+			 * @brief This constant holds the largest chunk the allocator can hand out.
+			 *
+			 */
+			static const usize MAXIMUM_SIZE = static_cast<usize>(1) << 36;
+
+			/*
+			 * @brief This constructor sets up an allocator without any memory. Memory is
+			 * either given to it with AddPool, or allocated from the operating system, a pool
+			 * at a time, when it runs out.
+			 *
+			 * @param InPoolSize: the size of the pools to grow by, or zero to never grow.
+			 *
+			 */
+			explicit TLSFAllocator(usize InPoolSize = DEFAULT_POOL_SIZE);
+
+			/*
+			 * @brief This destructor returns the pools the allocator grew by to the operating
+			 * system. Chunks that are still in use become invalid.
+			 *
+			 */
+			virtual ~TLSFAllocator();
+
+			TLSFAllocator(const TLSFAllocator&) = delete;
+			TLSFAllocator& operator=(const TLSFAllocator&) = delete;
+
+			/*
+			 * @brief This method gives the allocator a pool of memory to allocate from. The
+			 * memory remains owned by the caller, and must outlive the allocator.
+			 *
+			 * @param InMemory: the start of the pool, aligned to ALIGNMENT.
+			 * @param InSize: the size of the pool, in bytes.
+			 * @return true if the pool was added, false if it is too small or too large.
+			 *
+			 */
+			bool AddPool(void* InMemory, usize InSize);
+
+			/*
+			 * @brief This method allocates a chunk of memory aligned to 16 bytes.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @return a void pointer to the chunk, or nullptr if it failed.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates an aligned chunk of memory.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if it failed.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method frees a chunk, merging it with its free neighbours.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method frees a chunk, the same as Free.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method returns the usable size of an allocated chunk, which may be
+			 * larger than the size requested.
+			 *
+			 */
+			static usize GetSize(void* InAddress);
+
+			/*
+			 * @brief This method returns a snapshot of the state of the allocator, walking
+			 * only the list of the largest free blocks.
+			 *
+			 */
+			TLSFStats GetStats();
+
+			/*
+			 * @brief This method returns the allocator shared by the whole engine, which
+			 * lives as long as the program.
+			 *
+			 */
+			static TLSFAllocator& Shared();
+
+		private:
+			/*
+			 * @brief The second level splits every power of two in 32 lists, so a block is
+			 * never more than about 3% larger than the class it was found in.
+			 *
+			 */
+			static const u32 SECOND_LEVEL_SHIFT = 5;
+			static const u32 SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_SHIFT;
+			static const u32 FIRST_LEVEL_SHIFT = SECOND_LEVEL_SHIFT + 4;
+			static const u32 FIRST_LEVEL_COUNT = 36 - FIRST_LEVEL_SHIFT + 1;
+			static const usize SMALL_BLOCK_SIZE = static_cast<usize>(1) << FIRST_LEVEL_SHIFT;
+
+			struct Block;
+			struct Pool;
+
+			Block* FindFreeBlock(usize InSize);
+			void InsertFreeBlock(Block* InBlock);
+			void RemoveFreeBlock(Block* InBlock);
+			void RemoveFreeBlock(Block* InBlock, u32 InFirst, u32 InSecond);
+			Block* Split(Block* InBlock, usize InSize);
+			Block* Merge(Block* InBlock);
+			bool Grow(usize InSize);
+			Pool* CreatePool(void* InMemory, usize InSize, bool InOwned);
+			void ReleasePool(Pool* InPool);
+
+			u32 _firstLevelMap;
+			u32 _secondLevelMap[FIRST_LEVEL_COUNT];
+			Block* _freeLists[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+			usize _poolSize;
+			Pool* _pools;
+			usize _poolCount;
+			usize _capacity;
+			usize _usedBytes;
+			usize _usedBlocks;
+			usize _freeBlocks;
+
+			boost::atomic_flag _lock;
+		};
+	}
+}
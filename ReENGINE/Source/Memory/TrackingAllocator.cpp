@@ -0,0 +1,151 @@
+/*
+ * TrackingAllocator.cpp
+ *
+ * This source file defines the methods declared in the
+ * TrackingAllocator.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "TrackingAllocator.hpp"
+#include "AllocationTracer.hpp"
+#include "DefaultAllocator.hpp"
+#include "MemoryManager.hpp"
+#include "SmallObjectAllocator.hpp"
+#include "TLSFAllocator.hpp"
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u8 HEADER_MAGIC = 0xA7;
+			const u8 HEADER_MAGIC_ALIGNED = 0xA8;
+			const u8 HEADER_MAGIC_TLSF = 0xA9;
+			const u8 HEADER_MAGIC_SMALL_OBJECT = 0xAA;
+			const usize DEFAULT_ALIGNMENT = 16;
+
+			/*
+			 * @brief This structure sits right before every tracked allocation, so it can be
+			 * accounted back to its tag and call site, and its real start found, when freed.
+			 *
+			 */
+			struct AllocationHeader
+			{
+				usize Size;
+				u32 Site;
+				u16 Offset;
+				u8 Tag;
+				u8 Magic;
+			};
+
+			static_assert(sizeof(AllocationHeader) <= 16, "The allocation header must fit the default alignment.");
+
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+		}
+
+		const usize TrackingAllocator::MAXIMUM_ALIGNMENT;
+
+		void* TrackingAllocator::Allocate(usize Size)
+		{
+			return AllocateAt(Size, DEFAULT_ALIGNMENT, nullptr, 0);
+		}
+
+		void* TrackingAllocator::AllocateAligned(usize Size, usize Alignment)
+		{
+			return AllocateAt(Size, Alignment, nullptr, 0);
+		}
+
+		void* TrackingAllocator::AllocateAt(usize Size, usize Alignment, const utf8* File, u32 Line)
+		{
+			ASSERT(Alignment >= 1 && (Alignment & (Alignment - 1)) == 0);
+			ASSERT(Alignment <= MAXIMUM_ALIGNMENT);
+			AllocationTracer::Scope trace;
+
+			Alignment = Alignment < DEFAULT_ALIGNMENT ? DEFAULT_ALIGNMENT : Alignment;
+			usize offset = AlignUp(sizeof(AllocationHeader), Alignment);
+
+			u32 site;
+			if (!MemoryManager::TrackAllocation(_tag, Size, File, Line, &site))
+				return nullptr;
+
+			// The system heap already aligns to 16 bytes, and its unaligned path is the faster one.
+			u8 magic;
+			u8* memory;
+			HeapType heap = MemoryManager::GetHeap();
+			if (heap == HeapType::TLSF)
+			{
+				magic = HEADER_MAGIC_TLSF;
+				memory = static_cast<u8*>(TLSFAllocator::Shared().AllocateAligned(offset + Size, Alignment));
+			}
+			else if (heap == HeapType::SmallObject)
+			{
+				magic = HEADER_MAGIC_SMALL_OBJECT;
+				memory = static_cast<u8*>(SmallObjectAllocator::Shared().AllocateAligned(offset + Size, Alignment));
+			}
+			else
+			{
+				DefaultAllocator allocator;
+				magic = Alignment > DEFAULT_ALIGNMENT ? HEADER_MAGIC_ALIGNED : HEADER_MAGIC;
+				memory = static_cast<u8*>(magic == HEADER_MAGIC_ALIGNED ? allocator.AllocateAligned(offset + Size, Alignment) : allocator.Allocate(offset + Size));
+			}
+
+			if (!memory)
+			{
+				MemoryManager::TrackFree(_tag, Size, site);
+				return nullptr;
+			}
+
+			u8* address = memory + offset;
+			AllocationHeader* header = reinterpret_cast<AllocationHeader*>(address) - 1;
+			header->Size = Size;
+			header->Site = site;
+			header->Offset = static_cast<u16>(offset);
+			header->Tag = static_cast<u8>(_tag);
+			header->Magic = magic;
+			return trace.Allocated(address, Size);
+		}
+
+		void TrackingAllocator::Free(void* Address)
+		{
+			if (!Address)
+				return;
+
+			AllocationTracer::Scope trace;
+			trace.Freed(Address);
+
+			AllocationHeader* header = static_cast<AllocationHeader*>(Address) - 1;
+			ASSERT(header->Magic == HEADER_MAGIC || header->Magic == HEADER_MAGIC_ALIGNED || header->Magic == HEADER_MAGIC_TLSF ||
+				header->Magic == HEADER_MAGIC_SMALL_OBJECT);
+
+			MemoryManager::TrackFree(static_cast<MemoryTag>(header->Tag), header->Size, header->Site);
+
+			// Clear the magic, so a second free of the same address trips the assertion. The
+			// magic also records the heap, so memory goes back where it came from even if the
+			// heap was switched in the meantime.
+			u8 magic = header->Magic;
+			header->Magic = 0;
+
+			DefaultAllocator allocator;
+			u8* memory = static_cast<u8*>(Address) - header->Offset;
+			if (magic == HEADER_MAGIC_TLSF)
+				TLSFAllocator::Shared().Free(memory);
+			else if (magic == HEADER_MAGIC_SMALL_OBJECT)
+				SmallObjectAllocator::Shared().Free(memory);
+			else if (magic == HEADER_MAGIC_ALIGNED)
+				allocator.FreeAligned(memory);
+			else
+				allocator.Free(memory);
+		}
+
+		void TrackingAllocator::FreeAligned(void* Address)
+		{
+			Free(Address);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/*
+ * TrackingAllocator.hpp
+ *
+ * This header file declares the TrackingAllocator, which allocates from the
+ * operating system and accounts every allocation to a memory tag.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+#include "MemoryTag.hpp"
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This class is responsible for allocating memory on behalf of a subsystem and
+		 * reporting it to the MemoryManager, which keeps the statistics and budgets of each tag.
+		 *
+		 * Every allocation is preceded by a small header recording its size, tag and call site,
+		 * so memory can be freed through the allocator of any tag.
+		 *
+		 */
+		class TrackingAllocator : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the largest alignment the allocator supports.
+			 *
+			 */
+			static const usize MAXIMUM_ALIGNMENT = 32 * 1024;
+
+			/*
+			 * @brief This constructor sets up an allocator for the given tag.
+			 *
+			 * @param InTag: the tag every allocation is accounted to.
+			 *
+			 */
+			explicit TrackingAllocator(MemoryTag InTag)
+				: _tag(InTag) {}
+
+			/*
+			 * @brief This method allocates a chunk of memory aligned to 16 bytes.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @return a void pointer to the chunk, or nullptr if it failed or the tag's enforced
+			 * budget would be exceeded.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates an aligned chunk of memory.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if it failed or the tag's enforced
+			 * budget would be exceeded.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method allocates an aligned chunk of memory and, when call site capture
+			 * is enabled, records the line of code it was requested from.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @param File: the file of the call site, which must be a static string.
+			 * @param Line: the line of the call site.
+			 * @return a void pointer to the chunk, or nullptr if it failed or the tag's enforced
+			 * budget would be exceeded.
+			 *
+			 */
+			void* AllocateAt(usize Size, usize Alignment, const utf8* File, u32 Line);
+
+			/*
+			 * @brief This method frees a chunk allocated by any tracking allocator.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method frees a chunk allocated by any tracking allocator, the same as Free.
+			 *
+			 * @param Address: the pointer to the chunk to free, or nullptr.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method returns the tag the allocator accounts memory to.
+			 *
+			 */
+			INLINE MemoryTag GetTag() const { return _tag; }
+
+		private:
+			MemoryTag _tag;
+		};
+	}
+}
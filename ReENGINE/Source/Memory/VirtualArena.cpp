@@ -0,0 +1,313 @@
+/*
+ * VirtualArena.cpp
+ *
+ * This source file defines the methods declared in the
+ * VirtualArena.hpp header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "VirtualArena.hpp"
+#include "AllocationTracer.hpp"
+#include "MemoryManager.hpp"
+
+#include <immintrin.h>
+
+#if !PLATFORM_WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Re
+{
+	namespace Memory
+	{
+		namespace
+		{
+			const u8 RESET_PATTERN = 0xDD;
+
+			/*
+			 * @brief This structure holds a spin lock for the duration of a scope. It is only
+			 * taken to commit or decommit pages, which is rare next to allocating.
+			 *
+			 */
+			struct SpinLockGuard
+			{
+				boost::atomic_flag& Flag;
+
+				explicit SpinLockGuard(boost::atomic_flag& InFlag)
+					: Flag(InFlag)
+				{
+					while (Flag.test_and_set(boost::memory_order_acquire))
+						_mm_pause();
+				}
+
+				~SpinLockGuard()
+				{
+					Flag.clear(boost::memory_order_release);
+				}
+			};
+
+			FORCEINLINE usize AlignUp(usize InValue, usize InAlignment)
+			{
+				return (InValue + InAlignment - 1) & ~(InAlignment - 1);
+			}
+
+			usize GetPageSize()
+			{
+#if PLATFORM_WINDOWS
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return static_cast<usize>(info.dwPageSize);
+#else
+				return static_cast<usize>(sysconf(_SC_PAGESIZE));
+#endif
+			}
+
+			bool CommitPages(u8* InAddress, usize InSize)
+			{
+#if PLATFORM_WINDOWS
+				return VirtualAlloc(InAddress, InSize, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+				return mprotect(InAddress, InSize, PROT_READ | PROT_WRITE) == 0;
+#endif
+			}
+
+			void DecommitPages(u8* InAddress, usize InSize)
+			{
+#if PLATFORM_WINDOWS
+				VirtualFree(InAddress, InSize, MEM_DECOMMIT);
+#else
+				// Drop the pages first, then forbid access, so stale pointers fault instead of reading zeros.
+				madvise(InAddress, InSize, MADV_DONTNEED);
+				mprotect(InAddress, InSize, PROT_NONE);
+#endif
+			}
+		}
+
+		const usize VirtualArena::HUGE_PAGE_SIZE;
+		const usize VirtualArena::COMMIT_GRANULARITY;
+
+		VirtualArena::VirtualArena(usize InReserveSize, HugePages InHugePages, MemoryTag InTag)
+			: _base(nullptr), _mapping(nullptr), _mappingSize(0), _reserved(0), _granularity(0), _hugePages(HugePages::None), _tag(InTag),
+			_tracked(true), _used(0), _committed(0)
+		{
+			_lock.clear();
+			Reserve(InReserveSize, InHugePages);
+		}
+
+		VirtualArena::VirtualArena(usize InReserveSize, HugePages InHugePages, Untracked)
+			: _base(nullptr), _mapping(nullptr), _mappingSize(0), _reserved(0), _granularity(0), _hugePages(HugePages::None), _tag(MemoryTag::General),
+			_tracked(false), _used(0), _committed(0)
+		{
+			_lock.clear();
+			Reserve(InReserveSize, InHugePages);
+		}
+
+		VirtualArena::~VirtualArena()
+		{
+			if (!_base)
+				return;
+
+			usize committed = _committed.load(boost::memory_order_relaxed);
+			if (committed && _tracked)
+				MemoryManager::TrackFree(_tag, committed, MemoryManager::NO_CALL_SITE);
+
+#if PLATFORM_WINDOWS
+			VirtualFree(_mapping, 0, MEM_RELEASE);
+#else
+			munmap(_mapping, _mappingSize);
+#endif
+		}
+
+		void VirtualArena::Reserve(usize InReserveSize, HugePages InHugePages)
+		{
+			usize pageSize = GetPageSize();
+			usize granularity = COMMIT_GRANULARITY > pageSize ? COMMIT_GRANULARITY : pageSize;
+
+#if PLATFORM_WINDOWS
+			// Large pages can't be committed on demand, so the whole range is committed up front.
+			if (InHugePages == HugePages::Explicit && GetLargePageMinimum() > 0)
+			{
+				usize largePage = static_cast<usize>(GetLargePageMinimum());
+				usize size = AlignUp(InReserveSize, largePage);
+				void* memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+				u32 site;
+				if (memory && (!_tracked || MemoryManager::TrackAllocation(_tag, size, nullptr, 0, &site)))
+				{
+					_base = _mapping = static_cast<u8*>(memory);
+					_mappingSize = _reserved = size;
+					_granularity = largePage;
+					_hugePages = HugePages::Explicit;
+					_committed.store(size, boost::memory_order_release);
+					return;
+				}
+
+				if (memory)
+					VirtualFree(memory, 0, MEM_RELEASE);
+			}
+
+			usize size = AlignUp(InReserveSize, granularity);
+			void* memory = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+			if (!memory)
+				return;
+
+			_base = _mapping = static_cast<u8*>(memory);
+			_mappingSize = _reserved = size;
+			_granularity = granularity;
+#else
+			// Explicit huge pages are reserved from the system's pool as the range is mapped,
+			// so a pool too small fails here rather than when the pages are touched.
+			if (InHugePages == HugePages::Explicit)
+			{
+				usize size = AlignUp(InReserveSize, HUGE_PAGE_SIZE);
+				void* memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (memory != MAP_FAILED)
+				{
+					_base = _mapping = static_cast<u8*>(memory);
+					_mappingSize = _reserved = size;
+					_granularity = HUGE_PAGE_SIZE;
+					_hugePages = HugePages::Explicit;
+					return;
+				}
+			}
+
+			// Transparent huge pages need the range aligned to them, so reserve a huge page more.
+			bool transparent = InHugePages != HugePages::None;
+			usize alignment = transparent ? HUGE_PAGE_SIZE : granularity;
+			usize size = AlignUp(InReserveSize, alignment);
+			usize mappingSize = transparent ? size + HUGE_PAGE_SIZE : size;
+
+			void* memory = mmap(nullptr, mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (memory == MAP_FAILED)
+				return;
+
+			_mapping = static_cast<u8*>(memory);
+			_mappingSize = mappingSize;
+			_base = reinterpret_cast<u8*>(AlignUp(reinterpret_cast<usize>(memory), alignment));
+			_reserved = size;
+			_granularity = alignment;
+
+			if (transparent && madvise(_base, _reserved, MADV_HUGEPAGE) == 0)
+				_hugePages = HugePages::Transparent;
+#endif
+		}
+
+		void* VirtualArena::Allocate(usize Size)
+		{
+			return AllocateAligned(Size, 16);
+		}
+
+		void* VirtualArena::AllocateAligned(usize Size, usize Alignment)
+		{
+			ASSERT(Alignment >= 1 && (Alignment & (Alignment - 1)) == 0);
+
+			if (!_base)
+				return nullptr;
+
+			usize base = reinterpret_cast<usize>(_base);
+			usize offset = _used.load(boost::memory_order_acquire);
+			for (;;)
+			{
+				usize start = AlignUp(base + offset, Alignment) - base;
+				if (start > _reserved || Size > _reserved - start)
+					return nullptr;
+
+				usize end = start + Size;
+				if (end > _committed.load(boost::memory_order_acquire) && !Commit(end))
+					return nullptr;
+
+				if (_used.compare_exchange_weak(offset, end, boost::memory_order_acq_rel, boost::memory_order_acquire))
+					return AllocationTracer::TracePooled(_base + start, Size);
+			}
+		}
+
+		void VirtualArena::Free(void* Address)
+		{}
+
+		void VirtualArena::FreeAligned(void* Address)
+		{}
+
+		void VirtualArena::FreeToMarker(StackMarker InMarker)
+		{
+			usize used = _used.load(boost::memory_order_relaxed);
+			ASSERT(InMarker <= used);
+
+#if defined(ASSERTIONS)
+			// Poison everything released, so memory used past its lifetime stands out.
+			Set(_base + InMarker, RESET_PATTERN, used - InMarker);
+#endif
+
+			_used.store(InMarker, boost::memory_order_release);
+		}
+
+		usize VirtualArena::Decommit(usize InKeepBytes)
+		{
+			if (!_base)
+				return 0;
+
+#if PLATFORM_WINDOWS
+			// Large pages stay committed for as long as the range is reserved.
+			if (_hugePages == HugePages::Explicit)
+				return 0;
+#endif
+
+			SpinLockGuard guard(_lock);
+
+			usize used = _used.load(boost::memory_order_relaxed);
+			usize keep = InKeepBytes > _reserved - used ? _reserved : used + InKeepBytes;
+			usize start = AlignUp(keep, _granularity);
+			usize committed = _committed.load(boost::memory_order_relaxed);
+			if (start >= committed)
+				return 0;
+
+			DecommitPages(_base + start, committed - start);
+
+			// The committed pages count as a single live allocation of the tag, whatever their size.
+			if (_tracked)
+				MemoryManager::TrackFree(_tag, committed - start, MemoryManager::NO_CALL_SITE);
+
+			if (_tracked && start)
+			{
+				u32 site;
+				MemoryManager::TrackAllocation(_tag, 0, nullptr, 0, &site);
+			}
+
+			_committed.store(start, boost::memory_order_release);
+			return committed - start;
+		}
+
+		bool VirtualArena::Commit(usize InEnd)
+		{
+			SpinLockGuard guard(_lock);
+
+			usize committed = _committed.load(boost::memory_order_relaxed);
+			if (InEnd <= committed)
+				return true;
+
+			usize end = AlignUp(InEnd, _granularity);
+			end = end > _reserved ? _reserved : end;
+
+			u32 site;
+			if (_tracked && !MemoryManager::TrackAllocation(_tag, end - committed, nullptr, 0, &site))
+				return false;
+
+			if (!CommitPages(_base + committed, end - committed))
+			{
+				if (_tracked)
+					MemoryManager::TrackFree(_tag, end - committed, site);
+
+				return false;
+			}
+
+			// Only the growth was accounted, so close the previous allocation without freeing bytes.
+			if (_tracked && committed)
+				MemoryManager::TrackFree(_tag, 0, site);
+
+			_committed.store(end, boost::memory_order_release);
+			return true;
+		}
+	}
+}
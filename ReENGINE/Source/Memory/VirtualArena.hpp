@@ -0,0 +1,243 @@
+/*
+ * VirtualArena.hpp
+ *
+ * This header file declares the VirtualArena, a linear allocator that reserves
+ * a large range of address space up front and commits its pages on demand,
+ * optionally backed by huge pages.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Allocator.hpp"
+#include "MemoryTag.hpp"
+#include "StackAllocator.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace Re
+{
+	namespace Memory
+	{
+		/*
+		 * @brief This enumeration lists how a VirtualArena may back its pages with huge pages.
+		 *
+		 * Transparent pages are a hint the operating system may honour as pages are touched,
+		 * on Linux only. Explicit pages come from the operating system's reserved huge pages,
+		 * and on Windows must be committed all at once. When the system can't provide them,
+		 * explicit pages fall back to transparent ones on Linux, and to regular pages otherwise.
+		 *
+		 */
+		enum class HugePages : u8
+		{
+			None,
+			Transparent,
+			Explicit
+		};
+
+		/*
+		 * @brief This class is responsible for large, long lived pools of memory, such as the
+		 * storage of components, asset caches and the mirrors of staging buffers.
+		 *
+		 * The arena reserves its whole range when constructed, so it never moves nor copies
+		 * what it holds, and only commits pages as allocations reach them. Allocations are
+		 * linear and released all at once, by rolling back to a marker or resetting, after
+		 * which the unused tail of the range can be decommitted to return it to the system.
+		 * Committed memory is accounted to the arena's tag, when it is given one.
+		 *
+		 */
+		class VirtualArena : public IAllocator
+		{
+		public:
+			/*
+			 * @brief This constant holds the size of the huge pages the arena aligns to.
+			 *
+			 */
+			static const usize HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+			/*
+			 * @brief This constant holds the smallest amount of memory committed at once with
+			 * regular pages, so a run of small allocations doesn't commit a page at a time.
+			 *
+			 */
+			static const usize COMMIT_GRANULARITY = 64 * 1024;
+
+			/*
+			 * @brief This constructor reserves the range of the arena, without committing it.
+			 *
+			 * @param InReserveSize: the size of the range to reserve, in bytes.
+			 * @param InHugePages: whether to back the range with huge pages.
+			 * @param InTag: the tag the committed memory is accounted to.
+			 *
+			 */
+			VirtualArena(usize InReserveSize, HugePages InHugePages = HugePages::None, MemoryTag InTag = MemoryTag::General);
+
+			/*
+			 * @brief This structure selects the constructor of an arena whose memory is not
+			 * accounted to any tag.
+			 *
+			 */
+			struct Untracked {};
+
+			/*
+			 * @brief This constructor reserves the range of an arena whose memory is not
+			 * accounted to any tag, for the heaps that sit underneath the tracking allocators.
+			 *
+			 * @param InReserveSize: the size of the range to reserve, in bytes.
+			 * @param InHugePages: whether to back the range with huge pages.
+			 * @param InUntracked: selects this constructor.
+			 *
+			 */
+			VirtualArena(usize InReserveSize, HugePages InHugePages, Untracked InUntracked);
+
+			/*
+			 * @brief This destructor releases the whole range back to the operating system.
+			 *
+			 */
+			virtual ~VirtualArena();
+
+			VirtualArena(const VirtualArena&) = delete;
+			VirtualArena& operator=(const VirtualArena&) = delete;
+
+			/*
+			 * @brief This method allocates a chunk of memory aligned to 16 bytes, committing
+			 * pages as needed. It may be called from any thread.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @return a void pointer to the chunk, or nullptr if the range is exhausted or the
+			 * pages could not be committed.
+			 *
+			 */
+			virtual void* Allocate(usize Size) override;
+
+			/*
+			 * @brief This method allocates an aligned chunk of memory, committing pages as
+			 * needed. It may be called from any thread.
+			 *
+			 * @param Size: the size of the chunk to allocate.
+			 * @param Alignment: the alignment of the chunk, which must be a power of two.
+			 * @return a void pointer to the chunk, or nullptr if the range is exhausted or the
+			 * pages could not be committed.
+			 *
+			 */
+			virtual void* AllocateAligned(usize Size, usize Alignment) override;
+
+			/*
+			 * @brief This method does nothing, since memory is released by rolling back the arena.
+			 *
+			 */
+			virtual void Free(void* Address) override;
+
+			/*
+			 * @brief This method does nothing, since memory is released by rolling back the arena.
+			 *
+			 */
+			virtual void FreeAligned(void* Address) override;
+
+			/*
+			 * @brief This method returns a marker to the current top of the arena.
+			 *
+			 */
+			INLINE StackMarker GetMarker() const { return _used.load(boost::memory_order_acquire); }
+
+			/*
+			 * @brief This method releases everything allocated after a marker. It must not
+			 * run concurrently with allocations. The pages stay committed for reuse.
+			 *
+			 * @param InMarker: the marker to roll back to.
+			 *
+			 */
+			void FreeToMarker(StackMarker InMarker);
+
+			/*
+			 * @brief This method releases everything allocated from the arena, the same as
+			 * rolling back to its first marker.
+			 *
+			 */
+			INLINE void Reset() { FreeToMarker(0); }
+
+			/*
+			 * @brief This method returns the committed pages past the top of the arena to the
+			 * operating system. It must not run concurrently with allocations.
+			 *
+			 * @param InKeepBytes: the number of bytes to keep committed past the top, so the
+			 * next allocations don't commit them again.
+			 * @return the number of bytes decommitted.
+			 *
+			 */
+			usize Decommit(usize InKeepBytes = 0);
+
+			/*
+			 * @brief This method returns whether the range was reserved successfully.
+			 *
+			 */
+			INLINE bool IsValid() const { return _base != nullptr; }
+
+			/*
+			 * @brief This method returns whether an address lies in the reserved range.
+			 *
+			 */
+			INLINE bool Contains(const void* InAddress) const
+			{
+				return static_cast<usize>(static_cast<const u8*>(InAddress) - _base) < _reserved;
+			}
+
+			/*
+			 * @brief This method returns how the range is actually backed, after falling back
+			 * to regular pages when huge pages were not available.
+			 *
+			 */
+			INLINE HugePages GetHugePages() const { return _hugePages; }
+
+			/*
+			 * @brief This method returns the size of the reserved range, in bytes.
+			 *
+			 */
+			INLINE usize GetReserved() const { return _reserved; }
+
+			/*
+			 * @brief This method returns the number of bytes currently committed.
+			 *
+			 */
+			INLINE usize GetCommitted() const { return _committed.load(boost::memory_order_relaxed); }
+
+			/*
+			 * @brief This method returns the number of bytes currently allocated.
+			 *
+			 */
+			INLINE usize GetUsed() const { return _used.load(boost::memory_order_relaxed); }
+
+		private:
+			/*
+			 * @brief This method reserves the range of the arena, falling back from huge pages
+			 * to regular pages when they are not available.
+			 *
+			 */
+			void Reserve(usize InReserveSize, HugePages InHugePages);
+
+			/*
+			 * @brief This method commits the pages up to the given offset, rounded up to the
+			 * commit granularity.
+			 *
+			 * @return true if the pages are committed, false otherwise.
+			 *
+			 */
+			bool Commit(usize InEnd);
+
+			u8* _base;
+			u8* _mapping;
+			usize _mappingSize;
+			usize _reserved;
+			usize _granularity;
+			HugePages _hugePages;
+			MemoryTag _tag;
+			bool _tracked;
+
+			boost::atomic<usize> _used;
+			boost::atomic<usize> _committed;
+			boost::atomic_flag _lock;
+		};
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * CPU.cpp
+ *
+ * This source file defines the functions declared in the CPU.hpp
+ * header file.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#include "CPU.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace Re
+{
+	namespace Platform
+	{
+		namespace
+		{
+			void QueryCPUID(u32 InLeaf, u32 InSubleaf, u32 OutRegisters[4])
+			{
+#if defined(_MSC_VER)
+				i32 registers[4];
+				__cpuidex(registers, static_cast<i32>(InLeaf), static_cast<i32>(InSubleaf));
+				for (u32 i = 0; i < 4; ++i)
+					OutRegisters[i] = static_cast<u32>(registers[i]);
+#else
+				__cpuid_count(InLeaf, InSubleaf, OutRegisters[0], OutRegisters[1], OutRegisters[2], OutRegisters[3]);
+#endif
+			}
+
+			u64 QueryXCR0()
+			{
+#if defined(_MSC_VER)
+				return _xgetbv(0);
+#else
+				u32 low, high;
+				__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+				return (static_cast<u64>(high) << 32) | low;
+#endif
+			}
+
+			CPUFeatures DetectCPUFeatures()
+			{
+				CPUFeatures features = {};
+				u32 registers[4];
+
+				QueryCPUID(0, 0, registers);
+				u32 maximumLeaf = registers[0];
+
+				QueryCPUID(1, 0, registers);
+				features.SSE2 = (registers[3] & (1u << 26)) != 0;
+				features.SSE41 = (registers[2] & (1u << 19)) != 0;
+
+				// AVX state must also be saved by the operating system, which is reported in XCR0.
+				bool osxsave = (registers[2] & (1u << 27)) != 0;
+				bool avxState = osxsave && (QueryXCR0() & 0x6) == 0x6;
+				features.AVX = avxState && (registers[2] & (1u << 28)) != 0;
+				features.FMA = features.AVX && (registers[2] & (1u << 12)) != 0;
+
+				if (maximumLeaf >= 7)
+				{
+					QueryCPUID(7, 0, registers);
+					features.AVX2 = features.AVX && (registers[1] & (1u << 5)) != 0;
+				}
+
+				return features;
+			}
+		}
+
+		const CPUFeatures& GetCPUFeatures()
+		{
+			static const CPUFeatures features = DetectCPUFeatures();
+			return features;
+		}
+	}
+}
@@ -0,0 +1,49 @@
+/*
+ * CPU.hpp
+ *
+ * This header file declares the detection of the instruction set extensions
+ * supported by the processor and the operating system, used to dispatch to
+ * the widest available SIMD implementation at runtime.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include "Core/Debug/Assert.hpp"
+
+/* Compiles a single function for AVX2 regardless of the project-wide instruction set. */
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Re
+{
+	namespace Platform
+	{
+		/**
+		 * @brief This structure holds the instruction set extensions that may be used, which
+		 * requires support from both the processor and the operating system.
+		 *
+		 */
+		struct CPUFeatures
+		{
+			bool SSE2;
+			bool SSE41;
+			bool AVX;
+			bool AVX2;
+			bool FMA;
+		};
+
+		/**
+		 * @brief This function queries the processor features once and returns them.
+		 *
+		 * @return a reference to the detected processor features.
+		 *
+		 */
+		const CPUFeatures& GetCPUFeatures();
+	}
+}
@@ -11,12 +11,20 @@
 
 /* Platform Settings */
 #ifndef PLATFORM_WINDOWS
+#if defined(_WIN32)
 #define PLATFORM_WINDOWS 1
+#else
+#define PLATFORM_WINDOWS 0
+#endif
 #endif
 
 #ifndef PLATFORM_LINUX
+#if defined(__linux__)
+#define PLATFORM_LINUX 1
+#else
 #define PLATFORM_LINUX 0
 #endif
+#endif
 
 #ifndef PLATFORM_USE_VULKAN
 #define PLATFORM_USE_VULKAN 1
@@ -26,7 +34,8 @@
 #if PLATFORM_WINDOWS
 #include "Win32/Platform.hpp"
 #elif PLATFORM_LINUX
-// Include Linux Settings
+#include "Linux/Platform.hpp"
+#else
 #error "Unknown Platform..."
 #endif
 
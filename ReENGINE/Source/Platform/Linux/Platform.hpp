@@ -0,0 +1,57 @@
+/*
+ * Platform.hpp
+ *
+ * This header file specifies specific macros, types and functions unique to the
+ * Linux Platform.
+ *
+ * Copyright (c) Giovanni Giacomo. All Rights Reserved.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <typeinfo>
+#include <typeindex>
+
+// Linux specific macro settings.
+
+#define ALIGNOF(x) alignof(x)
+#define FASTCALL
+#define FORCEINLINE inline __attribute__((always_inline))
+#define INLINE inline
+#define MEMCALL
+#define NTEXT(x) x
+#define STDCALL
+#define VECTORCALL
+
+#ifdef _DEBUG
+#define ASSERTIONS
+#endif
+
+// Linux specific macros
+
+#define NSUCCESS 0
+
+/* Linux Specific Atomic Data Types */
+
+namespace Re 
+{
+	typedef uint8_t				u8;
+	typedef uint16_t			u16;
+	typedef uint32_t			u32;
+	typedef uint64_t			u64;
+	typedef size_t				usize;
+	typedef int8_t				i8;
+	typedef int16_t				i16;
+	typedef int32_t				i32;
+	typedef int64_t				i64;
+	typedef intptr_t			isize;
+	typedef float				f32;
+	typedef double				f64;
+	typedef char				utf8;
+	typedef	uint32_t			utf32;
+	typedef unsigned long		NRESULT;
+}
@@ -10,7 +10,7 @@
 
 #pragma once
 
-#include "Memory/DefaultAllocator.hpp"
+#include "Memory/TrackingAllocator.hpp"
 
 namespace Re
 {
@@ -59,8 +59,8 @@ namespace Re
 
 		/**
 		 * @brief This function duplicates a string of characters of UTF-8 encoding.
-		 * It allocates space in memory using the DefaultAllocator, unless
-		 * specified otherwise.
+		 * It allocates space in memory accounted to the Strings tag, which
+		 * must be freed through a TrackingAllocator.
 		 *
 		 * @param str: the UTF-8 string to duplicate.
 		 *
@@ -69,7 +69,7 @@ namespace Re
 		 */
 		extern INLINE utf8* NStrDup(const utf8* str)
 		{
-			Memory::DefaultAllocator alloc;
+			Memory::TrackingAllocator alloc(Memory::MemoryTag::Strings);
 			utf8* result = nullptr;
 			i32 size = NStrBytes(str);
 